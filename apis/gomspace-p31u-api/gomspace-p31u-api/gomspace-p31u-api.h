@@ -144,7 +144,7 @@ typedef struct
  */
 KEPSStatus k_eps_init(KEPSConf config);
 /**
- * Terminate the EPS interface
+ * Terminate the EPS interface, stopping any watchdog kicks
  */
 void k_eps_terminate(void);
 /**
@@ -264,6 +264,17 @@ KEPSStatus k_eps_get_system_config(eps_system_config_t * buff);
  * @return KEPSStatus EPS_OK if OK, error otherwise
  */
 KEPSStatus k_eps_get_battery_config(eps_battery_config_t * buff);
+/**
+ * Get the housekeeping data, system configuration and battery configuration
+ * in a single sweep, without releasing the I2C bus in-between requests
+ * @param [out] hk Pointer to storage for housekeeping data. May be `NULL` if not needed
+ * @param [out] sys_config Pointer to storage for system configuration. May be `NULL` if not needed
+ * @param [out] batt_config Pointer to storage for battery configuration. May be `NULL` if not needed
+ * @return KEPSStatus EPS_OK if all requested data was retrieved, error otherwise.
+ * Structures whose requests succeeded are filled in even if another request failed
+ */
+KEPSStatus k_eps_get_telemetry(eps_hk_t * hk, eps_system_config_t * sys_config,
+                               eps_battery_config_t * batt_config);
 /**
  * Get heaters' statuses
  * @param [out] bp4 Status of BP4 heater. 0 = Off, 1 = On
@@ -277,15 +288,20 @@ KEPSStatus k_eps_get_heater(uint8_t * bp4, uint8_t * onboard);
  */
 KEPSStatus k_eps_watchdog_kick(void);
 /**
- * Start a thread to kick the EPS's watchdog
+ * Start kicking the EPS's watchdog periodically
+ *
+ * The kicks are run by the kubos-hal kick scheduler (see ::KKick), which
+ * shares one thread between every driver.
  * @note The watchdog kick requires a write to EEPROM, which has a limited lifespan.
  * It is recommended that the watchdog interval be very large (ex. 48 **hours**)
- * @param [in] interval Time to sleep in between kicks [seconds]
+ * @param [in] interval Longest time in between kicks [seconds]
  * @return KEPSStatus `EPS_OK` if OK, error otherwise
  */
 KEPSStatus k_eps_watchdog_start(uint32_t interval);
 /**
- * Stop the watchdog thread
+ * Stop kicking the EPS's watchdog
+ *
+ * A kick which is in progress is allowed to finish first.
  * @return KEPSStatus `EPS_OK` if OK, error otherwise
  */
 KEPSStatus k_eps_watchdog_stop(void);
@@ -314,5 +330,12 @@ KEPSStatus k_eps_passthrough(const uint8_t * tx, int tx_len, uint8_t * rx,
  */
 KEPSStatus kprv_eps_transfer(const uint8_t * tx, int tx_len, uint8_t * rx,
                              int rx_len);
+/**
+ * Verify the header of an EPS response
+ * @param [in] tx Pointer to the command packet which was sent
+ * @param [in] rx Pointer to the response which was received
+ * @return KEPSStatus EPS_OK if the response is valid, error otherwise
+ */
+KEPSStatus kprv_eps_check_response(const uint8_t * tx, const uint8_t * rx);
 
 /* @} */
@@ -15,6 +15,9 @@
  */
 
 #include <gomspace-p31u-api.h>
+#include <endian.h>
+#include <kick.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -23,6 +26,160 @@
 static int eps_bus = 0;
 static uint8_t eps_addr = 0;
 
+static void kprv_eps_watchdog_kick(void * arg)
+{
+    k_eps_watchdog_kick();
+}
+
+/* Kicks the watchdog from the shared kick scheduler */
+static KKick eps_kick = {.func = kprv_eps_watchdog_kick };
+
+/*
+ * Wire codec
+ *
+ * The EPS structures are packed, so they go over the wire exactly as they're
+ * laid out in memory, except that multi-byte fields are big-endian. Each
+ * structure's fields are listed once, in wire order, along with the width of a
+ * single element. The list generates the table the codec walks, as well as a
+ * compile-time check that every byte of the structure is accounted for, so a
+ * new field can't be left unconverted.
+ */
+#define EPS_HK_FIELDS(X, T)                                                   \
+    X(T, vboost, 2)                                                           \
+    X(T, vbatt, 2)                                                            \
+    X(T, curin, 2)                                                            \
+    X(T, cursun, 2)                                                           \
+    X(T, cursys, 2)                                                           \
+    X(T, reserved1, 2)                                                        \
+    X(T, curout, 2)                                                           \
+    X(T, output, 1)                                                           \
+    X(T, output_on_delta, 2)                                                  \
+    X(T, output_off_delta, 2)                                                 \
+    X(T, latchup, 2)                                                          \
+    X(T, wdt_i2c_time_left, 4)                                                \
+    X(T, wdt_gnd_time_left, 4)                                                \
+    X(T, wdt_csp_pings_left, 1)                                               \
+    X(T, counter_wdt_i2c, 4)                                                  \
+    X(T, counter_wdt_gnd, 4)                                                  \
+    X(T, counter_wdt_csp, 4)                                                  \
+    X(T, counter_boot, 4)                                                     \
+    X(T, temp, 2)                                                             \
+    X(T, boot_cause, 1)                                                       \
+    X(T, batt_mode, 1)                                                        \
+    X(T, ppt_mode, 1)                                                         \
+    X(T, reserved2, 2)
+
+#define EPS_SYSTEM_CONFIG_FIELDS(X, T)                                        \
+    X(T, ppt_mode, 1)                                                         \
+    X(T, battheater_mode, 1)                                                  \
+    X(T, battheater_low, 1)                                                   \
+    X(T, battheater_high, 1)                                                  \
+    X(T, output_normal_value, 1)                                              \
+    X(T, output_safe_value, 1)                                                \
+    X(T, output_initial_on_delay, 2)                                          \
+    X(T, output_initial_off_delay, 2)                                         \
+    X(T, vboost, 2)
+
+#define EPS_BATTERY_CONFIG_FIELDS(X, T)                                       \
+    X(T, batt_maxvoltage, 2)                                                  \
+    X(T, batt_safevoltage, 2)                                                 \
+    X(T, batt_criticalvoltage, 2)                                             \
+    X(T, batt_normalvoltage, 2)                                               \
+    X(T, reserved1, 4)                                                        \
+    X(T, reserved2, 1)
+
+/* A run of same-width elements within a structure */
+typedef struct
+{
+    uint16_t offset;                        /* Offset of the run from the start of the structure */
+    uint8_t  width;                         /* Size of each element, in bytes */
+    uint8_t  count;                         /* Number of elements */
+} eps_field;
+
+typedef struct
+{
+    size_t            size;                 /* Size of the whole structure */
+    const eps_field * fields;               /* Every field of the structure */
+    int               num_fields;           /* Number of entries in fields */
+} eps_codec;
+
+#define EPS_FIELD_SIZE(type, member) sizeof(((type *) 0)->member)
+
+#define EPS_FIELD(type, member, width)                                        \
+    { offsetof(type, member), width, EPS_FIELD_SIZE(type, member) / width },
+
+#define EPS_FIELD_BYTES(type, member, width) + EPS_FIELD_SIZE(type, member)
+
+#define EPS_CODEC(name, type, FIELDS)                                         \
+    static const eps_field name##_fields[] = { FIELDS(EPS_FIELD, type) };     \
+    _Static_assert(0 FIELDS(EPS_FIELD_BYTES, type) == sizeof(type),           \
+                   "Codec for " #type " is missing fields");                  \
+    static const eps_codec name = {                                           \
+        sizeof(type), name##_fields,                                          \
+        sizeof(name##_fields) / sizeof(name##_fields[0])                      \
+    }
+
+EPS_CODEC(eps_hk_codec, eps_hk_t, EPS_HK_FIELDS);
+EPS_CODEC(eps_system_config_codec, eps_system_config_t, EPS_SYSTEM_CONFIG_FIELDS);
+EPS_CODEC(eps_battery_config_codec, eps_battery_config_t, EPS_BATTERY_CONFIG_FIELDS);
+
+/*
+ * Byte-swap a run of 16-bit elements. This is done bytewise, since packed
+ * fields needn't be aligned, and kept free of branches so that the compiler
+ * can vectorise it
+ */
+static void kprv_eps_swap16(uint8_t * data, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint8_t tmp     = data[2 * i];
+        data[2 * i]     = data[2 * i + 1];
+        data[2 * i + 1] = tmp;
+    }
+}
+
+/* Byte-swap a run of 32-bit elements */
+static void kprv_eps_swap32(uint8_t * data, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint8_t tmp0    = data[4 * i];
+        uint8_t tmp1    = data[4 * i + 1];
+        data[4 * i]     = data[4 * i + 3];
+        data[4 * i + 1] = data[4 * i + 2];
+        data[4 * i + 2] = tmp1;
+        data[4 * i + 3] = tmp0;
+    }
+}
+
+/*
+ * Convert a whole structure between its big-endian wire form and host
+ * endianness. Swapping is its own inverse, so this both decodes responses and
+ * encodes requests
+ */
+static void kprv_eps_convert(void * dest, const void * src,
+                             const eps_codec * codec)
+{
+    memmove(dest, src, codec->size);
+
+#if __BYTE_ORDER != __BIG_ENDIAN
+    for (int i = 0; i < codec->num_fields; i++)
+    {
+        const eps_field * field = &codec->fields[i];
+        uint8_t *         data  = (uint8_t *) dest + field->offset;
+
+        if (field->width == 2)
+        {
+            kprv_eps_swap16(data, field->count);
+        }
+        else if (field->width == 4)
+        {
+            kprv_eps_swap32(data, field->count);
+        }
+    }
+#endif
+}
+
 KEPSStatus k_eps_init(KEPSConf config)
 {
     if (config.bus == NULL || config.addr == 0)
@@ -51,6 +208,9 @@ KEPSStatus k_eps_init(KEPSConf config)
 
 void k_eps_terminate()
 {
+    /* The kick scheduler outlives us, so make sure it stops using the bus */
+    k_kick_unregister(&eps_kick);
+
     k_i2c_terminate(&eps_bus);
 
     eps_bus = 0;
@@ -65,20 +225,13 @@ KEPSStatus k_eps_ping()
     uint8_t    cmd  = PING;
     uint8_t    resp = 0;
 
-    status = k_i2c_write(eps_bus, eps_addr, &cmd, 1);
+    status = k_i2c_transfer(eps_bus, eps_addr, &cmd, 1, &resp, 1);
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to send EPS ping: %d\n", status);
         return EPS_ERROR;
     }
 
-    status = k_i2c_read(eps_bus, eps_addr, &resp, 1);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to get EPS ping response: %d\n", status);
-        return EPS_ERROR;
-    }
-
     if (resp != cmd)
     {
         fprintf(stderr, "Unexpected EPS ping response: %#x vs %#x\n", cmd,
@@ -138,29 +291,7 @@ KEPSStatus k_eps_configure_system(const eps_system_config_t * config)
 
     packet.cmd = SET_CONFIG1;
 
-    packet.sys_config.ppt_mode = config->ppt_mode;
-    packet.sys_config.battheater_mode = config->battheater_mode;
-    packet.sys_config.battheater_low = config->battheater_low;
-    packet.sys_config.battheater_high = config->battheater_high;
-    for (int i = 0; i < 8; i++)
-    {
-        packet.sys_config.output_normal_value[i] = config->output_normal_value[i];
-    }
-    for (int i = 0; i < 8; i++)
-    {
-        packet.sys_config.output_safe_value[i] = config->output_safe_value[i];
-    }
-    for (int i = 0; i < 8; i++)
-    {
-        packet.sys_config.output_initial_on_delay[i] = htobe16(config->output_initial_on_delay[i]);
-    }
-    for (int i = 0; i < 8; i++)
-    {
-        packet.sys_config.output_initial_off_delay[i] = htobe16(config->output_initial_off_delay[i]);
-    }
-    packet.sys_config.vboost[0] = htobe16(config->vboost[0]);
-    packet.sys_config.vboost[1] = htobe16(config->vboost[1]);
-    packet.sys_config.vboost[2] = htobe16(config->vboost[2]);
+    kprv_eps_convert(&packet.sys_config, config, &eps_system_config_codec);
 
     status = kprv_eps_transfer((uint8_t *) &packet, sizeof(packet), (uint8_t *) &response,
                                sizeof(response));
@@ -191,10 +322,11 @@ KEPSStatus k_eps_configure_battery(const eps_battery_config_t * config)
     }
 
     packet.cmd = SET_CONFIG2;
-    packet.batt_config.batt_maxvoltage = htobe16(config->batt_maxvoltage);
-    packet.batt_config.batt_safevoltage = htobe16(config->batt_safevoltage);
-    packet.batt_config.batt_criticalvoltage = htobe16(config->batt_criticalvoltage);
-    packet.batt_config.batt_normalvoltage = htobe16(config->batt_normalvoltage);
+    kprv_eps_convert(&packet.batt_config, config, &eps_battery_config_codec);
+
+    /* Callers only fill in the documented fields, so never send the rest */
+    memset(packet.batt_config.reserved1, 0, sizeof(packet.batt_config.reserved1));
+    memset(packet.batt_config.reserved2, 0, sizeof(packet.batt_config.reserved2));
 
     status = kprv_eps_transfer((uint8_t *) &packet, sizeof(packet), (uint8_t *) &response,
                                sizeof(response));
@@ -438,52 +570,7 @@ KEPSStatus k_eps_get_housekeeping(eps_hk_t * buff)
 
     eps_hk_t * body = (eps_hk_t *) (response + sizeof(eps_resp_header));
 
-    /* Convert big endian to host endianness for multi-byte fields */
-    buff->vboost[0] = be16toh(body->vboost[0]);
-    buff->vboost[1] = be16toh(body->vboost[1]);
-    buff->vboost[2] = be16toh(body->vboost[2]);
-    buff->vbatt = be16toh(body->vbatt);
-    buff->curin[0] = be16toh(body->curin[0]);
-    buff->curin[1] = be16toh(body->curin[1]);
-    buff->curin[2] = be16toh(body->curin[2]);
-    buff->cursun = be16toh(body->cursun);
-    buff->cursys = be16toh(body->cursys);
-    for (int i = 0; i < 6; i++)
-    {
-        buff->curout[i] = be16toh(body->curout[i]);
-    }
-    for (int i = 0; i < 8; i++)
-    {
-        buff->output[i] = body->output[i];
-    }
-    for (int i = 0; i < 8; i++)
-    {
-        buff->output_on_delta[i] = be16toh(body->output_on_delta[i]);
-    }
-    for (int i = 0; i < 8; i++)
-    {
-        buff->output_off_delta[i] = be16toh(body->output_off_delta[i]);
-    }
-    for (int i = 0; i < 6; i++)
-    {
-        buff->latchup[i] = be16toh(body->latchup[i]);
-    }
-    buff->wdt_i2c_time_left = be32toh(body->wdt_i2c_time_left);
-    buff->wdt_gnd_time_left = be32toh(body->wdt_gnd_time_left);
-    buff->wdt_csp_pings_left[0] = body->wdt_csp_pings_left[0];
-    buff->wdt_csp_pings_left[1] = body->wdt_csp_pings_left[1];
-    buff->counter_wdt_i2c = be32toh(body->counter_wdt_i2c);
-    buff->counter_wdt_gnd = be32toh(body->counter_wdt_gnd);
-    buff->counter_wdt_csp[0] = be32toh(body->counter_wdt_csp[0]);
-    buff->counter_wdt_csp[1] = be32toh(body->counter_wdt_csp[1]);
-    buff->counter_boot = be32toh(body->counter_boot);
-    for (int i = 0; i < 6; i++)
-    {
-        buff->temp[i] = be16toh(body->temp[i]);
-    }
-    buff->boot_cause = body->boot_cause;
-    buff->batt_mode = body->batt_mode;
-    buff->ppt_mode = body->ppt_mode;
+    kprv_eps_convert(buff, body, &eps_hk_codec);
 
     return EPS_OK;
 }
@@ -508,29 +595,7 @@ KEPSStatus k_eps_get_system_config(eps_system_config_t * buff)
 
     eps_system_config_t * body = (eps_system_config_t *) (response + sizeof(eps_resp_header));
 
-    buff->ppt_mode = body->ppt_mode;
-    buff->battheater_mode = body->battheater_mode;
-    buff->battheater_low = body->battheater_low;
-    buff->battheater_high = body->battheater_high;
-    for (int i = 0; i < 8; i++)
-    {
-        buff->output_normal_value[i] = body->output_normal_value[i];
-    }
-    for (int i = 0; i < 8; i++)
-    {
-        buff->output_safe_value[i] = body->output_safe_value[i];
-    }
-    for (int i = 0; i < 8; i++)
-    {
-        buff->output_initial_on_delay[i] = be16toh(body->output_initial_on_delay[i]);
-    }
-    for (int i = 0; i < 8; i++)
-    {
-        buff->output_initial_off_delay[i] = be16toh(body->output_initial_off_delay[i]);
-    }
-    buff->vboost[0] = be16toh(body->vboost[0]);
-    buff->vboost[1] = be16toh(body->vboost[1]);
-    buff->vboost[2] = be16toh(body->vboost[2]);
+    kprv_eps_convert(buff, body, &eps_system_config_codec);
 
     return EPS_OK;
 }
@@ -555,14 +620,105 @@ KEPSStatus k_eps_get_battery_config(eps_battery_config_t * buff)
 
     eps_battery_config_t * body = (eps_battery_config_t *) (response + sizeof(eps_resp_header));
 
-    buff->batt_maxvoltage = be16toh(body->batt_maxvoltage);
-    buff->batt_safevoltage = be16toh(body->batt_safevoltage);
-    buff->batt_criticalvoltage = be16toh(body->batt_criticalvoltage);
-    buff->batt_normalvoltage = be16toh(body->batt_normalvoltage);
+    kprv_eps_convert(buff, body, &eps_battery_config_codec);
 
     return EPS_OK;
 }
 
+KEPSStatus k_eps_get_telemetry(eps_hk_t * hk, eps_system_config_t * sys_config,
+                               eps_battery_config_t * batt_config)
+{
+    KEPSStatus   status = EPS_OK;
+    KI2CBatchMsg msgs[3];
+    int          count  = 0;
+
+    uint8_t hk_cmd[]   = { GET_HOUSEKEEPING, 0 };
+    uint8_t sys_cmd    = GET_CONFIG1;
+    uint8_t batt_cmd   = GET_CONFIG2;
+    uint8_t hk_resp[sizeof(eps_resp_header) + sizeof(eps_hk_t)] = { 0 };
+    uint8_t sys_resp[sizeof(eps_resp_header) + sizeof(eps_system_config_t)] = { 0 };
+    uint8_t batt_resp[sizeof(eps_resp_header) + sizeof(eps_battery_config_t)] = { 0 };
+
+    if (hk == NULL && sys_config == NULL && batt_config == NULL)
+    {
+        return EPS_ERROR_CONFIG;
+    }
+
+    /* Only request the structures the caller asked for */
+    if (hk != NULL)
+    {
+        msgs[count++] = (KI2CBatchMsg) {
+            .addr = eps_addr, .tx = hk_cmd, .tx_len = sizeof(hk_cmd),
+            .rx = hk_resp, .rx_len = sizeof(hk_resp)
+        };
+    }
+    if (sys_config != NULL)
+    {
+        msgs[count++] = (KI2CBatchMsg) {
+            .addr = eps_addr, .tx = &sys_cmd, .tx_len = 1,
+            .rx = sys_resp, .rx_len = sizeof(sys_resp)
+        };
+    }
+    if (batt_config != NULL)
+    {
+        msgs[count++] = (KI2CBatchMsg) {
+            .addr = eps_addr, .tx = &batt_cmd, .tx_len = 1,
+            .rx = batt_resp, .rx_len = sizeof(batt_resp)
+        };
+    }
+
+    /* Fetch everything while holding the bus */
+    k_i2c_batch(eps_bus, msgs, count);
+
+    for (int i = 0; i < count; i++)
+    {
+        KEPSStatus msg_status = EPS_ERROR;
+
+        if (msgs[i].status == I2C_OK)
+        {
+            msg_status = kprv_eps_check_response(msgs[i].tx, msgs[i].rx);
+        }
+        else
+        {
+            fprintf(stderr, "Failed to transfer EPS command (%x): %d\n",
+                    msgs[i].tx[0], msgs[i].status);
+        }
+
+        if (msg_status != EPS_OK)
+        {
+            /* Report the first failure, but keep converting the rest */
+            if (status == EPS_OK)
+            {
+                status = msg_status;
+            }
+            continue;
+        }
+
+        if (msgs[i].rx == hk_resp)
+        {
+            kprv_eps_convert(hk, hk_resp + sizeof(eps_resp_header),
+                             &eps_hk_codec);
+        }
+        else if (msgs[i].rx == sys_resp)
+        {
+            kprv_eps_convert(sys_config, sys_resp + sizeof(eps_resp_header),
+                             &eps_system_config_codec);
+        }
+        else
+        {
+            kprv_eps_convert(batt_config, batt_resp + sizeof(eps_resp_header),
+                             &eps_battery_config_codec);
+        }
+    }
+
+    if (status != EPS_OK)
+    {
+        fprintf(stderr, "Failed to get EPS telemetry: %d\n", status);
+    }
+
+    return status;
+}
+
 KEPSStatus k_eps_get_heater(uint8_t * bp4, uint8_t * onboard)
 {
     KEPSStatus status;
@@ -610,23 +766,6 @@ KEPSStatus k_eps_watchdog_kick()
     return EPS_OK;
 }
 
-pthread_t handle_watchdog = { 0 };
-uint32_t watchdog_interval = 0;
-
-void * kprv_eps_watchdog_thread(void * args)
-{
-    KEPSStatus status;
-
-    while (1)
-    {
-        k_eps_watchdog_kick();
-
-        sleep(watchdog_interval);
-    }
-
-    return NULL;
-}
-
 KEPSStatus k_eps_watchdog_start(uint32_t interval)
 {
     if (interval == 0)
@@ -634,19 +773,17 @@ KEPSStatus k_eps_watchdog_start(uint32_t interval)
         return EPS_ERROR_CONFIG;
     }
 
-    if (handle_watchdog != 0)
+    if (k_kick_is_registered(&eps_kick))
     {
-        fprintf(stderr, "EPS watchdog thread already started\n");
+        fprintf(stderr, "EPS watchdog kicks already started\n");
         return EPS_OK;
     }
 
-    watchdog_interval = interval;
+    eps_kick.period = (struct timespec) {.tv_sec = interval, .tv_nsec = 0 };
 
-    if (pthread_create(&handle_watchdog, NULL, kprv_eps_watchdog_thread, NULL)
-        != 0)
+    if (!k_kick_register(&eps_kick))
     {
-        perror("Failed to create EPS watchdog thread");
-        handle_watchdog = 0;
+        fprintf(stderr, "Failed to schedule EPS watchdog kicks\n");
         return EPS_ERROR;
     }
 
@@ -655,30 +792,13 @@ KEPSStatus k_eps_watchdog_start(uint32_t interval)
 
 KEPSStatus k_eps_watchdog_stop()
 {
-    /* Check if watchdog thread has been started */
-    if (handle_watchdog == 0)
+    /* Waits for a kick in progress, rather than interrupting it */
+    if (!k_kick_unregister(&eps_kick))
     {
-        perror("EPS watchdog thread has not been started\n");
+        fprintf(stderr, "EPS watchdog kicks have not been started\n");
         return EPS_ERROR;
     }
 
-    /* Send the cancel request */
-    if (pthread_cancel(handle_watchdog) != 0)
-    {
-        perror("Failed to cancel EPS watchdog thread");
-        return EPS_ERROR;
-    }
-
-    /* Wait for the cancellation to complete */
-    if (pthread_join(handle_watchdog, NULL) != 0)
-    {
-        perror("Failed to rejoin EPS watchdog thread");
-        return EPS_ERROR;
-    }
-
-    handle_watchdog = 0;
-    watchdog_interval = 0;
-
     return EPS_OK;
 }
 
@@ -712,22 +832,24 @@ KEPSStatus kprv_eps_transfer(const uint8_t * tx, int tx_len, uint8_t * rx,
         return EPS_ERROR_CONFIG;
     }
 
-    status = k_i2c_write(eps_bus, eps_addr, (uint8_t *) tx, tx_len);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to send EPS command: %d\n", status);
-        return EPS_ERROR;
-    }
-
-    status = k_i2c_read(eps_bus, eps_addr, rx, rx_len);
-
+    /*
+     * The EPS responds immediately, so the command and the response read can
+     * be issued back-to-back with a repeated start
+     */
+    status = k_i2c_transfer(eps_bus, eps_addr, (uint8_t *) tx, tx_len, rx,
+                            rx_len);
     if (status != I2C_OK)
     {
-        fprintf(stderr, "Failed to read EPS response (%x): %d\n", tx[0],
+        fprintf(stderr, "Failed to transfer EPS command (%x): %d\n", tx[0],
                 status);
         return EPS_ERROR;
     }
 
+    return kprv_eps_check_response(tx, rx);
+}
+
+KEPSStatus kprv_eps_check_response(const uint8_t * tx, const uint8_t * rx)
+{
     eps_resp_header response = { .cmd = rx[0], .status = rx[1] };
 
     if (response.cmd != tx[0])
@@ -262,6 +262,63 @@ static void test_configure_battery(void ** arg)
     assert_int_equal(ret, EPS_OK);
 }
 
+static void test_configure_system_packet(void ** arg)
+{
+    KEPSStatus ret;
+
+    /* Exact bytes of the SET_CONFIG1 command for sys_config_le */
+    uint8_t test_packet[] = {
+        SET_CONFIG1,
+        1, 0, 0x92, 1,
+        1, 0, 1, 0, 1, 0, 1, 0,
+        0, 1, 0, 1, 0, 1, 0, 1,
+        0, 1, 0, 2, 0, 3, 0, 4, 0, 5, 0, 6, 0, 7, 0, 8,
+        0, 21, 0, 22, 0, 23, 0, 24, 0, 25, 0, 26, 0, 27, 0, 28,
+        0x0E, 0x10, 0x0E, 0x10, 0x0E, 0x10
+    };
+
+    assert_int_equal(sizeof(test_packet), sizeof(eps_system_config_t) + 1);
+
+    expect_value(__wrap_write, cmd, SET_CONFIG1);
+    expect_memory(__wrap_write, buf, test_packet, sizeof(test_packet));
+    expect_value(__wrap_read, len, sizeof(eps_resp_header));
+    will_return(__wrap_read, &response);
+
+    ret = k_eps_configure_system(&sys_config_le);
+
+    assert_int_equal(ret, EPS_OK);
+}
+
+static void test_configure_battery_packet(void ** arg)
+{
+    KEPSStatus ret;
+
+    eps_battery_config_t config = batt_config_le;
+
+    /* Exact bytes of the SET_CONFIG2 command. Reserved bytes are always zero */
+    uint8_t test_packet[] = {
+        SET_CONFIG2,
+        0x20, 0x08, 0x1B, 0xBC, 0x19, 0x00, 0x1C, 0x84,
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0
+    };
+
+    assert_int_equal(sizeof(test_packet), sizeof(eps_battery_config_t) + 1);
+
+    config.reserved1[0] = 0xFFFFFFFF;
+    config.reserved1[1] = 0x12345678;
+    memset(config.reserved2, 0xA5, sizeof(config.reserved2));
+
+    expect_value(__wrap_write, cmd, SET_CONFIG2);
+    expect_memory(__wrap_write, buf, test_packet, sizeof(test_packet));
+    expect_value(__wrap_read, len, sizeof(eps_resp_header));
+    will_return(__wrap_read, &response);
+
+    ret = k_eps_configure_battery(&config);
+
+    assert_int_equal(ret, EPS_OK);
+}
+
 static void test_save_battery_config(void ** arg)
 {
     KEPSStatus ret;
@@ -492,6 +549,47 @@ static void test_get_battery_config(void ** arg)
     assert_memory_equal(&config, &batt_config_le, sizeof(eps_battery_config_t));
 }
 
+static void test_get_telemetry_null(void ** arg)
+{
+    assert_int_equal(k_eps_get_telemetry(NULL, NULL, NULL), EPS_ERROR_CONFIG);
+}
+
+static void test_get_telemetry(void ** arg)
+{
+    KEPSStatus ret;
+
+    eps_hk_t             hk          = { 0 };
+    eps_system_config_t  sys_config  = { 0 };
+    eps_battery_config_t batt_config = { 0 };
+
+    uint8_t hk_response[sizeof(eps_hk_t) + sizeof(eps_resp_header)] = { 0 };
+    uint8_t sys_response[sizeof(eps_system_config_t) + sizeof(eps_resp_header)] = { 0 };
+    uint8_t batt_response[sizeof(eps_battery_config_t) + sizeof(eps_resp_header)] = { 0 };
+
+    memcpy(hk_response + sizeof(eps_resp_header), &hk_be, sizeof(eps_hk_t));
+    memcpy(sys_response + sizeof(eps_resp_header), &sys_config_be, sizeof(eps_system_config_t));
+    memcpy(batt_response + sizeof(eps_resp_header), &batt_config_be, sizeof(eps_battery_config_t));
+
+    expect_value(__wrap_write, cmd, GET_HOUSEKEEPING);
+    expect_value(__wrap_read, len, sizeof(hk_response));
+    will_return(__wrap_read, hk_response);
+
+    expect_value(__wrap_write, cmd, GET_CONFIG1);
+    expect_value(__wrap_read, len, sizeof(sys_response));
+    will_return(__wrap_read, sys_response);
+
+    expect_value(__wrap_write, cmd, GET_CONFIG2);
+    expect_value(__wrap_read, len, sizeof(batt_response));
+    will_return(__wrap_read, batt_response);
+
+    ret = k_eps_get_telemetry(&hk, &sys_config, &batt_config);
+
+    assert_int_equal(ret, EPS_OK);
+    assert_memory_equal(&hk, &hk_le, sizeof(eps_hk_t));
+    assert_memory_equal(&sys_config, &sys_config_le, sizeof(eps_system_config_t));
+    assert_memory_equal(&batt_config, &batt_config_le, sizeof(eps_battery_config_t));
+}
+
 static void test_get_heater_null_null(void ** arg)
 {
     assert_int_equal(k_eps_get_heater(NULL, NULL), EPS_ERROR_CONFIG);
@@ -614,6 +712,24 @@ static void test_watchdog_thread_twice(void ** arg)
     assert_int_equal(stop_ret, EPS_OK);
 }
 
+static void test_watchdog_terminate(void ** arg)
+{
+    KEPSStatus start_ret;
+
+    expect_value(__wrap_write, cmd, RESET_WDT);
+    expect_value(__wrap_read, len, sizeof(eps_resp_header));
+    will_return(__wrap_read, &response);
+
+    start_ret = k_eps_watchdog_start(1);
+
+    /* Terminating stops the kicks, since the bus is about to be closed */
+    will_return(__wrap_close, 0);
+    k_eps_terminate();
+
+    assert_int_equal(start_ret, EPS_OK);
+    assert_int_equal(k_eps_watchdog_stop(), EPS_ERROR);
+}
+
 static void test_watchdog_stop_no_start(void ** arg)
 {
     KEPSStatus ret;
@@ -810,6 +926,8 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_configure_system, init, term),
         cmocka_unit_test_setup_teardown(test_configure_battery_null, init, term),
         cmocka_unit_test_setup_teardown(test_configure_battery, init, term),
+        cmocka_unit_test_setup_teardown(test_configure_system_packet, init, term),
+        cmocka_unit_test_setup_teardown(test_configure_battery_packet, init, term),
         cmocka_unit_test_setup_teardown(test_save_battery_config, init, term),
         cmocka_unit_test_setup_teardown(test_reset_system_config, init, term),
         cmocka_unit_test_setup_teardown(test_reset_battery_config, init, term),
@@ -832,6 +950,8 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_get_system_config, init, term),
         cmocka_unit_test_setup_teardown(test_get_battery_config_null, init, term),
         cmocka_unit_test_setup_teardown(test_get_battery_config, init, term),
+        cmocka_unit_test_setup_teardown(test_get_telemetry_null, init, term),
+        cmocka_unit_test_setup_teardown(test_get_telemetry, init, term),
         cmocka_unit_test_setup_teardown(test_get_heater_null_null, init, term),
         cmocka_unit_test_setup_teardown(test_get_heater_null_bp4_good_onboard, init, term),
         cmocka_unit_test_setup_teardown(test_get_heater_good_bp4_null_onboard, init, term),
@@ -839,6 +959,7 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_watchdog_kick, init, term),
         cmocka_unit_test_setup_teardown(test_watchdog_thread, init, term),
         cmocka_unit_test_setup_teardown(test_watchdog_thread_twice, init, term),
+        cmocka_unit_test_setup(test_watchdog_terminate, init),
         cmocka_unit_test_setup_teardown(test_watchdog_stop_no_start, init, term),
         cmocka_unit_test_setup_teardown(test_passthrough_null_tx, init, term),
         cmocka_unit_test_setup_teardown(test_passthrough_zero_tx_len, init, term),
@@ -17,6 +17,8 @@
 #include <gomspace-p31u-api.h>
 #include <cmocka.h>
 #include <errno.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
 #include <unistd.h>
 
 uint8_t  last_cmd;
@@ -37,8 +39,39 @@ int __wrap_close(int fd)
 /*
  * Returns 0 on success (or occasionally a positive value) and -1 on failure
  */
+ssize_t __wrap_write(int fd, const char * buf, size_t count);
+ssize_t __wrap_read(int fd, char * buf, size_t count);
+
 int __wrap_ioctl(int fd, unsigned long request, long addr, ...)
 {
+    if (request == I2C_RDWR)
+    {
+        /* Combined transfer: run each message through the read/write mocks */
+        struct i2c_rdwr_ioctl_data * data = (struct i2c_rdwr_ioctl_data *) addr;
+
+        for (int i = 0; i < (int) data->nmsgs; i++)
+        {
+            struct i2c_msg * msg = &data->msgs[i];
+
+            if (msg->addr != 0x02)
+            {
+                fprintf(stderr, "I2C slave address is wrong!\n");
+                return -1;
+            }
+
+            if (msg->flags & I2C_M_RD)
+            {
+                __wrap_read(fd, (char *) msg->buf, msg->len);
+            }
+            else
+            {
+                __wrap_write(fd, (const char *) msg->buf, msg->len);
+            }
+        }
+
+        return (int) data->nmsgs;
+    }
+
     /*
      * This shouldn't ever actually fail, it's just a convenient place to check that
      * we're still sending to the correct slave address
@@ -24,6 +24,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <i2c.h>
+#include <pacing.h>
 
 /** \cond WE DO NOT WANT TO HAVE THESE IN OUR GENERATED DOCS */
 /* AntS command values */
@@ -133,9 +134,21 @@ typedef struct
  */
 KANTSStatus k_ants_init(char * bus, uint8_t primary, uint8_t secondary, uint8_t ant_count, uint32_t timeout);
 /**
- * Terminate the antenna interface
+ * Terminate the antenna interface, stopping any watchdog kicks
  */
 void k_ants_terminate(void);
+/**
+ * Get the minimum time enforced between consecutive AntS transactions
+ * @param [out] gap Storage for the current minimum gap
+ */
+void k_ants_get_transfer_gap(struct timespec * gap);
+/**
+ * Change the minimum time enforced between consecutive AntS transactions
+ * @note The default is just over 1ms. Only the time which hasn't already passed since the
+ * previous transaction is slept.
+ * @param [in] gap New minimum gap
+ */
+void k_ants_set_transfer_gap(const struct timespec * gap);
 /**
  * Configure the antenna
  * @param [in] config Microntroller to use for system commanding
@@ -217,13 +230,17 @@ KANTSStatus k_ants_get_activation_time(KANTSAnt antenna, uint16_t * time);
  */
 KANTSStatus k_ants_watchdog_kick(void);
 /**
- * Start a thread to kick the AntS's watchdogs at an interval of
- * (timeout/3) seconds
+ * Start kicking the AntS's watchdogs at an interval of (timeout/3) seconds
+ *
+ * The kicks are run by the kubos-hal kick scheduler (see ::KKick), which
+ * shares one thread between every driver.
  * @return KANTSStatus `ANTS_OK` if OK, error otherwise
  */
 KANTSStatus k_ants_watchdog_start(void);
 /**
- * Stop the watchdog thread
+ * Stop kicking the AntS's watchdogs
+ *
+ * A kick which is in progress is allowed to finish first.
  * @return KANTSStatus `ANTS_OK` if OK, error otherwise
  */
 KANTSStatus k_ants_watchdog_stop(void);
@@ -16,6 +16,8 @@
 
 #include <ants-api.h>
 #include <i2c.h>
+#include <kick.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <time.h>
 #include <unistd.h>
@@ -27,8 +29,13 @@ static uint8_t ants_addr = 0; /* Address of the antenna microcontroller commands
 static uint8_t ant_count = 0;
 static uint8_t ants_wd_timeout = 0;
 
-/* Handle for watchdog thread */
-static pthread_t handle_watchdog = { 0 };
+static void kprv_ants_watchdog_kick(void * arg)
+{
+    k_ants_watchdog_kick();
+}
+
+/* Kicks the watchdogs from the shared kick scheduler */
+static KKick ants_kick = {.func = kprv_ants_watchdog_kick };
 
 /*
  * The system can lock up if you make too many calls too quickly,
@@ -36,6 +43,29 @@ static pthread_t handle_watchdog = { 0 };
  */
 const struct timespec TRANSFER_DELAY = {.tv_sec = 0, .tv_nsec = 1000001 };
 
+/* Enforces TRANSFER_DELAY between consecutive transactions */
+static KPacer ants_pacer;
+
+/*
+ * Serializes transactions, since watchdog kicks come from the shared kick
+ * thread while other calls come from the caller's. Pacers don't lock
+ */
+static pthread_mutex_t ants_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Wait out the transfer gap, and keep the device until kprv_ants_end */
+static void kprv_ants_begin(void)
+{
+    pthread_mutex_lock(&ants_mutex);
+    k_pacer_wait(&ants_pacer);
+}
+
+/* Record the end of a transaction, and let the next one start */
+static void kprv_ants_end(void)
+{
+    k_pacer_mark(&ants_pacer);
+    pthread_mutex_unlock(&ants_mutex);
+}
+
 KANTSStatus k_ants_init(char * bus, uint8_t primary, uint8_t secondary, uint8_t count, uint32_t timeout)
 {
     /* Save internal configuration values */
@@ -55,11 +85,32 @@ KANTSStatus k_ants_init(char * bus, uint8_t primary, uint8_t secondary, uint8_t
     /* Set default I2C slave address */
     ants_addr = ants_primary;
 
+    pthread_mutex_lock(&ants_mutex);
+    k_pacer_init(&ants_pacer, &TRANSFER_DELAY);
+    pthread_mutex_unlock(&ants_mutex);
+
     return ANTS_OK;
 }
 
+void k_ants_get_transfer_gap(struct timespec * gap)
+{
+    pthread_mutex_lock(&ants_mutex);
+    k_pacer_get_gap(&ants_pacer, gap);
+    pthread_mutex_unlock(&ants_mutex);
+}
+
+void k_ants_set_transfer_gap(const struct timespec * gap)
+{
+    pthread_mutex_lock(&ants_mutex);
+    k_pacer_set_gap(&ants_pacer, gap);
+    pthread_mutex_unlock(&ants_mutex);
+}
+
 void k_ants_terminate()
 {
+    /* The kick scheduler outlives us, so make sure it stops using the bus */
+    k_kick_unregister(&ants_kick);
+
     ants_addr = 0;
     k_i2c_terminate(&ants_bus);
 
@@ -92,8 +143,6 @@ KANTSStatus k_ants_configure(KANTSController config)
         return ANTS_ERROR_CONFIG;
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
-
     return status;
 }
 
@@ -103,6 +152,8 @@ KANTSStatus k_ants_reset()
     KI2CStatus  status;
     uint8_t     cmd = SYSTEM_RESET;
 
+    kprv_ants_begin();
+
     status = k_i2c_write(ants_bus, ants_primary, (uint8_t *) &cmd, 1);
     if (status != I2C_OK)
     {
@@ -122,7 +173,7 @@ KANTSStatus k_ants_reset()
         }
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
+    kprv_ants_end();
 
     return ret;
 }
@@ -132,15 +183,16 @@ KANTSStatus k_ants_arm()
     KI2CStatus status;
     uint8_t    cmd = ARM_ANTS;
 
+    kprv_ants_begin();
     status = k_i2c_write(ants_bus, ants_addr, (uint8_t *) &cmd, 1);
+    kprv_ants_end();
+
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to arm AntS: %d\n", status);
         return ANTS_ERROR;
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
-
     return ANTS_OK;
 }
 
@@ -149,15 +201,16 @@ KANTSStatus k_ants_disarm()
     KI2CStatus status;
     uint8_t    cmd = DISARM_ANTS;
 
+    kprv_ants_begin();
     status = k_i2c_write(ants_bus, ants_addr, (uint8_t *) &cmd, 1);
+    kprv_ants_end();
+
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to disarm AntS: %d\n", status);
         return ANTS_ERROR;
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
-
     return ANTS_OK;
 }
 
@@ -220,7 +273,10 @@ KANTSStatus k_ants_deploy(KANTSAnt antenna, bool override, uint8_t timeout)
             return ANTS_ERROR_CONFIG;
     }
 
+    kprv_ants_begin();
     status = k_i2c_write(ants_bus, ants_addr, packet, sizeof(packet));
+    kprv_ants_end();
+
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to deploy antenna %d: %d\n", (antenna + 1),
@@ -228,8 +284,6 @@ KANTSStatus k_ants_deploy(KANTSAnt antenna, bool override, uint8_t timeout)
         return ANTS_ERROR;
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
-
     return ANTS_OK;
 }
 
@@ -241,15 +295,16 @@ KANTSStatus k_ants_auto_deploy(uint8_t timeout)
     packet[0] = AUTO_DEPLOY;
     packet[1] = timeout;
 
+    kprv_ants_begin();
     status = k_i2c_write(ants_bus, ants_addr, packet, sizeof(packet));
+    kprv_ants_end();
+
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to auto-deploy AntS: %d\n", status);
         return ANTS_ERROR;
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
-
     return ANTS_OK;
 }
 
@@ -258,15 +313,16 @@ KANTSStatus k_ants_cancel_deploy()
     KI2CStatus status;
     uint8_t    cmd = CANCEL_DEPLOY;
 
+    kprv_ants_begin();
     status = k_i2c_write(ants_bus, ants_addr, (uint8_t *) &cmd, 1);
+    kprv_ants_end();
+
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to cancel AntS deployment: %d\n", status);
         return ANTS_ERROR;
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
-
     return ANTS_OK;
 }
 
@@ -280,23 +336,18 @@ KANTSStatus k_ants_get_deploy_status(uint16_t * resp)
     KI2CStatus status;
     uint8_t    cmd = GET_STATUS;
 
-    status = k_i2c_write(ants_bus, ants_addr, (uint8_t *) &cmd, 1);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to request AntS deployment status: %d\n",
-                status);
-        return ANTS_ERROR;
-    }
+    kprv_ants_begin();
+    status = k_i2c_transfer(ants_bus, ants_addr, (uint8_t *) &cmd, 1,
+                            (uint8_t *) resp, 2);
+    kprv_ants_end();
 
-    status = k_i2c_read(ants_bus, ants_addr, (uint8_t *) resp, 2);
     if (status != I2C_OK)
     {
-        fprintf(stderr, "Failed to read AntS deployment status: %d\n", status);
+        fprintf(stderr, "Failed to fetch AntS deployment status: %d\n",
+                status);
         return ANTS_ERROR;
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
-
     return ANTS_OK;
 }
 
@@ -310,22 +361,17 @@ KANTSStatus k_ants_get_uptime(uint32_t * uptime)
     KI2CStatus status;
     uint8_t    cmd = GET_UPTIME_SYS;
 
-    status = k_i2c_write(ants_bus, ants_addr, (uint8_t *) &cmd, 1);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to request AntS uptime: %d\n", status);
-        return ANTS_ERROR;
-    }
+    kprv_ants_begin();
+    status = k_i2c_transfer(ants_bus, ants_addr, (uint8_t *) &cmd, 1,
+                            (uint8_t *) uptime, 4);
+    kprv_ants_end();
 
-    status = k_i2c_read(ants_bus, ants_addr, (uint8_t *) uptime, 4);
     if (status != I2C_OK)
     {
-        fprintf(stderr, "Failed to read AntS uptime: %d\n", status);
+        fprintf(stderr, "Failed to fetch AntS uptime: %d\n", status);
         return ANTS_ERROR;
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
-
     return ANTS_OK;
 }
 
@@ -339,23 +385,17 @@ KANTSStatus k_ants_get_system_telemetry(ants_telemetry * telem)
     KI2CStatus status;
     uint8_t    cmd = GET_TELEMETRY;
 
-    status = k_i2c_write(ants_bus, ants_addr, (uint8_t *) &cmd, 1);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to request AntS telemetry: %d\n", status);
-        return ANTS_ERROR;
-    }
+    kprv_ants_begin();
+    status = k_i2c_transfer(ants_bus, ants_addr, (uint8_t *) &cmd, 1,
+                            (uint8_t *) telem, sizeof(ants_telemetry));
+    kprv_ants_end();
 
-    status = k_i2c_read(ants_bus, ants_addr, (uint8_t *) telem,
-                        sizeof(ants_telemetry));
     if (status != I2C_OK)
     {
-        fprintf(stderr, "Failed to read AntS telemetry: %d\n", status);
+        fprintf(stderr, "Failed to fetch AntS telemetry: %d\n", status);
         return ANTS_ERROR;
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
-
     return ANTS_OK;
 }
 
@@ -371,24 +411,18 @@ KANTSStatus k_ants_get_activation_count(KANTSAnt antenna, uint8_t * count)
     KI2CStatus status;
     uint8_t    cmd = GET_COUNT_1 + antenna;
 
-    status = k_i2c_write(ants_bus, ants_addr, (uint8_t *) &cmd, 1);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to request antenna %d activation count: %d\n",
-                (antenna + 1), status);
-        return ANTS_ERROR;
-    }
+    kprv_ants_begin();
+    status = k_i2c_transfer(ants_bus, ants_addr, (uint8_t *) &cmd, 1,
+                            count, 1);
+    kprv_ants_end();
 
-    status = k_i2c_read(ants_bus, ants_addr, count, 1);
     if (status != I2C_OK)
     {
-        fprintf(stderr, "Failed to read antenna %d activation count: %d\n",
+        fprintf(stderr, "Failed to fetch antenna %d activation count: %d\n",
                 (antenna + 1), status);
         return ANTS_ERROR;
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
-
     return ANTS_OK;
 }
 
@@ -404,24 +438,18 @@ KANTSStatus k_ants_get_activation_time(KANTSAnt antenna, uint16_t * time)
     KI2CStatus status;
     uint8_t    cmd = GET_UPTIME_1 + antenna;
 
-    status = k_i2c_write(ants_bus, ants_addr, (uint8_t *) &cmd, 1);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to request antenna %d activation times: %d\n",
-                (antenna + 1), status);
-        return ANTS_ERROR;
-    }
+    kprv_ants_begin();
+    status = k_i2c_transfer(ants_bus, ants_addr, (uint8_t *) &cmd, 1,
+                            (uint8_t *) time, 2);
+    kprv_ants_end();
 
-    status = k_i2c_read(ants_bus, ants_addr, (uint8_t *) time, 2);
     if (status != I2C_OK)
     {
-        fprintf(stderr, "Failed to read antenna %d activation times: %d\n",
+        fprintf(stderr, "Failed to fetch antenna %d activation times: %d\n",
                 (antenna + 1), status);
         return ANTS_ERROR;
     }
 
-    nanosleep(&TRANSFER_DELAY, NULL);
-
     return ANTS_OK;
 }
 
@@ -431,6 +459,8 @@ KANTSStatus k_ants_watchdog_kick()
     KANTSStatus ret = ANTS_OK;
     uint8_t     cmd = WATCHDOG_RESET;
 
+    kprv_ants_begin();
+
     status = k_i2c_write(ants_bus, ants_primary, (uint8_t *) &cmd, 1);
     if (status != I2C_OK)
     {
@@ -448,28 +478,16 @@ KANTSStatus k_ants_watchdog_kick()
         }
     }
 
-    return ret;
-}
+    kprv_ants_end();
 
-void * kprv_ants_watchdog_thread(void * args)
-{
-    KANTSStatus status;
-
-    while (1)
-    {
-        k_ants_watchdog_kick();
-
-        sleep(ants_wd_timeout / 3);
-    }
-
-    return NULL;
+    return ret;
 }
 
 KANTSStatus k_ants_watchdog_start()
 {
-    if (handle_watchdog != 0)
+    if (k_kick_is_registered(&ants_kick))
     {
-        fprintf(stderr, "AntS watchdog thread already started\n");
+        fprintf(stderr, "AntS watchdog kicks already started\n");
         return ANTS_OK;
     }
 
@@ -477,15 +495,19 @@ KANTSStatus k_ants_watchdog_start()
     {
         fprintf(
             stderr,
-            "AntS watchdog has been disabled. No thread will be started\n");
+            "AntS watchdog has been disabled. No kicks will be scheduled\n");
         return ANTS_OK;
     }
 
-    if (pthread_create(&handle_watchdog, NULL, kprv_ants_watchdog_thread, NULL)
-        != 0)
+    /* Kick three times per timeout */
+    ants_kick.period = (struct timespec) {
+        .tv_sec  = ants_wd_timeout / 3,
+        .tv_nsec = (ants_wd_timeout % 3) * 1000000000L / 3
+    };
+
+    if (!k_kick_register(&ants_kick))
     {
-        perror("Failed to create AntS watchdog thread");
-        handle_watchdog = 0;
+        fprintf(stderr, "Failed to schedule AntS watchdog kicks\n");
         return ANTS_ERROR;
     }
 
@@ -494,28 +516,13 @@ KANTSStatus k_ants_watchdog_start()
 
 KANTSStatus k_ants_watchdog_stop()
 {
-    if (handle_watchdog == 0)
-    {
-      perror("AntS watchdog thread has not been started");
-      return ANTS_ERROR;
-    }
-
-    /* Send the cancel request */
-    if (pthread_cancel(handle_watchdog) != 0)
+    /* Waits for a kick in progress, rather than interrupting it */
+    if (!k_kick_unregister(&ants_kick))
     {
-        perror("Failed to cancel AntS watchdog thread");
+        fprintf(stderr, "AntS watchdog kicks have not been started\n");
         return ANTS_ERROR;
     }
 
-    /* Wait for the cancellation to complete */
-    if (pthread_join(handle_watchdog, NULL) != 0)
-    {
-        perror("Failed to rejoin AntS watchdog thread");
-        return ANTS_ERROR;
-    }
-
-    handle_watchdog = 0;
-
     return ANTS_OK;
 }
 
@@ -529,25 +536,34 @@ KANTSStatus k_ants_passthrough(const uint8_t * tx, int tx_len, uint8_t * rx,
 
     KI2CStatus status;
 
-    status = k_i2c_write(ants_bus, ants_addr, (uint8_t *) tx, tx_len);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to send AntS passthrough packet: %d\n", status);
-        return ANTS_ERROR;
-    }
+    kprv_ants_begin();
 
     if (rx_len != 0)
     {
-        status = k_i2c_read(ants_bus, ants_addr, rx, rx_len);
+        status = k_i2c_transfer(ants_bus, ants_addr, (uint8_t *) tx, tx_len, rx,
+                                rx_len);
         if (status != I2C_OK)
         {
-            fprintf(stderr, "Failed to read AntS passthrough response: %d\n",
+            fprintf(stderr, "Failed to transfer AntS passthrough packet: %d\n",
                     status);
-            return ANTS_ERROR;
         }
     }
+    else
+    {
+        status = k_i2c_write(ants_bus, ants_addr, (uint8_t *) tx, tx_len);
+        if (status != I2C_OK)
+        {
+            fprintf(stderr, "Failed to send AntS passthrough packet: %d\n",
+                    status);
+        }
+    }
+
+    kprv_ants_end();
 
-    nanosleep(&TRANSFER_DELAY, NULL);
+    if (status != I2C_OK)
+    {
+        return ANTS_ERROR;
+    }
 
     return ANTS_OK;
 }
@@ -342,7 +342,6 @@ static void test_get_deploy_status(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, GET_STATUS);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(deploy_status));
     will_return(__wrap_read, &deploy_status);
 
@@ -368,7 +367,6 @@ static void test_get_uptime(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, GET_UPTIME_SYS);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(uptime));
     will_return(__wrap_read, &uptime);
 
@@ -394,7 +392,6 @@ static void test_get_system_telemetry(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, GET_TELEMETRY);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(system_telem));
     will_return(__wrap_read, &system_telem);
 
@@ -420,7 +417,6 @@ static void test_get_activation_count_1(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, GET_COUNT_1);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(activation_count));
     will_return(__wrap_read, &activation_count);
 
@@ -437,7 +433,6 @@ static void test_get_activation_count_2(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, GET_COUNT_2);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(activation_count));
     will_return(__wrap_read, &activation_count);
 
@@ -454,7 +449,6 @@ static void test_get_activation_count_3(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, GET_COUNT_3);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(activation_count));
     will_return(__wrap_read, &activation_count);
 
@@ -471,7 +465,6 @@ static void test_get_activation_count_4(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, GET_COUNT_4);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(activation_count));
     will_return(__wrap_read, &activation_count);
 
@@ -507,7 +500,6 @@ static void test_get_activation_time_1(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, GET_UPTIME_1);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(activation_time));
     will_return(__wrap_read, &activation_time);
 
@@ -524,7 +516,6 @@ static void test_get_activation_time_2(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, GET_UPTIME_2);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(activation_time));
     will_return(__wrap_read, &activation_time);
 
@@ -541,7 +532,6 @@ static void test_get_activation_time_3(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, GET_UPTIME_3);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(activation_time));
     will_return(__wrap_read, &activation_time);
 
@@ -558,7 +548,6 @@ static void test_get_activation_time_4(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, GET_UPTIME_4);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(activation_time));
     will_return(__wrap_read, &activation_time);
 
@@ -652,7 +641,6 @@ static void test_passthrough(void ** arg)
     expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     expect_value(__wrap_write, cmd, tx[0]);
 
-    expect_value(__wrap_ioctl, addr, ANTS_PRIMARY);
     will_return(__wrap_read, sizeof(rx));
     will_return(__wrap_read, "K");
 
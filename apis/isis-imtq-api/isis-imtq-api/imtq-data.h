@@ -193,6 +193,47 @@ typedef struct {
     int16_t mcu_temp;                   /**< MCU temperature in [<sup>o</sup>C] */
 } __attribute__((packed)) imtq_housekeeping_eng;
 
+/**
+ * Parts of an ::imtq_telemetry_snapshot, which can be fetched independently
+ */
+typedef enum {
+    IMTQ_SNAPSHOT_STATE,        /**< System state */
+    IMTQ_SNAPSHOT_HOUSE_RAW,    /**< Housekeeping data (raw ADC values) */
+    IMTQ_SNAPSHOT_HOUSE_ENG,    /**< Housekeeping data (engineering values) */
+    IMTQ_SNAPSHOT_DETUMBLE,     /**< Data from the last detumble loop */
+    IMTQ_SNAPSHOT_MTM_RAW,      /**< New raw MTM measurement */
+    IMTQ_SNAPSHOT_MTM_CALIB,    /**< New calibrated MTM measurement */
+    IMTQ_SNAPSHOT_DIPOLE,       /**< Commanded actuation dipole */
+    IMTQ_SNAPSHOT_PARTS         /**< Number of parts */
+} imtq_snapshot_part;
+
+/**
+ * Bit for a snapshot part in ::imtq_telemetry_snapshot.valid, and in the
+ * `parts` argument of ::k_imtq_get_telemetry_snapshot
+ */
+#define IMTQ_SNAPSHOT_BIT(part) (1u << (part))
+/** All snapshot parts */
+#define IMTQ_SNAPSHOT_ALL (IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_PARTS) - 1)
+
+/**
+ * Telemetry snapshot filled by ::k_imtq_get_telemetry_snapshot
+ *
+ * The device responses are read straight into the snapshot, so taking one
+ * doesn't allocate or convert anything. A part's data should only be used
+ * while its bit is set in `valid`.
+ */
+typedef struct {
+    uint32_t valid;                         /**< Bitmask of parts holding good data (see ::IMTQ_SNAPSHOT_BIT) */
+    imtq_state state;                       /**< System state */
+    imtq_housekeeping_raw house_raw;        /**< Housekeeping data (raw ADC values) */
+    imtq_housekeeping_eng house_eng;        /**< Housekeeping data (engineering values) */
+    imtq_detumble detumble;                 /**< Data from the last detumble loop */
+    imtq_mtm_msg mtm_raw;                   /**< Raw MTM measurement */
+    imtq_mtm_msg mtm_calib;                 /**< Calibrated MTM measurement */
+    imtq_dipole dipole;                     /**< Commanded actuation dipole */
+    struct timespec stamp[IMTQ_SNAPSHOT_PARTS]; /**< `CLOCK_MONOTONIC` time each part was read, indexed by ::imtq_snapshot_part */
+} imtq_telemetry_snapshot;
+
 /* Data Request Commands */
 /**
  * Get the ADCS's power status
@@ -223,11 +264,70 @@ KADCSStatus k_adcs_get_spin(adcs_spin * data);
 /**
  * Read ADCS telemetry values
  * @note See specific ADCS API documentation for available telemetry types
+ * @note New members are allocated from the same allocator as `buffer`. Creating the
+ * buffer with `json_mkobject_a` allows the whole telemetry tree to be released at once
+ * with `json_arena_reset`
  * @param [in] type Telemetry packet to read
  * @param [out] buffer (Pointer to) structure which data should be copied to
  * @return KADCSStatus ADCS_OK if OK, error otherwise
  */
 KADCSStatus k_adcs_get_telemetry(ADCSTelemType type, JsonNode * buffer);
+/**
+ * Write ADCS telemetry values as a JSON object, without building a JSON tree
+ *
+ * The object is written at the writer's current position, so several samples can be
+ * collected into an array. Whether the output fit should be checked with
+ * `json_writer_finish` once the document is complete.
+ * @param [in] type Telemetry packet to read
+ * @param [in,out] writer JSON writer to serialize the telemetry with
+ * @return KADCSStatus ADCS_OK if OK, error otherwise
+ */
+KADCSStatus k_imtq_write_telemetry(ADCSTelemType type, JsonWriter * writer);
+/**
+ * Read iMTQ telemetry into a snapshot structure
+ *
+ * All of the requested parts are fetched in a single bus transaction. Parts
+ * which weren't requested are left as they were, so fast-changing parts (such
+ * as the MTM measurements) can be refreshed more often than the rest of the
+ * snapshot. Each part's `stamp` records when it was read.
+ *
+ * Example usage:
+ * @code
+imtq_telemetry_snapshot snapshot = { 0 };
+k_imtq_get_telemetry_snapshot(&snapshot, IMTQ_SNAPSHOT_ALL);
+if (snapshot.valid & IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_MTM_CALIB))
+{
+    use_field(snapshot.mtm_calib.data);
+}
+ * @endcode
+ *
+ * @note Requesting either MTM part starts a new measurement
+ * @param [in,out] snapshot Snapshot to update
+ * @param [in] parts Bitmask of parts to read (see ::IMTQ_SNAPSHOT_BIT)
+ * @return KADCSStatus `ADCS_OK` if every requested part was read, `ADCS_ERROR` if
+ * some were not (their bits in `valid` are cleared), another error otherwise
+ */
+KADCSStatus k_imtq_get_telemetry_snapshot(imtq_telemetry_snapshot * snapshot, uint32_t parts);
+/**
+ * Add the valid parts of a telemetry snapshot to a JSON object
+ *
+ * The members are the same as the ones added by `k_adcs_get_telemetry`
+ * for ::NOMINAL telemetry
+ * @param [in] snapshot Snapshot to serialize
+ * @param [out] buffer JSON object which members should be added to
+ * @return KADCSStatus `ADCS_OK` if OK, error otherwise
+ */
+KADCSStatus k_imtq_snapshot_json(const imtq_telemetry_snapshot * snapshot, JsonNode * buffer);
+/**
+ * Write the valid parts of a telemetry snapshot as a JSON object
+ *
+ * The object is written at the writer's current position, as with
+ * ::k_imtq_write_telemetry
+ * @param [in] snapshot Snapshot to serialize
+ * @param [in,out] writer JSON writer to serialize the snapshot with
+ * @return KADCSStatus `ADCS_OK` if OK, error otherwise
+ */
+KADCSStatus k_imtq_write_snapshot(const imtq_telemetry_snapshot * snapshot, JsonWriter * writer);
 /**
  * Get iMTQ system state
  * @param [out] state Pointer to storage for state data
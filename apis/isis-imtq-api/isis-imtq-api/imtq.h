@@ -23,6 +23,7 @@
 #include <pthread.h>
 #include <stdint.h>
 #include <i2c.h>
+#include <pacing.h>
 
 /**
  *  @name Command Response Flags
@@ -113,9 +114,12 @@ typedef struct {
 #include "imtq-ops.h"
 
 /**
- * System mutex to preserve iMTQ command/response ordering
+ * System request queue to preserve iMTQ command/response ordering
+ *
+ * Waiting requests are served by priority class, so control commands are sent
+ * ahead of telemetry requests which were made earlier.
  */
-extern pthread_mutex_t imtq_mutex;
+extern KArbiter imtq_arbiter;
 
 /* Public Functions */
 /**
@@ -127,17 +131,37 @@ extern pthread_mutex_t imtq_mutex;
  */
 KADCSStatus k_adcs_init(char * bus, uint16_t addr, int timeout);
 /**
- * Terminate the ADCS interface
+ * Terminate the ADCS interface, stopping any watchdog kicks
  */
 void k_adcs_terminate(void);
 /**
- * Start a thread to kick the iMTQ's watchdog at an interval of
+ * Get the minimum time enforced between consecutive iMTQ transfers
+ * @param [out] gap Storage for the current minimum gap
+ */
+void k_imtq_get_transfer_gap(struct timespec * gap);
+/**
+ * Change the minimum time enforced between consecutive iMTQ transfers
+ *
+ * This is also the default time allowed for the iMTQ to process a command
+ * before its response is read.
+ * @note The default is just over 1ms. Only the time which hasn't already passed since the
+ * previous transfer is slept.
+ * @param [in] gap New minimum gap
+ */
+void k_imtq_set_transfer_gap(const struct timespec * gap);
+/**
+ * Start kicking the iMTQ's watchdog at an interval of
  * `(timeout/3)` seconds (`timeout` specified in `k_adcs_init`)
+ *
+ * The kicks are run by the kubos-hal kick scheduler (see ::KKick), which
+ * shares one thread between every driver.
  * @return KADCSStatus `ADCS_OK` if OK, error otherwise
  */
 KADCSStatus k_imtq_watchdog_start(void);
 /**
- * Stop the watchdog thread
+ * Stop kicking the iMTQ's watchdog
+ *
+ * A kick which is in progress is allowed to finish first.
  * @return KADCSStatus `ADCS_OK` if OK, error otherwise
  */
 KADCSStatus k_imtq_watchdog_stop(void);
@@ -158,6 +182,18 @@ KADCSStatus k_imtq_reset(void);
  * @return KADCSStatus ADCS_OK if OK, error otherwise
  */
 KADCSStatus k_adcs_passthrough(const uint8_t * tx, int tx_len, uint8_t * rx, int rx_len, const struct timespec * delay);
+/**
+ * Get the request queue statistics for one class of iMTQ request
+ *
+ * Actuation commands are ::ARBITER_CONTROL requests, with a deadline of 5ms
+ * after being issued; telemetry sweeps are ::ARBITER_BULK requests; everything
+ * else is ::ARBITER_NORMAL. A request which misses its deadline is still sent,
+ * and counted in `deadline_misses`.
+ * @param [in] cls Class of request
+ * @param [out] stats Storage for the statistics
+ * @return KADCSStatus `ADCS_OK` if OK, `ADCS_ERROR_CONFIG` for an unknown class
+ */
+KADCSStatus k_imtq_get_queue_stats(KArbiterClass cls, KArbiterStats * stats);
 
 /* Private Functions */
 /**
@@ -171,6 +207,87 @@ KADCSStatus k_adcs_passthrough(const uint8_t * tx, int tx_len, uint8_t * rx, int
  */
 KADCSStatus kprv_imtq_transfer(const uint8_t * tx, int tx_len, uint8_t * rx,
                                int rx_len, const struct timespec * delay);
+/**
+ * Send an iMTQ request with the given priority and deadline, and fetch the response
+ *
+ * The request waits for the iMTQ and for the I2C bus in priority order. The
+ * deadline applies to sending the command.
+ * @param [in] tx Pointer to data to send
+ * @param [in] tx_len Length of data to send
+ * @param [out] rx Pointer to buffer for response data
+ * @param [in] rx_len Length of data to read for response
+ * @param [in] delay Delay between sending data to the iMTQ and reading the response. A value of `NULL` indicates that the default should be used.
+ * @param [in] request Priority and deadline of the request
+ * @return KADCSStatus `ADCS_OK` if OK, error otherwise
+ */
+KADCSStatus kprv_imtq_transfer_request(const uint8_t * tx, int tx_len,
+                                       uint8_t * rx, int rx_len,
+                                       const struct timespec * delay,
+                                       const KArbiterRequest * request);
+/**
+ * Send a latency-critical iMTQ command (such as starting actuation) and fetch the response
+ *
+ * The command is an ::ARBITER_CONTROL request, which should be sent within 5ms
+ * @param [in] tx Pointer to data to send
+ * @param [in] tx_len Length of data to send
+ * @param [out] rx Pointer to buffer for response data
+ * @param [in] rx_len Length of data to read for response
+ * @return KADCSStatus `ADCS_OK` if OK, error otherwise
+ */
+KADCSStatus kprv_imtq_control_transfer(const uint8_t * tx, int tx_len,
+                                       uint8_t * rx, int rx_len);
+/**
+ * Fetch the value of a configuration parameter with the given priority
+ * @param [in] param ID of the parameter to fetch
+ * @param [out] response Pointer to storage for the response
+ * @param [in] request Priority and deadline of the request
+ * @return KADCSStatus `ADCS_OK` if OK, error otherwise
+ */
+KADCSStatus kprv_imtq_get_param(uint16_t param, imtq_config_resp * response,
+                                const KArbiterRequest * request);
+/**
+ * Verify the header of an iMTQ response
+ * @param [in] tx Pointer to the command which was sent
+ * @param [in] rx Pointer to the response which was received
+ * @return KADCSStatus `ADCS_OK` if the response is valid, error otherwise
+ */
+KADCSStatus kprv_imtq_check_response(const uint8_t * tx, const uint8_t * rx);
+/**
+ * Send a series of iMTQ requests and fetch their responses while holding the
+ * iMTQ request queue and the I2C bus
+ *
+ * The slave address of each message is filled in automatically. Messages
+ * without a `delay` get the default inter-transfer delay.
+ *
+ * @param [in,out] msgs Array of messages to execute
+ * @param [in] count Number of messages in the array
+ * @return KADCSStatus `ADCS_OK` if all of the I2C transfers completed, error otherwise.
+ * The responses should be checked individually with ::kprv_imtq_batch_status
+ */
+KADCSStatus kprv_imtq_batch(KI2CBatchMsg * msgs, int count);
+/**
+ * Send a series of iMTQ requests with the given priority and deadline
+ *
+ * This is the same as ::kprv_imtq_batch, except that messages flagged with
+ * `yield` are transaction boundaries: more urgent iMTQ requests, and more
+ * urgent users of the I2C bus, are let in before those messages are sent.
+ * Messages which must not be separated (such as starting a measurement and
+ * reading its result) should only have the flag set on the first.
+ *
+ * @param [in,out] msgs Array of messages to execute
+ * @param [in] count Number of messages in the array
+ * @param [in] request Priority and deadline of the batch
+ * @return KADCSStatus `ADCS_OK` if all of the I2C transfers completed, error otherwise.
+ * The responses should be checked individually with ::kprv_imtq_batch_status
+ */
+KADCSStatus kprv_imtq_batch_request(KI2CBatchMsg * msgs, int count,
+                                    const KArbiterRequest * request);
+/**
+ * Get the result of a single message from an iMTQ batch
+ * @param [in] msg Message which was executed by ::kprv_imtq_batch
+ * @return KADCSStatus `ADCS_OK` if the message completed and the response is valid, error otherwise
+ */
+KADCSStatus kprv_imtq_batch_status(const KI2CBatchMsg * msg);
 /**
  * Extract the return code in a response status byte
  * @param [in] status A ::imtq_resp_header.status byte returned in a response
@@ -115,6 +115,14 @@ KADCSStatus k_adcs_configure(const JsonNode * config)
 }
 
 KADCSStatus k_imtq_get_param(uint16_t param, imtq_config_resp * response)
+{
+    const KArbiterRequest request = {.priority = ARBITER_NORMAL, .deadline = NULL };
+
+    return kprv_imtq_get_param(param, response, &request);
+}
+
+KADCSStatus kprv_imtq_get_param(uint16_t param, imtq_config_resp * response,
+                                const KArbiterRequest * request)
 {
     KADCSStatus status    = ADCS_OK;
     uint8_t    packet[3] = {
@@ -127,8 +135,9 @@ KADCSStatus k_imtq_get_param(uint16_t param, imtq_config_resp * response)
         return ADCS_ERROR_CONFIG;
     }
 
-    status = kprv_imtq_transfer(packet, sizeof(packet), (uint8_t *) response,
-                                sizeof(imtq_config_resp), NULL);
+    status = kprv_imtq_transfer_request(packet, sizeof(packet),
+                                        (uint8_t *) response,
+                                        sizeof(imtq_config_resp), NULL, request);
     if (status != ADCS_OK)
     {
         fprintf(stderr, "Failed to retrieve parameter (%x): %d\n", param,
@@ -18,13 +18,36 @@
 
 #include <imtq.h>
 #include <i2c.h>
+#include <kick.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <sys/syscall.h>
 #include <time.h>
 #include <unistd.h>
 
-pthread_mutex_t imtq_mutex;
+KArbiter imtq_arbiter;
+
+/**
+ * Whether ::imtq_arbiter has been set up. Checked by every request, which may
+ * come from any thread
+ */
+static atomic_bool imtq_queue_ready = false;
+
+/**
+ * Wait statistics for each ::KArbiterClass of iMTQ request
+ */
+static KArbiterClient imtq_clients[ARBITER_CONTROL - ARBITER_BULK + 1];
+
+/**
+ * Control commands should be sent within 5ms of being requested
+ */
+static const struct timespec CONTROL_DEADLINE = {.tv_sec = 0, .tv_nsec = 5000000 };
+
+/**
+ * Requests which don't say otherwise are ordinary commands
+ */
+static const KArbiterRequest NORMAL_REQUEST = {.priority = ARBITER_NORMAL, .deadline = NULL };
 
 /**
  * I2C bus the iMTQ is connected to
@@ -41,6 +64,48 @@ static uint16_t imqt_addr = 0x10;
  */
 static int wd_timeout = 60;
 
+/**
+ * There must be at least a 1ms delay in-between each I2C transfer
+ */
+static const struct timespec TRANSFER_DELAY = {.tv_sec = 0, .tv_nsec = 1000001 };
+
+/**
+ * Tracks the time since the last I2C transfer
+ */
+static KPacer imtq_pacer;
+
+/**
+ * Guards the transfer gap in ::imtq_pacer, which may be changed from any
+ * thread while a transfer is pacing itself. The rest of the pacer is only
+ * used with ::imtq_arbiter held
+ */
+static pthread_mutex_t imtq_gap_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Take a consistent copy of the transfer gap */
+static void kprv_imtq_get_gap(struct timespec * gap)
+{
+    pthread_mutex_lock(&imtq_gap_mutex);
+    k_pacer_get_gap(&imtq_pacer, gap);
+    pthread_mutex_unlock(&imtq_gap_mutex);
+}
+
+/* Wait out the transfer gap. The caller must hold ::imtq_arbiter */
+static void kprv_imtq_wait(void)
+{
+    struct timespec gap;
+
+    kprv_imtq_get_gap(&gap);
+    k_pacer_wait_gap(&imtq_pacer, &gap);
+}
+
+static void kprv_imtq_watchdog_kick(void * arg)
+{
+    k_adcs_noop();
+}
+
+/* Kicks the watchdog from the shared kick scheduler */
+static KKick imtq_kick = {.func = kprv_imtq_watchdog_kick };
+
 KADCSStatus k_adcs_init(char * bus, uint16_t addr, int timeout)
 {
     imqt_addr = addr;
@@ -54,20 +119,31 @@ KADCSStatus k_adcs_init(char * bus, uint16_t addr, int timeout)
         return ADCS_ERROR;
     }
 
-    pthread_mutexattr_t mutex_attr;
-    if (pthread_mutexattr_settype(&mutex_attr, PTHREAD_MUTEX_ERRORCHECK) != 0)
+    /*
+     * Other drivers may share the bus. Don't wait for it any longer than we
+     * would wait for our own request queue
+     */
+    const struct timespec BUS_TIMEOUT = {.tv_sec = 1, .tv_nsec = 0 };
+    k_i2c_set_arbitration(i2c_bus, 0, &BUS_TIMEOUT);
+
+    if (!k_arbiter_init(&imtq_arbiter))
     {
-        perror("Failed to set up MTQ mutex attr");
-        k_adcs_terminate();
+        fprintf(stderr, "Failed to set up MTQ request queue\n");
+        k_i2c_terminate(&i2c_bus);
         return ADCS_ERROR_MUTEX;
     }
-    if (pthread_mutex_init(&imtq_mutex, &mutex_attr) != 0)
+
+    imtq_queue_ready = true;
+
+    for (int i = 0; i < (int) (sizeof(imtq_clients) / sizeof(imtq_clients[0])); i++)
     {
-        perror("Failed to set up MTQ mutex");
-        k_adcs_terminate();
-        return ADCS_ERROR_MUTEX;
+        imtq_clients[i] = (KArbiterClient) {.priority = ARBITER_BULK + i };
     }
 
+    pthread_mutex_lock(&imtq_gap_mutex);
+    k_pacer_init(&imtq_pacer, &TRANSFER_DELAY);
+    pthread_mutex_unlock(&imtq_gap_mutex);
+
     KADCSStatus imtq_status;
 
     /* Call noop to verify iMTQ is online */
@@ -86,21 +162,25 @@ void k_adcs_terminate(void)
 {
     const struct timespec MUTEX_TIMEOUT = {.tv_sec = 1, .tv_nsec = 0 };
 
-    /* Destroy the mutex */
-    if (pthread_mutex_timedlock(&imtq_mutex, &MUTEX_TIMEOUT) != 0)
-    {
-        perror("Failed to take MTQ mutex");
-        fprintf(stderr, "PID: %d TID: %ld", getpid(), syscall(SYS_gettid));
-    }
-    if (pthread_mutex_unlock(&imtq_mutex) != 0)
-    {
-        perror("Failed to unlock MTQ mutex");
-        fprintf(stderr, "PID: %d TID: %ld", getpid(), syscall(SYS_gettid));
-    }
-    if (pthread_mutex_destroy(&imtq_mutex) != 0)
+    /* The kick scheduler outlives us, so make sure it stops using the queue */
+    k_kick_unregister(&imtq_kick);
+
+    /* Wait for any transfer in progress, then destroy the queue */
+    if (atomic_exchange(&imtq_queue_ready, false))
     {
-        perror("Failed to destroy MTQ mutex");
-        fprintf(stderr, "PID: %d TID: %ld", getpid(), syscall(SYS_gettid));
+        if (k_arbiter_acquire(&imtq_arbiter,
+                              &imtq_clients[ARBITER_NORMAL - ARBITER_BULK],
+                              &MUTEX_TIMEOUT))
+        {
+            k_arbiter_release(&imtq_arbiter);
+        }
+        else
+        {
+            fprintf(stderr, "Failed to take MTQ request queue\n");
+            fprintf(stderr, "PID: %d TID: %ld", getpid(), syscall(SYS_gettid));
+        }
+
+        k_arbiter_destroy(&imtq_arbiter);
     }
 
     /* Close the I2C bus */
@@ -109,41 +189,92 @@ void k_adcs_terminate(void)
     return;
 }
 
+void k_imtq_get_transfer_gap(struct timespec * gap)
+{
+    kprv_imtq_get_gap(gap);
+}
+
+void k_imtq_set_transfer_gap(const struct timespec * gap)
+{
+    pthread_mutex_lock(&imtq_gap_mutex);
+    k_pacer_set_gap(&imtq_pacer, gap);
+    pthread_mutex_unlock(&imtq_gap_mutex);
+}
+
+KADCSStatus k_imtq_get_queue_stats(KArbiterClass cls, KArbiterStats * stats)
+{
+    if (cls < ARBITER_BULK || cls > ARBITER_CONTROL || stats == NULL)
+    {
+        return ADCS_ERROR_CONFIG;
+    }
+
+    k_arbiter_get_stats(&imtq_arbiter, &imtq_clients[cls - ARBITER_BULK], stats);
+
+    return ADCS_OK;
+}
+
 /*
- * Pass a custom command packet directly through to the iMTQ
+ * Requests with an unknown priority are tracked with the nearest class
  */
-KADCSStatus k_adcs_passthrough(const uint8_t * tx, int tx_len, uint8_t * rx,
-                               int rx_len, const struct timespec * delay)
+static KArbiterClient * kprv_imtq_client(const KArbiterRequest * request)
 {
-    return kprv_imtq_transfer(tx, tx_len, rx, rx_len, delay);
+    int priority = request->priority;
+
+    if (priority < ARBITER_BULK)
+    {
+        priority = ARBITER_BULK;
+    }
+    else if (priority > ARBITER_CONTROL)
+    {
+        priority = ARBITER_CONTROL;
+    }
+
+    return &imtq_clients[priority - ARBITER_BULK];
 }
 
 /*
- * This is a special transfer case. We have to wait way longer before trying
- * to get a response (since the system was rebooting)
+ * Wait for our turn to talk to the iMTQ
  */
-
-void * kprv_imtq_watchdog_thread(void * args)
+static KADCSStatus kprv_imtq_lock(const KArbiterRequest * request)
 {
-    KADCSStatus status;
+    const struct timespec MUTEX_TIMEOUT = {.tv_sec = 1, .tv_nsec = 0 };
 
-    while (1)
+    if (!imtq_queue_ready)
     {
-        k_adcs_noop();
+        fprintf(stderr, "MTQ request queue has not been set up\n");
+        return ADCS_ERROR_MUTEX;
+    }
 
-        sleep(wd_timeout / 3);
+    if (!k_arbiter_acquire_request(&imtq_arbiter, kprv_imtq_client(request),
+                                   request, &MUTEX_TIMEOUT))
+    {
+        fprintf(stderr, "Failed to take MTQ request queue\n");
+        fprintf(stderr, "PID: %d TID: %ld", getpid(), syscall(SYS_gettid));
+        return ADCS_ERROR_MUTEX;
     }
 
-    return NULL;
+    return ADCS_OK;
+}
+
+/*
+ * Pass a custom command packet directly through to the iMTQ
+ */
+KADCSStatus k_adcs_passthrough(const uint8_t * tx, int tx_len, uint8_t * rx,
+                               int rx_len, const struct timespec * delay)
+{
+    return kprv_imtq_transfer(tx, tx_len, rx, rx_len, delay);
 }
 
-pthread_t handle_watchdog = { 0 };
+/*
+ * This is a special transfer case. We have to wait way longer before trying
+ * to get a response (since the system was rebooting)
+ */
 
 KADCSStatus k_imtq_watchdog_start(void)
 {
-    if (handle_watchdog != 0)
+    if (k_kick_is_registered(&imtq_kick))
     {
-        fprintf(stderr, "ADCS watchdog thread already started\n");
+        fprintf(stderr, "ADCS watchdog kicks already started\n");
         return ADCS_OK;
     }
 
@@ -151,15 +282,19 @@ KADCSStatus k_imtq_watchdog_start(void)
     {
         fprintf(
             stderr,
-            "ADCS watchdog has been disabled. No thread will be startd\n");
+            "ADCS watchdog has been disabled. No kicks will be scheduled\n");
         return ADCS_OK;
     }
 
-    if (pthread_create(&handle_watchdog, NULL, kprv_imtq_watchdog_thread, NULL)
-        != 0)
+    /* Kick three times per timeout */
+    imtq_kick.period = (struct timespec) {
+        .tv_sec  = wd_timeout / 3,
+        .tv_nsec = (wd_timeout % 3) * 1000000000L / 3
+    };
+
+    if (!k_kick_register(&imtq_kick))
     {
-        perror("Failed to create ADCS watchdog thread");
-        handle_watchdog = 0;
+        fprintf(stderr, "Failed to schedule ADCS watchdog kicks\n");
         return ADCS_ERROR;
     }
 
@@ -168,28 +303,13 @@ KADCSStatus k_imtq_watchdog_start(void)
 
 KADCSStatus k_imtq_watchdog_stop(void)
 {
-    if (handle_watchdog == 0)
-    {
-        perror("ADCS watchdog has not been started");
-        return ADCS_ERROR;
-    }
-
-    /* Send the cancel request */
-    if (pthread_cancel(handle_watchdog) != 0)
-    {
-        perror("Failed to cancel ADCS watchdog thread");
-        return ADCS_ERROR;
-    }
-
-    /* Wait for the cancellation to complete */
-    if (pthread_join(handle_watchdog, NULL) != 0)
+    /* Waits for a kick in progress, rather than interrupting it */
+    if (!k_kick_unregister(&imtq_kick))
     {
-        perror("Failed to rejoin ADCS watchdog thread");
+        fprintf(stderr, "ADCS watchdog kicks have not been started\n");
         return ADCS_ERROR;
     }
 
-    handle_watchdog = 0;
-
     return ADCS_OK;
 }
 
@@ -201,64 +321,102 @@ KADCSStatus k_imtq_reset(void)
 KADCSStatus kprv_imtq_transfer(const uint8_t * tx, int tx_len, uint8_t * rx,
                                int rx_len, const struct timespec * delay)
 {
-    KI2CStatus status;
+    return kprv_imtq_transfer_request(tx, tx_len, rx, rx_len, delay,
+                                      &NORMAL_REQUEST);
+}
 
-    const struct timespec MUTEX_TIMEOUT = {.tv_sec = 1, .tv_nsec = 0 };
+KADCSStatus kprv_imtq_control_transfer(const uint8_t * tx, int tx_len,
+                                       uint8_t * rx, int rx_len)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += CONTROL_DEADLINE.tv_sec;
+    deadline.tv_nsec += CONTROL_DEADLINE.tv_nsec;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    const KArbiterRequest request
+        = {.priority = ARBITER_CONTROL, .deadline = &deadline };
+
+    return kprv_imtq_transfer_request(tx, tx_len, rx, rx_len, NULL, &request);
+}
+
+KADCSStatus kprv_imtq_transfer_request(const uint8_t * tx, int tx_len,
+                                       uint8_t * rx, int rx_len,
+                                       const struct timespec * delay,
+                                       const KArbiterRequest * request)
+{
+    KI2CStatus  status;
+    KADCSStatus lock;
 
     if (tx == NULL || tx_len < 1 || rx == NULL
-        || rx_len < (int) sizeof(imtq_resp_header))
+        || rx_len < (int) sizeof(imtq_resp_header) || request == NULL)
     {
         return ADCS_ERROR_CONFIG;
     }
 
-    if (pthread_mutex_timedlock(&imtq_mutex, &MUTEX_TIMEOUT) != 0)
+    /* The deadline is for starting the transfer, not for reading the response */
+    const KArbiterRequest response_request
+        = {.priority = request->priority, .deadline = NULL };
+
+    KI2CBatchMsg command = {
+        .addr = imqt_addr, .tx = (uint8_t *) tx, .tx_len = tx_len
+    };
+    KI2CBatchMsg response = {.addr = imqt_addr, .rx = rx, .rx_len = rx_len };
+
+    lock = kprv_imtq_lock(request);
+    if (lock != ADCS_OK)
     {
-        perror("Failed to take MTQ mutex");
-        fprintf(stderr, "PID: %d TID: %ld", getpid(), syscall(SYS_gettid));
-        return ADCS_ERROR_MUTEX;
+        return lock;
     }
 
-    status = k_i2c_write(i2c_bus, imqt_addr, (uint8_t *) tx, tx_len);
+    /* Make sure the iMTQ has had time to finish with the previous transfer */
+    kprv_imtq_wait();
+
+    /*
+     * The command and the response are sent separately, so that other users
+     * of the bus can use it while the iMTQ prepares the response
+     */
+    status = k_i2c_batch_request(i2c_bus, request, &command, 1);
+    k_pacer_mark(&imtq_pacer);
     if (status != I2C_OK)
     {
-        fprintf(stderr, "Failed to send MTQ command: %d\n", status);
-        if (pthread_mutex_unlock(&imtq_mutex) != 0)
-        {
-            perror("Failed to unlock MTQ mutex");
-            fprintf(stderr, "PID: %d TID: %ld", getpid(), syscall(SYS_gettid));
-        }
+        fprintf(stderr, "Failed to send MTQ command: %d\n", command.status);
+        k_arbiter_release(&imtq_arbiter);
         return ADCS_ERROR;
     }
 
     if (delay == NULL)
     {
-        /* There must be at least a 1ms delay in-between each I2C transfer */
-        const struct timespec TRANSFER_DELAY
-            = {.tv_sec = 0, .tv_nsec = 1000001 };
-
-        nanosleep(&TRANSFER_DELAY, NULL);
+        kprv_imtq_wait();
     }
     else
     {
         /* Wait the requested amount of time before fetching the response */
-        nanosleep(delay, NULL);
+        k_pacer_wait_gap(&imtq_pacer, delay);
     }
 
-    status = k_i2c_read(i2c_bus, imqt_addr, rx, rx_len);
+    status = k_i2c_batch_request(i2c_bus, &response_request, &response, 1);
+    k_pacer_mark(&imtq_pacer);
 
-    if (pthread_mutex_unlock(&imtq_mutex) != 0)
-    {
-        perror("Failed to unlock MTQ mutex");
-        fprintf(stderr, "PID: %d TID: %ld", getpid(), syscall(SYS_gettid));
-    }
+    k_arbiter_release(&imtq_arbiter);
 
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to read MTQ response (%x): %d\n", tx[0],
-                status);
+                response.status);
         return ADCS_ERROR;
     }
 
+    return kprv_imtq_check_response(tx, rx);
+}
+
+KADCSStatus kprv_imtq_check_response(const uint8_t * tx, const uint8_t * rx)
+{
     imtq_resp_header response = {.cmd = rx[0], .status = rx[1] };
 
     if (response.cmd == 0xFF)
@@ -288,3 +446,112 @@ KADCSStatus kprv_imtq_transfer(const uint8_t * tx, int tx_len, uint8_t * rx,
 
     return ADCS_OK;
 }
+
+KADCSStatus kprv_imtq_batch(KI2CBatchMsg * msgs, int count)
+{
+    return kprv_imtq_batch_request(msgs, count, &NORMAL_REQUEST);
+}
+
+KADCSStatus kprv_imtq_batch_request(KI2CBatchMsg * msgs, int count,
+                                    const KArbiterRequest * request)
+{
+    KI2CStatus      status = I2C_OK;
+    KADCSStatus     ret    = ADCS_OK;
+    struct timespec gap;
+    int             start;
+    int             end;
+
+    const struct timespec MUTEX_TIMEOUT = {.tv_sec = 1, .tv_nsec = 0 };
+
+    if (msgs == NULL || count < 1 || request == NULL)
+    {
+        return ADCS_ERROR_CONFIG;
+    }
+
+    /* Copied, so that changing the gap can't affect a batch in progress */
+    kprv_imtq_get_gap(&gap);
+
+    for (int i = 0; i < count; i++)
+    {
+        msgs[i].addr = imqt_addr;
+
+        /* The iMTQ always needs time to prepare its response */
+        if (msgs[i].delay == NULL && msgs[i].tx_len > 0 && msgs[i].rx_len > 0)
+        {
+            msgs[i].delay = &gap;
+        }
+    }
+
+    ret = kprv_imtq_lock(request);
+
+    /*
+     * Run the messages up to each yield point as one bus batch, and let more
+     * urgent iMTQ requests go in-between
+     */
+    for (start = 0; ret == ADCS_OK && start < count; start = end)
+    {
+        for (end = start + 1; end < count && !msgs[end].yield; end++)
+        {
+            continue;
+        }
+
+        if (start > 0
+            && !k_arbiter_yield(&imtq_arbiter, kprv_imtq_client(request),
+                                request, &MUTEX_TIMEOUT))
+        {
+            fprintf(stderr, "Failed to take back MTQ request queue\n");
+            for (int i = start; i < count; i++)
+            {
+                msgs[i].status = I2C_ERROR_TIMEOUT;
+            }
+            ret = ADCS_ERROR;
+            break;
+        }
+
+        k_pacer_wait_gap(&imtq_pacer, &gap);
+        if (k_i2c_batch_request(i2c_bus, request, &msgs[start], end - start)
+            != I2C_OK)
+        {
+            status = I2C_ERROR;
+        }
+        k_pacer_mark(&imtq_pacer);
+    }
+
+    if (ret == ADCS_OK)
+    {
+        k_arbiter_release(&imtq_arbiter);
+
+        if (status != I2C_OK)
+        {
+            ret = ADCS_ERROR;
+        }
+    }
+
+    /* Don't leave the caller's messages pointing at our copy of the gap */
+    for (int i = 0; i < count; i++)
+    {
+        if (msgs[i].delay == &gap)
+        {
+            msgs[i].delay = NULL;
+        }
+    }
+
+    return ret;
+}
+
+KADCSStatus kprv_imtq_batch_status(const KI2CBatchMsg * msg)
+{
+    if (msg == NULL)
+    {
+        return ADCS_ERROR_CONFIG;
+    }
+
+    if (msg->status != I2C_OK)
+    {
+        fprintf(stderr, "Failed to read MTQ response (%x): %d\n", msg->tx[0],
+                msg->status);
+        return ADCS_ERROR;
+    }
+
+    return kprv_imtq_check_response(msg->tx, msg->rx);
+}
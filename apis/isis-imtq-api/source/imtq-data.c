@@ -61,6 +61,51 @@ const char test_step[8][5] = {
         "fina"
 };
 
+/*
+ * Telemetry destination. The telemetry functions are shared between the
+ * JsonNode and JsonWriter interfaces, and exactly one of these is set
+ */
+typedef struct {
+    JsonNode *   node;
+    JsonWriter * writer;
+} imtq_telem_sink;
+
+static KADCSStatus get_status_telemetry(imtq_telem_sink * sink);
+static KADCSStatus get_nominal_telemetry(imtq_telem_sink * sink);
+static KADCSStatus get_debug_telemetry(imtq_telem_sink * sink);
+static void process_test(imtq_telem_sink * sink, imtq_test_result test);
+static void put_status(imtq_telem_sink * sink, const imtq_state * state);
+static void put_snapshot(imtq_telem_sink * sink, const imtq_telemetry_snapshot * snapshot);
+
+static void telem_number(imtq_telem_sink * sink, const char * key, double value)
+{
+    if (sink->writer != NULL)
+    {
+        json_writer_key(sink->writer, key);
+        json_writer_number(sink->writer, value);
+    }
+    else
+    {
+        /* New members come from the same allocator as the buffer */
+        json_append_member(sink->node, key,
+                           json_mknumber_a(json_node_arena(sink->node), value));
+    }
+}
+
+static void telem_string(imtq_telem_sink * sink, const char * key, const char * value)
+{
+    if (sink->writer != NULL)
+    {
+        json_writer_key(sink->writer, key);
+        json_writer_string(sink->writer, value);
+    }
+    else
+    {
+        json_append_member(sink->node, key,
+                           json_mkstring_a(json_node_arena(sink->node), value));
+    }
+}
+
 /* ADCS API Functions */
 
 KADCSStatus k_adcs_get_mode(ADCSMode * mode)
@@ -139,6 +184,190 @@ KADCSStatus k_adcs_get_telemetry(ADCSTelemType type, JsonNode * buffer)
     return status;
 }
 
+KADCSStatus k_imtq_write_telemetry(ADCSTelemType type, JsonWriter * writer)
+{
+    imtq_telem_sink sink = {.writer = writer };
+    KADCSStatus     status;
+
+    if (writer == NULL || (type != DEBUG && type != NOMINAL))
+    {
+        return ADCS_ERROR_CONFIG;
+    }
+
+    json_writer_begin_object(writer);
+
+    status = get_status_telemetry(&sink);
+    if (status == ADCS_OK)
+    {
+        status = (type == DEBUG) ? get_debug_telemetry(&sink)
+                                 : get_nominal_telemetry(&sink);
+    }
+
+    /* Always leave the object closed, so the writer stays consistent */
+    json_writer_end_object(writer);
+
+    return status;
+}
+
+KADCSStatus k_imtq_get_telemetry_snapshot(imtq_telemetry_snapshot * snapshot,
+                                          uint32_t                  parts)
+{
+    KADCSStatus status = ADCS_OK;
+    KADCSStatus part_status;
+    KADCSStatus measure_status = ADCS_OK;
+
+    const struct timespec MEASURE_DELAY = {.tv_sec = 0, .tv_nsec = 1000001 };
+
+    /* Telemetry sweeps shouldn't hold up control commands */
+    const KArbiterRequest SWEEP = {.priority = ARBITER_BULK, .deadline = NULL };
+
+    /* Indexed by imtq_snapshot_part */
+    uint8_t cmds[IMTQ_SNAPSHOT_PARTS] = { GET_STATE,     GET_HOUSE_RAW,
+                                          GET_HOUSE_ENG, GET_DETUMBLE,
+                                          GET_MTM_RAW,   GET_MTM_CALIB,
+                                          GET_DIPOLE };
+    int rx_len[IMTQ_SNAPSHOT_PARTS] = { sizeof(imtq_state),
+                                        sizeof(imtq_housekeeping_raw),
+                                        sizeof(imtq_housekeeping_eng),
+                                        sizeof(imtq_detumble),
+                                        sizeof(imtq_mtm_data),
+                                        sizeof(imtq_mtm_data),
+                                        sizeof(imtq_dipole) };
+    uint8_t * rx[IMTQ_SNAPSHOT_PARTS];
+
+    uint8_t          measure_cmd  = START_MEASURE;
+    imtq_resp_header measure_resp = { 0 };
+
+    /* One message per part, plus starting the MTM measurement */
+    KI2CBatchMsg msgs[IMTQ_SNAPSHOT_PARTS + 2] = { 0 };
+    int          part_msg[IMTQ_SNAPSHOT_PARTS];
+    int          measure_msg = -1;
+    int          count       = 0;
+
+    if (snapshot == NULL || parts == 0 || (parts & ~IMTQ_SNAPSHOT_ALL) != 0)
+    {
+        return ADCS_ERROR_CONFIG;
+    }
+
+    /* Responses are read straight into the snapshot */
+    rx[IMTQ_SNAPSHOT_STATE]     = (uint8_t *) &snapshot->state;
+    rx[IMTQ_SNAPSHOT_HOUSE_RAW] = (uint8_t *) &snapshot->house_raw;
+    rx[IMTQ_SNAPSHOT_HOUSE_ENG] = (uint8_t *) &snapshot->house_eng;
+    rx[IMTQ_SNAPSHOT_DETUMBLE]  = (uint8_t *) &snapshot->detumble;
+    rx[IMTQ_SNAPSHOT_MTM_RAW]   = (uint8_t *) &snapshot->mtm_raw;
+    rx[IMTQ_SNAPSHOT_MTM_CALIB] = (uint8_t *) &snapshot->mtm_calib;
+    rx[IMTQ_SNAPSHOT_DIPOLE]    = (uint8_t *) &snapshot->dipole;
+
+    for (int part = 0; part < IMTQ_SNAPSHOT_PARTS; part++)
+    {
+        if (!(parts & IMTQ_SNAPSHOT_BIT(part)))
+        {
+            continue;
+        }
+
+        if ((part == IMTQ_SNAPSHOT_MTM_RAW || part == IMTQ_SNAPSHOT_MTM_CALIB)
+            && measure_msg < 0)
+        {
+            measure_msg = count;
+            msgs[count++] = (KI2CBatchMsg) {
+                .tx = &measure_cmd, .tx_len = 1,
+                .rx = (uint8_t *) &measure_resp, .rx_len = sizeof(measure_resp),
+                .yield = true
+            };
+            /* Give the measurement time to complete */
+            msgs[count++] = (KI2CBatchMsg) {.delay = &MEASURE_DELAY };
+        }
+
+        /*
+         * Control commands may go in-between parts, but not in the middle of
+         * a measurement
+         */
+        part_msg[part] = count;
+        msgs[count++] = (KI2CBatchMsg) {
+            .tx = &cmds[part], .tx_len = 1,
+            .rx = rx[part], .rx_len = rx_len[part],
+            .yield = (part != IMTQ_SNAPSHOT_MTM_RAW
+                      && part != IMTQ_SNAPSHOT_MTM_CALIB)
+        };
+    }
+
+    /* The requested parts are being overwritten */
+    snapshot->valid &= ~parts;
+
+    status = kprv_imtq_batch_request(msgs, count, &SWEEP);
+    if (status == ADCS_ERROR_MUTEX || status == ADCS_ERROR_CONFIG)
+    {
+        return status;
+    }
+    status = ADCS_OK;
+
+    if (measure_msg >= 0)
+    {
+        measure_status = kprv_imtq_batch_status(&msgs[measure_msg]);
+    }
+
+    for (int part = 0; part < IMTQ_SNAPSHOT_PARTS; part++)
+    {
+        if (!(parts & IMTQ_SNAPSHOT_BIT(part)))
+        {
+            continue;
+        }
+
+        if ((part == IMTQ_SNAPSHOT_MTM_RAW || part == IMTQ_SNAPSHOT_MTM_CALIB)
+            && measure_status != ADCS_OK)
+        {
+            part_status = measure_status;
+        }
+        else
+        {
+            part_status = kprv_imtq_batch_status(&msgs[part_msg[part]]);
+        }
+
+        if (part_status != ADCS_OK)
+        {
+            status = ADCS_ERROR;
+            continue;
+        }
+
+        snapshot->valid |= IMTQ_SNAPSHOT_BIT(part);
+        snapshot->stamp[part] = msgs[part_msg[part]].done;
+    }
+
+    return status;
+}
+
+KADCSStatus k_imtq_snapshot_json(const imtq_telemetry_snapshot * snapshot,
+                                 JsonNode *                      buffer)
+{
+    imtq_telem_sink sink = {.node = buffer };
+
+    if (snapshot == NULL || buffer == NULL)
+    {
+        return ADCS_ERROR_CONFIG;
+    }
+
+    put_snapshot(&sink, snapshot);
+
+    return ADCS_OK;
+}
+
+KADCSStatus k_imtq_write_snapshot(const imtq_telemetry_snapshot * snapshot,
+                                  JsonWriter *                    writer)
+{
+    imtq_telem_sink sink = {.writer = writer };
+
+    if (snapshot == NULL || writer == NULL)
+    {
+        return ADCS_ERROR_CONFIG;
+    }
+
+    json_writer_begin_object(writer);
+    put_snapshot(&sink, snapshot);
+    json_writer_end_object(writer);
+
+    return ADCS_OK;
+}
+
 KADCSStatus k_adcs_get_orientation(adcs_orient * data)
 {
     return ADCS_ERROR_NOT_IMPLEMENTED;
@@ -151,193 +380,220 @@ KADCSStatus k_adcs_get_spin(adcs_spin * data)
 
 KADCSStatus kprv_adcs_get_status_telemetry(JsonNode * buffer)
 {
-    KADCSStatus status;
-    imtq_state  state;
+    imtq_telem_sink sink = {.node = buffer };
 
     if (buffer == NULL)
     {
         return ADCS_ERROR_CONFIG;
     }
 
-    status = k_imtq_get_system_state(&state);
-    if (status == ADCS_OK)
+    return get_status_telemetry(&sink);
+}
+
+KADCSStatus kprv_adcs_get_nominal_telemetry(JsonNode * buffer)
+{
+    imtq_telem_sink sink = {.node = buffer };
+
+    if (buffer == NULL)
     {
-        switch (state.mode)
-        {
-            case IDLE:
-                json_append_member(buffer, "system_mode", json_mkstring("IDLE"));
-                break;
-            case DETUMBLE:
-                json_append_member(buffer, "system_mode", json_mkstring("DETUMBLE"));
-                break;
-            case SELFTEST:
-                json_append_member(buffer, "system_mode", json_mkstring("SELFTEST"));
-                break;
-        }
+        return ADCS_ERROR_CONFIG;
+    }
+
+    return get_nominal_telemetry(&sink);
+}
+
+KADCSStatus kprv_adcs_get_debug_telemetry(JsonNode * buffer)
+{
+    imtq_telem_sink sink = {.node = buffer };
+
+    if (buffer == NULL)
+    {
+        return ADCS_ERROR_CONFIG;
+    }
+
+    return get_debug_telemetry(&sink);
+}
+
+void kprv_adcs_process_test(JsonNode * parent, imtq_test_result test)
+{
+    imtq_telem_sink sink = {.node = parent };
+
+    if (parent == NULL)
+    {
+        return;
+    }
 
-        json_append_member(buffer, "system_error", json_mkstring((state.error) ? "yes" : "no"));
-        json_append_member(buffer, "system_configured", json_mkstring((state.config) ? "yes" : "no"));
-        json_append_member(buffer, "system_uptime", json_mknumber((double) state.uptime));
+    process_test(&sink, test);
+}
 
+static KADCSStatus get_status_telemetry(imtq_telem_sink * sink)
+{
+    KADCSStatus status;
+    imtq_state  state;
 
+    status = k_imtq_get_system_state(&state);
+    if (status == ADCS_OK)
+    {
+        put_status(sink, &state);
     }
     else if (status == ADCS_ERROR)
     {
         /* Assume system is offline, so uptime is zero */
-        json_append_member(buffer, "system_mode", json_mkstring("OFFLINE"));
-        json_append_member(buffer, "system_uptime", json_mknumber(0));
+        telem_string(sink, "system_mode", "OFFLINE");
+        telem_number(sink, "system_uptime", 0);
     }
 
     return status;
 }
 
+static KADCSStatus get_nominal_telemetry(imtq_telem_sink * sink)
+{
+    KADCSStatus             status;
+    imtq_telemetry_snapshot snapshot = { 0 };
 
-KADCSStatus kprv_adcs_get_nominal_telemetry(JsonNode * buffer)
+    /* The system state has already been added by get_status_telemetry */
+    status = k_imtq_get_telemetry_snapshot(&snapshot,
+                                           IMTQ_SNAPSHOT_ALL
+                                           & ~IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_STATE));
+    if (status == ADCS_ERROR_MUTEX || status == ADCS_ERROR_CONFIG)
+    {
+        return status;
+    }
+
+    put_snapshot(sink, &snapshot);
+
+    return status;
+}
+
+static void put_status(imtq_telem_sink * sink, const imtq_state * state)
 {
-    KADCSStatus status = ADCS_OK;
-    KADCSStatus nom_status;
+    switch (state->mode)
+    {
+        case IDLE:
+            telem_string(sink, "system_mode", "IDLE");
+            break;
+        case DETUMBLE:
+            telem_string(sink, "system_mode", "DETUMBLE");
+            break;
+        case SELFTEST:
+            telem_string(sink, "system_mode", "SELFTEST");
+            break;
+    }
+
+    telem_string(sink, "system_error", (state->error) ? "yes" : "no");
+    telem_string(sink, "system_configured", (state->config) ? "yes" : "no");
+    telem_number(sink, "system_uptime", (double) state->uptime);
+}
 
-    imtq_housekeeping_raw house_raw = { 0 };
-    imtq_housekeeping_eng house_eng = { 0 };
-    imtq_detumble         detumble  = { 0 };
-    imtq_mtm_msg          mtm_raw   = { 0 };
-    imtq_mtm_msg          mtm_calib = { 0 };
-    imtq_dipole           dipole    = { 0 };
+static void put_snapshot(imtq_telem_sink * sink, const imtq_telemetry_snapshot * snapshot)
+{
+    const imtq_housekeeping_raw * house_raw = &snapshot->house_raw;
+    const imtq_housekeeping_eng * house_eng = &snapshot->house_eng;
+    const imtq_detumble *         detumble  = &snapshot->detumble;
 
-    if (buffer == NULL)
+    if (snapshot->valid & IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_STATE))
     {
-        return ADCS_ERROR_CONFIG;
+        put_status(sink, &snapshot->state);
     }
 
-    /* Housekeeping data */
-    nom_status = k_imtq_get_raw_housekeeping(&house_raw);
-    nom_status |= k_imtq_get_eng_housekeeping(&house_eng);
-    if (nom_status != ADCS_OK)
+    /* Raw ADC values */
+    if (snapshot->valid & IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_HOUSE_RAW))
     {
-        status = ADCS_ERROR;
+        telem_number(sink, "supply_voltage_digital_raw", (double) house_raw->voltage_d);
+        telem_number(sink, "supply_voltage_analog_raw", (double) house_raw->voltage_a);
+        telem_number(sink, "supply_current_digital_raw", (double) house_raw->current_d);
+        telem_number(sink, "supply_current_analog_raw", (double) house_raw->current_a);
+        telem_number(sink, "coil_current_x_raw", (double) house_raw->coil_current.x);
+        telem_number(sink, "coil_current_y_raw", (double) house_raw->coil_current.y);
+        telem_number(sink, "coil_current_z_raw", (double) house_raw->coil_current.z);
+        telem_number(sink, "coil_temp_x_raw", (double) house_raw->coil_temp.x);
+        telem_number(sink, "coil_temp_y_raw", (double) house_raw->coil_temp.y);
+        telem_number(sink, "coil_temp_z_raw", (double) house_raw->coil_temp.z);
+        telem_number(sink, "mcu_temp_raw", (double) house_raw->mcu_temp);
     }
-    else
+
+    /* Converted values */
+    if (snapshot->valid & IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_HOUSE_ENG))
     {
-        /* Raw ADC values */
-        json_append_member(buffer, "supply_voltage_digital_raw", json_mknumber((double) house_raw.voltage_d));
-        json_append_member(buffer, "supply_voltage_analog_raw", json_mknumber((double) house_raw.voltage_a));
-        json_append_member(buffer, "supply_current_digital_raw", json_mknumber((double) house_raw.current_d));
-        json_append_member(buffer, "supply_current_analog_raw", json_mknumber((double) house_raw.current_a));
-        json_append_member(buffer, "coil_current_x_raw", json_mknumber((double) house_raw.coil_current.x));
-        json_append_member(buffer, "coil_current_y_raw", json_mknumber((double) house_raw.coil_current.y));
-        json_append_member(buffer, "coil_current_z_raw", json_mknumber((double) house_raw.coil_current.z));
-        json_append_member(buffer, "coil_temp_x_raw", json_mknumber((double) house_raw.coil_temp.x));
-        json_append_member(buffer, "coil_temp_y_raw", json_mknumber((double) house_raw.coil_temp.y));
-        json_append_member(buffer, "coil_temp_z_raw", json_mknumber((double) house_raw.coil_temp.z));
-        json_append_member(buffer, "mcu_temp_raw", json_mknumber((double) house_raw.mcu_temp));
-
-        /* Converted values */
-        json_append_member(buffer, "supply_voltage_digital_eng", json_mknumber((double) house_eng.voltage_d));
-        json_append_member(buffer, "supply_voltage_analog_eng", json_mknumber((double) house_eng.voltage_a));
-        json_append_member(buffer, "supply_current_digital_eng", json_mknumber((double) house_eng.current_d));
-        json_append_member(buffer, "supply_current_analog_eng", json_mknumber((double) house_eng.current_a));
-        json_append_member(buffer, "coil_current_x_eng", json_mknumber((double) house_eng.coil_current.x));
-        json_append_member(buffer, "coil_current_y_eng", json_mknumber((double) house_eng.coil_current.y));
-        json_append_member(buffer, "coil_current_z_eng", json_mknumber((double) house_eng.coil_current.z));
-        json_append_member(buffer, "coil_temp_x_eng", json_mknumber((double) house_eng.coil_temp.x));
-        json_append_member(buffer, "coil_temp_y_eng", json_mknumber((double) house_eng.coil_temp.y));
-        json_append_member(buffer, "coil_temp_z_eng", json_mknumber((double) house_eng.coil_temp.z));
-        json_append_member(buffer, "mcu_temp_eng", json_mknumber((double) house_eng.mcu_temp));
+        telem_number(sink, "supply_voltage_digital_eng", (double) house_eng->voltage_d);
+        telem_number(sink, "supply_voltage_analog_eng", (double) house_eng->voltage_a);
+        telem_number(sink, "supply_current_digital_eng", (double) house_eng->current_d);
+        telem_number(sink, "supply_current_analog_eng", (double) house_eng->current_a);
+        telem_number(sink, "coil_current_x_eng", (double) house_eng->coil_current.x);
+        telem_number(sink, "coil_current_y_eng", (double) house_eng->coil_current.y);
+        telem_number(sink, "coil_current_z_eng", (double) house_eng->coil_current.z);
+        telem_number(sink, "coil_temp_x_eng", (double) house_eng->coil_temp.x);
+        telem_number(sink, "coil_temp_y_eng", (double) house_eng->coil_temp.y);
+        telem_number(sink, "coil_temp_z_eng", (double) house_eng->coil_temp.z);
+        telem_number(sink, "mcu_temp_eng", (double) house_eng->mcu_temp);
     }
 
     /* Data during last detumble loop */
-    nom_status = k_imtq_get_detumble(&detumble);
-    if (nom_status != ADCS_OK)
-    {
-        status = ADCS_ERROR;
-    }
-    else
-    {
-        json_append_member(buffer, "detumble_calib_mtm_x", json_mknumber((double) detumble.mtm_calib.x));
-        json_append_member(buffer, "detumble_calib_mtm_y", json_mknumber((double) detumble.mtm_calib.y));
-        json_append_member(buffer, "detumble_calib_mtm_z", json_mknumber((double) detumble.mtm_calib.z));
-        json_append_member(buffer, "detumble_filter_mtm_x", json_mknumber((double) detumble.mtm_filter.x));
-        json_append_member(buffer, "detumble_filter_mtm_y", json_mknumber((double) detumble.mtm_filter.y));
-        json_append_member(buffer, "detumble_filter_mtm_z", json_mknumber((double) detumble.mtm_filter.z));
-        json_append_member(buffer, "detumble_bdot_x", json_mknumber((double) detumble.bdot.x));
-        json_append_member(buffer, "detumble_bdot_y", json_mknumber((double) detumble.bdot.y));
-        json_append_member(buffer, "detumble_bdot_z", json_mknumber((double) detumble.bdot.z));
-        json_append_member(buffer, "detumble_dipole_x", json_mknumber((double) detumble.dipole.x));
-        json_append_member(buffer, "detumble_dipole_y", json_mknumber((double) detumble.dipole.y));
-        json_append_member(buffer, "detumble_dipole_z", json_mknumber((double) detumble.dipole.z));
-        json_append_member(buffer, "detumble_cmd_current_x", json_mknumber((double) detumble.cmd_current.x));
-        json_append_member(buffer, "detumble_cmd_current_y", json_mknumber((double) detumble.cmd_current.y));
-        json_append_member(buffer, "detumble_cmd_current_z", json_mknumber((double) detumble.cmd_current.z));
-        json_append_member(buffer, "detumble_coil_current_x", json_mknumber((double) detumble.coil_current.x));
-        json_append_member(buffer, "detumble_coil_current_y", json_mknumber((double) detumble.coil_current.y));
-        json_append_member(buffer, "detumble_coil_current_z", json_mknumber((double) detumble.coil_current.z));
+    if (snapshot->valid & IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_DETUMBLE))
+    {
+        telem_number(sink, "detumble_calib_mtm_x", (double) detumble->mtm_calib.x);
+        telem_number(sink, "detumble_calib_mtm_y", (double) detumble->mtm_calib.y);
+        telem_number(sink, "detumble_calib_mtm_z", (double) detumble->mtm_calib.z);
+        telem_number(sink, "detumble_filter_mtm_x", (double) detumble->mtm_filter.x);
+        telem_number(sink, "detumble_filter_mtm_y", (double) detumble->mtm_filter.y);
+        telem_number(sink, "detumble_filter_mtm_z", (double) detumble->mtm_filter.z);
+        telem_number(sink, "detumble_bdot_x", (double) detumble->bdot.x);
+        telem_number(sink, "detumble_bdot_y", (double) detumble->bdot.y);
+        telem_number(sink, "detumble_bdot_z", (double) detumble->bdot.z);
+        telem_number(sink, "detumble_dipole_x", (double) detumble->dipole.x);
+        telem_number(sink, "detumble_dipole_y", (double) detumble->dipole.y);
+        telem_number(sink, "detumble_dipole_z", (double) detumble->dipole.z);
+        telem_number(sink, "detumble_cmd_current_x", (double) detumble->cmd_current.x);
+        telem_number(sink, "detumble_cmd_current_y", (double) detumble->cmd_current.y);
+        telem_number(sink, "detumble_cmd_current_z", (double) detumble->cmd_current.z);
+        telem_number(sink, "detumble_coil_current_x", (double) detumble->coil_current.x);
+        telem_number(sink, "detumble_coil_current_y", (double) detumble->coil_current.y);
+        telem_number(sink, "detumble_coil_current_z", (double) detumble->coil_current.z);
     }
 
     /* Current magnetometer measurements */
-    nom_status = k_imtq_start_measurement();
-    if (nom_status != ADCS_OK)
+    if (snapshot->valid & IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_MTM_RAW))
     {
-        status = ADCS_ERROR;
+        telem_string(sink, "mtm_actuating", (snapshot->mtm_raw.act_status) ? "yes" : "no");
+        telem_number(sink, "mtm_x_raw", (double) snapshot->mtm_raw.data.x);
+        telem_number(sink, "mtm_y_raw", (double) snapshot->mtm_raw.data.y);
+        telem_number(sink, "mtm_z_raw", (double) snapshot->mtm_raw.data.z);
     }
-    else
+    if (snapshot->valid & IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_MTM_CALIB))
     {
-        const struct timespec TRANSFER_DELAY
-            = {.tv_sec = 0, .tv_nsec = 1000001 };
-
-        nanosleep(&TRANSFER_DELAY, NULL);
-
-        nom_status = k_imtq_get_raw_mtm(&mtm_raw);
-        nom_status |= k_imtq_get_calib_mtm(&mtm_calib);
-
-        if (nom_status != ADCS_OK)
-        {
-            status = ADCS_ERROR;
-        }
-        else
-        {
-            json_append_member(buffer, "mtm_actuating", json_mkstring((mtm_raw.act_status) ? "yes" : "no"));
-            json_append_member(buffer, "mtm_x_raw", json_mknumber((double) mtm_raw.data.x));
-            json_append_member(buffer, "mtm_y_raw", json_mknumber((double) mtm_raw.data.y));
-            json_append_member(buffer, "mtm_z_raw", json_mknumber((double) mtm_raw.data.z));
-            json_append_member(buffer, "mtm_x_calib", json_mknumber((double) mtm_calib.data.x));
-            json_append_member(buffer, "mtm_y_calib", json_mknumber((double) mtm_calib.data.y));
-            json_append_member(buffer, "mtm_z_calib", json_mknumber((double) mtm_calib.data.z));
-        }
+        telem_number(sink, "mtm_x_calib", (double) snapshot->mtm_calib.data.x);
+        telem_number(sink, "mtm_y_calib", (double) snapshot->mtm_calib.data.y);
+        telem_number(sink, "mtm_z_calib", (double) snapshot->mtm_calib.data.z);
     }
 
     /* Commanded actuation dipole */
-    nom_status = k_imtq_get_dipole(&dipole);
-    if (nom_status != ADCS_OK)
-    {
-        status = ADCS_ERROR;
-    }
-    else
+    if (snapshot->valid & IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_DIPOLE))
     {
-        json_append_member(buffer, "dipole_x", json_mknumber((double) dipole.data.x));
-        json_append_member(buffer, "dipole_y", json_mknumber((double) dipole.data.y));
-        json_append_member(buffer, "dipole_z", json_mknumber((double) dipole.data.z));
+        telem_number(sink, "dipole_x", (double) snapshot->dipole.data.x);
+        telem_number(sink, "dipole_y", (double) snapshot->dipole.data.y);
+        telem_number(sink, "dipole_z", (double) snapshot->dipole.data.z);
     }
-
-    return status;
 }
 
-KADCSStatus kprv_adcs_get_debug_telemetry(JsonNode * buffer)
+static KADCSStatus get_debug_telemetry(imtq_telem_sink * sink)
 {
     KADCSStatus      status = ADCS_OK;
     KADCSStatus      debug_status;
     imtq_config_resp config_data;
 
-    if (buffer == NULL)
-    {
-        return ADCS_ERROR_CONFIG;
-    }
+    /*
+     * Each parameter is a separate transfer, so control commands only ever
+     * wait for one of them
+     */
+    const KArbiterRequest SWEEP = {.priority = ARBITER_BULK, .deadline = NULL };
 
     /* Get all of the configuration values */
     int num_config_params
         = sizeof(adcs_config_params) / sizeof(adcs_config_params[0]);
     for (int i = 0; i < num_config_params; i++)
     {
-        debug_status = k_imtq_get_param(adcs_config_params[i], &config_data);
+        debug_status = kprv_imtq_get_param(adcs_config_params[i], &config_data,
+                                           &SWEEP);
         if (debug_status == ADCS_OK)
         {
             char param[7] = { 0 };
@@ -348,34 +604,34 @@ KADCSStatus kprv_adcs_get_debug_telemetry(JsonNode * buffer)
             switch (adcs_config_params[i] >> 12)
             {
                 case 0x1:
-                    json_append_member(buffer, param, json_mknumber((double) config_data.value.int8_val));
+                    telem_number(sink, param, (double) config_data.value.int8_val);
                     break;
                 case 0x2:
-                    json_append_member(buffer, param, json_mknumber((double) config_data.value.uint8_val));
+                    telem_number(sink, param, (double) config_data.value.uint8_val);
                     break;
                 case 0x3:
-                    json_append_member(buffer, param, json_mknumber((double) config_data.value.int16_val));
+                    telem_number(sink, param, (double) config_data.value.int16_val);
                     break;
                 case 0x4:
-                    json_append_member(buffer, param, json_mknumber((double) config_data.value.uint16_val));
+                    telem_number(sink, param, (double) config_data.value.uint16_val);
                     break;
                 case 0x5:
-                    json_append_member(buffer, param, json_mknumber((double) config_data.value.int32_val));
+                    telem_number(sink, param, (double) config_data.value.int32_val);
                     break;
                 case 0x6:
-                    json_append_member(buffer, param, json_mknumber((double) config_data.value.uint32_val));
+                    telem_number(sink, param, (double) config_data.value.uint32_val);
                     break;
                 case 0x7:
-                    json_append_member(buffer, param, json_mknumber((double) config_data.value.float_val));
+                    telem_number(sink, param, (double) config_data.value.float_val);
                     break;
                 case 0x8:
-                    json_append_member(buffer, param, json_mknumber((double) config_data.value.int64_val));
+                    telem_number(sink, param, (double) config_data.value.int64_val);
                     break;
                 case 0x9:
-                    json_append_member(buffer, param, json_mknumber((double) config_data.value.uint64_val));
+                    telem_number(sink, param, (double) config_data.value.uint64_val);
                     break;
                 case 0xA:
-                    json_append_member(buffer, param, json_mknumber(config_data.value.double_val));
+                    telem_number(sink, param, config_data.value.double_val);
                     break;
                 default:
                     /* We shouldn't ever get here... */
@@ -398,14 +654,14 @@ KADCSStatus kprv_adcs_get_debug_telemetry(JsonNode * buffer)
     debug_status              = k_imtq_get_test_results_all(&data);
     if (debug_status == ADCS_OK)
     {
-        kprv_adcs_process_test(buffer, data.init);
-        kprv_adcs_process_test(buffer, data.x_pos);
-        kprv_adcs_process_test(buffer, data.x_neg);
-        kprv_adcs_process_test(buffer, data.y_pos);
-        kprv_adcs_process_test(buffer, data.y_neg);
-        kprv_adcs_process_test(buffer, data.z_pos);
-        kprv_adcs_process_test(buffer, data.z_neg);
-        kprv_adcs_process_test(buffer, data.final);
+        process_test(sink, data.init);
+        process_test(sink, data.x_pos);
+        process_test(sink, data.x_neg);
+        process_test(sink, data.y_pos);
+        process_test(sink, data.y_neg);
+        process_test(sink, data.z_pos);
+        process_test(sink, data.z_neg);
+        process_test(sink, data.final);
     }
     else if (debug_status != ADCS_ERROR_INTERNAL
              && kprv_imtq_check_error(data.init.hdr.status) != IMTQ_ERROR_MODE)
@@ -425,13 +681,8 @@ KADCSStatus kprv_adcs_get_debug_telemetry(JsonNode * buffer)
     return status;
 }
 
-void kprv_adcs_process_test(JsonNode * parent, imtq_test_result test)
+static void process_test(imtq_telem_sink * sink, imtq_test_result test)
 {
-    if (parent == NULL)
-    {
-        return;
-    }
-
     if (test.hdr.cmd != GET_TEST)
     {
         /*
@@ -477,19 +728,19 @@ void kprv_adcs_process_test(JsonNode * parent, imtq_test_result test)
     sprintf(coil_temp_y, "tr_%s_coil_temp_y", step);
     sprintf(coil_temp_z, "tr_%s_coil_temp_z", step);
 
-    json_append_member(parent, error, json_mknumber((double) test.error));
-    json_append_member(parent, mtm_raw_x, json_mknumber((double) test.mtm_raw.x));
-    json_append_member(parent, mtm_raw_y, json_mknumber((double) test.mtm_raw.y));
-    json_append_member(parent, mtm_raw_z, json_mknumber((double) test.mtm_raw.z));
-    json_append_member(parent, mtm_calib_x, json_mknumber((double) test.mtm_calib.x));
-    json_append_member(parent, mtm_calib_y, json_mknumber((double) test.mtm_calib.y));
-    json_append_member(parent, mtm_calib_z, json_mknumber((double) test.mtm_calib.z));
-    json_append_member(parent, coil_current_x, json_mknumber((double) test.coil_current.x));
-    json_append_member(parent, coil_current_y, json_mknumber((double) test.coil_current.y));
-    json_append_member(parent, coil_current_z, json_mknumber((double) test.coil_current.z));
-    json_append_member(parent, coil_temp_x, json_mknumber((double) test.coil_temp.x));
-    json_append_member(parent, coil_temp_y, json_mknumber((double) test.coil_temp.y));
-    json_append_member(parent, coil_temp_z, json_mknumber((double) test.coil_temp.z));
+    telem_number(sink, error, (double) test.error);
+    telem_number(sink, mtm_raw_x, (double) test.mtm_raw.x);
+    telem_number(sink, mtm_raw_y, (double) test.mtm_raw.y);
+    telem_number(sink, mtm_raw_z, (double) test.mtm_raw.z);
+    telem_number(sink, mtm_calib_x, (double) test.mtm_calib.x);
+    telem_number(sink, mtm_calib_y, (double) test.mtm_calib.y);
+    telem_number(sink, mtm_calib_z, (double) test.mtm_calib.z);
+    telem_number(sink, coil_current_x, (double) test.coil_current.x);
+    telem_number(sink, coil_current_y, (double) test.coil_current.y);
+    telem_number(sink, coil_current_z, (double) test.coil_current.z);
+    telem_number(sink, coil_temp_x, (double) test.coil_temp.x);
+    telem_number(sink, coil_temp_y, (double) test.coil_temp.y);
+    telem_number(sink, coil_temp_z, (double) test.coil_temp.z);
 }
 
 /* iMTQ-specific functions */
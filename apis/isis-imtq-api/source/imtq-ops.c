@@ -176,8 +176,8 @@ KADCSStatus k_imtq_cancel_op(void)
     uint8_t          cmd    = CANCEL_OP;
     imtq_resp_header response;
 
-    status = kprv_imtq_transfer(&cmd, 1, (uint8_t *) &response,
-                                sizeof(response), NULL);
+    status = kprv_imtq_control_transfer(&cmd, 1, (uint8_t *) &response,
+                                        sizeof(response));
     if (status != ADCS_OK)
     {
         fprintf(stderr, "Failed to execute iMTQ cancel command: %d\n", status);
@@ -217,8 +217,8 @@ KADCSStatus k_imtq_start_actuation_current(imtq_axis_data current, uint16_t time
 
     imtq_resp_header response;
 
-    status = kprv_imtq_transfer(packet, sizeof(packet), (uint8_t *) &response,
-                                sizeof(response), NULL);
+    status = kprv_imtq_control_transfer(packet, sizeof(packet),
+                                        (uint8_t *) &response, sizeof(response));
     if (status != ADCS_OK)
     {
         fprintf(stderr, "Failed to start iMTQ actuation (current): %d\n",
@@ -248,8 +248,8 @@ KADCSStatus k_imtq_start_actuation_dipole(imtq_axis_data dipole, uint16_t time)
 
     imtq_resp_header response;
 
-    status = kprv_imtq_transfer(packet, sizeof(packet), (uint8_t *) &response,
-                                sizeof(response), NULL);
+    status = kprv_imtq_control_transfer(packet, sizeof(packet),
+                                        (uint8_t *) &response, sizeof(response));
     if (status != ADCS_OK)
     {
         fprintf(stderr, "Failed to start iMTQ actuation (dipole): %d\n",
@@ -280,8 +280,8 @@ KADCSStatus k_imtq_start_actuation_PWM(imtq_axis_data pwm, uint16_t time)
 
     imtq_resp_header response;
 
-    status = kprv_imtq_transfer(packet, sizeof(packet), (uint8_t *) &response,
-                                sizeof(response), NULL);
+    status = kprv_imtq_control_transfer(packet, sizeof(packet),
+                                        (uint8_t *) &response, sizeof(response));
     if (status != ADCS_OK)
     {
         fprintf(stderr, "Failed to start iMTQ actuation (PWM): %d\n", status);
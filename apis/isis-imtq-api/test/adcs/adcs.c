@@ -323,6 +323,274 @@ static void test_get_telemetry_debug(void ** arg)
     assert_true(json_ret);
 }
 
+static void test_get_telemetry_debug_arena(void ** arg)
+{
+    KADCSStatus ret;
+    JsonNode *  member;
+    bool        same_arena = true;
+
+    JsonArena * arena   = json_arena_create(0);
+    JsonNode *  results = json_mkobject_a(arena);
+
+    /* System State */
+    expect_value(__wrap_write, cmd, GET_STATE);
+    expect_value(__wrap_read, len, sizeof(imtq_state));
+    will_return(__wrap_read, &state);
+
+    /* Debug Telemetry: */
+    /* Current Configuration */
+    expect_value_count(__wrap_write, cmd, GET_PARAM, NUM_CONFIG_PARAMS);
+    expect_value_count(__wrap_read, len, sizeof(config_resp),
+                       NUM_CONFIG_PARAMS);
+    will_return_count(__wrap_read, &config_resp, NUM_CONFIG_PARAMS);
+
+    /* Last Test Results */
+    expect_value(__wrap_write, cmd, GET_TEST);
+    expect_value(__wrap_read, len, sizeof(test_results_all));
+    will_return(__wrap_read, &test_results_all);
+
+    ret = k_adcs_get_telemetry(DEBUG, results);
+
+    int json_ret = json_check(results, NULL);
+    json_foreach(member, results)
+    {
+        same_arena &= (json_node_arena(member) == arena);
+    }
+
+    /* The whole tree is released with the arena */
+    json_arena_destroy(arena);
+
+    assert_int_equal(ret, ADCS_OK);
+    assert_true(json_ret);
+    assert_true(same_arena);
+}
+
+static void test_write_telemetry_nominal(void ** arg)
+{
+    KADCSStatus ret;
+    char        buf[2048];
+    JsonWriter  writer;
+
+    json_writer_init(&writer, buf, sizeof(buf));
+
+    /* System State */
+    expect_value(__wrap_write, cmd, GET_STATE);
+    expect_value(__wrap_read, len, sizeof(imtq_state));
+    will_return(__wrap_read, &state);
+
+    /* Nominal Telemetry: */
+    /* Raw Housekeeping */
+    expect_value(__wrap_write, cmd, GET_HOUSE_RAW);
+    expect_value(__wrap_read, len, sizeof(house_raw));
+    will_return(__wrap_read, &house_raw);
+    /* Engineering Housekeeping */
+    expect_value(__wrap_write, cmd, GET_HOUSE_ENG);
+    expect_value(__wrap_read, len, sizeof(house_eng));
+    will_return(__wrap_read, &house_eng);
+    /* Last Detumble Data */
+    expect_value(__wrap_write, cmd, GET_DETUMBLE);
+    expect_value(__wrap_read, len, sizeof(detumble));
+    will_return(__wrap_read, &detumble);
+    /* (Prep for measurement requests) */
+    expect_value(__wrap_write, cmd, START_MEASURE);
+    expect_value(__wrap_read, len, sizeof(imtq_resp_header));
+    will_return(__wrap_read, &response);
+    /* Current Raw MTM Measurement */
+    expect_value(__wrap_write, cmd, GET_MTM_RAW);
+    expect_value(__wrap_read, len, sizeof(mtm));
+    will_return(__wrap_read, &mtm);
+    /* Current Calibrated MTM Measurement */
+    expect_value(__wrap_write, cmd, GET_MTM_CALIB);
+    expect_value(__wrap_read, len, sizeof(mtm));
+    will_return(__wrap_read, &mtm);
+    /* Last Dipole Data */
+    expect_value(__wrap_write, cmd, GET_DIPOLE);
+    expect_value(__wrap_read, len, sizeof(dipole));
+    will_return(__wrap_read, &dipole);
+
+    ret = k_imtq_write_telemetry(NOMINAL, &writer);
+
+    assert_int_equal(ret, ADCS_OK);
+    assert_true(json_writer_finish(&writer));
+
+    /* The output should hold the same data as the tree version */
+    JsonNode * results = json_decode(buf);
+    assert_non_null(results);
+    assert_non_null(json_find_member(results, "system_mode"));
+    assert_non_null(json_find_member(results, "mcu_temp_eng"));
+    assert_non_null(json_find_member(results, "dipole_z"));
+    json_delete(results);
+}
+
+static void test_write_telemetry_overflow(void ** arg)
+{
+    KADCSStatus ret;
+    char        buf[16];
+    JsonWriter  writer;
+
+    json_writer_init(&writer, buf, sizeof(buf));
+
+    /* System State */
+    expect_value(__wrap_write, cmd, GET_STATE);
+    expect_value(__wrap_read, len, sizeof(imtq_state));
+    will_return(__wrap_read, &state);
+
+    /* Debug Telemetry: */
+    /* Current Configuration */
+    expect_value_count(__wrap_write, cmd, GET_PARAM, NUM_CONFIG_PARAMS);
+    expect_value_count(__wrap_read, len, sizeof(config_resp),
+                       NUM_CONFIG_PARAMS);
+    will_return_count(__wrap_read, &config_resp, NUM_CONFIG_PARAMS);
+
+    /* Last Test Results */
+    expect_value(__wrap_write, cmd, GET_TEST);
+    expect_value(__wrap_read, len, sizeof(test_results_all));
+    will_return(__wrap_read, &test_results_all);
+
+    ret = k_imtq_write_telemetry(DEBUG, &writer);
+
+    /* The data was all fetched, but didn't fit */
+    assert_int_equal(ret, ADCS_OK);
+    assert_false(json_writer_finish(&writer));
+}
+
+static void test_write_telemetry_null(void ** arg)
+{
+    assert_int_equal(k_imtq_write_telemetry(NOMINAL, NULL), ADCS_ERROR_CONFIG);
+}
+
+static bool stamp_before(const struct timespec * a, const struct timespec * b)
+{
+    return a->tv_sec < b->tv_sec
+           || (a->tv_sec == b->tv_sec && a->tv_nsec <= b->tv_nsec);
+}
+
+static void test_get_snapshot_all(void ** arg)
+{
+    KADCSStatus             ret;
+    imtq_telemetry_snapshot snapshot = { 0 };
+    imtq_housekeeping_eng   eng      = {.mcu_temp = 23 };
+    imtq_dipole             dip      = {.data = {.x = -5 } };
+
+    /* Everything comes back in a single sweep, starting with the state */
+    expect_value(__wrap_write, cmd, GET_STATE);
+    expect_value(__wrap_read, len, sizeof(imtq_state));
+    will_return(__wrap_read, &state);
+    expect_value(__wrap_write, cmd, GET_HOUSE_RAW);
+    expect_value(__wrap_read, len, sizeof(house_raw));
+    will_return(__wrap_read, &house_raw);
+    expect_value(__wrap_write, cmd, GET_HOUSE_ENG);
+    expect_value(__wrap_read, len, sizeof(eng));
+    will_return(__wrap_read, &eng);
+    expect_value(__wrap_write, cmd, GET_DETUMBLE);
+    expect_value(__wrap_read, len, sizeof(detumble));
+    will_return(__wrap_read, &detumble);
+    expect_value(__wrap_write, cmd, START_MEASURE);
+    expect_value(__wrap_read, len, sizeof(imtq_resp_header));
+    will_return(__wrap_read, &response);
+    expect_value(__wrap_write, cmd, GET_MTM_RAW);
+    expect_value(__wrap_read, len, sizeof(mtm));
+    will_return(__wrap_read, &mtm);
+    expect_value(__wrap_write, cmd, GET_MTM_CALIB);
+    expect_value(__wrap_read, len, sizeof(mtm));
+    will_return(__wrap_read, &mtm);
+    expect_value(__wrap_write, cmd, GET_DIPOLE);
+    expect_value(__wrap_read, len, sizeof(dip));
+    will_return(__wrap_read, &dip);
+
+    ret = k_imtq_get_telemetry_snapshot(&snapshot, IMTQ_SNAPSHOT_ALL);
+
+    assert_int_equal(ret, ADCS_OK);
+    assert_int_equal(snapshot.valid, IMTQ_SNAPSHOT_ALL);
+    assert_int_equal(snapshot.state.uptime, state.uptime);
+    assert_int_equal(snapshot.house_eng.mcu_temp, 23);
+    assert_int_equal(snapshot.dipole.data.x, -5);
+    assert_true(snapshot.stamp[IMTQ_SNAPSHOT_STATE].tv_sec != 0
+                || snapshot.stamp[IMTQ_SNAPSHOT_STATE].tv_nsec != 0);
+    assert_true(stamp_before(&snapshot.stamp[IMTQ_SNAPSHOT_STATE],
+                             &snapshot.stamp[IMTQ_SNAPSHOT_MTM_RAW]));
+    assert_true(stamp_before(&snapshot.stamp[IMTQ_SNAPSHOT_MTM_RAW],
+                             &snapshot.stamp[IMTQ_SNAPSHOT_DIPOLE]));
+}
+
+static void test_get_snapshot_partial(void ** arg)
+{
+    KADCSStatus             ret;
+    imtq_telemetry_snapshot snapshot = { 0 };
+    imtq_dipole             dip      = {.hdr = {.status = IMTQ_ERROR } };
+
+    /* Parts fetched earlier are kept as they were */
+    snapshot.valid = IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_HOUSE_ENG)
+                     | IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_DIPOLE);
+    snapshot.house_eng.mcu_temp = 42;
+
+    /* Only the calibrated MTM measurement and the dipole are requested */
+    expect_value(__wrap_write, cmd, START_MEASURE);
+    expect_value(__wrap_read, len, sizeof(imtq_resp_header));
+    will_return(__wrap_read, &response);
+    expect_value(__wrap_write, cmd, GET_MTM_CALIB);
+    expect_value(__wrap_read, len, sizeof(mtm));
+    will_return(__wrap_read, &mtm);
+    expect_value(__wrap_write, cmd, GET_DIPOLE);
+    expect_value(__wrap_read, len, sizeof(dip));
+    will_return(__wrap_read, &dip);
+
+    ret = k_imtq_get_telemetry_snapshot(&snapshot,
+                                        IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_MTM_CALIB)
+                                        | IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_DIPOLE));
+
+    /* The iMTQ rejected the dipole request, so that part is no longer valid */
+    assert_int_equal(ret, ADCS_ERROR);
+    assert_int_equal(snapshot.valid,
+                     IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_HOUSE_ENG)
+                     | IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_MTM_CALIB));
+    assert_int_equal(snapshot.house_eng.mcu_temp, 42);
+}
+
+static void test_get_snapshot_bad_args(void ** arg)
+{
+    imtq_telemetry_snapshot snapshot = { 0 };
+
+    assert_int_equal(k_imtq_get_telemetry_snapshot(NULL, IMTQ_SNAPSHOT_ALL),
+                     ADCS_ERROR_CONFIG);
+    assert_int_equal(k_imtq_get_telemetry_snapshot(&snapshot, 0),
+                     ADCS_ERROR_CONFIG);
+    assert_int_equal(k_imtq_get_telemetry_snapshot(&snapshot, IMTQ_SNAPSHOT_ALL + 1),
+                     ADCS_ERROR_CONFIG);
+}
+
+static void test_snapshot_json(void ** arg)
+{
+    imtq_telemetry_snapshot snapshot = { 0 };
+    JsonNode *              results  = json_mkobject();
+    char                    buf[512];
+    JsonWriter              writer;
+
+    snapshot.valid       = IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_STATE)
+                     | IMTQ_SNAPSHOT_BIT(IMTQ_SNAPSHOT_DIPOLE);
+    snapshot.state       = state;
+    snapshot.dipole.data.z = 7;
+    snapshot.house_eng.mcu_temp = 99;
+
+    /* Only the valid parts are serialized */
+    assert_int_equal(k_imtq_snapshot_json(&snapshot, results), ADCS_OK);
+    assert_string_equal(json_find_member(results, "system_mode")->string_, "SELFTEST");
+    assert_int_equal(json_find_member(results, "dipole_z")->number_, 7);
+    assert_null(json_find_member(results, "mcu_temp_eng"));
+
+    json_writer_init(&writer, buf, sizeof(buf));
+    assert_int_equal(k_imtq_write_snapshot(&snapshot, &writer), ADCS_OK);
+    assert_true(json_writer_finish(&writer));
+
+    char * encoded = json_encode(results);
+    assert_string_equal(buf, encoded);
+    free(encoded);
+    json_delete(results);
+
+    assert_int_equal(k_imtq_snapshot_json(NULL, results), ADCS_ERROR_CONFIG);
+    assert_int_equal(k_imtq_write_snapshot(&snapshot, NULL), ADCS_ERROR_CONFIG);
+}
+
 static void test_passthrough(void ** arg)
 {
     KADCSStatus ret;
@@ -377,6 +645,14 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_get_spin, init, term),
         cmocka_unit_test_setup_teardown(test_get_telemetry_nominal, init, term),
         cmocka_unit_test_setup_teardown(test_get_telemetry_debug, init, term),
+        cmocka_unit_test_setup_teardown(test_get_telemetry_debug_arena, init, term),
+        cmocka_unit_test_setup_teardown(test_write_telemetry_nominal, init, term),
+        cmocka_unit_test_setup_teardown(test_write_telemetry_overflow, init, term),
+        cmocka_unit_test_setup_teardown(test_write_telemetry_null, init, term),
+        cmocka_unit_test_setup_teardown(test_get_snapshot_all, init, term),
+        cmocka_unit_test_setup_teardown(test_get_snapshot_partial, init, term),
+        cmocka_unit_test(test_get_snapshot_bad_args),
+        cmocka_unit_test(test_snapshot_json),
         cmocka_unit_test_setup_teardown(test_passthrough, init, term),
     };
 
@@ -798,6 +798,40 @@ static void test_transfer_error(void ** arg)
     assert_int_equal(ret, ADCS_ERROR_INTERNAL);
 }
 
+static void test_queue_stats(void ** arg)
+{
+    KArbiterStats  stats;
+    imtq_axis_data data = { 0 };
+
+    /* Actuation commands are control requests */
+    expect_value(__wrap_write, cmd, START_DIPOLE);
+    expect_value(__wrap_read, len, sizeof(imtq_resp_header));
+    will_return(__wrap_read, &response);
+    assert_int_equal(k_imtq_start_actuation_dipole(data, 10), ADCS_OK);
+
+    assert_int_equal(k_imtq_get_queue_stats(ARBITER_CONTROL, &stats), ADCS_OK);
+    assert_int_equal(stats.acquired, 1);
+    assert_int_equal(stats.deadline_misses, 0);
+
+    /* Nothing has swept the telemetry */
+    assert_int_equal(k_imtq_get_queue_stats(ARBITER_BULK, &stats), ADCS_OK);
+    assert_int_equal(stats.acquired, 0);
+
+    /* The noop sent by k_adcs_init is an ordinary request */
+    assert_int_equal(k_imtq_get_queue_stats(ARBITER_NORMAL, &stats), ADCS_OK);
+    assert_int_equal(stats.acquired, 1);
+}
+
+static void test_queue_stats_bad_args(void ** arg)
+{
+    KArbiterStats stats;
+
+    assert_int_equal(k_imtq_get_queue_stats(ARBITER_CONTROL + 1, &stats),
+                     ADCS_ERROR_CONFIG);
+    assert_int_equal(k_imtq_get_queue_stats(ARBITER_CONTROL, NULL),
+                     ADCS_ERROR_CONFIG);
+}
+
 /* End of Test Declarations */
 
 static int init(void ** state)
@@ -891,6 +925,8 @@ int main(void)
             cmocka_unit_test_setup_teardown(test_transfer_cmd_mismatch, init, term),
             cmocka_unit_test_setup_teardown(test_transfer_no_resp, init, term),
             cmocka_unit_test_setup_teardown(test_transfer_error, init, term),
+            cmocka_unit_test_setup_teardown(test_queue_stats, init, term),
+            cmocka_unit_test_setup_teardown(test_queue_stats_bad_args, init, term),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
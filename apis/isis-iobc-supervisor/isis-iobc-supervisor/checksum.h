@@ -61,6 +61,9 @@ uint8_t checksum_calculate_CRC8(const uint8_t * data, unsigned int length, uint8
 
 /**
  * Calculates a CRC checksum according to the algorithm used in the iOBC supervisor.
+ *
+ * This is a wrapper around the kubos-hal `k_crc8` function, which should be
+ * preferred by new code.
  * @param[in] data Pointer to data to calculate the checksum for.
  * @param[in] length Length of the data in bytes
  * @return uint8_t 8-bit CRC checksum.
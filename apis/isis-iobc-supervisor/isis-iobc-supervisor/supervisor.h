@@ -251,6 +251,24 @@ typedef union __attribute__((__packed__))  {
     } /** Individual housekeeping fields */ fields;
 } supervisor_housekeeping_t;
 
+/**
+ * @brief Opens the connection to the Supervisor Controller.
+ *
+ * The connection is kept open between commands. Calling this function is
+ * optional, since the first command will open the connection if needed, but
+ * it allows any problems with the SPI device to be found up front.
+ *
+ * @return true if the connection is open, otherwise false
+ */
+bool supervisor_open();
+
+/**
+ * @brief Closes the connection to the Supervisor Controller.
+ *
+ * Any later command will reopen the connection.
+ */
+void supervisor_close();
+
 /**
  * @brief Performs a software reset of the microcontroller directly without shutting down its components.
  * As this command is considered unsafe for the hardware and the software of the IOBC-S, use supervisor_reset() instead.
@@ -16,10 +16,7 @@
  */
 
 #include <checksum.h>
-
-#define CRC8_POLYNOMIAL 0x07
-
-static uint8_t supervisor_crctable[256];
+#include <crc.h>
 
 void checksum_prepare_LUTCRC8(uint8_t polynomial, uint8_t * LUT)
 {
@@ -109,13 +106,6 @@ uint8_t checksum_calculate_CRC8(const uint8_t * data, unsigned int length, uint8
 
 uint8_t supervisor_calculate_CRC(const uint8_t * data, unsigned int length)
 {
-    unsigned int i = 0;
-    uint8_t crcvalue = 0;
-    checksum_prepare_LUTCRC8(CRC8_POLYNOMIAL, supervisor_crctable);
-
-    for (i = 0; i < length; i++)
-    {
-        crcvalue = supervisor_crctable[data[i] ^ crcvalue];
-    }
-    return crcvalue;
+    /* The supervisor uses plain CRC-8 (polynomial 0x07, zero initial value) */
+    return k_crc8(K_CRC8_INIT, data, length);
 }
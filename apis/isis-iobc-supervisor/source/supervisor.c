@@ -18,6 +18,8 @@
 #include <checksum.h>
 #include <fcntl.h>
 #include <linux/spi/spidev.h>
+#include <pacing.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/ioctl.h>
@@ -38,20 +40,50 @@
 /** Obtain Version and Configuration Command in hexadecimal. */
 #define CMD_SUPERVISOR_OBTAIN_VERSION_CONFIG 0x55
 
-static bool spi_comms(const uint8_t * tx_buffer, uint8_t * rx_buffer, uint16_t tx_length)
+/* Longest message exchanged with the supervisor */
+#define SUPERVISOR_MAX_LENGTH LENGTH_TELEMETRY_HOUSEKEEPING
+
+/*
+ * ISIS suggested at least 1 ms between bytes, and the supervisor needs time
+ * to prepare its response after a sample request
+ */
+#define SUPERVISOR_BYTE_GAP_US 1000
+#define SUPERVISOR_SAMPLE_GAP_NS 10000000
+
+static const struct timespec SAMPLE_GAP = {.tv_sec = 0, .tv_nsec = SUPERVISOR_SAMPLE_GAP_NS };
+
+/*
+ * Connection to the supervisor, kept open between commands
+ *
+ * The mutex serializes whole messages, and sample/obtain pairs, since the
+ * supervisor can't cope with bytes from two commands being interleaved. It
+ * also covers the pacer, which does no locking of its own.
+ */
+typedef struct {
+    int             fd;     /* spidev descriptor (-1 if not open) */
+    KPacer          pacer;  /* Tracks the time since the last byte exchanged */
+    pthread_mutex_t mutex;
+} supervisor_session;
+
+static supervisor_session session = {
+    .fd = -1,
+    .pacer = {.min_gap = {.tv_sec = 0, .tv_nsec = SUPERVISOR_BYTE_GAP_US * 1000 } },
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+/* Open the SPI device if needed. The caller must hold the session mutex */
+static bool kprv_supervisor_open(void)
 {
-    int fd, ret;
     static uint32_t speed = 1000000;
 
-    if ((tx_buffer == NULL) || (rx_buffer == NULL))
+    if (session.fd >= 0)
     {
-        return false;
+        return true;
     }
 
-    char checksum = supervisor_calculate_CRC(tx_buffer, tx_length - 1);
-
-    fd = open(SPI_DEV, O_RDWR);
-    if (fd < 0) {
+    int fd = open(SPI_DEV, O_RDWR);
+    if (fd < 0)
+    {
         perror("Can't open device ");
         return false;
     }
@@ -59,58 +91,108 @@ static bool spi_comms(const uint8_t * tx_buffer, uint8_t * rx_buffer, uint16_t t
     /*
      * Setting SPI bus speed
      */
-    ret = ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
-    if (ret == -1) {
+    if (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1)
+    {
         perror("Can't set max speed hz");
+        close(fd);
         return false;
     }
 
-    /**
-     * Messages are sent across one byte per ioctl call
-     * This is to introduce inter-byte delays, as per
-     * discussion with ISIS on 3/31. They suggested
-     * at least 1 ms between bytes.
-     */
-    for (uint16_t i = 0; i < tx_length - 1; i++)
-    {
-        struct spi_ioc_transfer tr = {
-            .tx_buf = (unsigned long)&tx_buffer[i],
-            .rx_buf = (unsigned long)&rx_buffer[i],
-            .len = 1,
-            .delay_usecs = 0,
-            .cs_change = 1
-        };
-        ret = ioctl(fd, SPI_IOC_MESSAGE(1), &tr);
-        if (ret < 1)
-        {
-            perror("Can't send spi message ");
-            return false;
-        }
-        usleep(1000);
+    session.fd = fd;
+
+    return true;
+}
+
+/* Exchange one message with the supervisor. The caller must hold the session mutex */
+static bool kprv_spi_comms(const uint8_t * tx_buffer, uint8_t * rx_buffer, uint16_t tx_length)
+{
+    struct spi_ioc_transfer tr[SUPERVISOR_MAX_LENGTH];
+    uint8_t checksum;
+    int ret;
+
+    if ((tx_buffer == NULL) || (rx_buffer == NULL) || tx_length < 1
+        || tx_length > SUPERVISOR_MAX_LENGTH)
+    {
+        return false;
     }
 
+    /* The last byte sent is always replaced by the checksum */
+    checksum = supervisor_calculate_CRC(tx_buffer, tx_length - 1);
+
     /**
-     * Send checksum last
+     * Each byte is still its own transfer, with a delay after it, as per
+     * discussion with ISIS on 3/31. They suggested at least 1 ms between
+     * bytes. The kernel applies the delays, so the whole message only needs
+     * a single system call.
+     *
+     * Chip select stays asserted between the bytes, and is left asserted
+     * after the last one, the same as when each byte was sent as a separate
+     * single-transfer message.
      */
-    struct spi_ioc_transfer tr = {
-        .tx_buf = (unsigned long)&checksum,
-        .rx_buf = (unsigned long)&rx_buffer[tx_length - 1],
-        .len = 1,
-        .delay_usecs = 0,
-        .cs_change = 1
-    };
-    ret = ioctl(fd, SPI_IOC_MESSAGE(1), &tr);
-    if (ret < 1)
+    memset(tr, 0, sizeof(tr));
+    for (uint16_t i = 0; i < tx_length; i++)
+    {
+        tr[i].tx_buf = (unsigned long) &tx_buffer[i];
+        tr[i].rx_buf = (unsigned long) &rx_buffer[i];
+        tr[i].len = 1;
+        tr[i].delay_usecs = SUPERVISOR_BYTE_GAP_US;
+    }
+    tr[tx_length - 1].tx_buf = (unsigned long) &checksum;
+    tr[tx_length - 1].cs_change = 1;
+
+    /* The gap after the final byte is covered by the pacer instead */
+    tr[tx_length - 1].delay_usecs = 0;
+
+    if (!kprv_supervisor_open())
     {
-        perror("Can't send spi message ");
         return false;
     }
 
-    close(fd);
+    k_pacer_wait(&session.pacer);
+    ret = ioctl(session.fd, SPI_IOC_MESSAGE(tx_length), tr);
+    k_pacer_mark(&session.pacer);
+
+    /* On success, the total number of bytes transferred is returned */
+    if (ret < tx_length)
+    {
+        perror("Can't send spi message ");
+        return false;
+    }
 
     return true;
 }
 
+static bool spi_comms(const uint8_t * tx_buffer, uint8_t * rx_buffer, uint16_t tx_length)
+{
+    pthread_mutex_lock(&session.mutex);
+    bool result = kprv_spi_comms(tx_buffer, rx_buffer, tx_length);
+    pthread_mutex_unlock(&session.mutex);
+
+    return result;
+}
+
+bool supervisor_open()
+{
+    pthread_mutex_lock(&session.mutex);
+    bool result = kprv_supervisor_open();
+    pthread_mutex_unlock(&session.mutex);
+
+    return result;
+}
+
+void supervisor_close()
+{
+    pthread_mutex_lock(&session.mutex);
+
+    if (session.fd >= 0)
+    {
+        close(session.fd);
+        session.fd = -1;
+    }
+
+    pthread_mutex_unlock(&session.mutex);
+}
+
 static bool verify_checksum(const uint8_t * buffer, int buffer_length)
 {
     uint8_t checksum = supervisor_calculate_CRC(buffer + 1, buffer_length - 2);
@@ -124,17 +206,29 @@ bool supervisor_get_version(supervisor_version_t * version)
     uint8_t bytesToSendObtainVersion[LENGTH_TELEMETRY_GET_VERSION] = { 0 };
     uint8_t bytesToReceiveObtainVersion[LENGTH_TELEMETRY_GET_VERSION] = { 0 };
 
-    if (!spi_comms(bytesToSendSampleVersion, bytesToReceiveSampleVersion, LENGTH_TELEMETRY_SAMPLE_VERSION))
+    /* Nothing else may reach the supervisor between the sample and the obtain */
+    pthread_mutex_lock(&session.mutex);
+
+    bool result = kprv_spi_comms(bytesToSendSampleVersion, bytesToReceiveSampleVersion, LENGTH_TELEMETRY_SAMPLE_VERSION);
+    if (!result)
     {
         printf("Failed to sample version\n");
-        return false;
+    }
+    else
+    {
+        k_pacer_wait_gap(&session.pacer, &SAMPLE_GAP);
+
+        result = kprv_spi_comms(bytesToSendObtainVersion, bytesToReceiveObtainVersion, LENGTH_TELEMETRY_GET_VERSION);
+        if (!result)
+        {
+            printf("Failed to obtain version\n");
+        }
     }
 
-    usleep(10000);
+    pthread_mutex_unlock(&session.mutex);
 
-    if (!spi_comms(bytesToSendObtainVersion, bytesToReceiveObtainVersion, LENGTH_TELEMETRY_GET_VERSION))
+    if (!result)
     {
-        printf("Failed to obtain version\n");
         return false;
     }
 
@@ -156,17 +250,29 @@ bool supervisor_get_housekeeping(supervisor_housekeeping_t * housekeeping)
     uint8_t bytesToSendObtainHousekeepingTelemetry[LENGTH_TELEMETRY_HOUSEKEEPING] = { 0 };
     uint8_t bytesToReceiveObtainHousekeepingTelemetry[LENGTH_TELEMETRY_HOUSEKEEPING] = { 0 };
 
-    if (!spi_comms(bytesToSendSampleHousekeepingTelemetry, bytesToReceiveSampleHousekeepingTelemetry, LENGTH_TELEMETRY_SAMPLE_HOUSEKEEPING))
+    /* Nothing else may reach the supervisor between the sample and the obtain */
+    pthread_mutex_lock(&session.mutex);
+
+    bool result = kprv_spi_comms(bytesToSendSampleHousekeepingTelemetry, bytesToReceiveSampleHousekeepingTelemetry, LENGTH_TELEMETRY_SAMPLE_HOUSEKEEPING);
+    if (!result)
     {
         printf("Failed to sample housekeeping\n");
-        return false;
+    }
+    else
+    {
+        k_pacer_wait_gap(&session.pacer, &SAMPLE_GAP);
+
+        result = kprv_spi_comms(bytesToSendObtainHousekeepingTelemetry, bytesToReceiveObtainHousekeepingTelemetry, LENGTH_TELEMETRY_HOUSEKEEPING);
+        if (!result)
+        {
+            printf("Failed to obtain housekeeping\n");
+        }
     }
 
-    usleep(10000);
+    pthread_mutex_unlock(&session.mutex);
 
-    if (!spi_comms(bytesToSendObtainHousekeepingTelemetry, bytesToReceiveObtainHousekeepingTelemetry, LENGTH_TELEMETRY_HOUSEKEEPING))
+    if (!result)
     {
-        printf("Failed to obtain housekeeping\n");
         return false;
     }
 
@@ -22,6 +22,7 @@
 #pragma once
 
 #include <math.h>
+#include <time.h>
 
 /** \cond WE DO NOT WANT TO HAVE THESE IN OUR GENERATED DOCS */
 /* Radio command values */
@@ -48,6 +49,19 @@
 #define WATCHDOG_RESET              0xCC
 /** \endcond */
 
+/**
+ * Largest frame payload the TRXVU receiver can deliver (see ::radio_rx_frame)
+ */
+#define RADIO_RX_MAX_SIZE 200
+
+/**
+ * Number of frames the background RX pump can hold (see ::k_radio_rx_pump_start).
+ * Must be a power of two
+ */
+#ifndef RADIO_RX_RING_SIZE
+#define RADIO_RX_RING_SIZE 32
+#endif
+
 /**
  * Radio function return values
  */
@@ -215,6 +229,19 @@ typedef struct
     uint16_t signal_strength;       /**< ADC value of signal strength at receive time (convert with ::get_signal_strength)*/
 } radio_rx_header;
 
+/**
+ * Fixed-size storage slot for one received frame
+ *
+ * The layout matches the response to the radio's "get frame" command, so a
+ * frame can be read straight into a slot without any intermediate buffer.
+ * Only the first `header.msg_size` bytes of `message` are valid.
+ */
+typedef struct
+{
+    radio_rx_header header;                     /**< Frame properties */
+    uint8_t         message[RADIO_RX_MAX_SIZE]; /**< Frame payload */
+} radio_rx_frame;
+
 /*
  * Public Functions
  */
@@ -225,12 +252,17 @@ typedef struct
 KRadioStatus k_radio_watchdog_kick(void);
 
 /**
- * Start a thread to kick the radio's watchdogs at an interval of (timeout/3) seconds
+ * Start kicking the radio's watchdogs at an interval of (timeout/3) seconds
+ *
+ * The kicks are run by the kubos-hal kick scheduler (see ::KKick), which
+ * shares one thread between every driver.
  * @return KRadioStatus `RADIO_OK` if OK, error otherwise
  */
 KRadioStatus k_radio_watchdog_start(void);
 /**
- * Stop the watchdog thread
+ * Stop kicking the radio's watchdogs
+ *
+ * A kick which is in progress is allowed to finish first.
  * @return KRadioStatus `RADIO_OK` if OK, error otherwise
  */
 KRadioStatus k_radio_watchdog_stop(void);
@@ -317,7 +349,8 @@ float get_rf_power_mw(uint16_t raw);
  */
 KRadioStatus k_radio_init(char * bus, trx_prop tx, trx_prop rx, uint16_t timeout);
 /**
- * Terminate the radio interface
+ * Terminate the radio interface, stopping any watchdog kicks and the
+ * background receive thread
  */
 void k_radio_terminate(void);
 /**
@@ -350,6 +383,66 @@ KRadioStatus k_radio_send(char * buffer, int len, uint8_t * response);
  * @return KRadioStatus RADIO_OK if a message was received successfully, RADIO_RX_EMPTY if there are no messages to receive, error otherwise
  */
 KRadioStatus k_radio_recv(radio_rx_header * frame, uint8_t * message, uint8_t * len);
+/**
+ * Receive all waiting messages from the radio's receive buffer, up to a limit
+ *
+ * The number of waiting frames is only requested once. Each frame is then
+ * read directly into the next slot of `frames` and removed from the radio.
+ * If an error occurs part way through, `count` still reflects the frames
+ * which were successfully received.
+ * @param [out] frames Array of slots to receive the frames into, in the order they were received
+ * @param [in] max_frames Number of slots in `frames`
+ * @param [out] count Number of frames received
+ * @return KRadioStatus RADIO_OK if at least one message was received successfully, RADIO_RX_EMPTY if there are no messages to receive, error otherwise
+ */
+KRadioStatus k_radio_recv_batch(radio_rx_frame * frames, uint16_t max_frames,
+                                uint16_t * count);
+/**
+ * Start a background thread which collects received frames
+ *
+ * Every `interval`, the thread drains the radio's receive buffer into an
+ * internal ring of ::RADIO_RX_RING_SIZE frames and signals the descriptor
+ * returned by ::k_radio_rx_pump_fd. If the ring fills up, the remaining frames
+ * are left in the radio until there is room for them.
+ *
+ * While the pump is running, frames should only be collected with
+ * ::k_radio_rx_pump_recv. Transmit and telemetry functions may still be
+ * called from other threads.
+ * @param [in] interval Time between polls of the radio's receive buffer
+ * @return KRadioStatus `RADIO_OK` if OK, error otherwise
+ */
+KRadioStatus k_radio_rx_pump_start(const struct timespec * interval);
+/**
+ * Stop the background receive thread
+ *
+ * Frames already collected remain available from ::k_radio_rx_pump_recv, and
+ * the descriptor from ::k_radio_rx_pump_fd stays open. Starting the thread
+ * again reuses the same descriptor
+ * @return KRadioStatus `RADIO_OK` if OK, error otherwise
+ */
+KRadioStatus k_radio_rx_pump_stop(void);
+/**
+ * Get a file descriptor which becomes readable when the receive thread has
+ * collected new frames
+ *
+ * The descriptor can be added to a `poll()`/`epoll()` set. Once it is readable,
+ * ::k_radio_rx_pump_recv should be called until it returns `RADIO_RX_EMPTY`,
+ * which clears the notification.
+ *
+ * The descriptor stays open until ::k_radio_terminate, which also stops the
+ * receive thread. The consumer must stop using it before then.
+ * @return int Event file descriptor, or -1 if the receive thread has not been started
+ */
+int k_radio_rx_pump_fd(void);
+/**
+ * Take the oldest frame collected by the background receive thread
+ *
+ * This function does not block or use the I2C bus. It must only be called
+ * from one thread at a time.
+ * @param [out] frame Pointer to storage for the frame
+ * @return KRadioStatus `RADIO_OK` if a frame was returned, `RADIO_RX_EMPTY` if no frames are waiting, error otherwise
+ */
+KRadioStatus k_radio_rx_pump_recv(radio_rx_frame * frame);
 /**
  * Read radio telemetry values
  * @note See specific radio API documentation for available telemetry types
@@ -363,11 +456,6 @@ KRadioStatus k_radio_get_telemetry(radio_telem * buffer, RadioTelemType type);
  * Internal Functions
  */
 
-/**
- * Thread which kicks the radio's watchdogs every (timeout/3) seconds
- */
-void * kprv_radio_watchdog_thread(void * args);
-
 /**
  * Set the transmitter beacon's interval and message
  *
@@ -443,6 +531,27 @@ KRadioStatus kprv_radio_rx_remove_frame(void);
  * @return KRadioStatus `RADIO_OK` if OK, error otherwise
  */
 KRadioStatus kprv_radio_rx_get_frame(radio_rx_header * frame, uint8_t * message, uint8_t * len);
+/**
+ * Retrieve oldest frame from receive buffer directly into a frame slot
+ * @param [out] slot Pointer to storage for the frame
+ * @return KRadioStatus `RADIO_OK` if OK, error otherwise
+ */
+KRadioStatus kprv_radio_rx_read_frame(radio_rx_frame * slot);
+/**
+ * Collect waiting frames into the background receive ring once
+ *
+ * This is the body of the receive thread started by ::k_radio_rx_pump_start
+ * @param [out] received Number of frames added to the ring
+ * @return KRadioStatus `RADIO_OK` if OK, error otherwise
+ */
+KRadioStatus kprv_radio_rx_pump_poll(uint16_t * received);
+/**
+ * Stop the background receive thread, if it's running, and close its event
+ * file descriptor
+ *
+ * Called by ::k_radio_terminate
+ */
+void kprv_radio_rx_pump_close(void);
 /**
  * Get telemetry from receiver
  *
@@ -15,6 +15,7 @@
  */
 
 #include <i2c.h>
+#include <kick.h>
 #include <trxvu.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -24,9 +25,19 @@ uint16_t wd_timeout = 0;
 trx_prop radio_tx;
 trx_prop radio_rx;
 
+static void kprv_radio_watchdog_kick(void * arg)
+{
+    kprv_radio_tx_watchdog_kick();
+    kprv_radio_rx_watchdog_kick();
+}
+
+/* Kicks the watchdogs from the shared kick scheduler */
+static KKick radio_kick = {.func = kprv_radio_watchdog_kick };
+
 KRadioStatus k_radio_init(char * bus, trx_prop tx, trx_prop rx, uint16_t timeout)
 {
-    if (bus == NULL)
+    /* Received frames are read into fixed-size slots */
+    if (bus == NULL || rx.max_size > RADIO_RX_MAX_SIZE)
     {
         return RADIO_ERROR_CONFIG;
     }
@@ -48,6 +59,11 @@ KRadioStatus k_radio_init(char * bus, trx_prop tx, trx_prop rx, uint16_t timeout
 
 void k_radio_terminate()
 {
+    /* The kick scheduler outlives us, so make sure it stops using the bus */
+    k_kick_unregister(&radio_kick);
+
+    kprv_radio_rx_pump_close();
+
     k_i2c_terminate(&radio_bus);
 
     return;
@@ -105,28 +121,11 @@ KRadioStatus k_radio_watchdog_kick()
     return status;
 }
 
-void * kprv_radio_watchdog_thread(void * args)
-{
-    KRadioStatus status;
-
-    while (1)
-    {
-        kprv_radio_tx_watchdog_kick();
-        kprv_radio_rx_watchdog_kick();
-
-        sleep(wd_timeout / 3);
-    }
-
-    return NULL;
-}
-
-pthread_t handle_watchdog = { 0 };
-
 KRadioStatus k_radio_watchdog_start()
 {
-    if (handle_watchdog != 0)
+    if (k_kick_is_registered(&radio_kick))
     {
-        fprintf(stderr, "TRXVU watchdog thread already started\n");
+        fprintf(stderr, "TRXVU watchdog kicks already started\n");
         return RADIO_OK;
     }
 
@@ -134,15 +133,19 @@ KRadioStatus k_radio_watchdog_start()
     {
         fprintf(
             stderr,
-            "TRXVU watchdog has been disabled. No thread will be started\n");
+            "TRXVU watchdog has been disabled. No kicks will be scheduled\n");
         return RADIO_OK;
     }
 
-    if (pthread_create(&handle_watchdog, NULL, kprv_radio_watchdog_thread, NULL)
-        != 0)
+    /* Kick three times per timeout */
+    radio_kick.period = (struct timespec) {
+        .tv_sec  = wd_timeout / 3,
+        .tv_nsec = (wd_timeout % 3) * 1000000000L / 3
+    };
+
+    if (!k_kick_register(&radio_kick))
     {
-        perror("Failed to create TRXVU watchdog thread");
-        handle_watchdog = 0;
+        fprintf(stderr, "Failed to schedule TRXVU watchdog kicks\n");
         return RADIO_ERROR;
     }
 
@@ -151,28 +154,13 @@ KRadioStatus k_radio_watchdog_start()
 
 KRadioStatus k_radio_watchdog_stop()
 {
-    if (handle_watchdog == 0)
-    {
-        perror("TRXVU watchdog thread has not been started");
-        return RADIO_ERROR;
-    }
-    
-    /* Send the cancel request */
-    if (pthread_cancel(handle_watchdog) != 0)
-    {
-        perror("Failed to cancel TRXVU watchdog thread");
-        return RADIO_ERROR;
-    }
-
-    /* Wait for the cancellation to complete */
-    if (pthread_join(handle_watchdog, NULL) != 0)
+    /* Waits for a kick in progress, rather than interrupting it */
+    if (!k_kick_unregister(&radio_kick))
     {
-        perror("Failed to rejoin TRXVU watchdog thread");
+        fprintf(stderr, "TRXVU watchdog kicks have not been started\n");
         return RADIO_ERROR;
     }
 
-    handle_watchdog = 0;
-
     return RADIO_OK;
 }
 
@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <i2c.h>
+#include <trxvu.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define RING_MASK (RADIO_RX_RING_SIZE - 1)
+
+#if (RADIO_RX_RING_SIZE & RING_MASK) != 0
+#error "RADIO_RX_RING_SIZE must be a power of two"
+#endif
+
+/*
+ * Single-producer/single-consumer frame ring
+ *
+ * The pump thread is the only writer of `head` and the consumer is the only
+ * writer of `tail`. Both are free-running and wrap naturally, so the number
+ * of waiting frames is always `head - tail`.
+ */
+static radio_rx_frame ring[RADIO_RX_RING_SIZE];
+static atomic_uint    ring_head = 0;
+static atomic_uint    ring_tail = 0;
+
+/*
+ * Signalled whenever new frames are published to the ring. The consumer may
+ * be polling it from another thread, so it stays open (and its number stays
+ * reserved) from the first start until the radio is terminated
+ */
+static atomic_int pump_fd = -1;
+
+static pthread_t       handle_pump = { 0 };
+static pthread_mutex_t pump_mutex  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pump_cond;
+static bool            pump_running = false;
+static struct timespec pump_interval;
+
+KRadioStatus kprv_radio_rx_pump_poll(uint16_t * received)
+{
+    unsigned int head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+    unsigned int space = RADIO_RX_RING_SIZE - (head - tail);
+    uint16_t     count = 0;
+    KRadioStatus status;
+
+    if (received != NULL)
+    {
+        *received = 0;
+    }
+
+    /*
+     * If the consumer has fallen behind, leave the frames in the radio's own
+     * buffer until it catches up
+     */
+    if (space == 0)
+    {
+        return RADIO_OK;
+    }
+
+    /* Only fill up to the end of the array, so each slot is read in place */
+    unsigned int slot = head & RING_MASK;
+    if (space > RADIO_RX_RING_SIZE - slot)
+    {
+        space = RADIO_RX_RING_SIZE - slot;
+    }
+
+    status = k_radio_recv_batch(&ring[slot], (uint16_t) space, &count);
+
+    /* Publish whatever we got, even if the sweep was cut short */
+    if (count > 0)
+    {
+        atomic_store_explicit(&ring_head, head + count, memory_order_release);
+
+        int fd = atomic_load(&pump_fd);
+        if (fd >= 0)
+        {
+            eventfd_write(fd, count);
+        }
+    }
+
+    if (received != NULL)
+    {
+        *received = count;
+    }
+
+    return (status == RADIO_RX_EMPTY) ? RADIO_OK : status;
+}
+
+void * kprv_radio_rx_pump_thread(void * args)
+{
+    struct timespec deadline;
+    uint16_t        received;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    pthread_mutex_lock(&pump_mutex);
+
+    while (pump_running)
+    {
+        pthread_mutex_unlock(&pump_mutex);
+        kprv_radio_rx_pump_poll(&received);
+        pthread_mutex_lock(&pump_mutex);
+
+        /*
+         * The sweep stopped at the end of the array, so there may be more
+         * frames waiting. Check again straight away
+         */
+        if (received > 0 && (atomic_load(&ring_head) & RING_MASK) == 0)
+        {
+            continue;
+        }
+
+        deadline.tv_sec += pump_interval.tv_sec;
+        deadline.tv_nsec += pump_interval.tv_nsec;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+        }
+
+        /* Sleep until the next poll is due, or until we're told to stop */
+        while (pump_running
+               && pthread_cond_timedwait(&pump_cond, &pump_mutex, &deadline)
+                      != ETIMEDOUT)
+        {
+            continue;
+        }
+    }
+
+    pthread_mutex_unlock(&pump_mutex);
+
+    return NULL;
+}
+
+KRadioStatus k_radio_rx_pump_start(const struct timespec * interval)
+{
+    pthread_condattr_t attr;
+
+    if (interval == NULL || interval->tv_sec < 0 || interval->tv_nsec < 0
+        || interval->tv_nsec >= 1000000000L
+        || (interval->tv_sec == 0 && interval->tv_nsec == 0))
+    {
+        return RADIO_ERROR_CONFIG;
+    }
+
+    if (handle_pump != 0)
+    {
+        fprintf(stderr, "TRXVU RX pump thread already started\n");
+        return RADIO_OK;
+    }
+
+    /* A restarted pump keeps signalling the descriptor the consumer has */
+    if (atomic_load(&pump_fd) < 0)
+    {
+        int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd < 0)
+        {
+            perror("Failed to create TRXVU RX pump eventfd");
+            return RADIO_ERROR;
+        }
+        atomic_store(&pump_fd, fd);
+    }
+
+    /* The deadlines are absolute monotonic times */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pump_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pump_interval = *interval;
+    pump_running  = true;
+
+    if (pthread_create(&handle_pump, NULL, kprv_radio_rx_pump_thread, NULL)
+        != 0)
+    {
+        perror("Failed to create TRXVU RX pump thread");
+        handle_pump  = 0;
+        pump_running = false;
+        pthread_cond_destroy(&pump_cond);
+        return RADIO_ERROR;
+    }
+
+    return RADIO_OK;
+}
+
+KRadioStatus k_radio_rx_pump_stop(void)
+{
+    if (handle_pump == 0)
+    {
+        fprintf(stderr, "TRXVU RX pump thread has not been started\n");
+        return RADIO_ERROR;
+    }
+
+    pthread_mutex_lock(&pump_mutex);
+    pump_running = false;
+    pthread_cond_signal(&pump_cond);
+    pthread_mutex_unlock(&pump_mutex);
+
+    if (pthread_join(handle_pump, NULL) != 0)
+    {
+        perror("Failed to rejoin TRXVU RX pump thread");
+        return RADIO_ERROR;
+    }
+
+    handle_pump = 0;
+    pthread_cond_destroy(&pump_cond);
+
+    /*
+     * Any frames still in the ring can continue to be collected, so the
+     * descriptor is left open for the consumer
+     */
+
+    return RADIO_OK;
+}
+
+void kprv_radio_rx_pump_close(void)
+{
+    int fd;
+
+    /* The pump thread must not outlive the bus */
+    if (handle_pump != 0)
+    {
+        k_radio_rx_pump_stop();
+    }
+
+    fd = atomic_exchange(&pump_fd, -1);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+int k_radio_rx_pump_fd(void)
+{
+    return atomic_load(&pump_fd);
+}
+
+KRadioStatus k_radio_rx_pump_recv(radio_rx_frame * frame)
+{
+    if (frame == NULL)
+    {
+        return RADIO_ERROR_CONFIG;
+    }
+
+    unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring_head, memory_order_acquire);
+
+    if (head == tail)
+    {
+        /*
+         * Clear the notification before looking one last time, so that a
+         * frame published in-between will raise it again rather than being
+         * missed
+         */
+        int fd = atomic_load(&pump_fd);
+        if (fd >= 0)
+        {
+            eventfd_t value;
+            eventfd_read(fd, &value);
+        }
+
+        head = atomic_load_explicit(&ring_head, memory_order_acquire);
+        if (head == tail)
+        {
+            return RADIO_RX_EMPTY;
+        }
+    }
+
+    radio_rx_frame * slot = &ring[tail & RING_MASK];
+
+    frame->header = slot->header;
+    memcpy(frame->message, slot->message, slot->header.msg_size);
+
+    /* Hand the slot back to the pump */
+    atomic_store_explicit(&ring_tail, tail + 1, memory_order_release);
+
+    return RADIO_OK;
+}
@@ -64,6 +64,66 @@ KRadioStatus k_radio_recv(radio_rx_header * frame, uint8_t * message, uint8_t *
     return status;
 }
 
+KRadioStatus k_radio_recv_batch(radio_rx_frame * frames, uint16_t max_frames,
+                                uint16_t * count)
+{
+    if (frames == NULL || max_frames == 0 || count == NULL)
+    {
+        return RADIO_ERROR_CONFIG;
+    }
+
+    KRadioStatus status  = RADIO_OK;
+    uint16_t     waiting = 0;
+
+    *count = 0;
+
+    /*
+     * Only ask once. Frames which arrive while we're draining will be
+     * picked up by the next call
+     */
+    status = kprv_radio_rx_get_count((uint8_t *) &waiting);
+    if (status != RADIO_OK)
+    {
+        fprintf(stderr, "Failed to get radio RX frame count\n");
+        return status;
+    }
+
+    if (waiting == 0)
+    {
+        return RADIO_RX_EMPTY;
+    }
+
+    if (waiting > max_frames)
+    {
+        waiting = max_frames;
+    }
+
+    while (*count < waiting)
+    {
+        status = kprv_radio_rx_read_frame(&frames[*count]);
+        if (status != RADIO_OK)
+        {
+            fprintf(stderr, "Failed to receive frame from radio\n");
+            return status;
+        }
+
+        status = kprv_radio_rx_remove_frame();
+        if (status != RADIO_OK)
+        {
+            /*
+             * The frame is still in the radio's buffer, so don't count it.
+             * Otherwise it would be received twice
+             */
+            fprintf(stderr, "Failed to remove radio RX frame\n");
+            return status;
+        }
+
+        (*count)++;
+    }
+
+    return RADIO_OK;
+}
+
 KRadioStatus kprv_radio_rx_get_telemetry(radio_telem *  buffer,
                                          RadioTelemType type)
 {
@@ -91,17 +151,9 @@ KRadioStatus kprv_radio_rx_get_telemetry(radio_telem *  buffer,
             return RADIO_ERROR_CONFIG;
     }
 
-    KI2CStatus status
-        = k_i2c_write(radio_bus, radio_rx.addr, (uint8_t *) &cmd, 1);
-
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to request radio RX telemetry type %d: %d\n",
-                type, status);
-        return RADIO_ERROR;
-    }
-
-    status = k_i2c_read(radio_bus, radio_rx.addr, (char *) buffer, len);
+    KI2CStatus status = k_i2c_transfer(radio_bus, radio_rx.addr,
+                                       (uint8_t *) &cmd, 1, (uint8_t *) buffer,
+                                       len);
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to retrieve radio RX telemetry type %d: %d\n",
@@ -165,17 +217,11 @@ KRadioStatus kprv_radio_rx_get_count(uint8_t * count)
     uint8_t    cmd = GET_RX_FRAME_COUNT;
     KI2CStatus status;
 
-    status = k_i2c_write(radio_bus, radio_rx.addr, (uint8_t *) &cmd, 1);
+    status = k_i2c_transfer(radio_bus, radio_rx.addr, (uint8_t *) &cmd, 1,
+                            count, 2);
     if (status != I2C_OK)
     {
-        fprintf(stderr, "Failed to request radio frame count: %d\n", status);
-        return RADIO_ERROR;
-    }
-
-    status = k_i2c_read(radio_bus, radio_rx.addr, count, 2);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to read radio frame count: %d\n", status);
+        fprintf(stderr, "Failed to fetch radio frame count: %d\n", status);
         return RADIO_ERROR;
     }
 
@@ -204,42 +250,52 @@ KRadioStatus kprv_radio_rx_get_frame(radio_rx_header * frame, uint8_t * message,
         return RADIO_ERROR_CONFIG;
     }
 
-    uint8_t cmd = GET_RX_FRAME;
+    radio_rx_frame slot;
+    KRadioStatus   status;
 
-    KI2CStatus status;
-
-    status = k_i2c_write(radio_bus, radio_rx.addr, (uint8_t *) &cmd, 1);
-    if (status != I2C_OK)
+    status = kprv_radio_rx_read_frame(&slot);
+    if (status != RADIO_OK)
     {
-        fprintf(stderr, "Failed to request radio RX frame: %d\n",
-                status);
-        return RADIO_ERROR;
+        return status;
     }
 
-    uint8_t * buffer = malloc(sizeof(radio_rx_header) + radio_rx.max_size);
+    *frame = slot.header;
+    memcpy(message, slot.message, frame->msg_size);
 
-    status = k_i2c_read(radio_bus, radio_rx.addr, (char *) buffer,
-            sizeof(radio_rx_header) + radio_rx.max_size);
-    if (status != I2C_OK)
+    if (len != NULL)
     {
-        fprintf(stderr, "Failed to read radio RX frame: %d\n", status);
-        free(buffer);
-        return RADIO_ERROR;
+        *len = frame->msg_size;
     }
 
-    radio_rx_header * temp = (radio_rx_header *) buffer;
+    return RADIO_OK;
+}
 
-    frame->msg_size = temp->msg_size;
-    frame->doppler_offset = temp->doppler_offset;
-    frame->signal_strength = temp->signal_strength;
+KRadioStatus kprv_radio_rx_read_frame(radio_rx_frame * slot)
+{
+    if (slot == NULL)
+    {
+        return RADIO_ERROR_CONFIG;
+    }
 
-    memcpy(message, buffer+sizeof(radio_rx_header), frame->msg_size);
+    uint8_t    cmd = GET_RX_FRAME;
+    KI2CStatus status;
 
-    if (len != NULL)
+    /* The radio always returns a full-size frame, whatever the payload length */
+    status = k_i2c_transfer(radio_bus, radio_rx.addr, (uint8_t *) &cmd, 1,
+                            (uint8_t *) slot,
+                            sizeof(radio_rx_header) + radio_rx.max_size);
+    if (status != I2C_OK)
     {
-        *len = frame->msg_size;
+        fprintf(stderr, "Failed to fetch radio RX frame: %d\n", status);
+        return RADIO_ERROR;
+    }
+
+    if (slot->header.msg_size > radio_rx.max_size)
+    {
+        fprintf(stderr, "Invalid radio RX frame size: %d\n",
+                slot->header.msg_size);
+        return RADIO_ERROR;
     }
 
-    free(buffer);
     return RADIO_OK;
 }
@@ -29,29 +29,24 @@ KRadioStatus k_radio_send(char * buffer, int len, uint8_t * response)
         return RADIO_ERROR_CONFIG;
     }
 
-    char * packet   = malloc(len + 1);
-    packet[0]       = SEND_FRAME;
-
-    memcpy(packet + 1, buffer, len);
-
-    KI2CStatus status = k_i2c_write(radio_bus, radio_tx.addr, packet, len + 1);
-    free(packet);
-
+    uint8_t      cmd    = SEND_FRAME;
+    struct iovec iov[2] = {
+        {.iov_base = &cmd, .iov_len = 1 },
+        {.iov_base = buffer, .iov_len = len }
+    };
+
+    /*
+     * Send the frame and read back the number of remaining TX buffer slots
+     * available
+     */
+    KI2CStatus status
+        = k_i2c_transferv(radio_bus, radio_tx.addr, iov, 2, response, 1);
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to send radio TX frame: %d\n", status);
         return RADIO_ERROR;
     }
 
-    /* Read number of remaining TX buffer slots available */
-    status = k_i2c_read(radio_bus, radio_tx.addr, response, 1);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to read radio TX slots remaining: %d\n",
-                status);
-        return RADIO_ERROR;
-    }
-
     return RADIO_OK;
 }
 
@@ -66,17 +61,20 @@ KRadioStatus k_radio_send_override(ax25_callsign to, ax25_callsign from,
         return RADIO_ERROR_CONFIG;
     }
 
-    char * packet   = malloc(len + 15);
-    packet[0]       = SEND_AX25_OVERRIDE;
-
-    memcpy(packet + 1, &to, sizeof(ax25_callsign));
-    memcpy(packet + 8, &from, sizeof(ax25_callsign));
-    memcpy(packet + 15, buffer, len);
-
-    KI2CStatus status = k_i2c_write(radio_bus, radio_tx.addr, packet,
-                                    len + sizeof(ax25_callsign) * 2 + 1);
-    free(packet);
-
+    uint8_t      cmd    = SEND_AX25_OVERRIDE;
+    struct iovec iov[4] = {
+        {.iov_base = &cmd, .iov_len = 1 },
+        {.iov_base = &to, .iov_len = sizeof(ax25_callsign) },
+        {.iov_base = &from, .iov_len = sizeof(ax25_callsign) },
+        {.iov_base = buffer, .iov_len = len }
+    };
+
+    /*
+     * Send the frame and read back the number of remaining TX buffer slots
+     * available
+     */
+    KI2CStatus status
+        = k_i2c_transferv(radio_bus, radio_tx.addr, iov, 4, response, 1);
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to send radio TX frame (override): %d\n",
@@ -84,15 +82,6 @@ KRadioStatus k_radio_send_override(ax25_callsign to, ax25_callsign from,
         return RADIO_ERROR;
     }
 
-    /* Read number of remaining TX buffer slots available */
-    status = k_i2c_read(radio_bus, radio_tx.addr, response, 1);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to read radio TX slots remaining: %d\n",
-                status);
-        return RADIO_ERROR;
-    }
-
     return RADIO_OK;
 }
 
@@ -106,20 +95,16 @@ KRadioStatus k_radio_set_beacon_override(ax25_callsign to, ax25_callsign from,
         return RADIO_ERROR_CONFIG;
     }
 
-    KI2CStatus status;
-    char * packet   = malloc(beacon.len + sizeof(ax25_callsign) * 2 + 3);
-    packet[0] = SET_AX25_BEACON_OVERRIDE;
-
-    memcpy(packet + 1, (void *) &beacon.interval, sizeof(beacon.interval));
-    memcpy(packet + 3, &to, sizeof(ax25_callsign));
-    memcpy(packet + 10, &from, sizeof(ax25_callsign));
-    memcpy(packet + 17, beacon.msg, beacon.len);
-
-    status = k_i2c_write(radio_bus, radio_tx.addr, packet,
-                         beacon.len + sizeof(ax25_callsign) * 2 + 3);
-
-    free(packet);
+    uint8_t      cmd    = SET_AX25_BEACON_OVERRIDE;
+    struct iovec iov[5] = {
+        {.iov_base = &cmd, .iov_len = 1 },
+        {.iov_base = &beacon.interval, .iov_len = sizeof(beacon.interval) },
+        {.iov_base = &to, .iov_len = sizeof(ax25_callsign) },
+        {.iov_base = &from, .iov_len = sizeof(ax25_callsign) },
+        {.iov_base = beacon.msg, .iov_len = beacon.len }
+    };
 
+    KI2CStatus status = k_i2c_writev(radio_bus, radio_tx.addr, iov, 5);
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to set radio TX beacon (override): %d\n",
@@ -183,19 +168,12 @@ KRadioStatus kprv_radio_tx_get_telemetry(radio_telem *  buffer,
             return RADIO_ERROR;
     }
 
-    KI2CStatus status
-        = k_i2c_write(radio_bus, radio_tx.addr, (uint8_t *) &cmd, 1);
-
+    KI2CStatus status = k_i2c_transfer(radio_bus, radio_tx.addr,
+                                       (uint8_t *) &cmd, 1, (uint8_t *) buffer,
+                                       len);
     if (status != I2C_OK)
     {
-        fprintf(stderr, "Failed to request radio TX telemetry: %d\n", status);
-        return RADIO_ERROR;
-    }
-
-    status = k_i2c_read(radio_bus, radio_tx.addr, (char *) buffer, len);
-    if (status != I2C_OK)
-    {
-        fprintf(stderr, "Failed to read radio TX telemetry: %d\n", status);
+        fprintf(stderr, "Failed to fetch radio TX telemetry: %d\n", status);
         return RADIO_ERROR;
     }
 
@@ -253,16 +231,14 @@ KRadioStatus kprv_radio_tx_set_beacon(uint16_t rate, char * buffer, int len)
         return RADIO_ERROR_CONFIG;
     }
 
-    char * packet   = malloc(len + 3);
-    packet[0]       = SET_BEACON;
-
-    memcpy(packet + 1, (void *) &rate, 2);
-    memcpy(packet + 3, buffer, len);
-
-    KI2CStatus status = k_i2c_write(radio_bus, radio_tx.addr, packet, len + 3);
-
-    free(packet);
+    uint8_t      cmd    = SET_BEACON;
+    struct iovec iov[3] = {
+        {.iov_base = &cmd, .iov_len = 1 },
+        {.iov_base = &rate, .iov_len = sizeof(rate) },
+        {.iov_base = buffer, .iov_len = len }
+    };
 
+    KI2CStatus status = k_i2c_writev(radio_bus, radio_tx.addr, iov, 3);
     if (status != I2C_OK)
     {
         fprintf(stderr, "Failed to set radio TX beacon: %d\n", status);
@@ -29,6 +29,11 @@ radio_rx_header test_header
 };
 char * test_message = "hi there";
 
+radio_rx_frame test_frame = {
+    .header = {.msg_size = 8, .doppler_offset = 5, .signal_strength = 2 },
+    .message = "hi there"
+};
+
 uint16_t frame_count = 5;
 uint8_t  remaining   = 39;
 
@@ -168,6 +173,212 @@ static void test_recv_len(void ** arg)
     assert_int_equal(len, header.msg_size);
 }
 
+static void test_recv_batch(void ** arg)
+{
+    radio_rx_frame frames[4] = { 0 };
+    uint16_t       waiting   = 2;
+    uint16_t       count     = 0;
+    KRadioStatus   ret;
+
+    /* The frame count should only be requested once */
+    expect_value(__wrap_write, cmd, GET_RX_FRAME_COUNT);
+    will_return(__wrap_read, 2);
+    will_return(__wrap_read, &waiting);
+
+    for (int i = 0; i < waiting; i++)
+    {
+        expect_value(__wrap_write, cmd, GET_RX_FRAME);
+        will_return(__wrap_read, sizeof(radio_rx_header) + RX_SIZE);
+        will_return(__wrap_read, &test_frame);
+
+        expect_value(__wrap_write, cmd, REMOVE_RX_FRAME);
+    }
+
+    ret = k_radio_recv_batch(frames, 4, &count);
+
+    assert_int_equal(ret, RADIO_OK);
+    assert_int_equal(count, waiting);
+    assert_int_equal(frames[1].header.msg_size, test_frame.header.msg_size);
+    assert_memory_equal(frames[1].message, test_message,
+                        test_frame.header.msg_size);
+}
+
+static void test_recv_batch_limit(void ** arg)
+{
+    radio_rx_frame frames[2] = { 0 };
+    uint16_t       count     = 0;
+    KRadioStatus   ret;
+
+    /* More frames are waiting than there are slots */
+    expect_value(__wrap_write, cmd, GET_RX_FRAME_COUNT);
+    will_return(__wrap_read, 2);
+    will_return(__wrap_read, &frame_count);
+
+    for (int i = 0; i < 2; i++)
+    {
+        expect_value(__wrap_write, cmd, GET_RX_FRAME);
+        will_return(__wrap_read, sizeof(radio_rx_header) + RX_SIZE);
+        will_return(__wrap_read, &test_frame);
+
+        expect_value(__wrap_write, cmd, REMOVE_RX_FRAME);
+    }
+
+    ret = k_radio_recv_batch(frames, 2, &count);
+
+    assert_int_equal(ret, RADIO_OK);
+    assert_int_equal(count, 2);
+}
+
+static void test_recv_batch_empty(void ** arg)
+{
+    radio_rx_frame frames[2] = { 0 };
+    uint16_t       waiting   = 0;
+    uint16_t       count     = 1;
+    KRadioStatus   ret;
+
+    expect_value(__wrap_write, cmd, GET_RX_FRAME_COUNT);
+    will_return(__wrap_read, 2);
+    will_return(__wrap_read, &waiting);
+
+    ret = k_radio_recv_batch(frames, 2, &count);
+
+    assert_int_equal(ret, RADIO_RX_EMPTY);
+    assert_int_equal(count, 0);
+}
+
+static void test_recv_batch_fail(void ** arg)
+{
+    radio_rx_frame frames[4] = { 0 };
+    uint16_t       count     = 0;
+    KRadioStatus   ret;
+
+    expect_value(__wrap_write, cmd, GET_RX_FRAME_COUNT);
+    will_return(__wrap_read, 2);
+    will_return(__wrap_read, &frame_count);
+
+    expect_value(__wrap_write, cmd, GET_RX_FRAME);
+    will_return(__wrap_read, sizeof(radio_rx_header) + RX_SIZE);
+    will_return(__wrap_read, &test_frame);
+    expect_value(__wrap_write, cmd, REMOVE_RX_FRAME);
+
+    /* The second frame can't be read */
+    expect_value(__wrap_write, cmd, GET_RX_FRAME);
+    will_return(__wrap_read, -1);
+
+    ret = k_radio_recv_batch(frames, 4, &count);
+
+    assert_int_equal(ret, RADIO_ERROR);
+    assert_int_equal(count, 1);
+}
+
+static void test_recv_batch_null(void ** arg)
+{
+    uint16_t count = 0;
+
+    assert_int_equal(k_radio_recv_batch(NULL, 1, &count), RADIO_ERROR_CONFIG);
+}
+
+/* Queue up the bus traffic for a single RX pump poll */
+static void expect_pump_poll(uint16_t * waiting, radio_rx_frame * frames,
+                             int reads)
+{
+    expect_value(__wrap_write, cmd, GET_RX_FRAME_COUNT);
+    will_return(__wrap_read, 2);
+    will_return(__wrap_read, waiting);
+
+    for (int i = 0; i < reads; i++)
+    {
+        expect_value(__wrap_write, cmd, GET_RX_FRAME);
+        will_return(__wrap_read, sizeof(radio_rx_header) + RX_SIZE);
+        will_return(__wrap_read, &frames[i]);
+
+        expect_value(__wrap_write, cmd, REMOVE_RX_FRAME);
+    }
+}
+
+/* Note: This must be the first test to use the pump, so that the ring is empty */
+static void test_pump_full(void ** arg)
+{
+    static radio_rx_frame frames[RADIO_RX_RING_SIZE + 1];
+    radio_rx_frame        frame;
+    uint16_t              waiting  = RADIO_RX_RING_SIZE + 8;
+    uint16_t              received = 0;
+
+    for (int i = 0; i <= RADIO_RX_RING_SIZE; i++)
+    {
+        frames[i].header.msg_size       = 1;
+        frames[i].header.doppler_offset = i;
+    }
+
+    /* Only as many frames as will fit should be taken from the radio */
+    expect_pump_poll(&waiting, frames, RADIO_RX_RING_SIZE);
+    assert_int_equal(kprv_radio_rx_pump_poll(&received), RADIO_OK);
+    assert_int_equal(received, RADIO_RX_RING_SIZE);
+
+    /* The ring is full, so the radio shouldn't be touched at all */
+    assert_int_equal(kprv_radio_rx_pump_poll(&received), RADIO_OK);
+    assert_int_equal(received, 0);
+
+    /* Free up one slot, which is at the start of the array */
+    assert_int_equal(k_radio_rx_pump_recv(&frame), RADIO_OK);
+    assert_int_equal(frame.header.doppler_offset, 0);
+
+    expect_pump_poll(&waiting, &frames[RADIO_RX_RING_SIZE], 1);
+    assert_int_equal(kprv_radio_rx_pump_poll(&received), RADIO_OK);
+    assert_int_equal(received, 1);
+
+    /* Everything should come back out in order */
+    for (int i = 1; i <= RADIO_RX_RING_SIZE; i++)
+    {
+        assert_int_equal(k_radio_rx_pump_recv(&frame), RADIO_OK);
+        assert_int_equal(frame.header.doppler_offset, i);
+    }
+
+    assert_int_equal(k_radio_rx_pump_recv(&frame), RADIO_RX_EMPTY);
+}
+
+static void test_pump_poll(void ** arg)
+{
+    radio_rx_frame frames[2] = { test_frame, test_frame };
+    radio_rx_frame frame     = { 0 };
+    uint16_t       waiting   = 2;
+    uint16_t       received  = 0;
+
+    expect_pump_poll(&waiting, frames, 2);
+    assert_int_equal(kprv_radio_rx_pump_poll(&received), RADIO_OK);
+    assert_int_equal(received, 2);
+
+    assert_int_equal(k_radio_rx_pump_recv(&frame), RADIO_OK);
+    assert_int_equal(frame.header.msg_size, test_frame.header.msg_size);
+    assert_memory_equal(frame.message, test_message, frame.header.msg_size);
+
+    assert_int_equal(k_radio_rx_pump_recv(&frame), RADIO_OK);
+    assert_int_equal(k_radio_rx_pump_recv(&frame), RADIO_RX_EMPTY);
+}
+
+static void test_pump_poll_empty(void ** arg)
+{
+    radio_rx_frame frame    = { 0 };
+    uint16_t       waiting  = 0;
+    uint16_t       received = 1;
+
+    expect_pump_poll(&waiting, NULL, 0);
+    assert_int_equal(kprv_radio_rx_pump_poll(&received), RADIO_OK);
+    assert_int_equal(received, 0);
+
+    assert_int_equal(k_radio_rx_pump_recv(&frame), RADIO_RX_EMPTY);
+}
+
+static void test_pump_start_invalid(void ** arg)
+{
+    const struct timespec zero = { 0, 0 };
+
+    assert_int_equal(k_radio_rx_pump_start(NULL), RADIO_ERROR_CONFIG);
+    assert_int_equal(k_radio_rx_pump_start(&zero), RADIO_ERROR_CONFIG);
+    assert_int_equal(k_radio_rx_pump_fd(), -1);
+    assert_int_equal(k_radio_rx_pump_stop(), RADIO_ERROR);
+}
+
 static void test_config_null(void ** arg)
 {
     assert_int_equal(k_radio_configure(NULL), RADIO_ERROR_CONFIG);
@@ -464,6 +675,15 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_recv, init, term),
         cmocka_unit_test_setup_teardown(test_recv_null, init, term),
         cmocka_unit_test_setup_teardown(test_recv_len, init, term),
+        cmocka_unit_test_setup_teardown(test_recv_batch, init, term),
+        cmocka_unit_test_setup_teardown(test_recv_batch_limit, init, term),
+        cmocka_unit_test_setup_teardown(test_recv_batch_empty, init, term),
+        cmocka_unit_test_setup_teardown(test_recv_batch_fail, init, term),
+        cmocka_unit_test_setup_teardown(test_recv_batch_null, init, term),
+        cmocka_unit_test_setup_teardown(test_pump_full, init, term),
+        cmocka_unit_test_setup_teardown(test_pump_poll, init, term),
+        cmocka_unit_test_setup_teardown(test_pump_poll_empty, init, term),
+        cmocka_unit_test_setup_teardown(test_pump_start_invalid, init, term),
         cmocka_unit_test_setup_teardown(test_config_null, init, term),
         cmocka_unit_test_setup_teardown(test_set_beacon, init, term),
         cmocka_unit_test_setup_teardown(test_set_beacon_override, init, term),
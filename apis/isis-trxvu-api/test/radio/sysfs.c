@@ -18,6 +18,9 @@
 
 #include <cmocka.h>
 #include <errno.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <stdarg.h>
 #include <unistd.h>
 
 /* Returns a file descriptor or -1 on failure */
@@ -35,8 +38,44 @@ int __wrap_close(int fd)
 /* 
  * Returns 0 on success (or occasionally a positive value) and -1 on failure
  */
+ssize_t __wrap_write(int fd, const char * buf, size_t count);
+ssize_t __wrap_read(int fd, char * buf, size_t count);
+
 int __wrap_ioctl(int fd, unsigned long request, ...)
 {
+    if (request == I2C_RDWR)
+    {
+        /* Combined transfer: run each message through the read/write mocks */
+        va_list                      args;
+        struct i2c_rdwr_ioctl_data * data;
+
+        va_start(args, request);
+        data = va_arg(args, struct i2c_rdwr_ioctl_data *);
+        va_end(args);
+
+        for (int i = 0; i < (int) data->nmsgs; i++)
+        {
+            struct i2c_msg * msg = &data->msgs[i];
+            ssize_t          len;
+
+            if (msg->flags & I2C_M_RD)
+            {
+                len = __wrap_read(fd, (char *) msg->buf, msg->len);
+            }
+            else
+            {
+                len = __wrap_write(fd, (const char *) msg->buf, msg->len);
+            }
+
+            if (len != msg->len)
+            {
+                return -1;
+            }
+        }
+
+        return (int) data->nmsgs;
+    }
+
     /* Pretty sure this shouldn't ever fail */
     return 0;
 }
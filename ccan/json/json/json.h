@@ -66,18 +66,235 @@ struct JsonNode
 	};
 };
 
+/*
+ * Arena allocation
+ *
+ * Nodes built with the *_a functions (and their keys and strings) are carved
+ * out of a JsonArena instead of being malloc'd one by one.  Everything in an
+ * arena is released at once by json_arena_reset or json_arena_destroy, so
+ * there is no need to json_delete an arena-built tree first.
+ *
+ * Passing a NULL arena to any *_a function allocates from the heap, exactly
+ * like the plain version.  A tree may mix heap and arena nodes, but the arena
+ * must outlive any heap tree which still references its nodes.
+ */
+typedef struct JsonArena JsonArena;
+
+/* block_size of 0 selects a reasonable default. */
+JsonArena  *json_arena_create   (size_t block_size);
+void        json_arena_reset    (JsonArena *arena);
+void        json_arena_destroy  (JsonArena *arena);
+size_t      json_arena_used     (const JsonArena *arena);
+
+/* Arena which node was allocated from, or NULL if it came from the heap. */
+JsonArena  *json_node_arena     (const JsonNode *node);
+
+/*
+ * Memory limits
+ *
+ * Nothing here exits or aborts when memory runs out: functions which
+ * allocate return NULL (or false) instead, and constructors hand back NULL,
+ * which the append/prepend functions ignore.  A member whose key can't be
+ * copied is left unattached.
+ *
+ * To bound the memory an operation can take, give it an arena created with
+ * a budget: a cap on the bytes the arena holds at once, counting its blocks
+ * and the scratch buffers used while decoding or encoding with it.  Its
+ * memory can also come from caller-supplied hooks instead of malloc.  When
+ * a hook fails or the budget would be exceeded, the operation in progress
+ * fails, and json_arena_error says why until the arena is next reset.
+ */
+typedef struct
+{
+	/* All three must be set; ctx is passed to each. */
+	void *(*malloc)  (void *ctx, size_t size);
+	void *(*realloc) (void *ctx, void *ptr, size_t size);
+	void  (*free)    (void *ctx, void *ptr);
+	void *ctx;
+} JsonAllocator;
+
+typedef enum {
+	JSON_ERROR_NONE,
+	JSON_ERROR_NOMEM,       /* the allocator returned NULL */
+	JSON_ERROR_BUDGET,      /* an allocation would have gone over budget */
+} JsonError;
+
+/* allocator NULL uses malloc; budget 0 means no limit. */
+JsonArena  *json_arena_create_ex (size_t block_size, const JsonAllocator *allocator, size_t budget);
+
+/* Bytes currently taken from the allocator, which budget caps. */
+size_t      json_arena_held      (const JsonArena *arena);
+
+/* The first allocation failure since the arena was created or reset. */
+JsonError   json_arena_error     (const JsonArena *arena);
+
 /*** Encoding, decoding, and validation ***/
 
 JsonNode   *json_decode         (const char *json);
+JsonNode   *json_decode_a       (JsonArena *arena, const char *json);
+
+/*
+ * Decode buf without copying its strings: they are unescaped where they lie,
+ * and the tree's keys and string values point into buf.  buf is modified,
+ * even if decoding fails, and must outlive the tree.  Keys and strings
+ * borrowed this way are left alone by json_delete.
+ */
+JsonNode   *json_decode_inplace   (char *buf);
+JsonNode   *json_decode_inplace_a (JsonArena *arena, char *buf);
+
 char       *json_encode         (const JsonNode *node);
 char       *json_encode_string  (const char *str);
 char       *json_stringify      (const JsonNode *node, const char *space);
+
+/* The text is allocated from arena, along with the scratch space to build it. */
+char       *json_encode_a       (JsonArena *arena, const JsonNode *node);
+char       *json_stringify_a    (JsonArena *arena, const JsonNode *node, const char *space);
+
 void        json_delete         (JsonNode *node);
 
 bool        json_validate       (const char *json);
 
+/*** Streaming ***/
+
+/*
+ * Callback-driven parsing, for documents which are too big to hold as a tree.
+ *
+ * Input can be fed in pieces of any size.  Memory use is bounded by the
+ * longest string/number token and the nesting depth, both of which are
+ * limits set when the stream is created.
+ */
+
+typedef enum {
+	JSON_EVENT_NULL,
+	JSON_EVENT_BOOL,
+	JSON_EVENT_STRING,
+	JSON_EVENT_NUMBER,
+	JSON_EVENT_ARRAY_BEGIN,
+	JSON_EVENT_ARRAY_END,
+	JSON_EVENT_OBJECT_BEGIN,
+	JSON_EVENT_OBJECT_END,
+} JsonEventType;
+
+typedef struct
+{
+	JsonEventType type;
+	
+	/* Member name, for values (and *_BEGIN events) inside an object; NULL otherwise. */
+	const char *key;
+	
+	/* Number of containers enclosing this value (0 at the top level). */
+	int depth;
+	
+	union {
+		/* JSON_EVENT_BOOL */
+		bool bool_;
+		
+		/* JSON_EVENT_STRING; only valid during the callback. */
+		const char *string_;
+		
+		/* JSON_EVENT_NUMBER */
+		double number_;
+	};
+} JsonEvent;
+
+/* Return false to stop parsing. */
+typedef bool (*JsonEventHandler)(void *ctx, const JsonEvent *event);
+
+typedef struct JsonStream JsonStream;
+
+/* max_token (in bytes) and max_depth of 0 select reasonable defaults. */
+JsonStream *json_stream_create  (JsonEventHandler handler, void *ctx, size_t max_token, int max_depth);
+void        json_stream_reset   (JsonStream *stream);
+void        json_stream_destroy (JsonStream *stream);
+
+/* Returns false, with the reason in json_stream_error, once the input is found to be bad. */
+bool        json_stream_feed    (JsonStream *stream, const char *data, size_t len);
+
+/* Call after the last piece of input, to check the document is complete. */
+bool        json_stream_finish  (JsonStream *stream);
+
+/* Read and parse everything from fd, then finish. */
+bool        json_stream_parse_fd(JsonStream *stream, int fd);
+
+/* NULL if nothing has gone wrong; offset is how far into the input parsing got. */
+const char *json_stream_error   (const JsonStream *stream, size_t *offset);
+
+/*** Writing ***/
+
+/*
+ * Serializes straight into a caller-supplied buffer, or through one into a
+ * file descriptor (flushing whenever it fills), without building a tree or
+ * allocating anything.
+ *
+ * Errors, such as running out of buffer, a failed write, or a value inside
+ * an object without a key, are sticky: later calls do nothing, and
+ * json_writer_finish returns false.
+ */
+
+#define JSON_WRITER_MAX_DEPTH 31
+
+typedef struct
+{
+	/* Everything here is private. */
+	char *buf;
+	size_t size;
+	size_t len;
+	size_t flushed;
+	int fd;
+	int depth;
+	unsigned long need_comma;
+	unsigned long objects;
+	bool have_key;
+	bool failed;
+} JsonWriter;
+
+/* The output in buf is NUL-terminated by json_writer_finish. */
+void        json_writer_init         (JsonWriter *w, char *buf, size_t size);
+void        json_writer_init_fd      (JsonWriter *w, int fd, char *buf, size_t size);
+
+void        json_writer_begin_object (JsonWriter *w);
+void        json_writer_end_object   (JsonWriter *w);
+void        json_writer_begin_array  (JsonWriter *w);
+void        json_writer_end_array    (JsonWriter *w);
+
+/* Inside an object, every value must be preceded by its key. */
+void        json_writer_key          (JsonWriter *w, const char *key);
+
+void        json_writer_null         (JsonWriter *w);
+void        json_writer_bool         (JsonWriter *w, bool b);
+void        json_writer_string       (JsonWriter *w, const char *str);
+void        json_writer_number       (JsonWriter *w, double n);
+
+/* Checks a single, complete value was written, and terminates or flushes it. */
+bool        json_writer_finish       (JsonWriter *w);
+
+/* Bytes of JSON produced so far (not counting the terminator). */
+size_t      json_writer_length       (const JsonWriter *w);
+
+/*** Binary encoding ***/
+
+/*
+ * A compact tagged binary form of a tree, for links where JSON text costs
+ * too much.  Integers are stored as varints, other numbers as float32 when
+ * that is exact and float64 otherwise, and each distinct key is only
+ * spelled out the first time it appears.  Decoding gives back the same tree.
+ *
+ * json_encode_binary returns a malloc'd buffer, with its length in *len.
+ */
+
+unsigned char *json_encode_binary   (const JsonNode *node, size_t *len);
+JsonNode      *json_decode_binary   (const void *data, size_t len);
+JsonNode      *json_decode_binary_a (JsonArena *arena, const void *data, size_t len);
+
 /*** Lookup and traversal ***/
 
+/*
+ * Large arrays and objects are indexed on demand, after which these lookups
+ * are O(1).  The index is kept up to date by the functions in this header, so
+ * children must not be relinked, or keys changed, by hand once lookups have
+ * been made.
+ */
+
 JsonNode   *json_find_element   (JsonNode *array, int index);
 JsonNode   *json_find_member    (JsonNode *object, const char *key);
 
@@ -88,6 +305,55 @@ JsonNode   *json_first_child    (const JsonNode *node);
 		 (i) != NULL;                               \
 		 (i) = (i)->next)
 
+/*** JSON Pointer ***/
+
+/*
+ * Paths into a document, as in RFC 6901: "" is the document itself, and
+ * "/imtq/params/0x3003" the member "0x3003" of "params" of "imtq".  ~1 and
+ * ~0 stand for / and ~ inside a name, and names which are decimal numbers
+ * also select array elements.
+ *
+ * A path compiled once can be resolved any number of times, against any
+ * document, without parsing it again.  Resolving returns NULL if there is
+ * nothing at the path.
+ */
+typedef struct JsonPointer JsonPointer;
+
+/* NULL if path isn't a valid pointer, or there's no memory for it. */
+JsonPointer *json_pointer_compile     (const char *path);
+void         json_pointer_free        (JsonPointer *ptr);
+JsonNode    *json_pointer_resolve     (const JsonPointer *ptr, JsonNode *doc);
+
+/*
+ * Resolve count pointers at once, into out[0..count).  Leading names shared
+ * with the previous pointer are only looked up once, so pointers sorted or
+ * grouped by prefix make a single pass over the document.
+ */
+void         json_pointer_resolve_all (JsonPointer *const *ptrs, size_t count, JsonNode *doc, JsonNode **out);
+
+/* Compile, resolve and free in one go, for paths used only once. */
+JsonNode    *json_pointer_get         (JsonNode *doc, const char *path);
+
+/*** Diff and patch ***/
+
+/*
+ * json_diff returns an RFC 6902 patch (an array of add, remove and replace
+ * operations, with RFC 6901 paths) which turns a into b, or an empty array
+ * if they are the same.  It runs in time linear in the size of a and b;
+ * to stay that way, arrays are compared position by position, so an element
+ * inserted near the front of an array is described as a run of changes.
+ * Neither a nor b is modified (lookup indexes included), so they can be
+ * diffed while other threads are reading them.
+ *
+ * json_patch applies a patch (including move, copy and test operations) to
+ * doc in place, and returns false if an operation can't be applied.  It
+ * stops at that operation, leaving the ones before it applied, so patch a
+ * copy when the original must survive a bad patch.  The patch itself is
+ * only read.
+ */
+JsonNode   *json_diff           (const JsonNode *a, const JsonNode *b);
+bool        json_patch          (JsonNode *doc, const JsonNode *patch);
+
 /*** Construction and manipulation ***/
 
 JsonNode *json_mknull(void);
@@ -97,6 +363,17 @@ JsonNode *json_mknumber(double n);
 JsonNode *json_mkarray(void);
 JsonNode *json_mkobject(void);
 
+JsonNode *json_mknull_a(JsonArena *arena);
+JsonNode *json_mkbool_a(JsonArena *arena, bool b);
+JsonNode *json_mkstring_a(JsonArena *arena, const char *s);
+JsonNode *json_mknumber_a(JsonArena *arena, double n);
+JsonNode *json_mkarray_a(JsonArena *arena);
+JsonNode *json_mkobject_a(JsonArena *arena);
+
+/*
+ * The copy of the key made by json_append_member/json_prepend_member comes
+ * from the same arena as value.
+ */
 void json_append_element(JsonNode *array, JsonNode *element);
 void json_prepend_element(JsonNode *array, JsonNode *element);
 void json_append_member(JsonNode *object, const char *key, JsonNode *value);
@@ -0,0 +1,276 @@
+/*
+ * Compare the binary encoding with JSON text, in size and speed, on
+ * documents shaped like the iMTQ ADCS telemetry: the same keys as the
+ * nominal and debug telemetry produced by isis-imtq-api, with values in the
+ * ranges the hardware reports, and a batch of nominal records as they would
+ * be queued up for a downlink pass.
+ *
+ * Usage: json-bench-binary [seconds per measurement]
+ */
+
+#include "json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* TRXVU downlink rate, RADIO_TX_RATE_9600 */
+#define DOWNLINK_BPS 9600
+
+#define BATCH 20
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long rng_state = 12345;
+
+static long rnd(long lo, long hi)
+{
+	rng_state = rng_state * 1103515245 + 12345;
+	return lo + (long) ((rng_state >> 16) % (unsigned long) (hi - lo + 1));
+}
+
+static void add(JsonNode *obj, const char *key, double value)
+{
+	json_append_member(obj, key, json_mknumber(value));
+}
+
+static void add_xyz(JsonNode *obj, const char *fmt, long lo, long hi)
+{
+	static const char axes[] = "xyz";
+	char key[64];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		sprintf(key, fmt, axes[i]);
+		add(obj, key, rnd(lo, hi));
+	}
+}
+
+static void add_status(JsonNode *obj, unsigned long uptime)
+{
+	json_append_member(obj, "system_mode", json_mkstring("DETUMBLE"));
+	json_append_member(obj, "system_error", json_mkstring("no"));
+	json_append_member(obj, "system_configured", json_mkstring("yes"));
+	add(obj, "system_uptime", uptime);
+}
+
+static JsonNode *make_nominal(unsigned long uptime)
+{
+	JsonNode *obj = json_mkobject();
+
+	add_status(obj, uptime);
+
+	add(obj, "supply_voltage_digital_raw", rnd(3200, 3400));
+	add(obj, "supply_voltage_analog_raw", rnd(3200, 3400));
+	add(obj, "supply_current_digital_raw", rnd(20, 60));
+	add(obj, "supply_current_analog_raw", rnd(5, 30));
+	add_xyz(obj, "coil_current_%c_raw", 0, 4095);
+	add_xyz(obj, "coil_temp_%c_raw", 1800, 2300);
+	add(obj, "mcu_temp_raw", rnd(1800, 2300));
+
+	add(obj, "supply_voltage_digital_eng", rnd(3250, 3350));
+	add(obj, "supply_voltage_analog_eng", rnd(3250, 3350));
+	add(obj, "supply_current_digital_eng", rnd(20, 60));
+	add(obj, "supply_current_analog_eng", rnd(5, 30));
+	add_xyz(obj, "coil_current_%c_eng", -180, 180);
+	add_xyz(obj, "coil_temp_%c_eng", -20, 60);
+	add(obj, "mcu_temp_eng", rnd(-20, 60));
+
+	add_xyz(obj, "detumble_calib_mtm_%c", -60000, 60000);
+	add_xyz(obj, "detumble_filter_mtm_%c", -60000, 60000);
+	add_xyz(obj, "detumble_bdot_%c", -5000, 5000);
+	add_xyz(obj, "detumble_dipole_%c", -200000, 200000);
+	add_xyz(obj, "detumble_cmd_current_%c", -180, 180);
+	add_xyz(obj, "detumble_coil_current_%c", -180, 180);
+
+	json_append_member(obj, "mtm_actuating", json_mkstring("no"));
+	add_xyz(obj, "mtm_%c_raw", -60000, 60000);
+	add_xyz(obj, "mtm_%c_calib", -60000, 60000);
+	add_xyz(obj, "dipole_%c", -200000, 200000);
+
+	return obj;
+}
+
+/* Parameter IDs from adcs_config_params, in order */
+static const unsigned short config_params[] = {
+	0x2002, 0x2003, 0x2004, 0x2005, 0x2006, 0x2007, 0x2008, 0x2009, 0x200A,
+	0xA001, 0xA002, 0xA003, 0xA004, 0xA005, 0xA006, 0xA007, 0xA008, 0xA009,
+	0xA00A, 0xA00B, 0xA00C, 0x301C, 0x301D, 0x301E, 0x301F, 0x3020, 0x3021,
+	0x3022, 0x3023, 0x3024, 0x3025, 0x3026, 0x3027, 0x3028, 0x3029, 0x302A,
+	0x302B, 0x302C, 0x302D, 0x2000, 0xA000, 0xA00D, 0xA00E, 0xA00F, 0xA010,
+	0xA011, 0x4000, 0x2001, 0x5000, 0x5001, 0x5002, 0x3000, 0x3001, 0x3002,
+	0x3003, 0x3004, 0x3005, 0x3006, 0x3007, 0x3008, 0x3009, 0x300A, 0x300B,
+	0x300C, 0x300D, 0x300E, 0x300F, 0x3010, 0x3011, 0x3012, 0x3013, 0x3014,
+	0x3015, 0x3016, 0x3017, 0x3018, 0x3019, 0x301A, 0x301B, 0x2800, 0x2801,
+	0x4800, 0x6800
+};
+
+static const char *test_steps[] = { "init", "posx", "negx", "posy", "negy", "posz", "negz", "fina" };
+
+static JsonNode *make_debug(void)
+{
+	JsonNode *obj = json_mkobject();
+	char key[64];
+	size_t i;
+
+	add_status(obj, 86400);
+
+	/* The top nibble of a parameter ID is its type; 0xA is a double */
+	for (i = 0; i < sizeof(config_params) / sizeof(*config_params); i++) {
+		sprintf(key, "%#x", config_params[i]);
+		if ((config_params[i] >> 12) == 0xA)
+			add(obj, key, rnd(-1000000, 1000000) / 1048576.0 + rnd(-1000000, 1000000) / 1e15);
+		else
+			add(obj, key, rnd(0, 65535));
+	}
+
+	for (i = 0; i < 8; i++) {
+		sprintf(key, "tr_%s_error", test_steps[i]);
+		add(obj, key, 0);
+		sprintf(key, "tr_%s_mtm_raw_%%c", test_steps[i]);
+		add_xyz(obj, key, -60000, 60000);
+		sprintf(key, "tr_%s_mtm_calib_%%c", test_steps[i]);
+		add_xyz(obj, key, -60000, 60000);
+		sprintf(key, "tr_%s_coil_current_%%c", test_steps[i]);
+		add_xyz(obj, key, -180, 180);
+		sprintf(key, "tr_%s_coil_temp_%%c", test_steps[i]);
+		add_xyz(obj, key, -20, 60);
+	}
+
+	return obj;
+}
+
+static JsonNode *make_batch(void)
+{
+	JsonNode *array = json_mkarray();
+	int i;
+
+	for (i = 0; i < BATCH; i++)
+		json_append_element(array, make_nominal(86400 + i * 10));
+	return array;
+}
+
+/* Calls per second of one of the operations below, best of a few runs */
+static double rate(void (*op)(void *), void *arg, double seconds)
+{
+	double best = 0;
+	int run;
+
+	for (run = 0; run < 5; run++) {
+		double start = now(), elapsed;
+		long n = 0;
+
+		do {
+			op(arg);
+			n++;
+		} while ((elapsed = now() - start) < seconds / 5);
+
+		if (n / elapsed > best)
+			best = n / elapsed;
+	}
+	return best;
+}
+
+typedef struct
+{
+	JsonNode *tree;
+	char *text;
+	unsigned char *bin;
+	size_t bin_len;
+	JsonArena *arena;
+} Doc;
+
+static void op_encode(void *arg)
+{
+	free(json_encode(((Doc*) arg)->tree));
+}
+
+static void op_decode(void *arg)
+{
+	json_delete(json_decode(((Doc*) arg)->text));
+}
+
+static void op_encode_binary(void *arg)
+{
+	size_t len;
+	free(json_encode_binary(((Doc*) arg)->tree, &len));
+}
+
+static void op_decode_binary(void *arg)
+{
+	Doc *doc = arg;
+	json_delete(json_decode_binary(doc->bin, doc->bin_len));
+}
+
+/* Without malloc and free for every node, which otherwise dominate decoding */
+static void op_decode_arena(void *arg)
+{
+	Doc *doc = arg;
+	json_decode_a(doc->arena, doc->text);
+	json_arena_reset(doc->arena);
+}
+
+static void op_decode_binary_arena(void *arg)
+{
+	Doc *doc = arg;
+	json_decode_binary_a(doc->arena, doc->bin, doc->bin_len);
+	json_arena_reset(doc->arena);
+}
+
+static void measure(const char *name, JsonNode *tree, double seconds)
+{
+	Doc doc;
+	JsonNode *back;
+	char *check;
+	size_t text_len;
+
+	doc.tree = tree;
+	doc.text = json_encode(tree);
+	doc.bin = json_encode_binary(tree, &doc.bin_len);
+	doc.arena = json_arena_create(0);
+	text_len = strlen(doc.text);
+
+	/* The binary form must decode to exactly the same document */
+	back = json_decode_binary(doc.bin, doc.bin_len);
+	check = json_encode(back);
+	if (check == NULL || strcmp(check, doc.text) != 0) {
+		fprintf(stderr, "%s: binary round trip failed\n", name);
+		exit(1);
+	}
+
+	printf("%-8s %6zu %6zu %4.0f%% %6.2f %6.2f %8.0f %8.0f %8.0f %8.0f %8.0f %8.0f\n", name,
+	       text_len, doc.bin_len, 100.0 * doc.bin_len / text_len,
+	       text_len * 8.0 / DOWNLINK_BPS, doc.bin_len * 8.0 / DOWNLINK_BPS,
+	       rate(op_encode, &doc, seconds), rate(op_encode_binary, &doc, seconds),
+	       rate(op_decode, &doc, seconds), rate(op_decode_binary, &doc, seconds),
+	       rate(op_decode_arena, &doc, seconds), rate(op_decode_binary_arena, &doc, seconds));
+
+	free(check);
+	json_delete(back);
+	free(doc.text);
+	free(doc.bin);
+	json_arena_destroy(doc.arena);
+	json_delete(tree);
+}
+
+int main(int argc, char *argv[])
+{
+	double seconds = (argc > 1) ? atof(argv[1]) : 0.5;
+
+	printf("%-8s %6s %6s %5s %6s %6s %8s %8s %8s %8s %8s %8s\n", "", "text", "binary", "",
+	       "text s", "bin s", "encode", "binary", "decode", "binary", "arena", "binary");
+
+	measure("nominal", make_nominal(86400), seconds);
+	measure("debug", make_debug(), seconds);
+	measure("batch", make_batch(), seconds);
+
+	printf("\nSizes in bytes; seconds are airtime at %d bps; the rest are documents/s,\n"
+	       "with the last two decoding into an arena.\n", DOWNLINK_BPS);
+	return 0;
+}
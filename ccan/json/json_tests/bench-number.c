@@ -0,0 +1,160 @@
+/*
+ * Compare number formatting and parsing against the implementations they
+ * replaced: sprintf("%.16g") plus a validity check for formatting, and a
+ * grammar scan followed by strtod for parsing.
+ *
+ * Usage: json-bench-number [count]
+ */
+
+#include <ccan/json/json.c>
+
+#include <stdio.h>
+#include <time.h>
+
+#define SETS 3
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void)
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static bool scan_number(const char **sp)
+{
+	return parse_number(sp, NULL);
+}
+
+/* The formatter before the change */
+static int old_format_number(char *buf, double num)
+{
+	const char *s = buf;
+
+	sprintf(buf, "%.16g", num);
+	if (!scan_number(&s) || *s != 0)
+		strcpy(buf, "null");
+	return strlen(buf);
+}
+
+/* The parser before the change */
+static bool old_parse_number(const char **sp, double *out)
+{
+	const char *s = *sp;
+
+	if (!scan_number(&s))
+		return false;
+	if (out)
+		*out = strtod(*sp, NULL);
+	*sp = s;
+	return true;
+}
+
+static void generate(double *values, size_t count, int set)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		uint64_t u = rng();
+
+		switch (set) {
+			case 0:     /* Counters, timestamps and raw register values */
+				values[i] = (double) (int64_t) (u % 4000000000u) - 2000000000.0;
+				break;
+			case 1:     /* Scaled telemetry readings */
+				values[i] = (double) (int64_t) (u % 2000001 - 1000000) / 1000.0;
+				break;
+			default:    /* Arbitrary doubles */
+				memcpy(&values[i], &u, sizeof(double));
+				if (values[i] != values[i] || values[i] - values[i] != 0)
+					values[i] = (double) u;
+				break;
+		}
+	}
+}
+
+static double time_format(int (*format)(char *, double), const double *values, size_t count, char *text)
+{
+	double start = now();
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		format(text + i * JSON_NUMBER_MAX, values[i]);
+	return count / (now() - start);
+}
+
+static double time_parse(bool (*parse)(const char **, double *), const char *text, size_t count, double *sum)
+{
+	double start = now();
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		const char *s = text + i * JSON_NUMBER_MAX;
+		double num;
+
+		parse(&s, &num);
+		*sum += num;
+	}
+	return count / (now() - start);
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *names[SETS] = { "integers", "telemetry", "random" };
+	size_t count = (argc > 1) ? (size_t) atol(argv[1]) : 1000000;
+	double *values = malloc(count * sizeof(double));
+	char *old_text = malloc(count * JSON_NUMBER_MAX);
+	char *new_text = malloc(count * JSON_NUMBER_MAX);
+	double sum = 0;
+	int set;
+
+	if (values == NULL || old_text == NULL || new_text == NULL || count == 0) {
+		fprintf(stderr, "Usage: %s [count]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%-10s %12s %12s %12s %12s %10s\n", "", "old fmt/s", "new fmt/s",
+	       "old parse/s", "new parse/s", "mismatch");
+
+	for (set = 0; set < SETS; set++) {
+		double old_fmt, new_fmt, old_parse, new_parse;
+		size_t i, mismatches = 0;
+
+		generate(values, count, set);
+
+		old_fmt = time_format(old_format_number, values, count, old_text);
+		new_fmt = time_format(format_number, values, count, new_text);
+		old_parse = time_parse(old_parse_number, old_text, count, &sum);
+		new_parse = time_parse(parse_number, old_text, count, &sum);
+
+		/* The new output must read back exactly */
+		for (i = 0; i < count; i++) {
+			const char *s = new_text + i * JSON_NUMBER_MAX;
+			double num;
+
+			if (!parse_number(&s, &num) || memcmp(&num, &values[i], sizeof(num)) != 0)
+				mismatches++;
+		}
+
+		printf("%-10s %12.0f %12.0f %12.0f %12.0f %10zu\n", names[set],
+		       old_fmt, new_fmt, old_parse, new_parse, mismatches);
+	}
+
+	/* Keeps the parse loops from being optimised away */
+	if (sum == 1.0)
+		printf("\n");
+
+	free(values);
+	free(old_text);
+	free(new_text);
+	return 0;
+}
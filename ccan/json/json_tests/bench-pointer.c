@@ -0,0 +1,150 @@
+/*
+ * Compare ways of picking values out of a configuration document on every
+ * poll: chains of json_find_member with the path split each time, pointers
+ * compiled on every poll, pointers compiled once, and pointers compiled
+ * once and resolved as a batch.
+ *
+ * Usage: json-bench-pointer [seconds per measurement]
+ */
+
+#include "json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PARAMS 100
+#define PATHS 64
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Shaped like a service configuration, with the iMTQ parameters in the middle */
+static JsonNode *make_config(void)
+{
+	static const char *services[] = { "trxvu", "ants", "eps", "imtq", "gps", "supervisor" };
+	JsonNode *doc = json_mkobject();
+	char key[16];
+	size_t s;
+	int i;
+
+	for (s = 0; s < sizeof(services) / sizeof(*services); s++) {
+		JsonNode *service = json_mkobject();
+		JsonNode *params = json_mkobject();
+
+		for (i = 0; i < PARAMS; i++) {
+			sprintf(key, "%#x", 0x3000 + i);
+			json_append_member(params, key, json_mknumber(i));
+		}
+		json_append_member(service, "enabled", json_mkbool(true));
+		json_append_member(service, "params", params);
+		json_append_member(doc, services[s], service);
+	}
+	return doc;
+}
+
+static char paths[PATHS][32];
+
+static JsonNode *find_by_members(JsonNode *doc, const char *path)
+{
+	char copy[32];
+	char *name;
+
+	strcpy(copy, path);
+	for (name = strtok(copy, "/"); name != NULL && doc != NULL; name = strtok(NULL, "/"))
+		doc = json_find_member(doc, name);
+	return doc;
+}
+
+typedef struct
+{
+	JsonNode *doc;
+	JsonPointer *ptrs[PATHS];
+	JsonNode *out[PATHS];
+	double sum;
+} Bench;
+
+static void op_members(Bench *b)
+{
+	int i;
+	for (i = 0; i < PATHS; i++)
+		b->sum += find_by_members(b->doc, paths[i])->number_;
+}
+
+static void op_get(Bench *b)
+{
+	int i;
+	for (i = 0; i < PATHS; i++)
+		b->sum += json_pointer_get(b->doc, paths[i])->number_;
+}
+
+static void op_compiled(Bench *b)
+{
+	int i;
+	for (i = 0; i < PATHS; i++)
+		b->sum += json_pointer_resolve(b->ptrs[i], b->doc)->number_;
+}
+
+static void op_batch(Bench *b)
+{
+	int i;
+	json_pointer_resolve_all(b->ptrs, PATHS, b->doc, b->out);
+	for (i = 0; i < PATHS; i++)
+		b->sum += b->out[i]->number_;
+}
+
+/* Polls (of every path) per second, best of a few runs */
+static double rate(void (*op)(Bench *), Bench *b, double seconds)
+{
+	double best = 0;
+	int run;
+
+	for (run = 0; run < 5; run++) {
+		double start = now(), elapsed;
+		long n = 0;
+
+		do {
+			op(b);
+			n++;
+		} while ((elapsed = now() - start) < seconds / 5);
+
+		if (n / elapsed > best)
+			best = n / elapsed;
+	}
+	return best;
+}
+
+int main(int argc, char *argv[])
+{
+	double seconds = (argc > 1) ? atof(argv[1]) : 0.5;
+	Bench b;
+	int i;
+
+	b.doc = make_config();
+	b.sum = 0;
+	for (i = 0; i < PATHS; i++) {
+		sprintf(paths[i], "/imtq/params/%#x", 0x3000 + (i * 37) % PARAMS);
+		b.ptrs[i] = json_pointer_compile(paths[i]);
+	}
+
+	printf("%-24s %10s\n", "", "polls/s");
+	printf("%-24s %10.0f\n", "json_find_member chain", rate(op_members, &b, seconds));
+	printf("%-24s %10.0f\n", "json_pointer_get", rate(op_get, &b, seconds));
+	printf("%-24s %10.0f\n", "compiled", rate(op_compiled, &b, seconds));
+	printf("%-24s %10.0f\n", "compiled, batch", rate(op_batch, &b, seconds));
+	printf("\nEach poll looks up %d paths.\n", PATHS);
+
+	/* Keeps the lookups from being optimised away */
+	if (b.sum == 1.0)
+		printf("\n");
+
+	for (i = 0; i < PATHS; i++)
+		json_pointer_free(b.ptrs[i]);
+	json_delete(b.doc);
+	return 0;
+}
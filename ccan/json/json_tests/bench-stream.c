@@ -0,0 +1,170 @@
+/*
+ * Compare json_decode against the streaming parser on a large document.
+ *
+ * Each parser runs in its own child process, so that its peak RSS can be
+ * measured on its own.  Usage: json-bench-stream [size in MB]
+ */
+
+#include "json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Telemetry-like records, roughly 200 bytes each */
+static void generate(const char *path, size_t target)
+{
+	FILE *f = fopen(path, "w");
+	size_t written = 0;
+	long i;
+
+	if (f == NULL) {
+		perror("Failed to create input file");
+		exit(1);
+	}
+
+	fputc('[', f);
+	for (i = 0; written < target; i++) {
+		written += fprintf(f,
+			"%s{\"timestamp\":%ld.25,\"mode\":\"DETUMBLE\",\"error\":false,"
+			"\"mtm\":[%ld,%ld,%ld],\"dipole\":[-1.5e-3,2.25e-3,%ld.5],"
+			"\"coil_temp\":{\"x\":%ld,\"y\":%ld,\"z\":%ld},\"note\":\"caf\\u00e9\\n\"}",
+			i ? "," : "", 1500000000L + i, i % 97, -(i % 89), i % 83, i % 7,
+			20 + i % 5, 21 + i % 3, 19 + i % 4);
+	}
+	fputs("]\n", f);
+	fclose(f);
+}
+
+static void *read_file(const char *path, size_t *len)
+{
+	struct stat st;
+	char *buf;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) != 0)
+		return NULL;
+
+	buf = malloc(st.st_size + 1);
+	if (buf == NULL || read(fd, buf, st.st_size) != st.st_size) {
+		close(fd);
+		free(buf);
+		return NULL;
+	}
+	buf[st.st_size] = 0;
+	close(fd);
+
+	*len = st.st_size;
+	return buf;
+}
+
+static bool count_event(void *ctx, const JsonEvent *event)
+{
+	(void) event;
+	(*(long*) ctx)++;
+	return true;
+}
+
+static int run_decode(const char *path)
+{
+	size_t len;
+	char *json = read_file(path, &len);
+	JsonNode *root;
+
+	if (json == NULL)
+		return 1;
+
+	root = json_decode(json);
+	if (root == NULL)
+		return 1;
+
+	json_delete(root);
+	free(json);
+	return 0;
+}
+
+static int run_stream(const char *path)
+{
+	long events = 0;
+	JsonStream *stream = json_stream_create(count_event, &events, 0, 0);
+	int fd = open(path, O_RDONLY);
+	bool ok;
+
+	if (fd < 0)
+		return 1;
+
+	ok = json_stream_parse_fd(stream, fd);
+	close(fd);
+	json_stream_destroy(stream);
+	return ok && events > 0 ? 0 : 1;
+}
+
+static int run_idle(const char *path)
+{
+	(void) path;
+	return 0;
+}
+
+static void measure(const char *name, int (*func)(const char *), const char *path, size_t size)
+{
+	struct rusage usage;
+	int status;
+	double start = now();
+	pid_t pid = fork();
+
+	if (pid == 0)
+		_exit(func(path));
+
+	if (pid < 0 || wait4(pid, &status, 0, &usage) != pid) {
+		perror("Failed to run benchmark");
+		exit(1);
+	}
+
+	double elapsed = now() - start;
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "%s failed\n", name);
+		exit(1);
+	}
+
+	printf("%-12s %8.1f MB/s  %8ld kB peak RSS\n", name,
+	       size / elapsed / 1e6, usage.ru_maxrss);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t size = (size_t) ((argc > 1) ? atoi(argv[1]) : 16) << 20;
+	char path[] = "/tmp/json-bench-XXXXXX";
+	struct stat st;
+	int fd = mkstemp(path);
+
+	if (fd < 0 || size == 0) {
+		fprintf(stderr, "Usage: %s [size in MB]\n", argv[0]);
+		return 1;
+	}
+	close(fd);
+
+	generate(path, size);
+	stat(path, &st);
+
+	printf("%.1f MB document\n", st.st_size / 1e6);
+	measure("(baseline)", run_idle, path, st.st_size);
+	measure("json_decode", run_decode, path, st.st_size);
+	measure("json_stream", run_stream, path, st.st_size);
+
+	unlink(path);
+	return 0;
+}
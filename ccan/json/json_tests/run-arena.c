@@ -0,0 +1,128 @@
+/* Build and decode trees in an arena, check they behave exactly like heap trees, and that resetting the arena recycles its memory. */
+
+#include "common.h"
+
+static bool encodes_as(const JsonNode *node, const char *expected)
+{
+	char *encoded = json_encode(node);
+	bool ret = encoded != NULL && strcmp(encoded, expected) == 0;
+
+	if (!ret)
+		diag("expected %s, got %s", expected, encoded);
+	free(encoded);
+	return ret;
+}
+
+static void test_construction(JsonArena *arena)
+{
+	JsonNode *object = json_mkobject_a(arena);
+	JsonNode *array = json_mkarray_a(arena);
+	JsonNode *member;
+
+	json_append_member(object, "null", json_mknull_a(arena));
+	json_append_member(object, "bool", json_mkbool_a(arena, true));
+	json_append_member(object, "string", json_mkstring_a(arena, "Hello\tworld"));
+	json_append_element(array, json_mknumber_a(arena, 1));
+	json_append_element(array, json_mknumber_a(arena, -2.5));
+	json_prepend_member(object, "array", array);
+
+	ok1(json_check(object, NULL));
+	ok1(encodes_as(object, "{\"array\":[1,-2.5],\"null\":null,\"bool\":true,\"string\":\"Hello\\tworld\"}"));
+
+	ok1(json_node_arena(object) == arena);
+	ok1(json_node_arena(array->children.head) == arena);
+
+	/* Detaching and deleting arena nodes is allowed, and leaves the rest intact */
+	member = json_find_member(object, "bool");
+	json_delete(member);
+	ok1(encodes_as(object, "{\"array\":[1,-2.5],\"null\":null,\"string\":\"Hello\\tworld\"}"));
+	ok1(json_check(object, NULL));
+}
+
+static void test_mixed(JsonArena *arena)
+{
+	/* Heap nodes can live in arena trees, and take their keys from the heap */
+	JsonNode *object = json_mkobject_a(arena);
+	JsonNode *heap = json_mknumber(7);
+
+	json_append_member(object, "heap", heap);
+	ok1(json_node_arena(heap) == NULL);
+	ok1(encodes_as(object, "{\"heap\":7}"));
+
+	json_delete(heap);
+	ok1(encodes_as(object, "{}"));
+}
+
+static void test_decode(JsonArena *arena)
+{
+	const char *json = "{\"a\":[true,false,null],\"b\":\"\\u00e9t\\u00e9\",\"c\":{\"d\":1e3}}";
+	JsonNode *node = json_decode_a(arena, json);
+	JsonNode *heap = json_decode(json);
+	char *a, *b;
+
+	ok1(node != NULL && heap != NULL);
+	ok1(json_node_arena(node) == arena);
+	ok1(json_node_arena(json_find_member(node, "c")->children.head) == arena);
+	ok1(json_check(node, NULL));
+
+	a = json_encode(node);
+	b = json_encode(heap);
+	ok1(strcmp(a, b) == 0);
+	free(a);
+	free(b);
+	json_delete(heap);
+
+	ok1(json_decode_a(arena, "[1, 2") == NULL);
+}
+
+int main(void)
+{
+	JsonArena *arena;
+	JsonNode *node;
+	size_t used;
+	int i;
+
+	(void) chomp;
+
+	plan_tests(23);
+
+	ok1(json_node_arena(NULL) == NULL);
+	ok1(json_arena_used(NULL) == 0);
+
+	node = json_mknull_a(NULL);
+	ok1(json_node_arena(node) == NULL);
+	json_delete(node);
+
+	/* Tiny blocks, so that block chaining and oversized blocks get exercised */
+	arena = json_arena_create(64);
+	ok1(arena != NULL);
+
+	test_construction(arena);
+	test_mixed(arena);
+	test_decode(arena);
+
+	/* Long strings don't fit a block, and must get one to themselves */
+	{
+		char big[1000];
+		memset(big, 'x', sizeof(big) - 1);
+		big[sizeof(big) - 1] = 0;
+		ok1(strcmp(json_mkstring_a(arena, big)->string_, big) == 0);
+	}
+
+	used = json_arena_used(arena);
+	ok1(used > 0);
+
+	json_arena_reset(arena);
+	ok1(json_arena_used(arena) == 0);
+
+	/* Memory is counted again from scratch after a reset */
+	for (i = 0; i < 3; i++)
+		json_delete(json_decode_a(arena, "{\"x\":[1,2,3],\"y\":\"z\"}"));
+	ok1(json_arena_used(arena) > 0 && json_arena_used(arena) < used);
+
+	json_arena_destroy(arena);
+	json_arena_destroy(NULL);
+	json_arena_reset(NULL);
+
+	return exit_status();
+}
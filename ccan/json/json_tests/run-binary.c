@@ -0,0 +1,192 @@
+/* Round-trip trees through the binary encoding, check the encoding of each kind of value byte for byte, and check that truncated or corrupt input is rejected. */
+
+#include "common.h"
+
+static bool same_tree(const JsonNode *a, const JsonNode *b)
+{
+	char *ea = json_encode(a);
+	char *eb = json_encode(b);
+	bool ret = ea != NULL && eb != NULL && strcmp(ea, eb) == 0;
+
+	free(ea);
+	free(eb);
+	return ret;
+}
+
+static bool encodes_as(JsonNode *node, const char *expected, size_t expected_len)
+{
+	size_t len = 0;
+	unsigned char *bin = json_encode_binary(node, &len);
+	JsonNode *back = json_decode_binary(bin, len);
+	bool ret = bin != NULL && len == expected_len && memcmp(bin, expected, len) == 0;
+
+	if (!ret) {
+		size_t i;
+		diag("%zu bytes, expected %zu:", len, expected_len);
+		for (i = 0; i < len; i++)
+			diag("  %02X", bin[i]);
+	}
+
+	/* Numbers must come back bit for bit, not just with the same text */
+	if (node->tag == JSON_NUMBER)
+		ret &= back != NULL && memcmp(&back->number_, &node->number_, sizeof(double)) == 0;
+	else
+		ret &= same_tree(node, back);
+
+	free(bin);
+	json_delete(back);
+	json_delete(node);
+	return ret;
+}
+
+static bool decodes(const char *bin, size_t len)
+{
+	JsonNode *node = json_decode_binary(bin, len);
+	json_delete(node);
+	return node != NULL;
+}
+
+static void test_strings(void)
+{
+	const char *strings_file = "test/test-strings";
+	FILE *f;
+	char buffer[1024];
+	int count = 0, good = 0;
+
+	f = fopen(strings_file, "rb");
+	if (f == NULL) {
+		diag("Could not open %s: %s", strings_file, strerror(errno));
+		exit(1);
+	}
+
+	while (fgets(buffer, sizeof(buffer), f)) {
+		const char *s = chomp(buffer);
+		JsonNode *node, *back;
+		unsigned char *bin;
+		size_t len;
+
+		if (!expect_literal(&s, "valid "))
+			continue;
+
+		node = json_decode(s);
+		bin = json_encode_binary(node, &len);
+		back = json_decode_binary(bin, len);
+
+		count++;
+		if (same_tree(node, back) && json_check(back, NULL))
+			good++;
+		else
+			diag("%s does not round-trip", s);
+
+		free(bin);
+		json_delete(node);
+		json_delete(back);
+	}
+
+	ok(count > 0 && good == count, "%d of %d valid documents round-trip", good, count);
+	fclose(f);
+}
+
+static void test_values(void)
+{
+	JsonNode *node;
+
+	ok1(encodes_as(json_mknull(), "\x00", 1));
+	ok1(encodes_as(json_mkbool(false), "\x01", 1));
+	ok1(encodes_as(json_mkbool(true), "\x02", 1));
+
+	/* Integers: inline below 31, varints after */
+	ok1(encodes_as(json_mknumber(0), "\x20", 1));
+	ok1(encodes_as(json_mknumber(30), "\x3E", 1));
+	ok1(encodes_as(json_mknumber(31), "\x3F\x00", 2));
+	ok1(encodes_as(json_mknumber(31 + 300), "\x3F\xAC\x02", 3));
+	ok1(encodes_as(json_mknumber(-1), "\x40", 1));
+	ok1(encodes_as(json_mknumber(-32), "\x5F\x00", 2));
+	ok1(encodes_as(json_mknumber(-9007199254740994.0), "\x5F\xE2\xFF\xFF\xFF\xFF\xFF\xFF\x0F", 9));
+	ok1(encodes_as(json_mknumber(-1.7535714386254010e16), "\x5F\x9A\xB1\x80\xD7\xBA\x94\x93\x1F", 9));
+	ok1(encodes_as(json_mknumber(18446744073709549568.0), "\x3F\xE1\xEF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01", 11));
+
+	/* Floats shrink to 32 bits only when nothing is lost */
+	ok1(encodes_as(json_mknumber(1.5), "\x03\x00\x00\xC0\x3F", 5));
+	ok1(encodes_as(json_mknumber(-0.0), "\x03\x00\x00\x00\x80", 5));
+	ok1(encodes_as(json_mknumber(0.1), "\x04\x9A\x99\x99\x99\x99\x99\xB9\x3F", 9));
+	ok1(encodes_as(json_mknumber(1e300), "\x04\x9C\x75\x00\x88\x3C\xE4\x37\x7E", 9));
+	ok1(encodes_as(json_mknumber(18446744073709551616.0), "\x03\x00\x00\x80\x5F", 5));
+
+	ok1(encodes_as(json_mkstring(""), "\x60", 1));
+	ok1(encodes_as(json_mkstring("caf\xc3\xa9"), "\x65" "caf\xc3\xa9", 6));
+
+	/* Keys are spelled out once, and referred to by number after that */
+	node = json_decode("[{\"ab\":1,\"c\":2},{\"c\":3,\"ab\":4},{\"d\":null}]");
+	ok1(encodes_as(node, "\x83" "\xA2\x62" "ab\x21\x61" "c\x22"
+	                     "\xA2\xC1\x23\xC0\x24" "\xA1\x61" "d\x00", 18));
+
+	ok1(encodes_as(json_mkarray(), "\x80", 1));
+	ok1(encodes_as(json_mkobject(), "\xA0", 1));
+}
+
+static void test_corrupt(void)
+{
+	JsonNode *node = json_decode("{\"mode\":\"DETUMBLE\",\"mtm\":[1,-2.5,1e300],\"ok\":true}");
+	unsigned char *bin;
+	size_t len, i;
+	bool all = true;
+
+	bin = json_encode_binary(node, &len);
+	ok1(decodes((const char*) bin, len));
+
+	/* Every proper prefix, and one byte too many */
+	for (i = 0; i < len; i++)
+		all &= !decodes((const char*) bin, i);
+	ok(all, "truncated input is rejected");
+
+	bin = realloc(bin, len + 1);
+	bin[len] = 0;
+	ok1(!decodes((const char*) bin, len + 1));
+
+	free(bin);
+	json_delete(node);
+
+	ok1(!decodes("\x05", 1));                       /* unknown simple value */
+	ok1(!decodes("\xE0", 1));                       /* unknown type */
+	ok1(!decodes("\x62" "a\0", 3));                 /* NUL in a string */
+	ok1(!decodes("\x61\xC3", 2));                   /* bad UTF-8 */
+	ok1(!decodes("\xA1\xC0\x00", 3));               /* keyref to nothing */
+	ok1(!decodes("\xA1\x20\x00", 3));               /* key which isn't a string */
+	ok1(!decodes("\x3F\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01", 12)); /* varint too long */
+	ok1(!decodes("\x9F\xFF\xFF\xFF\xFF\x0F", 6));   /* huge count, no items */
+	ok1(!decodes("\x5F\xE0\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01", 11)); /* -2^64 */
+	ok1(!decodes("", 0));
+	ok1(json_decode_binary(NULL, 0) == NULL);
+	ok1(json_encode_binary(NULL, &len) == NULL);
+}
+
+static void test_arena(void)
+{
+	JsonArena *arena = json_arena_create(0);
+	JsonNode *node = json_decode("{\"a\":[\"x\",{\"a\":2}],\"b\":\"y\"}");
+	JsonNode *back;
+	unsigned char *bin;
+	size_t len;
+
+	bin = json_encode_binary(node, &len);
+	back = json_decode_binary_a(arena, bin, len);
+	ok1(back != NULL && json_node_arena(back) == arena);
+	ok1(same_tree(node, back) && json_check(back, NULL));
+
+	free(bin);
+	json_delete(node);
+	json_arena_destroy(arena);
+}
+
+int main(void)
+{
+	plan_tests(1 + 22 + 15 + 2);
+
+	test_strings();
+	test_values();
+	test_corrupt();
+	test_arena();
+
+	return exit_status();
+}
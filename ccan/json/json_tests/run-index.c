@@ -0,0 +1,195 @@
+/* Do lookups on objects and arrays large enough to be indexed, mutate them in every supported way, and check that lookups keep agreeing with a plain walk of the children. */
+
+#include "common.h"
+
+#define MEMBERS 200
+
+static JsonNode *walk_member(JsonNode *object, const char *key)
+{
+	JsonNode *member;
+
+	for (member = object->children.head; member != NULL; member = member->next)
+		if (strcmp(member->key, key) == 0)
+			return member;
+	return NULL;
+}
+
+static JsonNode *walk_element(JsonNode *array, int index)
+{
+	JsonNode *element = index >= 0 ? array->children.head : NULL;
+
+	while (element != NULL && index-- > 0)
+		element = element->next;
+	return element;
+}
+
+static bool members_agree(JsonNode *object)
+{
+	char key[16];
+	int i;
+
+	if (!json_check(object, NULL))
+		return false;
+
+	/* Include keys which aren't there */
+	for (i = 0; i < MEMBERS * 2; i++) {
+		sprintf(key, "k%d", i);
+		if (json_find_member(object, key) != walk_member(object, key))
+			return false;
+	}
+	return true;
+}
+
+static bool elements_agree(JsonNode *array)
+{
+	int i;
+
+	if (!json_check(array, NULL))
+		return false;
+
+	for (i = -1; i < MEMBERS * 2; i++)
+		if (json_find_element(array, i) != walk_element(array, i))
+			return false;
+	return true;
+}
+
+static void test_object(JsonArena *arena)
+{
+	JsonNode *object = json_mkobject_a(arena);
+	JsonNode *dup_first, *dup_second, *node;
+	char key[16];
+	int i;
+
+	for (i = 0; i < MEMBERS; i++) {
+		sprintf(key, "k%d", i);
+		json_append_member(object, key, json_mknumber_a(arena, i));
+	}
+
+	/* The first long lookup builds the index */
+	node = json_find_member(object, "k150");
+	ok1(node != NULL && node->number_ == 150);
+	ok1(node_index(object) != NULL);
+	ok1(members_agree(object));
+
+	/* Appends and prepends, including enough to grow the table */
+	for (i = MEMBERS; i < MEMBERS * 2; i += 2) {
+		sprintf(key, "k%d", i);
+		json_append_member(object, key, json_mknumber_a(arena, i));
+		sprintf(key, "k%d", i + 1);
+		json_prepend_member(object, key, json_mknumber_a(arena, i + 1));
+	}
+	ok1(members_agree(object));
+
+	/* Removals from the front, back and middle */
+	json_delete(object->children.head);
+	json_delete(object->children.tail);
+	json_delete(json_find_member(object, "k42"));
+	ok1(json_find_member(object, "k42") == NULL);
+	ok1(members_agree(object));
+
+	/* Duplicate keys resolve to the first one in the list, as before */
+	dup_first = json_mknumber_a(arena, 1);
+	dup_second = json_mknumber_a(arena, 2);
+	json_append_member(object, "k42", dup_second);
+	json_prepend_member(object, "k42", dup_first);
+	ok1(json_find_member(object, "k42") == dup_first);
+	json_delete(dup_first);
+	ok1(json_find_member(object, "k42") == dup_second);
+	ok1(members_agree(object));
+
+	/* Moving a member to an object which is not indexed */
+	node = json_find_member(object, "k7");
+	json_remove_from_parent(node);
+	ok1(json_find_member(object, "k7") == NULL);
+	ok1(members_agree(object));
+	json_delete(node);
+
+	json_delete(object);
+}
+
+static void test_array(JsonArena *arena)
+{
+	JsonNode *array = json_mkarray_a(arena);
+	JsonNode *node;
+	int i;
+
+	for (i = 0; i < MEMBERS; i++)
+		json_append_element(array, json_mknumber_a(arena, i));
+
+	node = json_find_element(array, 150);
+	ok1(node != NULL && node->number_ == 150);
+	ok1(node_index(array) != NULL);
+	ok1(json_find_element(array, MEMBERS) == NULL);
+	ok1(elements_agree(array));
+
+	/* Appending past the index's capacity */
+	for (i = 0; i < MEMBERS * 2; i++)
+		json_append_element(array, json_mknumber_a(arena, MEMBERS + i));
+	ok1(json_find_element(array, MEMBERS * 3 - 1)->number_ == MEMBERS * 3 - 1);
+	ok1(elements_agree(array));
+
+	/* Removing the last element keeps the index */
+	json_delete(array->children.tail);
+	ok1(node_index(array) != NULL);
+	ok1(elements_agree(array));
+
+	/* Shifting positions */
+	json_prepend_element(array, json_mknull_a(arena));
+	ok1(json_find_element(array, 0)->tag == JSON_NULL);
+	ok1(json_find_element(array, 151)->number_ == 150);
+	ok1(elements_agree(array));
+
+	json_delete(json_find_element(array, 10));
+	ok1(json_find_element(array, 10)->number_ == 10);
+	ok1(elements_agree(array));
+
+	json_delete(array);
+}
+
+static void test_decoded(void)
+{
+	SB sb;
+	char *json;
+	JsonNode *root;
+	int i;
+
+	sb_init(&sb, NULL);
+	sb_putc(&sb, '{');
+	for (i = 0; i < MEMBERS; i++) {
+		char member[32];
+		sprintf(member, "%s\"k%d\":[%d]", i ? "," : "", i, i);
+		sb_puts(&sb, member);
+	}
+	sb_putc(&sb, '}');
+
+	json = sb_finish(&sb);
+	root = json_decode(json);
+	free(json);
+
+	ok1(root != NULL);
+	ok1(json_find_element(json_find_member(root, "k199"), 0)->number_ == 199);
+	ok1(members_agree(root));
+
+	json_delete(root);
+}
+
+int main(void)
+{
+	JsonArena *arena;
+
+	(void) chomp;
+
+	plan_tests(51);
+
+	test_object(NULL);
+	test_array(NULL);
+
+	arena = json_arena_create(0);
+	test_object(arena);
+	test_array(arena);
+	json_arena_destroy(arena);
+
+	test_decoded();
+
+	return exit_status();
+}
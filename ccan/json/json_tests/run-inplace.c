@@ -0,0 +1,163 @@
+/* Decode documents in place: check the trees match json_decode, that keys and strings are borrowed from the buffer, and that deleting or moving nodes never frees what they borrowed. */
+
+#include "common.h"
+
+static bool same_tree(const JsonNode *a, const JsonNode *b)
+{
+	char *ea = json_encode(a);
+	char *eb = json_encode(b);
+	bool ret = ea != NULL && eb != NULL && strcmp(ea, eb) == 0;
+
+	free(ea);
+	free(eb);
+	return ret;
+}
+
+static bool within(const char *p, const char *buf, size_t len)
+{
+	return p >= buf && p < buf + len;
+}
+
+/* Every key and string in the tree points into buf */
+static bool all_borrowed(const JsonNode *node, const char *buf, size_t len)
+{
+	const JsonNode *child;
+
+	if (node->key != NULL && !within(node->key, buf, len))
+		return false;
+	if (node->tag == JSON_STRING && !within(node->string_, buf, len))
+		return false;
+	json_foreach(child, node)
+		if (!all_borrowed(child, buf, len))
+			return false;
+	return true;
+}
+
+static void test_strings(void)
+{
+	const char *strings_file = "test/test-strings";
+	FILE *f;
+	char buffer[1024];
+	int valid = 0, valid_good = 0, invalid = 0, invalid_good = 0;
+
+	f = fopen(strings_file, "rb");
+	if (f == NULL) {
+		diag("Could not open %s: %s", strings_file, strerror(errno));
+		exit(1);
+	}
+
+	while (fgets(buffer, sizeof(buffer), f)) {
+		const char *s = chomp(buffer);
+		bool expected_valid;
+		char *copy;
+		size_t len;
+		JsonNode *node, *expected;
+
+		if (expect_literal(&s, "valid "))
+			expected_valid = true;
+		else if (expect_literal(&s, "invalid "))
+			expected_valid = false;
+		else
+			continue;
+
+		len = strlen(s) + 1;
+		copy = malloc(len);
+		memcpy(copy, s, len);
+
+		node = json_decode_inplace(copy);
+		if (expected_valid) {
+			expected = json_decode(s);
+			valid++;
+			if (node != NULL && same_tree(node, expected) && json_check(node, NULL) &&
+			    all_borrowed(node, copy, len))
+				valid_good++;
+			else
+				diag("%s decodes differently in place", s);
+			json_delete(expected);
+		} else {
+			invalid++;
+			if (node == NULL)
+				invalid_good++;
+			else
+				diag("%s decodes in place", s);
+		}
+
+		json_delete(node);
+		free(copy);
+	}
+
+	ok(valid > 0 && valid_good == valid, "%d of %d valid documents decode in place", valid_good, valid);
+	ok(invalid > 0 && invalid_good == invalid, "%d of %d invalid documents are rejected", invalid_good, invalid);
+	fclose(f);
+}
+
+static void test_escapes(void)
+{
+	char buf[] = "{\"k\\u00e9y\":\"a\\\"b\\\\c\\n\",\"\":\"\\ud834\\udd1e!\",\"plain\":\"caf\xc3\xa9\"}";
+	JsonNode *node = json_decode_inplace(buf);
+
+	ok1(node != NULL && json_check(node, NULL));
+	ok1(strcmp(json_find_member(node, "k\xc3\xa9y")->string_, "a\"b\\c\n") == 0);
+	ok1(strcmp(json_find_member(node, "")->string_, "\xf0\x9d\x84\x9e!") == 0);
+	ok1(strcmp(json_find_member(node, "plain")->string_, "caf\xc3\xa9") == 0);
+	ok1(all_borrowed(node, buf, sizeof(buf)));
+
+	json_delete(node);
+}
+
+static void test_ownership(void)
+{
+	char buf[] = "{\"moved\":\"value\",\"deleted\":[\"x\",{\"y\":\"z\"}],\"kept\":1}";
+	JsonNode *node = json_decode_inplace(buf);
+	JsonNode *other = json_mkobject();
+	JsonNode *moved;
+
+	/* Deleting a subtree leaves the buffer, and the rest of the tree, alone */
+	json_delete(json_find_member(node, "deleted"));
+	ok1(json_check(node, NULL));
+
+	/* A member moved to another object gets a key of its own, but keeps borrowing its string */
+	moved = json_find_member(node, "moved");
+	json_remove_from_parent(moved);
+	json_append_member(other, "renamed", moved);
+	ok1(!within(moved->key, buf, sizeof(buf)) && within(moved->string_, buf, sizeof(buf)));
+	ok1(strcmp(moved->string_, "value") == 0);
+
+	json_delete(node);
+	json_delete(other);
+	ok1(strcmp(buf + 2, "moved") == 0);
+}
+
+static void test_arena(void)
+{
+	JsonArena *arena = json_arena_create(0);
+	char buf[] = "{\"a\":[\"x\",{\"a\":\"\\t\"}],\"b\":\"y\"}";
+	JsonNode *node;
+	size_t used;
+
+	node = json_decode_inplace_a(arena, buf);
+	ok1(node != NULL && json_node_arena(node) == arena);
+	ok1(json_check(node, NULL) && all_borrowed(node, buf, sizeof(buf)));
+
+	/* Only the nodes come from the arena */
+	used = json_arena_used(arena);
+	json_arena_reset(arena);
+	json_decode_a(arena, "{\"a\":[\"x\",{\"a\":\"\\t\"}],\"b\":\"y\"}");
+	ok1(json_arena_used(arena) > used);
+
+	json_arena_destroy(arena);
+
+	ok1(json_decode_inplace(NULL) == NULL);
+}
+
+int main(void)
+{
+	plan_tests(2 + 5 + 4 + 4);
+
+	test_strings();
+	test_escapes();
+	test_ownership();
+	test_arena();
+
+	return exit_status();
+}
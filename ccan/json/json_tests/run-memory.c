@@ -0,0 +1,224 @@
+/* Decode and encode through arenas with allocator hooks and budgets: check the hooks are used, the budget is never exceeded, and that every allocation failure is reported rather than fatal, without leaking. */
+
+#include "common.h"
+
+/* Hooks which count what they hand out, and can be told to fail */
+typedef struct
+{
+	size_t held;            /* bytes outstanding */
+	size_t peak;
+	long calls;
+	long fail_after;        /* calls until malloc/realloc start failing, or -1 */
+} Hooks;
+
+typedef union
+{
+	size_t size;
+	double align;
+} Header;
+
+static void *hook_realloc(void *ctx, void *ptr, size_t size)
+{
+	Hooks *h = ctx;
+	Header *block = ptr ? (Header*) ptr - 1 : NULL;
+	size_t old = block ? block->size : 0;
+
+	h->calls++;
+	if (h->fail_after >= 0 && h->calls > h->fail_after)
+		return NULL;
+
+	block = realloc(block, sizeof(Header) + size);
+	if (block == NULL)
+		return NULL;
+	block->size = size;
+	h->held = h->held - old + size;
+	if (h->held > h->peak)
+		h->peak = h->held;
+	return block + 1;
+}
+
+static void *hook_malloc(void *ctx, size_t size)
+{
+	return hook_realloc(ctx, NULL, size);
+}
+
+static void hook_free(void *ctx, void *ptr)
+{
+	Hooks *h = ctx;
+	Header *block = (Header*) ptr - 1;
+
+	h->held -= block->size;
+	free(block);
+}
+
+static Hooks hooks;
+static const JsonAllocator allocator = { hook_malloc, hook_realloc, hook_free, &hooks };
+
+static void hooks_reset(long fail_after)
+{
+	hooks.held = hooks.peak = 0;
+	hooks.calls = 0;
+	hooks.fail_after = fail_after;
+}
+
+/* An object with long strings, escapes and enough members to be indexed */
+static char *make_document(int members)
+{
+	JsonNode *object = json_mkobject();
+	char key[32], value[128];
+	char *json;
+	int i;
+
+	for (i = 0; i < members; i++) {
+		sprintf(key, "member_%d", i);
+		sprintf(value, "value %d with a \"quote\", a tab\t and some padding to make it long", i);
+		json_append_member(object, key, json_mkstring(value));
+	}
+	json_append_member(object, "array", json_decode("[1, 2.5, null, true, [{}], \"caf\\u00e9\"]"));
+
+	json = json_encode(object);
+	json_delete(object);
+	return json;
+}
+
+static void test_hooks(const char *json)
+{
+	JsonArena *arena;
+	JsonNode *node;
+	char *text;
+
+	hooks_reset(-1);
+	arena = json_arena_create_ex(0, &allocator, 0);
+	ok1(arena != NULL && hooks.held == json_arena_held(arena));
+
+	node = json_decode_a(arena, json);
+	text = json_encode_a(arena, node);
+	ok1(node != NULL && text != NULL && strcmp(text, json) == 0);
+	ok1(json_arena_error(arena) == JSON_ERROR_NONE);
+	ok1(hooks.held == json_arena_held(arena) && hooks.calls > 2);
+
+	json_arena_destroy(arena);
+	ok1(hooks.held == 0);
+}
+
+static void test_budget(const char *json)
+{
+	size_t len = strlen(json);
+	JsonArena *arena;
+	JsonNode *node;
+
+	hooks_reset(-1);
+	arena = json_arena_create_ex(1024, &allocator, len);
+	ok1(arena != NULL);
+
+	/* The tree takes more than the text, so this can't fit */
+	ok1(json_decode_a(arena, json) == NULL);
+	ok1(json_arena_error(arena) == JSON_ERROR_BUDGET);
+	ok1(hooks.peak <= len && json_arena_held(arena) <= len);
+
+	/* Resetting clears the error, and small documents still fit */
+	json_arena_reset(arena);
+	ok1(json_arena_error(arena) == JSON_ERROR_NONE);
+	node = json_decode_a(arena, "{\"small\":[1,2,3]}");
+	ok1(node != NULL && json_arena_error(arena) == JSON_ERROR_NONE);
+
+	/* Encoding is held to the same budget */
+	json_arena_reset(arena);
+	node = json_decode(json);
+	ok1(json_encode_a(arena, node) == NULL && json_arena_error(arena) == JSON_ERROR_BUDGET);
+	ok1(hooks.peak <= len);
+	json_delete(node);
+
+	json_arena_destroy(arena);
+	ok1(hooks.held == 0);
+
+	ok1(json_arena_create_ex(0, &allocator, sizeof(JsonArena) + 16) == NULL);
+	ok1(json_arena_create_ex(0, &allocator, 1) == NULL && hooks.held == 0);
+}
+
+/* Fail the nth allocation, for every n until the operation succeeds */
+static bool survives_failures(const char *name, const char *json, int op)
+{
+	JsonNode *expected = json_decode(json);
+	char *expected_text = json_encode(expected);
+	unsigned char *bin;
+	size_t bin_len;
+	long n;
+	bool ret = true;
+
+	bin = json_encode_binary(expected, &bin_len);
+
+	for (n = 0; ; n++) {
+		JsonArena *arena;
+		JsonNode *node = NULL;
+		char *text = NULL;
+		bool done;
+
+		hooks_reset(n);
+		arena = json_arena_create_ex(256, &allocator, 0);
+		if (arena == NULL)
+			continue;
+
+		switch (op) {
+			case 0:
+				node = json_decode_a(arena, json);
+				text = node ? json_encode(node) : NULL;
+				break;
+			case 1:
+				text = json_encode_a(arena, expected);
+				text = text ? strdup(text) : NULL;
+				break;
+			default:
+				node = json_decode_binary_a(arena, bin, bin_len);
+				text = node ? json_encode(node) : NULL;
+				break;
+		}
+
+		done = text != NULL;
+		if (done && strcmp(text, expected_text) != 0) {
+			diag("%s: wrong result after %ld allocations", name, n);
+			ret = false;
+		}
+		if (!done && json_arena_error(arena) != JSON_ERROR_NOMEM) {
+			diag("%s: failed without an error after %ld allocations", name, n);
+			ret = false;
+		}
+
+		free(text);
+		json_arena_destroy(arena);
+		if (hooks.held != 0) {
+			diag("%s: %zu bytes leaked after %ld allocations", name, hooks.held, n);
+			ret = false;
+		}
+		if (done || !ret)
+			break;
+	}
+
+	free(bin);
+	free(expected_text);
+	json_delete(expected);
+	return ret;
+}
+
+static void test_failures(const char *json)
+{
+	ok1(survives_failures("decode", json, 0));
+	ok1(survives_failures("encode", json, 1));
+	ok1(survives_failures("binary", json, 2));
+}
+
+int main(void)
+{
+	char *json = make_document(40);
+
+	(void) chomp;
+
+	plan_tests(5 + 11 + 3);
+
+	test_hooks(json);
+	test_budget(json);
+	test_failures(json);
+
+	free(json);
+	return exit_status();
+}
@@ -0,0 +1,177 @@
+/* Format and parse numbers: check the layout of known values, that formatting random doubles reads back exactly with no more than 17 significant digits, and that parsing agrees with strtod. */
+
+#include "common.h"
+
+#define RANDOM_COUNT 200000
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void)
+{
+	/* xorshift64* */
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static bool formats_as(double num, const char *expected)
+{
+	char buf[JSON_NUMBER_MAX];
+	int len = format_number(buf, num);
+	bool ret = strcmp(buf, expected) == 0 && len == (int) strlen(expected);
+
+	if (!ret)
+		diag("%.17g: expected %s, got %s", num, expected, buf);
+	return ret;
+}
+
+static bool parses_like_strtod(const char *str)
+{
+	const char *s = str;
+	double num;
+	double expected = strtod(str, NULL);
+
+	if (!parse_number(&s, &num) || *s != 0) {
+		diag("%s: not accepted", str);
+		return false;
+	}
+	if (memcmp(&num, &expected, sizeof(num)) != 0) {
+		diag("%s: got %.17g, strtod gives %.17g", str, num, expected);
+		return false;
+	}
+	return true;
+}
+
+/* Leading zeros, and trailing zeros of an integer, are not significant */
+static int significant_digits(const char *s)
+{
+	int count = 0, zeros = 0;
+	bool point = false;
+
+	for (; *s != 0 && *s != 'e'; s++) {
+		if (*s == '.') {
+			point = true;
+		} else if (*s == '0') {
+			if (count > 0)
+				zeros++;
+		} else if (is_digit(*s)) {
+			count += zeros + 1;
+			zeros = 0;
+		}
+	}
+	return point ? count + zeros : count;
+}
+
+static bool round_trips(double num)
+{
+	char buf[JSON_NUMBER_MAX];
+	const char *s = buf;
+	double back;
+
+	format_number(buf, num);
+	if (!parse_number(&s, &back) || *s != 0 || memcmp(&num, &back, sizeof(num)) != 0) {
+		diag("%.17g formatted as %s", num, buf);
+		return false;
+	}
+
+	/* 17 digits are always enough for a double */
+	if (significant_digits(buf) > 17) {
+		diag("%s has more than 17 significant digits", buf);
+		return false;
+	}
+	return true;
+}
+
+static void test_layout(void)
+{
+	ok1(formats_as(0, "0"));
+	ok1(formats_as(-0.0, "-0"));
+	ok1(formats_as(42, "42"));
+	ok1(formats_as(-9007199254740991.0, "-9007199254740991"));
+	ok1(formats_as(9007199254740992.0, "9007199254740992"));
+	ok1(formats_as(1e16, "1e+16"));
+	ok1(formats_as(0.1, "0.1"));
+	ok1(formats_as(0.3, "0.3"));
+	ok1(formats_as(-1.5e-3, "-0.0015"));
+	ok1(formats_as(123456.25, "123456.25"));
+	ok1(formats_as(1e-4, "0.0001"));
+	ok1(formats_as(3e-6, "3e-06"));
+	ok1(formats_as(1.23456e144, "1.23456e+144"));
+	ok1(formats_as(1.23456e-140, "1.23456e-140"));
+	ok1(formats_as(1.7976931348623157e308, "1.7976931348623157e+308"));
+	ok1(formats_as(5e-324, "5e-324"));
+	ok1(formats_as(2.2250738585072014e-308, "2.2250738585072014e-308"));
+	ok1(formats_as(0.0 / 0.0, "null"));
+	ok1(formats_as(1.0 / 0.0, "null"));
+	ok1(formats_as(-1.0 / 0.0, "null"));
+}
+
+static void test_parse(void)
+{
+	const char *numbers[] = {
+		"0", "-0", "1", "-1", "0.5", "123456.25", "1e22", "1e23", "9007199254740993",
+		"18446744073709551615", "123456789012345678901234567890",
+		"0.000000000000000000000000000001", "2.2250738585072011e-308",
+		"4.9e-324", "1.7976931348623157e308", "1e400", "1e-400",
+		"0.1e1", "1E+2", "1e-0", "3.14159265358979323846264338327950288",
+		"100000000000000000000000e-23",
+	};
+	const char *invalid[] = { "", "-", "01", "1.", ".5", "1e", "1e+", "+1", "0x10" };
+	size_t i;
+	bool all = true;
+
+	for (i = 0; i < sizeof(numbers) / sizeof(*numbers); i++)
+		all &= parses_like_strtod(numbers[i]);
+	ok(all, "parse known numbers");
+
+	all = true;
+	for (i = 0; i < sizeof(invalid) / sizeof(*invalid); i++) {
+		const char *s = invalid[i];
+		if (parse_number(&s, NULL) && *s == 0) {
+			diag("%s: accepted", invalid[i]);
+			all = false;
+		}
+	}
+	ok(all, "reject invalid numbers");
+}
+
+static void test_random(void)
+{
+	bool bits = true, decimals = true, integers = true;
+	int i;
+
+	for (i = 0; i < RANDOM_COUNT; i++) {
+		uint64_t u = rng();
+		double num;
+
+		/* Any finite bit pattern, including subnormals */
+		memcpy(&num, &u, sizeof(num));
+		if (num == num && num - num == 0)
+			bits &= round_trips(num);
+
+		/* Values with few digits, like telemetry */
+		num = (double) (int64_t) (u % 2000001 - 1000000) / 1000.0;
+		decimals &= round_trips(num);
+
+		num = (double) (int64_t) (u >> 11) * ((u & 1) ? -1 : 1);
+		integers &= round_trips(num);
+	}
+
+	ok(bits, "random bit patterns round-trip");
+	ok(decimals, "random decimals round-trip");
+	ok(integers, "random integers round-trip");
+}
+
+int main(void)
+{
+	(void) chomp;
+
+	plan_tests(20 + 2 + 3);
+
+	test_layout();
+	test_parse();
+	test_random();
+
+	return exit_status();
+}
@@ -0,0 +1,275 @@
+/* Diff and patch: check the operations produced for known changes, that diffs of random documents patch one into the other, and that RFC 6902 operations apply (or are refused) as specified. */
+
+#include "common.h"
+
+#define RANDOM_COUNT 2000
+
+static bool same_json(const JsonNode *node, const char *expected)
+{
+	char *encoded = json_encode(node);
+	bool ret = encoded != NULL && strcmp(encoded, expected) == 0;
+
+	if (!ret)
+		diag("expected %s, got %s", expected, encoded ? encoded : "NULL");
+	free(encoded);
+	return ret;
+}
+
+static bool diffs_as(const char *a, const char *b, const char *expected)
+{
+	JsonNode *na = json_decode(a);
+	JsonNode *nb = json_decode(b);
+	JsonNode *patch = json_diff(na, nb);
+	bool ret = same_json(patch, expected);
+
+	/* And the patch must do what it says */
+	ret &= json_patch(na, patch) && nodes_equal(na, nb);
+
+	json_delete(patch);
+	json_delete(na);
+	json_delete(nb);
+	return ret;
+}
+
+static void test_diff(void)
+{
+	ok1(diffs_as("{\"a\":1,\"b\":[1,2]}", "{\"a\":1,\"b\":[1,2]}", "[]"));
+	ok1(diffs_as("{\"mode\":\"DETUMBLE\",\"x\":1,\"y\":2}", "{\"mode\":\"DETUMBLE\",\"x\":1,\"y\":3}",
+	             "[{\"op\":\"replace\",\"path\":\"/y\",\"value\":3}]"));
+	ok1(diffs_as("{\"a\":1,\"b\":2}", "{\"b\":2,\"c\":{\"d\":[]}}",
+	             "[{\"op\":\"remove\",\"path\":\"/a\"},{\"op\":\"add\",\"path\":\"/c\",\"value\":{\"d\":[]}}]"));
+	ok1(diffs_as("[1,2,3]", "[1,5]",
+	             "[{\"op\":\"replace\",\"path\":\"/1\",\"value\":5},{\"op\":\"remove\",\"path\":\"/2\"}]"));
+	ok1(diffs_as("[1]", "[1,[2],3]",
+	             "[{\"op\":\"add\",\"path\":\"/1\",\"value\":[2]},{\"op\":\"add\",\"path\":\"/2\",\"value\":3}]"));
+	ok1(diffs_as("[1,2,3,4]", "[1]",
+	             "[{\"op\":\"remove\",\"path\":\"/3\"},{\"op\":\"remove\",\"path\":\"/2\"},{\"op\":\"remove\",\"path\":\"/1\"}]"));
+	ok1(diffs_as("{\"a/b\":{\"c~d\":0}}", "{\"a/b\":{\"c~d\":-0}}",
+	             "[{\"op\":\"replace\",\"path\":\"/a~1b/c~0d\",\"value\":-0}]"));
+	ok1(diffs_as("{\"a\":1}", "[1]", "[{\"op\":\"replace\",\"path\":\"\",\"value\":[1]}]"));
+	ok1(diffs_as("\"x\"", "null", "[{\"op\":\"replace\",\"path\":\"\",\"value\":null}]"));
+
+	/* Member order doesn't matter */
+	ok1(diffs_as("{\"a\":1,\"b\":2,\"c\":3}", "{\"c\":3,\"a\":1,\"b\":2}", "[]"));
+	ok1(diffs_as("{\"a\":1,\"b\":2,\"c\":3}", "{\"c\":3,\"b\":1}",
+	             "[{\"op\":\"remove\",\"path\":\"/a\"},{\"op\":\"replace\",\"path\":\"/b\",\"value\":1}]"));
+
+	ok1(json_diff(NULL, NULL) == NULL);
+}
+
+static bool patches_to(const char *doc, const char *patch, const char *expected)
+{
+	JsonNode *node = json_decode(doc);
+	JsonNode *ops = json_decode(patch);
+	bool ret;
+
+	if (expected == NULL) {
+		ret = !json_patch(node, ops);
+		if (!ret)
+			diag("%s applied to %s", patch, doc);
+	} else {
+		ret = json_patch(node, ops) && same_json(node, expected) && json_check(node, NULL);
+	}
+
+	json_delete(node);
+	json_delete(ops);
+	return ret;
+}
+
+/* Examples from RFC 6902, appendix A */
+static void test_patch(void)
+{
+	ok1(patches_to("{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\"}]",
+	               "{\"foo\":\"bar\",\"baz\":\"qux\"}"));
+	ok1(patches_to("{\"foo\":[\"bar\",\"baz\"]}", "[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"}]",
+	               "{\"foo\":[\"bar\",\"qux\",\"baz\"]}"));
+	ok1(patches_to("{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"remove\",\"path\":\"/baz\"}]",
+	               "{\"foo\":\"bar\"}"));
+	ok1(patches_to("{\"foo\":[\"bar\",\"qux\",\"baz\"]}", "[{\"op\":\"remove\",\"path\":\"/foo/1\"}]",
+	               "{\"foo\":[\"bar\",\"baz\"]}"));
+	ok1(patches_to("{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"replace\",\"path\":\"/baz\",\"value\":\"boo\"}]",
+	               "{\"baz\":\"boo\",\"foo\":\"bar\"}"));
+	ok1(patches_to("{\"foo\":{\"bar\":\"baz\",\"waldo\":\"fred\"},\"qux\":{\"corge\":\"grault\"}}",
+	               "[{\"op\":\"move\",\"from\":\"/foo/waldo\",\"path\":\"/qux/thud\"}]",
+	               "{\"foo\":{\"bar\":\"baz\"},\"qux\":{\"corge\":\"grault\",\"thud\":\"fred\"}}"));
+	ok1(patches_to("{\"foo\":[\"all\",\"grass\",\"cows\",\"eat\"]}",
+	               "[{\"op\":\"move\",\"from\":\"/foo/1\",\"path\":\"/foo/3\"}]",
+	               "{\"foo\":[\"all\",\"cows\",\"eat\",\"grass\"]}"));
+	ok1(patches_to("{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+	               "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"qux\"},{\"op\":\"test\",\"path\":\"/foo/1\",\"value\":2}]",
+	               "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}"));
+	ok1(patches_to("{\"baz\":\"qux\"}", "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"bar\"}]", NULL));
+	ok1(patches_to("{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/child\",\"value\":{\"grandchild\":{}}}]",
+	               "{\"foo\":\"bar\",\"child\":{\"grandchild\":{}}}"));
+	ok1(patches_to("{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz/bat\",\"value\":\"qux\"}]", NULL));
+	ok1(patches_to("{\"foo\":[\"bar\"]}", "[{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":[\"abc\",\"def\"]}]",
+	               "{\"foo\":[\"bar\",[\"abc\",\"def\"]]}"));
+	ok1(patches_to("{\"/\":9,\"~1\":10}", "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":10}]",
+	               "{\"/\":9,\"~1\":10}"));
+
+	/* Corners */
+	ok1(patches_to("{\"a\":{\"b\":1}}", "[{\"op\":\"copy\",\"from\":\"/a\",\"path\":\"/c\"}]",
+	               "{\"a\":{\"b\":1},\"c\":{\"b\":1}}"));
+	ok1(patches_to("{\"a\":1}", "[{\"op\":\"add\",\"path\":\"/a\",\"value\":2}]", "{\"a\":2}"));
+	ok1(patches_to("{\"a\":1}", "[{\"op\":\"add\",\"path\":\"\",\"value\":[true]}]", "[true]"));
+	ok1(patches_to("[1,2]", "[{\"op\":\"add\",\"path\":\"/2\",\"value\":3}]", "[1,2,3]"));
+	ok1(patches_to("[1,2]", "[{\"op\":\"add\",\"path\":\"/3\",\"value\":3}]", NULL));
+	ok1(patches_to("[1,2]", "[{\"op\":\"remove\",\"path\":\"/2\"}]", NULL));
+	ok1(patches_to("{\"a\":{\"b\":{}}}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a/b/c\"}]", NULL));
+	ok1(patches_to("{\"a\":1}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a\"}]", "{\"a\":1}"));
+	ok1(patches_to("{\"a\":1}", "[{\"op\":\"remove\",\"path\":\"\"}]", NULL));
+	ok1(patches_to("{\"a\":1}", "[{\"op\":\"jump\",\"path\":\"/a\"}]", NULL));
+	ok1(patches_to("{\"a\":1}", "[{\"path\":\"/a\"}]", NULL));
+	ok1(patches_to("{\"a\":1}", "{\"op\":\"remove\",\"path\":\"/a\"}", NULL));
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static unsigned rnd(unsigned n)
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return (unsigned) ((rng_state * 0x2545F4914F6CDD1DULL) >> 33) % n;
+}
+
+static JsonNode *random_value(int depth)
+{
+	static const char *keys[] = { "a", "b", "c", "d", "e", "x/y", "t~" };
+	JsonNode *node;
+	unsigned i, n;
+
+	switch (depth > 0 ? rnd(7) : rnd(4)) {
+		case 0: return json_mknull();
+		case 1: return json_mkbool(rnd(2));
+		case 2: return json_mknumber(rnd(4));
+		case 3: return json_mkstring(keys[rnd(3)]);
+		case 4:
+		case 5:
+			node = json_mkobject();
+			for (i = 0, n = rnd(6); i < n; i++)
+				json_append_member(node, keys[rnd(7)], random_value(depth - 1));
+			return node;
+		default:
+			node = json_mkarray();
+			for (i = 0, n = rnd(5); i < n; i++)
+				json_append_element(node, random_value(depth - 1));
+			return node;
+	}
+}
+
+/* Duplicate keys would make member lookups ambiguous */
+static void drop_duplicates(JsonNode *node)
+{
+	JsonNode *child, *next;
+
+	for (child = json_first_child(node); child != NULL; child = next) {
+		next = child->next;
+		if (child->key != NULL && json_find_member(node, child->key) != child)
+			json_delete(child);
+		else
+			drop_duplicates(child);
+	}
+}
+
+static void test_random(void)
+{
+	bool all = true;
+	int i;
+
+	for (i = 0; i < RANDOM_COUNT && all; i++) {
+		JsonNode *a = random_value(4);
+		JsonNode *b = random_value(4);
+		JsonNode *patch;
+
+		drop_duplicates(a);
+		drop_duplicates(b);
+		patch = json_diff(a, b);
+		if (!json_patch(a, patch) || !nodes_equal(a, b) || !json_check(a, NULL)) {
+			char *ea = json_encode(a), *eb = json_encode(b), *ep = json_encode(patch);
+			diag("patched %s, expected %s, with %s", ea, eb, ep);
+			free(ea);
+			free(eb);
+			free(ep);
+			all = false;
+		}
+
+		json_delete(patch);
+		json_delete(a);
+		json_delete(b);
+	}
+	ok(all, "diffs of random documents patch one into the other");
+}
+
+/* A telemetry update changing a few readings among many */
+static void test_telemetry(void)
+{
+	JsonNode *a = json_mkobject();
+	JsonNode *b;
+	JsonNode *patch;
+	char key[32], *text, *delta;
+	int i;
+
+	for (i = 0; i < 60; i++) {
+		sprintf(key, "reading_%d", i);
+		json_append_member(a, key, json_mknumber(i * 100));
+	}
+	text = json_encode(a);
+	b = json_decode(text);
+	json_find_member(b, "reading_7")->number_ = -1;
+	json_find_member(b, "reading_42")->number_ = 4201.5;
+
+	patch = json_diff(a, b);
+	delta = json_encode(patch);
+	ok1(same_json(patch, "[{\"op\":\"replace\",\"path\":\"/reading_7\",\"value\":-1},"
+	                     "{\"op\":\"replace\",\"path\":\"/reading_42\",\"value\":4201.5}]"));
+	ok1(strlen(delta) * 5 < strlen(text));
+
+	free(text);
+	free(delta);
+	json_delete(patch);
+	json_delete(a);
+	json_delete(b);
+}
+
+/* Diffing only reads its arguments, even when big objects need indexed lookups */
+static void test_read_only(void)
+{
+	JsonNode *a = json_mkobject();
+	JsonNode *b = json_mkobject();
+	JsonNode *patch;
+	char key[32];
+	int i;
+
+	/* b has the same members backwards, so nearly every lookup has to search */
+	for (i = 0; i < 60; i++) {
+		sprintf(key, "reading_%d", i);
+		json_append_member(a, key, json_mknumber(i));
+		sprintf(key, "reading_%d", 59 - i);
+		json_append_member(b, key, json_mknumber(59 - i == 30 ? -1 : 59 - i));
+	}
+
+	patch = json_diff(a, b);
+	ok1(same_json(patch, "[{\"op\":\"replace\",\"path\":\"/reading_30\",\"value\":-1}]"));
+	ok1(node_index(a) == NULL && node_index(b) == NULL);
+	ok1(json_patch(a, patch) && nodes_equal(a, b) && node_index(b) == NULL);
+
+	json_delete(patch);
+	json_delete(a);
+	json_delete(b);
+}
+
+int main(void)
+{
+	(void) chomp;
+
+	plan_tests(12 + 25 + 1 + 2 + 3);
+
+	test_diff();
+	test_patch();
+	test_random();
+	test_telemetry();
+	test_read_only();
+
+	return exit_status();
+}
@@ -0,0 +1,174 @@
+/* Resolve JSON Pointers: the examples from RFC 6901, array positions, malformed pointers, big indexed containers, and batches checked against one-at-a-time resolution. */
+
+#include "common.h"
+
+static const char rfc_document[] =
+	"{\"foo\":[\"bar\",\"baz\"],\"\":0,\"a/b\":1,\"c%d\":2,\"e^f\":3,\"g|h\":4,"
+	"\"i\\\\j\":5,\"k\\\"l\":6,\" \":7,\"m~n\":8}";
+
+/* Where path leads, encoded, or "missing" */
+static bool resolves_to(JsonNode *doc, const char *path, const char *expected)
+{
+	JsonNode *node = json_pointer_get(doc, path);
+	char *encoded = node ? json_encode(node) : NULL;
+	bool ret = strcmp(encoded ? encoded : "missing", expected) == 0;
+
+	if (!ret)
+		diag("%s: expected %s, got %s", path, expected, encoded ? encoded : "missing");
+	free(encoded);
+	return ret;
+}
+
+static void test_rfc(void)
+{
+	JsonNode *doc = json_decode(rfc_document);
+	char *whole = json_encode(doc);
+
+	ok1(resolves_to(doc, "", whole));
+	ok1(resolves_to(doc, "/foo", "[\"bar\",\"baz\"]"));
+	ok1(resolves_to(doc, "/foo/0", "\"bar\""));
+	ok1(resolves_to(doc, "/", "0"));
+	ok1(resolves_to(doc, "/a~1b", "1"));
+	ok1(resolves_to(doc, "/c%d", "2"));
+	ok1(resolves_to(doc, "/e^f", "3"));
+	ok1(resolves_to(doc, "/g|h", "4"));
+	ok1(resolves_to(doc, "/i\\j", "5"));
+	ok1(resolves_to(doc, "/k\"l", "6"));
+	ok1(resolves_to(doc, "/ ", "7"));
+	ok1(resolves_to(doc, "/m~0n", "8"));
+
+	free(whole);
+	json_delete(doc);
+}
+
+static void test_arrays(void)
+{
+	JsonNode *doc = json_decode("{\"a\":[[10,11],[20,21]],\"0\":\"zero\",\"01\":\"padded\"}");
+
+	ok1(resolves_to(doc, "/a/1/0", "20"));
+	ok1(resolves_to(doc, "/a/2", "missing"));
+	ok1(resolves_to(doc, "/a/-", "missing"));
+	ok1(resolves_to(doc, "/a/01", "missing"));
+	ok1(resolves_to(doc, "/a/1x", "missing"));
+	ok1(resolves_to(doc, "/a/99999999999999999999", "missing"));
+
+	/* Numbers are just names in objects */
+	ok1(resolves_to(doc, "/0", "\"zero\""));
+	ok1(resolves_to(doc, "/01", "\"padded\""));
+
+	/* Nothing below a scalar */
+	ok1(resolves_to(doc, "/0/x", "missing"));
+	ok1(resolves_to(doc, "/a/0/0/0", "missing"));
+
+	json_delete(doc);
+}
+
+static void test_malformed(void)
+{
+	JsonNode *doc = json_decode("{\"a\":1}");
+
+	ok1(json_pointer_compile("a") == NULL);
+	ok1(json_pointer_compile("/~") == NULL);
+	ok1(json_pointer_compile("/a~2") == NULL);
+	ok1(json_pointer_compile(NULL) == NULL);
+	ok1(json_pointer_get(doc, "a") == NULL);
+	ok1(json_pointer_resolve(NULL, doc) == NULL);
+
+	json_delete(doc);
+}
+
+/* iMTQ-like configuration: many parameters under a few levels */
+static JsonNode *make_config(void)
+{
+	JsonNode *doc = json_mkobject();
+	JsonNode *imtq = json_mkobject();
+	JsonNode *params = json_mkobject();
+	JsonNode *list = json_mkarray();
+	char key[16];
+	int i;
+
+	for (i = 0; i < 200; i++) {
+		sprintf(key, "%#x", 0x3000 + i);
+		json_append_member(params, key, json_mknumber(i));
+		json_append_element(list, json_mknumber(-i));
+	}
+	json_append_member(imtq, "params", params);
+	json_append_member(imtq, "list", list);
+	json_append_member(doc, "imtq", imtq);
+	json_append_member(doc, "trxvu", json_decode("{\"tx\":{\"rate\":9600}}"));
+	return doc;
+}
+
+static void test_indexed(void)
+{
+	JsonNode *doc = make_config();
+	JsonPointer *ptr = json_pointer_compile("/imtq/params/0x3063");
+	int i;
+	bool all = true;
+
+	/* Repeated resolution goes through the index once it's built */
+	for (i = 0; i < 3; i++)
+		all &= json_pointer_resolve(ptr, doc) != NULL && json_pointer_resolve(ptr, doc)->number_ == 99;
+	ok1(all);
+	ok1(node_index(json_pointer_get(doc, "/imtq/params")) != NULL);
+	ok1(resolves_to(doc, "/imtq/params/0x30c7", "199"));
+	ok1(resolves_to(doc, "/imtq/params/0x30c8", "missing"));
+	ok1(resolves_to(doc, "/imtq/list/150", "-150"));
+
+	json_pointer_free(ptr);
+	json_delete(doc);
+}
+
+static void test_batch(void)
+{
+	static const char *paths[] = {
+		"/imtq/params/0x3000", "/imtq/params/0x3001", "/imtq/params/0x3001",
+		"/imtq/params/nope", "/imtq/params/nope/deeper", "/imtq/params/nope/deeper/still",
+		"/imtq/params", "/imtq", "", "/trxvu/tx/rate", "/trxvu/rx/rate", "/trxvu/rx",
+		"/trxvu/tx", "/imtq/list/0", "/imtq/list/199", "/imtq/list/200", "/imtq/list/x",
+		"/nope/params/0x3000", "/imtq/params/0x3002",
+	};
+	enum { COUNT = sizeof(paths) / sizeof(*paths) };
+	JsonNode *doc = make_config();
+	JsonPointer *ptrs[COUNT + 1];
+	JsonNode *out[COUNT + 1];
+	size_t i;
+	bool all = true;
+
+	for (i = 0; i < COUNT; i++)
+		ptrs[i] = json_pointer_compile(paths[i]);
+
+	/* Pointers which couldn't be compiled resolve to nothing */
+	ptrs[COUNT] = NULL;
+
+	json_pointer_resolve_all(ptrs, COUNT + 1, doc, out);
+	for (i = 0; i < COUNT; i++) {
+		if (out[i] != json_pointer_resolve(ptrs[i], doc)) {
+			diag("%s resolves differently in a batch", paths[i]);
+			all = false;
+		}
+	}
+	ok(all, "batch agrees with one at a time");
+	ok1(out[COUNT] == NULL);
+	ok1(out[0]->number_ == 0 && out[2]->number_ == 1 && out[3] == NULL && out[8] == doc);
+	ok1(out[9]->number_ == 9600 && out[10] == NULL && out[15] == NULL && out[18]->number_ == 2);
+
+	for (i = 0; i < COUNT; i++)
+		json_pointer_free(ptrs[i]);
+	json_delete(doc);
+}
+
+int main(void)
+{
+	(void) chomp;
+
+	plan_tests(12 + 10 + 6 + 5 + 4);
+
+	test_rfc();
+	test_arrays();
+	test_malformed();
+	test_indexed();
+	test_batch();
+
+	return exit_status();
+}
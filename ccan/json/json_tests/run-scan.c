@@ -0,0 +1,103 @@
+/* Check the run scanners used by the parser and encoder against byte-at-a-time definitions, at every alignment, and on text which ends right before an unmapped page. */
+
+#include "common.h"
+
+#include <sys/mman.h>
+
+static size_t naive_space(const char *s)
+{
+	size_t n = 0;
+	while (is_space(s[n]))
+		n++;
+	return n;
+}
+
+static size_t naive_plain(const char *s)
+{
+	size_t n = 0;
+	unsigned char c;
+	while ((c = s[n]) >= 0x20 && c < 0x80 && c != '"' && c != '\\')
+		n++;
+	return n;
+}
+
+static size_t naive_ascii(const char *s)
+{
+	size_t n = 0;
+	unsigned char c;
+	while ((c = s[n]) != 0 && c < 0x80)
+		n++;
+	return n;
+}
+
+/* Runs of every length up to 40, ended by each kind of stop byte, at every offset */
+static bool spans_agree(size_t (*span)(const char *), size_t (*naive)(const char *), char fill)
+{
+	static const char stops[] = { 0, ' ', '\n', 'x', '"', '\\', 0x1F, 0x7F, (char) 0x80, (char) 0xFF };
+	char buf[128];
+	size_t offset, len, i;
+
+	for (offset = 0; offset < 32; offset++) {
+		for (len = 0; len <= 40; len++) {
+			for (i = 0; i < sizeof(stops); i++) {
+				memset(buf, fill, sizeof(buf));
+				buf[offset + len] = stops[i];
+				buf[sizeof(buf) - 1] = 0;
+				if (span(buf + offset) != naive(buf + offset)) {
+					diag("offset %zu, length %zu, stop 0x%02X: %zu, expected %zu", offset, len,
+					     (unsigned char) stops[i], span(buf + offset), naive(buf + offset));
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/* Text whose terminator is the last byte before a page which can't be read */
+static void test_page_end(void)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	char *map = mmap(NULL, page * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	char *end = map + page;
+	const char *doc = "[  \"plain text\",\n    \"caf\xc3\xa9\"  ]";
+	size_t len = strlen(doc) + 1;
+	JsonNode *node;
+	char *s;
+
+	ok1(map != MAP_FAILED && mprotect(end, page, PROT_NONE) == 0);
+
+	memcpy(end - len, doc, len);
+	node = json_decode(end - len);
+	ok1(node != NULL && json_check(node, NULL));
+	ok1(strcmp(json_find_element(node, 1)->string_, "caf\xc3\xa9") == 0);
+	json_delete(node);
+
+	s = end - 17;
+	memset(s, 'a', 16);
+	s[16] = 0;
+	ok1(span_plain(s) == 16 && span_ascii(s) == 16 && span_space(s) == 0);
+	memset(s, ' ', 16);
+	ok1(span_space(s) == 16);
+	ok1(span_space(end - 1) == 0 && span_plain(end - 1) == 0 && span_ascii(end - 1) == 0);
+
+	munmap(map, page * 2);
+}
+
+int main(void)
+{
+	(void) chomp;
+
+	plan_tests(6 + 6);
+
+	ok1(spans_agree(span_space, naive_space, ' '));
+	ok1(spans_agree(span_space, naive_space, '\t'));
+	ok1(spans_agree(span_plain, naive_plain, 'a'));
+	ok1(spans_agree(span_plain, naive_plain, '~'));
+	ok1(spans_agree(span_ascii, naive_ascii, '"'));
+	ok1(spans_agree(span_ascii, naive_ascii, 0x01));
+
+	test_page_end();
+
+	return exit_status();
+}
@@ -0,0 +1,215 @@
+/* Check that the streaming parser accepts exactly what json_validate does, whole or one byte at a time, and that a tree rebuilt from its events matches json_decode. */
+
+#include "common.h"
+
+#define MAX_DEPTH 32
+
+/* Rebuilds a JsonNode tree from stream events */
+typedef struct
+{
+	JsonNode *root;
+	JsonNode *stack[MAX_DEPTH];
+	int depth;
+	int events;
+	int stop_after;
+} Builder;
+
+static bool build(void *ctx, const JsonEvent *event)
+{
+	Builder *b = ctx;
+	JsonNode *node = NULL;
+
+	if (++b->events == b->stop_after)
+		return false;
+
+	switch (event->type) {
+		case JSON_EVENT_NULL:
+			node = json_mknull();
+			break;
+		case JSON_EVENT_BOOL:
+			node = json_mkbool(event->bool_);
+			break;
+		case JSON_EVENT_STRING:
+			node = json_mkstring(event->string_);
+			break;
+		case JSON_EVENT_NUMBER:
+			node = json_mknumber(event->number_);
+			break;
+		case JSON_EVENT_ARRAY_BEGIN:
+			node = json_mkarray();
+			break;
+		case JSON_EVENT_OBJECT_BEGIN:
+			node = json_mkobject();
+			break;
+		case JSON_EVENT_ARRAY_END:
+		case JSON_EVENT_OBJECT_END:
+			b->depth--;
+			return event->depth == b->depth;
+	}
+
+	if (event->depth != b->depth)
+		return false;
+
+	if (b->depth == 0)
+		b->root = node;
+	else if (event->key != NULL)
+		json_append_member(b->stack[b->depth - 1], event->key, node);
+	else
+		json_append_element(b->stack[b->depth - 1], node);
+
+	if (event->type == JSON_EVENT_ARRAY_BEGIN || event->type == JSON_EVENT_OBJECT_BEGIN)
+		b->stack[b->depth++] = node;
+
+	return true;
+}
+
+static void builder_reset(Builder *b)
+{
+	json_delete(b->root);
+	memset(b, 0, sizeof(*b));
+}
+
+static bool stream_whole(JsonStream *stream, const char *s)
+{
+	json_stream_reset(stream);
+	return json_stream_feed(stream, s, strlen(s)) && json_stream_finish(stream);
+}
+
+static bool stream_bytewise(JsonStream *stream, const char *s)
+{
+	json_stream_reset(stream);
+	for (; *s != 0; s++)
+		if (!json_stream_feed(stream, s, 1))
+			return false;
+	return json_stream_finish(stream);
+}
+
+static bool same_tree(const JsonNode *a, const JsonNode *b)
+{
+	char *ea = json_encode(a);
+	char *eb = json_encode(b);
+	bool ret = ea != NULL && eb != NULL && strcmp(ea, eb) == 0;
+
+	free(ea);
+	free(eb);
+	return ret;
+}
+
+static void test_strings(void)
+{
+	const char *strings_file = "test/test-strings";
+	FILE *f;
+	char buffer[1024];
+	Builder b = { 0 };
+	JsonStream *stream = json_stream_create(build, &b, 0, MAX_DEPTH);
+
+	f = fopen(strings_file, "rb");
+	if (f == NULL) {
+		diag("Could not open %s: %s", strings_file, strerror(errno));
+		exit(1);
+	}
+
+	while (fgets(buffer, sizeof(buffer), f)) {
+		const char *s = chomp(buffer);
+		bool valid, whole, bytewise, tree = true;
+
+		(void) (expect_literal(&s, "valid ") || expect_literal(&s, "invalid "));
+		valid = json_validate(s);
+
+		builder_reset(&b);
+		whole = stream_whole(stream, s);
+		if (whole) {
+			JsonNode *decoded = json_decode(s);
+			tree = same_tree(b.root, decoded);
+			json_delete(decoded);
+		}
+
+		builder_reset(&b);
+		bytewise = stream_bytewise(stream, s);
+
+		ok(whole == valid && bytewise == valid && tree,
+		   "%s: validate %d, whole %d, bytewise %d, tree %d", s, valid, whole, bytewise, tree);
+	}
+
+	builder_reset(&b);
+	json_stream_destroy(stream);
+	fclose(f);
+}
+
+static void test_limits(void)
+{
+	Builder b = { 0 };
+	JsonStream *stream = json_stream_create(build, &b, 8, 4);
+	size_t offset;
+
+	ok1(json_stream_create(NULL, NULL, 0, 0) == NULL);
+
+	ok1(stream_whole(stream, "[[[[]]]]"));
+	builder_reset(&b);
+	ok1(!stream_whole(stream, "[[[[[]]]]]"));
+	builder_reset(&b);
+
+	/* The limit includes the quotes */
+	ok1(stream_whole(stream, "\"123456\""));
+	builder_reset(&b);
+	ok1(!stream_whole(stream, "[\"1234567\"]"));
+	ok1(strcmp(json_stream_error(stream, &offset), "Token too long") == 0);
+	builder_reset(&b);
+
+	/* Errors stick until the stream is reset */
+	ok1(!stream_whole(stream, "[1,]"));
+	ok1(json_stream_error(stream, &offset) != NULL && offset == 3);
+	ok1(!json_stream_feed(stream, "", 0));
+	builder_reset(&b);
+
+	/* Handler can stop parsing */
+	b.stop_after = 2;
+	ok1(!stream_whole(stream, "[1,2]"));
+	ok1(strcmp(json_stream_error(stream, NULL), "Stopped by handler") == 0);
+	builder_reset(&b);
+
+	/* A number at the very end is only complete once finished */
+	json_stream_reset(stream);
+	ok1(json_stream_feed(stream, "12", 2) && json_stream_feed(stream, "34", 2));
+	ok1(b.events == 0);
+	ok1(json_stream_finish(stream) && b.root->number_ == 1234);
+	ok1(json_stream_error(stream, NULL) == NULL);
+	builder_reset(&b);
+
+	json_stream_destroy(stream);
+}
+
+static void test_fd(void)
+{
+	Builder b = { 0 };
+	JsonStream *stream = json_stream_create(build, &b, 0, 0);
+	const char *doc = "{\"a\": [1, 2, {\"b\": \"c\"}], \"d\": true}";
+	int fds[2];
+
+	ok1(pipe(fds) == 0);
+	ok1(write(fds[1], doc, strlen(doc)) == (ssize_t) strlen(doc));
+	close(fds[1]);
+
+	ok1(json_stream_parse_fd(stream, fds[0]));
+	close(fds[0]);
+
+	{
+		JsonNode *decoded = json_decode(doc);
+		ok1(same_tree(b.root, decoded));
+		json_delete(decoded);
+	}
+
+	builder_reset(&b);
+	json_stream_destroy(stream);
+}
+
+int main(void)
+{
+	plan_tests(224 + 15 + 4);
+
+	test_strings();
+	test_limits();
+	test_fd();
+
+	return exit_status();
+}
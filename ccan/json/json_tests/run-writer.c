@@ -0,0 +1,206 @@
+/* Write documents with the streaming writer, into buffers and through pipes, and check they match json_encode of the same tree; also check that misuse and overflow are caught. */
+
+#include "common.h"
+
+/* Writes the same document as make_tree */
+static void write_doc(JsonWriter *w)
+{
+	json_writer_begin_object(w);
+	json_writer_key(w, "mode");
+	json_writer_string(w, "DETUMBLE \"quoted\"\n\x1f caf\xc3\xa9 \xf0\x9d\x84\x9e");
+	json_writer_key(w, "uptime");
+	json_writer_number(w, 123456.25);
+	json_writer_key(w, "mtm");
+	json_writer_begin_array(w);
+	json_writer_number(w, -1.5e-3);
+	json_writer_number(w, 0.0 / 0.0);
+	json_writer_begin_object(w);
+	json_writer_end_object(w);
+	json_writer_begin_array(w);
+	json_writer_end_array(w);
+	json_writer_end_array(w);
+	json_writer_key(w, "ok");
+	json_writer_bool(w, true);
+	json_writer_key(w, "error");
+	json_writer_bool(w, false);
+	json_writer_key(w, "none");
+	json_writer_null(w);
+	json_writer_end_object(w);
+}
+
+static JsonNode *make_tree(void)
+{
+	JsonNode *object = json_mkobject();
+	JsonNode *array = json_mkarray();
+
+	json_append_member(object, "mode", json_mkstring("DETUMBLE \"quoted\"\n\x1f caf\xc3\xa9 \xf0\x9d\x84\x9e"));
+	json_append_member(object, "uptime", json_mknumber(123456.25));
+	json_append_element(array, json_mknumber(-1.5e-3));
+	json_append_element(array, json_mknumber(0.0 / 0.0));
+	json_append_element(array, json_mkobject());
+	json_append_element(array, json_mkarray());
+	json_append_member(object, "mtm", array);
+	json_append_member(object, "ok", json_mkbool(true));
+	json_append_member(object, "error", json_mkbool(false));
+	json_append_member(object, "none", json_mknull());
+	return object;
+}
+
+static void test_buffer(const char *expected)
+{
+	char buf[256];
+	JsonWriter w;
+	size_t len = strlen(expected);
+
+	json_writer_init(&w, buf, sizeof(buf));
+	write_doc(&w);
+	ok1(json_writer_finish(&w));
+	ok1(strcmp(buf, expected) == 0);
+	ok1(json_writer_length(&w) == len);
+	ok1(json_validate(buf));
+
+	/* Exactly enough room, including the terminator */
+	json_writer_init(&w, buf, len + 1);
+	write_doc(&w);
+	ok1(json_writer_finish(&w) && strcmp(buf, expected) == 0);
+
+	/* One byte short */
+	json_writer_init(&w, buf, len);
+	write_doc(&w);
+	ok1(!json_writer_finish(&w));
+}
+
+static void test_fd(const char *expected)
+{
+	char staging[7];
+	char buf[256];
+	JsonWriter w;
+	int fds[2];
+	ssize_t count;
+
+	ok1(pipe(fds) == 0);
+
+	/* A tiny staging buffer forces lots of flushes */
+	json_writer_init_fd(&w, fds[1], staging, sizeof(staging));
+	write_doc(&w);
+	ok1(json_writer_finish(&w));
+	ok1(json_writer_length(&w) == strlen(expected));
+	close(fds[1]);
+
+	count = read(fds[0], buf, sizeof(buf) - 1);
+	close(fds[0]);
+	buf[count > 0 ? count : 0] = 0;
+	ok1(strcmp(buf, expected) == 0);
+
+	/* Write failures are reported */
+	json_writer_init_fd(&w, fds[1], staging, sizeof(staging));
+	write_doc(&w);
+	ok1(!json_writer_finish(&w));
+}
+
+static bool misuse(void (*steps)(JsonWriter *w))
+{
+	char buf[64];
+	JsonWriter w;
+
+	json_writer_init(&w, buf, sizeof(buf));
+	steps(&w);
+	return !json_writer_finish(&w);
+}
+
+static void value_without_key(JsonWriter *w)
+{
+	json_writer_begin_object(w);
+	json_writer_number(w, 1);
+	json_writer_end_object(w);
+}
+
+static void key_in_array(JsonWriter *w)
+{
+	json_writer_begin_array(w);
+	json_writer_key(w, "a");
+	json_writer_end_array(w);
+}
+
+static void key_without_value(JsonWriter *w)
+{
+	json_writer_begin_object(w);
+	json_writer_key(w, "a");
+	json_writer_end_object(w);
+}
+
+static void mismatched(JsonWriter *w)
+{
+	json_writer_begin_array(w);
+	json_writer_end_object(w);
+}
+
+static void unclosed(JsonWriter *w)
+{
+	json_writer_begin_array(w);
+}
+
+static void two_values(JsonWriter *w)
+{
+	json_writer_number(w, 1);
+	json_writer_number(w, 2);
+}
+
+static void nothing(JsonWriter *w)
+{
+	(void) w;
+}
+
+static void bad_utf8(JsonWriter *w)
+{
+	json_writer_string(w, "\xc3");
+}
+
+static void too_deep(JsonWriter *w)
+{
+	int i;
+
+	for (i = 0; i <= JSON_WRITER_MAX_DEPTH; i++)
+		json_writer_begin_array(w);
+	for (i = 0; i <= JSON_WRITER_MAX_DEPTH; i++)
+		json_writer_end_array(w);
+}
+
+int main(void)
+{
+	JsonNode *tree = make_tree();
+	char *expected = json_encode(tree);
+	char buf[8];
+	JsonWriter w;
+
+	(void) chomp;
+
+	plan_tests(6 + 5 + 9 + 2);
+
+	test_buffer(expected);
+	test_fd(expected);
+
+	ok1(misuse(value_without_key));
+	ok1(misuse(key_in_array));
+	ok1(misuse(key_without_value));
+	ok1(misuse(mismatched));
+	ok1(misuse(unclosed));
+	ok1(misuse(two_values));
+	ok1(misuse(nothing));
+	ok1(misuse(bad_utf8));
+	ok1(misuse(too_deep));
+
+	/* A bare scalar is a complete document */
+	json_writer_init(&w, buf, sizeof(buf));
+	json_writer_number(&w, 42);
+	ok1(json_writer_finish(&w) && strcmp(buf, "42") == 0);
+
+	json_writer_init(&w, NULL, 0);
+	json_writer_null(&w);
+	ok1(!json_writer_finish(&w));
+
+	free(expected);
+	json_delete(tree);
+
+	return exit_status();
+}
@@ -24,40 +24,562 @@
 #include "json.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
-#define out_of_memory() do {                    \
-		fprintf(stderr, "Out of memory.\n");    \
-		exit(EXIT_FAILURE);                     \
-	} while (0)
+/* Arena allocator */
+
+#define ARENA_DEFAULT_BLOCK 4096
+
+/* Every allocation handed out by an arena is aligned for any JSON data */
+typedef union {
+	double d;
+	void *p;
+	long l;
+} ArenaAlign;
+
+#define ARENA_ALIGN (sizeof(ArenaAlign))
+
+typedef struct ArenaBlock ArenaBlock;
+
+struct ArenaBlock
+{
+	ArenaBlock *next;
+	size_t size;
+	size_t used;
+	ArenaAlign data[];
+};
+
+struct JsonArena
+{
+	ArenaBlock *head;       /* block currently being allocated from */
+	size_t block_size;
+	size_t used;            /* bytes handed out since the last reset */
+	
+	JsonAllocator allocator;
+	size_t budget;          /* 0 if unlimited */
+	size_t held;            /* bytes currently taken from allocator */
+	JsonError error;        /* first failure since the last reset */
+};
+
+static void *std_malloc(void *ctx, size_t size)
+{
+	(void) ctx;
+	return malloc(size);
+}
+
+static void *std_realloc(void *ctx, void *ptr, size_t size)
+{
+	(void) ctx;
+	return realloc(ptr, size);
+}
+
+static void std_free(void *ctx, void *ptr)
+{
+	(void) ctx;
+	free(ptr);
+}
+
+static const JsonAllocator std_allocator = { std_malloc, std_realloc, std_free, NULL };
+
+/*
+ * Memory an arena holds on to directly: its blocks, and the scratch buffers
+ * used while decoding or encoding with it.  It comes from the arena's
+ * allocator, and counts against its budget until it is given back.  Without
+ * an arena this is plain malloc, realloc and free.
+ *
+ * Failures return NULL, leaving ptr as it was, and are recorded in the arena.
+ */
+static void *mem_realloc(JsonArena *arena, void *ptr, size_t old_size, size_t size)
+{
+	void *ret;
+	
+	if (arena == NULL)
+		return realloc(ptr, size);
+	
+	if (size > old_size && arena->budget != 0 && size - old_size > arena->budget - arena->held) {
+		if (arena->error == JSON_ERROR_NONE)
+			arena->error = JSON_ERROR_BUDGET;
+		return NULL;
+	}
+	
+	if (ptr == NULL)
+		ret = arena->allocator.malloc(arena->allocator.ctx, size);
+	else
+		ret = arena->allocator.realloc(arena->allocator.ctx, ptr, size);
+	if (ret == NULL) {
+		if (arena->error == JSON_ERROR_NONE)
+			arena->error = JSON_ERROR_NOMEM;
+		return NULL;
+	}
+	
+	arena->held = arena->held - old_size + size;
+	return ret;
+}
+
+static void *mem_alloc(JsonArena *arena, size_t size)
+{
+	return mem_realloc(arena, NULL, 0, size);
+}
+
+static void mem_free(JsonArena *arena, void *ptr, size_t size)
+{
+	if (arena == NULL) {
+		free(ptr);
+	} else if (ptr != NULL) {
+		arena->allocator.free(arena->allocator.ctx, ptr);
+		arena->held -= size;
+	}
+}
+
+static ArenaBlock *arena_new_block(JsonArena *arena, size_t size)
+{
+	ArenaBlock *block = (ArenaBlock*) mem_alloc(arena, sizeof(ArenaBlock) + size);
+	if (block == NULL)
+		return NULL;
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	return block;
+}
+
+static void arena_free_block(JsonArena *arena, ArenaBlock *block)
+{
+	mem_free(arena, block, sizeof(ArenaBlock) + block->size);
+}
+
+static void *arena_alloc(JsonArena *arena, size_t size)
+{
+	ArenaBlock *block = arena->head;
+	void *ret;
+	
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	
+	if (block->size - block->used < size) {
+		/*
+		 * Oversized requests get a block of their own, which goes behind the
+		 * current one so that its leftover space isn't wasted.
+		 */
+		ArenaBlock *fresh = arena_new_block(arena, size > arena->block_size ? size : arena->block_size);
+		if (fresh == NULL)
+			return NULL;
+		if (size > arena->block_size) {
+			fresh->next = block->next;
+			block->next = fresh;
+			block = fresh;
+		} else {
+			fresh->next = block;
+			arena->head = block = fresh;
+		}
+	}
+	
+	ret = (char*) block->data + block->used;
+	block->used += size;
+	arena->used += size;
+	return ret;
+}
+
+/*
+ * All memory owned by a node (the node itself, its key, and its string value)
+ * comes from the node's arena, or from the heap if it doesn't have one.
+ * Returns NULL if there is no memory left.
+ */
+static void *json_alloc(JsonArena *arena, size_t size)
+{
+	if (arena != NULL)
+		return arena_alloc(arena, size);
+	
+	return malloc(size);
+}
+
+/* Arena memory is only reclaimed all at once, by json_arena_reset */
+static void json_release(JsonArena *arena, void *ptr)
+{
+	if (arena == NULL)
+		free(ptr);
+}
 
 /* Sadly, strdup is not portable. */
-static char *json_strdup(const char *str)
+static char *json_strdup(JsonArena *arena, const char *str)
 {
-	char *ret = (char*) malloc(strlen(str) + 1);
-	if (ret == NULL)
-		out_of_memory();
-	strcpy(ret, str);
+	size_t len = strlen(str) + 1;
+	char *ret = (char*) json_alloc(arena, len);
+	if (ret != NULL)
+		memcpy(ret, str, len);
 	return ret;
 }
 
+JsonArena *json_arena_create(size_t block_size)
+{
+	return json_arena_create_ex(block_size, NULL, 0);
+}
+
+JsonArena *json_arena_create_ex(size_t block_size, const JsonAllocator *allocator, size_t budget)
+{
+	JsonArena *arena;
+	
+	if (allocator == NULL)
+		allocator = &std_allocator;
+	if (budget != 0 && budget < sizeof(JsonArena))
+		return NULL;
+	
+	arena = (JsonArena*) allocator->malloc(allocator->ctx, sizeof(JsonArena));
+	if (arena == NULL)
+		return NULL;
+	
+	if (block_size == 0)
+		block_size = ARENA_DEFAULT_BLOCK;
+	block_size = (block_size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	
+	arena->allocator = *allocator;
+	arena->budget = budget;
+	arena->held = sizeof(JsonArena);
+	arena->error = JSON_ERROR_NONE;
+	
+	arena->block_size = block_size;
+	arena->used = 0;
+	arena->head = arena_new_block(arena, block_size);
+	if (arena->head == NULL) {
+		allocator->free(allocator->ctx, arena);
+		return NULL;
+	}
+	return arena;
+}
+
+void json_arena_reset(JsonArena *arena)
+{
+    if (arena == NULL) {
+        return;
+    }
+
+	ArenaBlock *block, *next;
+	
+	/* Keep one regular block around, so the next document doesn't need malloc */
+	for (block = arena->head->next; block != NULL; block = next) {
+		next = block->next;
+		arena_free_block(arena, block);
+	}
+	
+	if (arena->head->size != arena->block_size) {
+		ArenaBlock *fresh = arena_new_block(arena, arena->block_size);
+		if (fresh != NULL) {
+			arena_free_block(arena, arena->head);
+			arena->head = fresh;
+		}
+	}
+	
+	arena->head->next = NULL;
+	arena->head->used = 0;
+	arena->used = 0;
+	arena->error = JSON_ERROR_NONE;
+}
+
+void json_arena_destroy(JsonArena *arena)
+{
+    if (arena == NULL) {
+        return;
+    }
+
+	ArenaBlock *block, *next;
+	
+	for (block = arena->head; block != NULL; block = next) {
+		next = block->next;
+		arena_free_block(arena, block);
+	}
+	arena->allocator.free(arena->allocator.ctx, arena);
+}
+
+size_t json_arena_used(const JsonArena *arena)
+{
+    if (arena == NULL) {
+        return 0;
+    }
+
+	return arena->used;
+}
+
+size_t json_arena_held(const JsonArena *arena)
+{
+    if (arena == NULL) {
+        return 0;
+    }
+
+	return arena->held;
+}
+
+JsonError json_arena_error(const JsonArena *arena)
+{
+    if (arena == NULL) {
+        return JSON_ERROR_NONE;
+    }
+
+	return arena->error;
+}
+
+/*
+ * Hidden per-node bookkeeping
+ *
+ * Every node is allocated with this header in front of it, so the public
+ * JsonNode layout stays the same.
+ */
+typedef struct JsonIndex JsonIndex;
+
+typedef struct
+{
+	JsonArena *arena;
+	
+	/* Lookup index, for arrays and objects which have had one built */
+	JsonIndex *index;
+	
+	/* Members of an indexed object: next member in the same bucket, and key hash */
+	JsonNode *hash_next;
+	uint32_t hash;
+	
+	/* META_BORROWED_* flags */
+	uint8_t borrowed;
+} JsonNodeMeta;
+
+/* Key or string value points into a buffer the node doesn't own, and isn't released with it */
+#define META_BORROWED_KEY    1
+#define META_BORROWED_STRING 2
+
+typedef struct
+{
+	JsonNodeMeta meta;
+	JsonNode node;
+} JsonNodeBox;
+
+#define node_box(n) ((JsonNodeBox*) ((char*) (n) - offsetof(JsonNodeBox, node)))
+#define node_arena(n) (node_box(n)->meta.arena)
+#define node_borrowed(n) (node_box(n)->meta.borrowed)
+
+JsonArena *json_node_arena(const JsonNode *node)
+{
+    if (node == NULL) {
+        return NULL;
+    }
+
+	return node_arena(node);
+}
+
+/*
+ * Lookup index
+ *
+ * Arrays and objects get an index the first time a lookup has to walk past
+ * JSON_INDEX_THRESHOLD children.  For arrays it is a vector of the elements,
+ * for objects a chained hash table threaded through the members' hidden
+ * headers.  Appends and member removals update the index in place; anything
+ * which would shift an array's positions simply drops it, to be rebuilt by the
+ * next long lookup.
+ *
+ * Duplicate keys are chained in list order, so lookups still find the first
+ * one, as they always have.
+ */
+
+#ifndef JSON_INDEX_THRESHOLD
+#define JSON_INDEX_THRESHOLD 16
+#endif
+
+struct JsonIndex
+{
+	size_t count;           /* elements/members in the index */
+	size_t size;            /* capacity (arrays) or bucket count (objects) */
+	JsonNode **slots;
+};
+
+#define node_index(n) (node_box(n)->meta.index)
+
+static uint32_t hash_key(const char *key)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+	
+	for (; *key != 0; key++)
+		hash = (hash ^ (unsigned char) *key) * 16777619u;
+	return hash;
+}
+
+static void index_free(JsonNode *container)
+{
+	JsonIndex *index = node_index(container);
+	JsonArena *arena = node_arena(container);
+	
+	if (index != NULL) {
+		json_release(arena, index->slots);
+		json_release(arena, index);
+		node_index(container) = NULL;
+	}
+}
+
+static JsonNode **bucket_of(JsonIndex *index, uint32_t hash)
+{
+	return &index->slots[hash & (index->size - 1)];
+}
+
+static void bucket_insert(JsonIndex *index, JsonNode *member, bool at_end)
+{
+	JsonNode **link = bucket_of(index, node_box(member)->meta.hash);
+	
+	if (at_end)
+		while (*link != NULL)
+			link = &node_box(*link)->meta.hash_next;
+	
+	node_box(member)->meta.hash_next = *link;
+	*link = member;
+}
+
+static void index_build(JsonNode *container)
+{
+	JsonArena *arena = node_arena(container);
+	JsonIndex *index;
+	JsonNode *child;
+	size_t count = 0;
+	
+	index_free(container);
+	
+	json_foreach(child, container)
+		count++;
+	
+	/* The index is only an accelerator, so without memory for one, lookups just walk */
+	index = (JsonIndex*) json_alloc(arena, sizeof(JsonIndex));
+	if (index == NULL)
+		return;
+	index->count = count;
+	index->size = 8;
+	
+	if (container->tag == JSON_ARRAY) {
+		size_t i = 0;
+		
+		if (count >= 4)
+			index->size = count * 2;
+		index->slots = (JsonNode**) json_alloc(arena, index->size * sizeof(JsonNode*));
+		if (index->slots == NULL)
+			goto out_of_memory;
+		json_foreach(child, container)
+			index->slots[i++] = child;
+	} else {
+		/* Power of two, with a load factor between 1/4 and 1/2 */
+		while (index->size < count * 2)
+			index->size *= 2;
+		index->slots = (JsonNode**) json_alloc(arena, index->size * sizeof(JsonNode*));
+		if (index->slots == NULL)
+			goto out_of_memory;
+		memset(index->slots, 0, index->size * sizeof(JsonNode*));
+		
+		/* Walking backwards and inserting at the front keeps duplicates in order */
+		for (child = container->children.tail; child != NULL; child = child->prev) {
+			node_box(child)->meta.hash = hash_key(child->key);
+			bucket_insert(index, child, false);
+		}
+	}
+	
+	node_index(container) = index;
+	return;
+
+out_of_memory:
+	json_release(arena, index);
+}
+
+/* Called after child has been linked into container */
+static void index_add(JsonNode *container, JsonNode *child, bool at_end)
+{
+	JsonIndex *index = node_index(container);
+	
+	if (index == NULL)
+		return;
+	
+	if (container->tag == JSON_ARRAY) {
+		if (!at_end) {
+			index_free(container);
+			return;
+		}
+		if (index->count == index->size) {
+			index_build(container);
+			return;
+		}
+		index->slots[index->count++] = child;
+	} else {
+		if (index->count + 1 > index->size / 2) {
+			index_build(container);
+			return;
+		}
+		node_box(child)->meta.hash = hash_key(child->key);
+		bucket_insert(index, child, at_end);
+		index->count++;
+	}
+}
+
+/* Called before child is unlinked from container */
+static void index_remove(JsonNode *container, JsonNode *child)
+{
+	JsonIndex *index = node_index(container);
+	
+	if (index == NULL)
+		return;
+	
+	if (container->tag == JSON_ARRAY) {
+		if (index->count > 0 && index->slots[index->count - 1] == child)
+			index->count--;
+		else
+			index_free(container);
+	} else {
+		JsonNode **link = bucket_of(index, node_box(child)->meta.hash);
+		
+		while (*link != child)
+			link = &node_box(*link)->meta.hash_next;
+		*link = node_box(child)->meta.hash_next;
+		node_box(child)->meta.hash_next = NULL;
+		index->count--;
+	}
+}
+
 /* String buffer */
 
+/*
+ * Once the buffer can't grow, it is failed: writes go to a small sink
+ * instead (so callers can carry on without checking every byte), and
+ * sb_finish returns NULL.  Callers which reserve more than SB_SINK bytes
+ * at once must check for failure before writing.
+ */
+#define SB_SINK 32
+
 typedef struct
 {
 	char *cur;
 	char *end;
 	char *start;
+	JsonArena *arena;       /* supplier of (and budget for) the buffer, if any */
+	bool failed;
+	char sink[SB_SINK + 1];
 } SB;
 
-static void sb_init(SB *sb)
+static void sb_fail(SB *sb)
+{
+	sb->failed = true;
+	sb->start = sb->cur = sb->sink;
+	sb->end = sb->sink + SB_SINK;
+}
+
+static void sb_free(SB *sb)
+{
+	if (!sb->failed)
+		mem_free(sb->arena, sb->start, sb->end - sb->start + 1);
+}
+
+static void sb_init(SB *sb, JsonArena *arena)
 {
-	sb->start = (char*) malloc(17);
-	if (sb->start == NULL)
-		out_of_memory();
+	sb->arena = arena;
+	sb->failed = false;
+	sb->start = (char*) mem_alloc(arena, 17);
+	if (sb->start == NULL) {
+		sb_fail(sb);
+		return;
+	}
 	sb->cur = sb->start;
 	sb->end = sb->start + 16;
 }
@@ -72,14 +594,24 @@ static void sb_grow(SB *sb, int need)
 {
 	size_t length = sb->cur - sb->start;
 	size_t alloc = sb->end - sb->start;
+	char *start;
+	
+	if (sb->failed) {
+		sb->cur = sb->start;
+		return;
+	}
 	
 	do {
 		alloc *= 2;
 	} while (alloc < length + need);
 	
-	sb->start = (char*) realloc(sb->start, alloc + 1);
-	if (sb->start == NULL)
-		out_of_memory();
+	start = (char*) mem_realloc(sb->arena, sb->start, sb->end - sb->start + 1, alloc + 1);
+	if (start == NULL) {
+		sb_free(sb);
+		sb_fail(sb);
+		return;
+	}
+	sb->start = start;
 	sb->cur = sb->start + length;
 	sb->end = sb->start + alloc;
 }
@@ -87,6 +619,8 @@ static void sb_grow(SB *sb, int need)
 static void sb_put(SB *sb, const char *bytes, int count)
 {
 	sb_need(sb, count);
+	if (sb->failed)
+		return;
 	memcpy(sb->cur, bytes, count);
 	sb->cur += count;
 }
@@ -102,47 +636,196 @@ static void sb_puts(SB *sb, const char *str)
 	sb_put(sb, str, strlen(str));
 }
 
+/* Heap buffers only; NULL if the buffer failed */
 static char *sb_finish(SB *sb)
 {
+	if (sb->failed)
+		return NULL;
 	*sb->cur = 0;
 	assert(sb->start <= sb->cur && strlen(sb->start) == (size_t)(sb->cur - sb->start));
 	return sb->start;
 }
 
-static void sb_free(SB *sb)
+/* Finish the buffer and move its contents into its arena, if it has one */
+static char *sb_finish_into(SB *sb)
 {
-	free(sb->start);
+	char *ret;
+	
+	if (sb->arena == NULL || sb->failed)
+		return sb_finish(sb);
+	
+	*sb->cur = 0;
+	ret = (char*) arena_alloc(sb->arena, sb->cur - sb->start + 1);
+	if (ret != NULL)
+		memcpy(ret, sb->start, sb->cur - sb->start + 1);
+	sb_free(sb);
+	return ret;
 }
 
 /*
- * Unicode helper functions
+ * Byte scanning
  *
- * These are taken from the ccan/charset module and customized a bit.
- * Putting them here means the compiler can (choose to) inline them,
- * and it keeps ccan/json from having a dependency.
+ * Whitespace, plain string characters and ASCII text usually come in runs.
+ * These find the end of a run 16 bytes at a time with SSE2 or NEON when the
+ * target has them, and a byte at a time otherwise.
+ *
+ * The strings are null-terminated, and every scan stops at the terminator.
+ * Vector loads are aligned to 16 bytes, so they never cross into a page the
+ * string doesn't touch, though they may read (and ignore) a few bytes past
+ * the terminator.  That is invisible to the program, but not to
+ * AddressSanitizer, so it is told to look away.
  */
 
-/*
- * Type for Unicode codepoints.
- * We need our own because wchar_t might be 16 bits.
- */
-typedef uint32_t uchar_t;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SCAN_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SCAN_NEON
+#endif
 
-/*
- * Validate a single UTF-8 character starting at @s.
- * The string must be null-terminated.
- *
- * If it's valid, return its length (1 thru 4).
- * If it's invalid or clipped, return 0.
- *
- * This function implements the syntax given in RFC3629, which is
- * the same as that given in The Unicode Standard, Version 6.0.
- *
- * It has the following properties:
- *
- *  * All codepoints U+0000..U+10FFFF may be encoded,
- *    except for U+D800..U+DFFF, which are reserved
- *    for UTF-16 surrogate pair encoding.
+#if defined(__SANITIZE_ADDRESS__)
+#define SCAN_ASAN
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define SCAN_ASAN
+#endif
+#endif
+
+#ifdef SCAN_ASAN
+#define SCAN_NO_ASAN __attribute__((no_sanitize_address))
+#else
+#define SCAN_NO_ASAN
+#endif
+
+#if defined(SCAN_SSE2) || defined(SCAN_NEON)
+
+#ifdef SCAN_SSE2
+
+typedef __m128i Vec;
+
+/* One bit per byte */
+typedef uint32_t VecMask;
+#define VEC_MASK_BITS 1
+#define VEC_MASK_ALL 0xFFFFu
+
+#define vec_load(p)     _mm_load_si128((const __m128i*) (p))
+#define vec_eq(v, c)    _mm_cmpeq_epi8(v, _mm_set1_epi8(c))
+#define vec_lt(v, c)    _mm_cmplt_epi8(v, _mm_set1_epi8(c))   /* signed */
+#define vec_or(a, b)    _mm_or_si128(a, b)
+#define vec_mask(v)     ((VecMask) _mm_movemask_epi8(v))
+#define mask_first(m)   ((size_t) __builtin_ctz(m))
+
+#else
+
+typedef int8x16_t Vec;
+
+/* Four bits per byte, from narrowing the comparison result */
+typedef uint64_t VecMask;
+#define VEC_MASK_BITS 4
+#define VEC_MASK_ALL (~(uint64_t) 0)
+
+#define vec_load(p)     vld1q_s8((const int8_t*) (p))
+#define vec_eq(v, c)    vreinterpretq_s8_u8(vceqq_s8(v, vdupq_n_s8(c)))
+#define vec_lt(v, c)    vreinterpretq_s8_u8(vcltq_s8(v, vdupq_n_s8(c)))
+#define vec_or(a, b)    vorrq_s8(a, b)
+#define vec_mask(v)     vget_lane_u64(vreinterpret_u64_u8( \
+                            vshrn_n_u16(vreinterpretq_u16_s8(v), 4)), 0)
+#define mask_first(m)   ((size_t) __builtin_ctzll(m))
+
+#endif
+
+/* Bytes which end a run, one mask bit (or nibble) per byte */
+static inline VecMask stop_space(Vec v)
+{
+	return vec_mask(vec_or(vec_or(vec_eq(v, ' '), vec_eq(v, '\n')),
+	                       vec_or(vec_eq(v, '\r'), vec_eq(v, '\t')))) ^ VEC_MASK_ALL;
+}
+
+/* Controls, non-ASCII, '"' and '\\' (bytes >= 0x80 are negative) */
+static inline VecMask stop_plain(Vec v)
+{
+	return vec_mask(vec_or(vec_lt(v, 0x20), vec_or(vec_eq(v, '"'), vec_eq(v, '\\'))));
+}
+
+/* The terminator and non-ASCII */
+static inline VecMask stop_ascii(Vec v)
+{
+	return vec_mask(vec_lt(v, 1));
+}
+
+#define DEFINE_SPAN(name, stop)                                             \
+	SCAN_NO_ASAN static size_t name(const char *s)                          \
+	{                                                                       \
+		const char *block = (const char*) ((uintptr_t) s & ~(uintptr_t) 15);   \
+		VecMask m = stop(vec_load(block)) >> ((s - block) * VEC_MASK_BITS); \
+		                                                                    \
+		if (m != 0)                                                         \
+			return mask_first(m) / VEC_MASK_BITS;                           \
+		for (;;) {                                                          \
+			block += 16;                                                    \
+			m = stop(vec_load(block));                                      \
+			if (m != 0)                                                     \
+				return block - s + mask_first(m) / VEC_MASK_BITS;           \
+		}                                                                   \
+	}
+
+#else
+
+#define stop_space(c) ((c) != ' ' && (c) != '\n' && (c) != '\r' && (c) != '\t')
+#define stop_plain(c) ((c) < 0x20 || (c) >= 0x80 || (c) == '"' || (c) == '\\')
+#define stop_ascii(c) ((c) == 0 || (c) >= 0x80)
+
+#define DEFINE_SPAN(name, stop)                     \
+	static size_t name(const char *s)               \
+	{                                               \
+		const unsigned char *p = (const unsigned char*) s; \
+		                                            \
+		while (!stop(*p))                           \
+			p++;                                    \
+		return p - (const unsigned char*) s;        \
+	}
+
+#endif
+
+/* Length of the run of JSON whitespace at s */
+DEFINE_SPAN(span_space, stop_space)
+
+/* Length of the run of printable ASCII at s, other than '"' and '\\' */
+DEFINE_SPAN(span_plain, stop_plain)
+
+/* Length of the run of non-null ASCII at s */
+DEFINE_SPAN(span_ascii, stop_ascii)
+
+/*
+ * Unicode helper functions
+ *
+ * These are taken from the ccan/charset module and customized a bit.
+ * Putting them here means the compiler can (choose to) inline them,
+ * and it keeps ccan/json from having a dependency.
+ */
+
+/*
+ * Type for Unicode codepoints.
+ * We need our own because wchar_t might be 16 bits.
+ */
+typedef uint32_t uchar_t;
+
+/*
+ * Validate a single UTF-8 character starting at @s.
+ * The string must be null-terminated.
+ *
+ * If it's valid, return its length (1 thru 4).
+ * If it's invalid or clipped, return 0.
+ *
+ * This function implements the syntax given in RFC3629, which is
+ * the same as that given in The Unicode Standard, Version 6.0.
+ *
+ * It has the following properties:
+ *
+ *  * All codepoints U+0000..U+10FFFF may be encoded,
+ *    except for U+D800..U+DFFF, which are reserved
+ *    for UTF-16 surrogate pair encoding.
  *  * UTF-8 byte sequences longer than 4 bytes are not permitted,
  *    as they exceed the range of Unicode.
  *  * The sixty-six Unicode "non-characters" are permitted
@@ -207,13 +890,16 @@ static bool utf8_validate(const char *s)
 {
 	int len;
 	
-	for (; *s != 0; s += len) {
+	for (;;) {
+		s += span_ascii(s);
+		if (*s == 0)
+			return true;
+		
 		len = utf8_validate_cz(s);
 		if (len == 0)
 			return false;
+		s += len;
 	}
-	
-	return true;
 }
 
 /*
@@ -328,11 +1014,20 @@ static void to_surrogate_pair(uchar_t unicode, uint16_t *uc, uint16_t *lc)
 #define is_space(c) ((c) == '\t' || (c) == '\n' || (c) == '\r' || (c) == ' ')
 #define is_digit(c) ((c) >= '0' && (c) <= '9')
 
-static bool parse_value     (const char **sp, JsonNode        **out);
-static bool parse_string    (const char **sp, char            **out);
+/* What the parser builds into */
+typedef struct
+{
+	JsonArena *arena;
+	
+	/* Unescape strings where they lie in the (writable) input, and have nodes borrow them */
+	bool inplace;
+} Parser;
+
+static bool parse_value     (const Parser *p, const char **sp, JsonNode **out);
+static bool parse_string    (const Parser *p, const char **sp, char     **out);
 static bool parse_number    (const char **sp, double           *out);
-static bool parse_array     (const char **sp, JsonNode        **out);
-static bool parse_object    (const char **sp, JsonNode        **out);
+static bool parse_array     (const Parser *p, const char **sp, JsonNode **out);
+static bool parse_object    (const Parser *p, const char **sp, JsonNode **out);
 static bool parse_hex16     (const char **sp, uint16_t         *out);
 
 static bool expect_literal  (const char **sp, const char *str);
@@ -349,26 +1044,29 @@ static void emit_object_indented    (SB *out, const JsonNode *object, const char
 
 static int write_hex16(char *out, uint16_t val);
 
-static JsonNode *mknode(JsonTag tag);
+static JsonNode *mknode(JsonArena *arena, JsonTag tag);
 static void append_node(JsonNode *parent, JsonNode *child);
 static void prepend_node(JsonNode *parent, JsonNode *child);
 static void append_member(JsonNode *object, char *key, JsonNode *value);
 
 /* Assertion-friendly validity checks */
 static bool tag_is_valid(unsigned int tag);
-static bool number_is_valid(const char *num);
+
+static JsonNode *find_member(JsonNode *object, const char *name, uint32_t hash);
+static uint64_t double_bits(double d);
 
 JsonNode *json_decode(const char *json)
 {
-    if (json == NULL) {
-        return NULL;
-    }
+	return json_decode_a(NULL, json);
+}
 
+static JsonNode *decode(const Parser *p, const char *json)
+{
 	const char *s = json;
 	JsonNode *ret = NULL;
 	
 	skip_space(&s);
-	if (!parse_value(&s, &ret)) {
+	if (!parse_value(p, &s, &ret)) {
 	    json_delete(ret);
 		return NULL;
 	}
@@ -382,6 +1080,33 @@ JsonNode *json_decode(const char *json)
 	return ret;
 }
 
+JsonNode *json_decode_a(JsonArena *arena, const char *json)
+{
+    if (json == NULL) {
+        return NULL;
+    }
+
+	Parser p = { arena, false };
+	
+	return decode(&p, json);
+}
+
+JsonNode *json_decode_inplace(char *buf)
+{
+	return json_decode_inplace_a(NULL, buf);
+}
+
+JsonNode *json_decode_inplace_a(JsonArena *arena, char *buf)
+{
+    if (buf == NULL) {
+        return NULL;
+    }
+
+	Parser p = { arena, true };
+	
+	return decode(&p, buf);
+}
+
 char *json_encode(const JsonNode *node)
 {
     if (node == NULL) {
@@ -398,7 +1123,7 @@ char *json_encode_string(const char *str)
     }
 
 	SB sb;
-	sb_init(&sb);
+	sb_init(&sb, NULL);
 	
 	emit_string(&sb, str);
 	
@@ -407,34 +1132,48 @@ char *json_encode_string(const char *str)
 
 char *json_stringify(const JsonNode *node, const char *space)
 {
-    if (node == NULL || space == NULL) {
+	return json_stringify_a(NULL, node, space);
+}
+
+char *json_encode_a(JsonArena *arena, const JsonNode *node)
+{
+	return json_stringify_a(arena, node, NULL);
+}
+
+char *json_stringify_a(JsonArena *arena, const JsonNode *node, const char *space)
+{
+    if (node == NULL) {
         return NULL;
     }
 
 	SB sb;
-	sb_init(&sb);
+	sb_init(&sb, arena);
 	
 	if (space != NULL)
 		emit_value_indented(&sb, node, space, 0);
 	else
 		emit_value(&sb, node);
 	
-	return sb_finish(&sb);
+	return sb_finish_into(&sb);
 }
 
 void json_delete(JsonNode *node)
 {
 	if (node != NULL) {
+		JsonArena *arena = node_arena(node);
+		
 		json_remove_from_parent(node);
 		
 		switch (node->tag) {
 			case JSON_STRING:
-				free(node->string_);
+				if (!(node_borrowed(node) & META_BORROWED_STRING))
+					json_release(arena, node->string_);
 				break;
 			case JSON_ARRAY:
 			case JSON_OBJECT:
 			{
 				JsonNode *child, *next;
+				index_free(node);
 				for (child = node->children.head; child != NULL; child = next) {
 					next = child->next;
 					json_delete(child);
@@ -444,7 +1183,7 @@ void json_delete(JsonNode *node)
 			default:;
 		}
 		
-		free(node);
+		json_release(arena, node_box(node));
 	}
 }
 
@@ -455,9 +1194,10 @@ bool json_validate(const char *json)
     }
 
 	const char *s = json;
+	Parser p = { NULL, false };
 	
 	skip_space(&s);
-	if (!parse_value(&s, NULL))
+	if (!parse_value(&p, &s, NULL))
 		return false;
 	
 	skip_space(&s);
@@ -474,18 +1214,26 @@ JsonNode *json_find_element(JsonNode *array, int index)
     }
 
 	JsonNode *element;
+	JsonIndex *lookup;
 	int i = 0;
 	
-	if (array == NULL || array->tag != JSON_ARRAY)
+	if (array == NULL || array->tag != JSON_ARRAY || index < 0)
 		return NULL;
 	
+	lookup = node_index(array);
+	if (lookup != NULL)
+		return (size_t) index < lookup->count ? lookup->slots[index] : NULL;
+	
 	json_foreach(element, array) {
 		if (i == index)
-			return element;
+			break;
 		i++;
 	}
 	
-	return NULL;
+	if (i >= JSON_INDEX_THRESHOLD)
+		index_build(array);
+	
+	return element;
 }
 
 JsonNode *json_find_member(JsonNode *object, const char *name)
@@ -494,18 +1242,223 @@ JsonNode *json_find_member(JsonNode *object, const char *name)
         return NULL;
     }
 
+	return find_member(object, name, 0);
+}
+
+/* hash is hash_key(name) if the caller has it, or 0 to work it out if needed */
+static JsonNode *find_member(JsonNode *object, const char *name, uint32_t hash)
+{
 	JsonNode *member;
+	JsonIndex *index;
+	int steps = 0;
 	
-	if (object == NULL || object->tag != JSON_OBJECT)
+	if (object->tag != JSON_OBJECT)
 		return NULL;
 	
-	json_foreach(member, object)
+	index = node_index(object);
+	if (index != NULL) {
+		if (hash == 0)
+			hash = hash_key(name);
+		
+		for (member = *bucket_of(index, hash); member != NULL; member = node_box(member)->meta.hash_next)
+			if (node_box(member)->meta.hash == hash && strcmp(member->key, name) == 0)
+				return member;
+		return NULL;
+	}
+	
+	json_foreach(member, object) {
 		if (strcmp(member->key, name) == 0)
-			return member;
+			break;
+		steps++;
+	}
+	
+	if (steps >= JSON_INDEX_THRESHOLD)
+		index_build(object);
+	
+	return member;
+}
+
+/*
+ * JSON Pointer (RFC 6901)
+ *
+ * Compiling splits the path into reference tokens once, unescaping them and
+ * working out their key hashes and array positions, so resolving is just one
+ * lookup per token, through the index for big containers.
+ */
+
+typedef struct
+{
+	const char *name;       /* unescaped */
+	uint32_t hash;          /* hash_key(name) */
+	int index;              /* array position it names, or -1 */
+} PointerToken;
+
+struct JsonPointer
+{
+	size_t count;
+	PointerToken tokens[];
+	/* followed by the tokens' names */
+};
+
+/* Prefixes shared by consecutive pointers are resolved once, up to this depth */
+#define POINTER_SHARE_DEPTH 32
+
+/* "0", or digits without a leading zero, that fit in an int */
+static int pointer_index(const char *name)
+{
+	long index = 0;
+	
+	if (!is_digit(*name) || (name[0] == '0' && name[1] != 0))
+		return -1;
+	for (; is_digit(*name); name++) {
+		index = index * 10 + (*name - '0');
+		if (index > INT_MAX)
+			return -1;
+	}
+	return *name == 0 ? (int) index : -1;
+}
+
+JsonPointer *json_pointer_compile(const char *path)
+{
+    if (path == NULL) {
+        return NULL;
+    }
+
+	JsonPointer *ptr;
+	size_t count = 0, len = strlen(path), i;
+	const char *s;
+	char *names;
+	
+	if (*path != 0 && *path != '/')
+		return NULL;
+	for (s = path; *s != 0; s++)
+		if (*s == '/')
+			count++;
+	
+	ptr = (JsonPointer*) malloc(sizeof(JsonPointer) + count * sizeof(PointerToken) + len + 1);
+	if (ptr == NULL)
+		return NULL;
+	ptr->count = count;
+	names = (char*) &ptr->tokens[count];
+	
+	/* Each token is copied after the last, unescaping ~1 to / and ~0 to ~ */
+	for (i = 0, s = path; i < count; i++) {
+		PointerToken *token = &ptr->tokens[i];
+		
+		token->name = names;
+		for (s++; *s != 0 && *s != '/'; s++) {
+			if (*s != '~') {
+				*names++ = *s;
+			} else if (s[1] == '0' || s[1] == '1') {
+				*names++ = s[1] == '0' ? '~' : '/';
+				s++;
+			} else {
+				free(ptr);
+				return NULL;
+			}
+		}
+		*names++ = 0;
+		
+		token->hash = hash_key(token->name);
+		token->index = pointer_index(token->name);
+	}
 	
+	return ptr;
+}
+
+void json_pointer_free(JsonPointer *ptr)
+{
+	free(ptr);
+}
+
+static JsonNode *pointer_step(JsonNode *node, const PointerToken *token)
+{
+	if (node->tag == JSON_OBJECT)
+		return find_member(node, token->name, token->hash);
+	if (node->tag == JSON_ARRAY && token->index >= 0)
+		return json_find_element(node, token->index);
 	return NULL;
 }
 
+/*
+ * Resolve tokens [from, count) of ptr, starting at node (which may be NULL),
+ * and record where each one led in stack, if given.
+ */
+static JsonNode *pointer_walk(const JsonPointer *ptr, size_t from, JsonNode *node,
+                              JsonNode *stack[POINTER_SHARE_DEPTH])
+{
+	size_t i;
+	
+	for (i = from; i < ptr->count; i++) {
+		if (node != NULL)
+			node = pointer_step(node, &ptr->tokens[i]);
+		if (stack == NULL) {
+			if (node == NULL)
+				break;
+		} else if (i < POINTER_SHARE_DEPTH) {
+			stack[i] = node;
+		}
+	}
+	return node;
+}
+
+JsonNode *json_pointer_resolve(const JsonPointer *ptr, JsonNode *doc)
+{
+    if (ptr == NULL || doc == NULL) {
+        return NULL;
+    }
+
+	return pointer_walk(ptr, 0, doc, NULL);
+}
+
+static bool token_equal(const PointerToken *a, const PointerToken *b)
+{
+	return a->hash == b->hash && strcmp(a->name, b->name) == 0;
+}
+
+void json_pointer_resolve_all(JsonPointer *const *ptrs, size_t count, JsonNode *doc, JsonNode **out)
+{
+    if (ptrs == NULL || out == NULL) {
+        return;
+    }
+
+	/* stack[i] is where the previous pointer's first i + 1 tokens led */
+	JsonNode *stack[POINTER_SHARE_DEPTH];
+	const JsonPointer *prev = NULL;
+	size_t i;
+	
+	for (i = 0; i < count; i++) {
+		const JsonPointer *ptr = ptrs[i];
+		size_t shared = 0;
+		
+		if (ptr == NULL || doc == NULL) {
+			out[i] = NULL;
+			continue;
+		}
+		
+		if (prev != NULL) {
+			size_t limit = prev->count < ptr->count ? prev->count : ptr->count;
+			
+			if (limit > POINTER_SHARE_DEPTH)
+				limit = POINTER_SHARE_DEPTH;
+			while (shared < limit && token_equal(&prev->tokens[shared], &ptr->tokens[shared]))
+				shared++;
+		}
+		
+		out[i] = pointer_walk(ptr, shared, shared > 0 ? stack[shared - 1] : doc, stack);
+		prev = ptr;
+	}
+}
+
+JsonNode *json_pointer_get(JsonNode *doc, const char *path)
+{
+	JsonPointer *ptr = json_pointer_compile(path);
+	JsonNode *ret = json_pointer_resolve(ptr, doc);
+	
+	json_pointer_free(ptr);
+	return ret;
+}
+
 JsonNode *json_first_child(const JsonNode *node)
 {
 	if (node != NULL && (node->tag == JSON_ARRAY || node->tag == JSON_OBJECT))
@@ -513,54 +1466,97 @@ JsonNode *json_first_child(const JsonNode *node)
 	return NULL;
 }
 
-static JsonNode *mknode(JsonTag tag)
+static JsonNode *mknode(JsonArena *arena, JsonTag tag)
 {
-	JsonNode *ret = (JsonNode*) calloc(1, sizeof(JsonNode));
-	if (ret == NULL)
-		out_of_memory();
-	ret->tag = tag;
-	return ret;
+	JsonNodeBox *box = (JsonNodeBox*) json_alloc(arena, sizeof(JsonNodeBox));
+	if (box == NULL)
+		return NULL;
+	memset(box, 0, sizeof(*box));
+	box->meta.arena = arena;
+	box->node.tag = tag;
+	return &box->node;
 }
 
 JsonNode *json_mknull(void)
 {
-	return mknode(JSON_NULL);
+	return mknode(NULL, JSON_NULL);
+}
+
+JsonNode *json_mknull_a(JsonArena *arena)
+{
+	return mknode(arena, JSON_NULL);
 }
 
 JsonNode *json_mkbool(bool b)
 {
-	JsonNode *ret = mknode(JSON_BOOL);
-	ret->bool_ = b;
+	return json_mkbool_a(NULL, b);
+}
+
+JsonNode *json_mkbool_a(JsonArena *arena, bool b)
+{
+	JsonNode *ret = mknode(arena, JSON_BOOL);
+	if (ret != NULL)
+		ret->bool_ = b;
 	return ret;
 }
 
-static JsonNode *mkstring(char *s)
+/* Takes ownership of s, releasing it if the node can't be made */
+static JsonNode *mkstring(JsonArena *arena, char *s)
 {
-	JsonNode *ret = mknode(JSON_STRING);
+	JsonNode *ret;
+	
+	if (s == NULL)
+		return NULL;
+	ret = mknode(arena, JSON_STRING);
+	if (ret == NULL) {
+		json_release(arena, s);
+		return NULL;
+	}
 	ret->string_ = s;
 	return ret;
 }
 
 JsonNode *json_mkstring(const char *s)
 {
-	return mkstring(json_strdup(s));
+	return json_mkstring_a(NULL, s);
+}
+
+JsonNode *json_mkstring_a(JsonArena *arena, const char *s)
+{
+	return mkstring(arena, json_strdup(arena, s));
 }
 
 JsonNode *json_mknumber(double n)
 {
-	JsonNode *node = mknode(JSON_NUMBER);
-	node->number_ = n;
+	return json_mknumber_a(NULL, n);
+}
+
+JsonNode *json_mknumber_a(JsonArena *arena, double n)
+{
+	JsonNode *node = mknode(arena, JSON_NUMBER);
+	if (node != NULL)
+		node->number_ = n;
 	return node;
 }
 
 JsonNode *json_mkarray(void)
 {
-	return mknode(JSON_ARRAY);
+	return mknode(NULL, JSON_ARRAY);
+}
+
+JsonNode *json_mkarray_a(JsonArena *arena)
+{
+	return mknode(arena, JSON_ARRAY);
 }
 
 JsonNode *json_mkobject(void)
 {
-	return mknode(JSON_OBJECT);
+	return mknode(NULL, JSON_OBJECT);
+}
+
+JsonNode *json_mkobject_a(JsonArena *arena)
+{
+	return mknode(arena, JSON_OBJECT);
 }
 
 static void append_node(JsonNode *parent, JsonNode *child)
@@ -574,6 +1570,8 @@ static void append_node(JsonNode *parent, JsonNode *child)
 	else
 		parent->children.head = child;
 	parent->children.tail = child;
+	
+	index_add(parent, child, true);
 }
 
 static void prepend_node(JsonNode *parent, JsonNode *child)
@@ -587,6 +1585,8 @@ static void prepend_node(JsonNode *parent, JsonNode *child)
 	else
 		parent->children.tail = child;
 	parent->children.head = child;
+	
+	index_add(parent, child, false);
 }
 
 static void append_member(JsonNode *object, char *key, JsonNode *value)
@@ -628,7 +1628,10 @@ void json_append_member(JsonNode *object, const char *key, JsonNode *value)
 	assert(object->tag == JSON_OBJECT);
 	assert(value->parent == NULL);
 	
-	append_member(object, json_strdup(key), value);
+	char *copy = json_strdup(node_arena(value), key);
+	if (copy == NULL)
+		return;
+	append_member(object, copy, value);
 }
 
 void json_prepend_member(JsonNode *object, const char *key, JsonNode *value)
@@ -640,7 +1643,9 @@ void json_prepend_member(JsonNode *object, const char *key, JsonNode *value)
 	assert(object->tag == JSON_OBJECT);
 	assert(value->parent == NULL);
 	
-	value->key = json_strdup(key);
+	value->key = json_strdup(node_arena(value), key);
+	if (value->key == NULL)
+		return;
 	prepend_node(object, value);
 }
 
@@ -653,6 +1658,8 @@ void json_remove_from_parent(JsonNode *node)
 	JsonNode *parent = node->parent;
 	
 	if (parent != NULL) {
+		index_remove(parent, node);
+		
 		if (node->prev != NULL)
 			node->prev->next = node->next;
 		else
@@ -662,90 +1669,697 @@ void json_remove_from_parent(JsonNode *node)
 		else
 			parent->children.tail = node->prev;
 		
-		free(node->key);
+		if (!(node_borrowed(node) & META_BORROWED_KEY))
+			json_release(node_arena(node), node->key);
 		
 		node->parent = NULL;
 		node->prev = node->next = NULL;
 		node->key = NULL;
+		node_borrowed(node) &= ~META_BORROWED_KEY;
 	}
 }
 
-static bool parse_value(const char **sp, JsonNode **out)
+/*
+ * Diff and patch
+ *
+ * Patches are RFC 6902 documents: arrays of operations like
+ * {"op":"replace","path":"/mtm/x","value":-1250}.  json_diff only emits add,
+ * remove and replace; json_patch also applies move, copy and test.
+ *
+ * Diffing walks both trees once.  Object members are matched in order where
+ * they line up, which they do between snapshots of the same telemetry, and
+ * looked up (through the index, for big objects) where they don't.  Arrays
+ * are compared position by position, with elements added or removed at the
+ * end, so an insertion near the front shows up as a run of replacements;
+ * finding the smallest edit would cost far more than linear time.
+ */
+
+/* Deep copy of node, allocated from arena; NULL if out of memory */
+static JsonNode *copy_node(JsonArena *arena, const JsonNode *node)
 {
-	const char *s = *sp;
+	const JsonNode *child;
+	JsonNode *ret;
 	
-	switch (*s) {
-		case 'n':
-			if (expect_literal(&s, "null")) {
-				if (out)
-					*out = json_mknull();
-				*sp = s;
-				return true;
-			}
-			return false;
-		
-		case 'f':
-			if (expect_literal(&s, "false")) {
-				if (out)
-					*out = json_mkbool(false);
-				*sp = s;
-				return true;
-			}
-			return false;
-		
-		case 't':
-			if (expect_literal(&s, "true")) {
-				if (out)
-					*out = json_mkbool(true);
-				*sp = s;
-				return true;
-			}
-			return false;
-		
-		case '"': {
-			char *str;
-			if (parse_string(&s, out ? &str : NULL)) {
-				if (out)
-					*out = mkstring(str);
-				*sp = s;
-				return true;
+	switch (node->tag) {
+		case JSON_STRING:
+			return json_mkstring_a(arena, node->string_);
+		case JSON_ARRAY:
+		case JSON_OBJECT:
+			ret = mknode(arena, node->tag);
+			if (ret == NULL)
+				return NULL;
+			json_foreach(child, node) {
+				JsonNode *copy = copy_node(arena, child);
+				char *key = NULL;
+				
+				if (copy == NULL || (child->key != NULL && (key = json_strdup(arena, child->key)) == NULL)) {
+					json_delete(copy);
+					json_delete(ret);
+					return NULL;
+				}
+				if (key != NULL)
+					append_member(ret, key, copy);
+				else
+					append_node(ret, copy);
 			}
-			return false;
-		}
-		
-		case '[':
-			if (parse_array(&s, out)) {
-				*sp = s;
-				return true;
+			return ret;
+		case JSON_BOOL:
+			return json_mkbool_a(arena, node->bool_);
+		case JSON_NUMBER:
+			return json_mknumber_a(arena, node->number_);
+		default:
+			return mknode(arena, node->tag);
+	}
+}
+
+static bool same_number(double a, double b)
+{
+	return double_bits(a) == double_bits(b);
+}
+
+/*
+ * Member lookup for callers with read-only access, such as json_diff's
+ * arguments, which other threads may be reading at the same time.  It uses
+ * the object's own index if it has one, but never builds one there: once a
+ * lookup has to walk past JSON_INDEX_THRESHOLD members, a throwaway hash table
+ * is built in heap scratch space instead, so that repeated lookups stay cheap.
+ * Without memory for it, lookups just walk.
+ */
+typedef struct
+{
+	const JsonNode *object;
+	const JsonNode **slots; /* open addressing, first duplicate wins */
+	size_t size;            /* power of two, or 0 if there is no table */
+	bool walk_only;         /* building the table failed */
+} MemberLookup;
+
+static void lookup_init(MemberLookup *l, const JsonNode *object)
+{
+	l->object = object;
+	l->slots = NULL;
+	l->size = 0;
+	l->walk_only = false;
+}
+
+static void lookup_free(MemberLookup *l)
+{
+	mem_free(NULL, l->slots, 0);
+	l->slots = NULL;
+	l->size = 0;
+}
+
+static void lookup_build(MemberLookup *l)
+{
+	const JsonNode *member;
+	size_t count = 0, size = 8;
+	
+	json_foreach(member, l->object)
+		count++;
+	while (size < count * 2)
+		size *= 2;
+	
+	l->slots = (const JsonNode**) mem_alloc(NULL, size * sizeof(JsonNode*));
+	if (l->slots == NULL) {
+		l->walk_only = true;
+		return;
+	}
+	memset(l->slots, 0, size * sizeof(JsonNode*));
+	l->size = size;
+	
+	/* Inserting in list order keeps the first of any duplicates first in its chain */
+	json_foreach(member, l->object) {
+		size_t i = hash_key(member->key) & (size - 1);
+		
+		while (l->slots[i] != NULL)
+			i = (i + 1) & (size - 1);
+		l->slots[i] = member;
+	}
+}
+
+static const JsonNode *lookup_find(MemberLookup *l, const char *name)
+{
+	const JsonNode *member;
+	JsonIndex *index;
+	uint32_t hash;
+	int steps = 0;
+	
+	if (l->object->tag != JSON_OBJECT)
+		return NULL;
+	
+	index = node_index(l->object);
+	if (index != NULL || l->size != 0) {
+		hash = hash_key(name);
+		if (index != NULL) {
+			for (member = *bucket_of(index, hash); member != NULL; member = node_box(member)->meta.hash_next)
+				if (node_box(member)->meta.hash == hash && strcmp(member->key, name) == 0)
+					return member;
+			return NULL;
+		}
+		for (size_t i = hash & (l->size - 1); l->slots[i] != NULL; i = (i + 1) & (l->size - 1))
+			if (strcmp(l->slots[i]->key, name) == 0)
+				return l->slots[i];
+		return NULL;
+	}
+	
+	json_foreach(member, l->object) {
+		if (strcmp(member->key, name) == 0)
+			break;
+		steps++;
+	}
+	
+	if (steps >= JSON_INDEX_THRESHOLD && !l->walk_only)
+		lookup_build(l);
+	
+	return member;
+}
+
+static bool nodes_equal(const JsonNode *a, const JsonNode *b)
+{
+	const JsonNode *ca, *cb;
+	
+	if (a->tag != b->tag)
+		return false;
+	
+	switch (a->tag) {
+		case JSON_NULL:
+			return true;
+		case JSON_BOOL:
+			return a->bool_ == b->bool_;
+		case JSON_STRING:
+			return strcmp(a->string_, b->string_) == 0;
+		case JSON_NUMBER:
+			return same_number(a->number_, b->number_);
+		case JSON_ARRAY:
+			for (ca = a->children.head, cb = b->children.head; ca != NULL && cb != NULL;
+			     ca = ca->next, cb = cb->next)
+				if (!nodes_equal(ca, cb))
+					return false;
+			return ca == NULL && cb == NULL;
+		case JSON_OBJECT:
+		{
+			MemberLookup lookup;
+			size_t count = 0;
+			bool equal = true;
+			
+			lookup_init(&lookup, b);
+			cb = b->children.head;
+			json_foreach(ca, a) {
+				const JsonNode *match = cb != NULL && strcmp(cb->key, ca->key) == 0
+				                        ? cb : lookup_find(&lookup, ca->key);
+				
+				if (match == NULL || !nodes_equal(ca, match)) {
+					equal = false;
+					break;
+				}
+				cb = match->next;
+				count++;
 			}
+			lookup_free(&lookup);
+			if (!equal)
+				return false;
+			json_foreach(cb, b)
+				count--;
+			return count == 0;
+		}
+		default:
 			return false;
+	}
+}
+
+typedef struct
+{
+	JsonNode *ops;
+	SB path;                /* pointer to the values being compared */
+	bool failed;
+} Diff;
+
+static void diff_op(Diff *d, const char *op, const JsonNode *value)
+{
+	JsonNode *node, *member;
+	JsonNode *copy = NULL;
+	int members = 0;
+	
+	if (d->failed || d->path.failed) {
+		d->failed = true;
+		return;
+	}
+	
+	*d->path.cur = 0;
+	node = json_mkobject();
+	json_append_member(node, "op", json_mkstring(op));
+	json_append_member(node, "path", json_mkstring(d->path.start));
+	if (value != NULL) {
+		copy = copy_node(NULL, value);
+		json_append_member(node, "value", copy);
+	}
+	
+	/* Anything missing means memory ran out */
+	json_foreach(member, node)
+		members++;
+	if (node == NULL || members != (value != NULL ? 3 : 2)) {
+		if (copy != NULL && copy->parent == NULL)
+			json_delete(copy);
+		json_delete(node);
+		d->failed = true;
+		return;
+	}
+	append_node(d->ops, node);
+}
+
+/* Append "/name" to the path, escaping ~ and / */
+static void diff_push_key(Diff *d, const char *key)
+{
+	sb_putc(&d->path, '/');
+	for (; *key != 0; key++) {
+		if (*key == '~' || *key == '/') {
+			sb_putc(&d->path, '~');
+			sb_putc(&d->path, *key == '~' ? '0' : '1');
+		} else {
+			sb_putc(&d->path, *key);
+		}
+	}
+}
+
+static void diff_push_index(Diff *d, size_t index)
+{
+	char buf[24];
+	
+	sb_put(&d->path, buf, sprintf(buf, "/%zu", index));
+}
+
+static void diff_value(Diff *d, const JsonNode *a, const JsonNode *b)
+{
+	size_t mark = d->path.cur - d->path.start;
+	const JsonNode *ca, *cb;
+	
+	if (a->tag != b->tag || (a->tag != JSON_ARRAY && a->tag != JSON_OBJECT)) {
+		if (!nodes_equal(a, b))
+			diff_op(d, "replace", b);
+		return;
+	}
+	
+	if (a->tag == JSON_ARRAY) {
+		size_t i = 0, count_a;
 		
-		case '{':
-			if (parse_object(&s, out)) {
-				*sp = s;
-				return true;
+		for (ca = a->children.head, cb = b->children.head; ca != NULL && cb != NULL;
+		     ca = ca->next, cb = cb->next, i++) {
+			diff_push_index(d, i);
+			diff_value(d, ca, cb);
+			d->path.cur = d->path.start + mark;
+		}
+		
+		/* Extra elements are added in order, or removed from the end backwards */
+		for (; cb != NULL; cb = cb->next, i++) {
+			diff_push_index(d, i);
+			diff_op(d, "add", cb);
+			d->path.cur = d->path.start + mark;
+		}
+		for (count_a = i; ca != NULL; ca = ca->next)
+			count_a++;
+		while (count_a-- > i) {
+			diff_push_index(d, count_a);
+			diff_op(d, "remove", NULL);
+			d->path.cur = d->path.start + mark;
+		}
+	} else {
+		MemberLookup lookup;
+		size_t matched = 0, count_b = 0;
+		
+		lookup_init(&lookup, b);
+		cb = b->children.head;
+		json_foreach(ca, a) {
+			const JsonNode *match = cb != NULL && strcmp(cb->key, ca->key) == 0
+			                        ? cb : lookup_find(&lookup, ca->key);
+			
+			diff_push_key(d, ca->key);
+			if (match != NULL) {
+				diff_value(d, ca, match);
+				cb = match->next;
+				matched++;
+			} else {
+				diff_op(d, "remove", NULL);
+			}
+			d->path.cur = d->path.start + mark;
+		}
+		lookup_free(&lookup);
+		
+		/* Members only in b, unless every one of them was matched above */
+		json_foreach(cb, b)
+			count_b++;
+		if (matched == count_b)
+			return;
+		lookup_init(&lookup, a);
+		json_foreach(cb, b) {
+			if (lookup_find(&lookup, cb->key) == NULL) {
+				diff_push_key(d, cb->key);
+				diff_op(d, "add", cb);
+				d->path.cur = d->path.start + mark;
+			}
+		}
+		lookup_free(&lookup);
+	}
+}
+
+JsonNode *json_diff(const JsonNode *a, const JsonNode *b)
+{
+    if (a == NULL || b == NULL) {
+        return NULL;
+    }
+
+	Diff d;
+	
+	d.ops = json_mkarray();
+	if (d.ops == NULL)
+		return NULL;
+	d.failed = false;
+	sb_init(&d.path, NULL);
+	
+	diff_value(&d, a, b);
+	
+	sb_free(&d.path);
+	if (d.failed) {
+		json_delete(d.ops);
+		return NULL;
+	}
+	return d.ops;
+}
+
+/*
+ * Drop node's value (but not its key or place), and take over from's,
+ * consuming from.  Fails, leaving node as it was, only if from's string
+ * has to be copied into node's arena and there's no memory for it.
+ */
+static bool patch_become(JsonNode *node, JsonNode *from)
+{
+	JsonArena *arena = node_arena(node);
+	JsonNode *child, *next;
+	char *str = NULL;
+	
+	if (from->tag == JSON_STRING) {
+		str = node_arena(from) == arena ? from->string_ : json_strdup(arena, from->string_);
+		if (str == NULL) {
+			json_delete(from);
+			return false;
+		}
+		if (str != from->string_)
+			json_release(node_arena(from), from->string_);
+	}
+	
+	switch (node->tag) {
+		case JSON_STRING:
+			if (!(node_borrowed(node) & META_BORROWED_STRING))
+				json_release(arena, node->string_);
+			node_borrowed(node) &= ~META_BORROWED_STRING;
+			break;
+		case JSON_ARRAY:
+		case JSON_OBJECT:
+			index_free(node);
+			for (child = node->children.head; child != NULL; child = next) {
+				next = child->next;
+				json_delete(child);
 			}
+			break;
+		default:;
+	}
+	
+	node->tag = from->tag;
+	switch (from->tag) {
+		case JSON_STRING:
+			node->string_ = str;
+			break;
+		case JSON_BOOL:
+			node->bool_ = from->bool_;
+			break;
+		case JSON_NUMBER:
+			node->number_ = from->number_;
+			break;
+		case JSON_ARRAY:
+		case JSON_OBJECT:
+			/* Children keep the arena they came from, as in any mixed tree */
+			node->children = from->children;
+			json_foreach(child, node)
+				child->parent = node;
+			break;
+		default:;
+	}
+	
+	/* from is a fresh copy, without a key or an index */
+	json_release(node_arena(from), node_box(from));
+	return true;
+}
+
+/* Where the last token of ptr goes: its container, or NULL for the root */
+static bool patch_parent(const JsonPointer *ptr, JsonNode *doc, JsonNode **parent)
+{
+	size_t i;
+	
+	*parent = NULL;
+	if (ptr->count == 0)
+		return true;
+	
+	for (i = 0; i + 1 < ptr->count && doc != NULL; i++)
+		doc = pointer_step(doc, &ptr->tokens[i]);
+	*parent = doc;
+	return doc != NULL && (doc->tag == JSON_ARRAY || doc->tag == JSON_OBJECT);
+}
+
+/* Add value (which is consumed) at ptr */
+static bool patch_add(JsonNode *doc, const JsonPointer *ptr, JsonNode *value)
+{
+	const PointerToken *last = &ptr->tokens[ptr->count - 1];
+	JsonNode *parent, *existing;
+	
+	if (!patch_parent(ptr, doc, &parent)) {
+		json_delete(value);
+		return false;
+	}
+	if (parent == NULL)
+		return patch_become(doc, value);
+	
+	if (parent->tag == JSON_OBJECT) {
+		char *key;
+		
+		existing = find_member(parent, last->name, last->hash);
+		if (existing != NULL)
+			return patch_become(existing, value);
+		key = json_strdup(node_arena(value), last->name);
+		if (key == NULL) {
+			json_delete(value);
+			return false;
+		}
+		append_member(parent, key, value);
+		return true;
+	}
+	
+	if (strcmp(last->name, "-") == 0) {
+		append_node(parent, value);
+		return true;
+	}
+	if (last->index < 0) {
+		json_delete(value);
+		return false;
+	}
+	
+	existing = json_find_element(parent, last->index);
+	if (existing == NULL) {
+		/* Only one past the end is allowed */
+		if (last->index != 0 && json_find_element(parent, last->index - 1) == NULL) {
+			json_delete(value);
+			return false;
+		}
+		append_node(parent, value);
+		return true;
+	}
+	
+	/* Elements after it move along, which the index can't follow */
+	index_free(parent);
+	value->parent = parent;
+	value->prev = existing->prev;
+	value->next = existing;
+	if (existing->prev != NULL)
+		existing->prev->next = value;
+	else
+		parent->children.head = value;
+	existing->prev = value;
+	return true;
+}
+
+static const char *op_string(MemberLookup *op, const char *name)
+{
+	const JsonNode *member = lookup_find(op, name);
+	return member != NULL && member->tag == JSON_STRING ? member->string_ : NULL;
+}
+
+static bool patch_apply(JsonNode *doc, const JsonNode *op)
+{
+	MemberLookup lookup;
+	const char *name, *path, *from_path;
+	const JsonNode *value;
+	JsonArena *arena = node_arena(doc);
+	JsonPointer *ptr, *from = NULL;
+	JsonNode *target, *source = NULL;
+	bool ok = false;
+	
+	/* The patch is the caller's, and read-only */
+	lookup_init(&lookup, op);
+	name = op_string(&lookup, "op");
+	path = op_string(&lookup, "path");
+	from_path = op_string(&lookup, "from");
+	value = lookup_find(&lookup, "value");
+	lookup_free(&lookup);
+	
+	if (op->tag != JSON_OBJECT || name == NULL || path == NULL)
+		return false;
+	ptr = json_pointer_compile(path);
+	if (ptr == NULL)
+		return false;
+	
+	if (strcmp(name, "move") == 0 || strcmp(name, "copy") == 0) {
+		from = from_path != NULL ? json_pointer_compile(from_path) : NULL;
+		source = from != NULL ? json_pointer_resolve(from, doc) : NULL;
+		if (source == NULL)
+			goto done;
+	}
+	
+	if (strcmp(name, "add") == 0) {
+		if (value != NULL)
+			ok = patch_add(doc, ptr, copy_node(arena, value));
+	} else if (strcmp(name, "replace") == 0) {
+		target = json_pointer_resolve(ptr, doc);
+		if (value != NULL && target != NULL) {
+			JsonNode *copy = copy_node(node_arena(target), value);
+			ok = copy != NULL && patch_become(target, copy);
+		}
+	} else if (strcmp(name, "remove") == 0) {
+		target = json_pointer_resolve(ptr, doc);
+		if (target != NULL && target != doc) {
+			json_delete(target);
+			ok = true;
+		}
+	} else if (strcmp(name, "test") == 0) {
+		target = json_pointer_resolve(ptr, doc);
+		ok = value != NULL && target != NULL && nodes_equal(target, value);
+	} else if (strcmp(name, "copy") == 0) {
+		ok = patch_add(doc, ptr, copy_node(arena, source));
+	} else if (strcmp(name, "move") == 0) {
+		size_t len = strlen(from_path);
+		
+		/* Nowhere to move the root, and a value can't move inside itself */
+		if (source == doc || (strncmp(path, from_path, len) == 0 && path[len] == '/'))
+			goto done;
+		if (path[len] == 0 && strcmp(path, from_path) == 0) {
+			ok = true;
+			goto done;
+		}
+		
+		/* Removed, then added, so the path is as it reads after the removal */
+		target = copy_node(arena, source);
+		if (target != NULL) {
+			json_delete(source);
+			ok = patch_add(doc, ptr, target);
+		}
+	}
+	
+done:
+	json_pointer_free(from);
+	json_pointer_free(ptr);
+	return ok;
+}
+
+bool json_patch(JsonNode *doc, const JsonNode *patch)
+{
+    if (doc == NULL || patch == NULL) {
+        return false;
+    }
+
+	const JsonNode *op;
+	
+	if (patch->tag != JSON_ARRAY)
+		return false;
+	json_foreach(op, patch)
+		if (!patch_apply(doc, op))
 			return false;
+	return true;
+}
+
+static bool parse_value(const Parser *p, const char **sp, JsonNode **out)
+{
+	const char *s = *sp;
+	
+	switch (*s) {
+		case 'n':
+			if (!expect_literal(&s, "null"))
+				return false;
+			if (out)
+				*out = json_mknull_a(p->arena);
+			break;
+		
+		case 'f':
+			if (!expect_literal(&s, "false"))
+				return false;
+			if (out)
+				*out = json_mkbool_a(p->arena, false);
+			break;
+		
+		case 't':
+			if (!expect_literal(&s, "true"))
+				return false;
+			if (out)
+				*out = json_mkbool_a(p->arena, true);
+			break;
+		
+		case '"': {
+			char *str;
+			if (!parse_string(p, &s, out ? &str : NULL))
+				return false;
+			if (out && p->inplace) {
+				*out = mknode(p->arena, JSON_STRING);
+				if (*out != NULL) {
+					(*out)->string_ = str;
+					node_borrowed(*out) |= META_BORROWED_STRING;
+				}
+			} else if (out) {
+				*out = mkstring(p->arena, str);
+			}
+			break;
+		}
+		
+		case '[':
+			if (!parse_array(p, &s, out))
+				return false;
+			break;
+		
+		case '{':
+			if (!parse_object(p, &s, out))
+				return false;
+			break;
 		
 		default: {
 			double num;
-			if (parse_number(&s, out ? &num : NULL)) {
-				if (out)
-					*out = json_mknumber(num);
-				*sp = s;
-				return true;
-			}
-			return false;
+			if (!parse_number(&s, out ? &num : NULL))
+				return false;
+			if (out)
+				*out = json_mknumber_a(p->arena, num);
+			break;
 		}
 	}
+	
+	/* Out of memory */
+	if (out && *out == NULL)
+		return false;
+	
+	*sp = s;
+	return true;
 }
 
-static bool parse_array(const char **sp, JsonNode **out)
+static bool parse_array(const Parser *p, const char **sp, JsonNode **out)
 {
 	const char *s = *sp;
-	JsonNode *ret = out ? json_mkarray() : NULL;
+	JsonNode *ret = out ? json_mkarray_a(p->arena) : NULL;
 	JsonNode *element;
 	
+	if (out && ret == NULL)
+		return false;
 	if (*s++ != '[')
 		goto failure;
 	skip_space(&s);
@@ -756,12 +2370,12 @@ static bool parse_array(const char **sp, JsonNode **out)
 	}
 	
 	for (;;) {
-		if (!parse_value(&s, out ? &element : NULL))
+		if (!parse_value(p, &s, out ? &element : NULL))
 			goto failure;
 		skip_space(&s);
 		
 		if (out)
-			json_append_element(ret, element);
+			append_node(ret, element);
 		
 		if (*s == ']') {
 			s++;
@@ -784,13 +2398,15 @@ failure:
 	return false;
 }
 
-static bool parse_object(const char **sp, JsonNode **out)
+static bool parse_object(const Parser *p, const char **sp, JsonNode **out)
 {
 	const char *s = *sp;
-	JsonNode *ret = out ? json_mkobject() : NULL;
+	JsonNode *ret = out ? json_mkobject_a(p->arena) : NULL;
 	char *key;
 	JsonNode *value;
 	
+	if (out && ret == NULL)
+		return false;
 	if (*s++ != '{')
 		goto failure;
 	skip_space(&s);
@@ -801,7 +2417,7 @@ static bool parse_object(const char **sp, JsonNode **out)
 	}
 	
 	for (;;) {
-		if (!parse_string(&s, out ? &key : NULL))
+		if (!parse_string(p, &s, out ? &key : NULL))
 			goto failure;
 		skip_space(&s);
 		
@@ -809,12 +2425,15 @@ static bool parse_object(const char **sp, JsonNode **out)
 			goto failure_free_key;
 		skip_space(&s);
 		
-		if (!parse_value(&s, out ? &value : NULL))
+		if (!parse_value(p, &s, out ? &value : NULL))
 			goto failure_free_key;
 		skip_space(&s);
 		
-		if (out)
+		if (out) {
 			append_member(ret, key, value);
+			if (p->inplace)
+				node_borrowed(value) |= META_BORROWED_KEY;
+		}
 		
 		if (*s == '}') {
 			s++;
@@ -833,34 +2452,65 @@ success:
 	return true;
 
 failure_free_key:
-	if (out)
-		free(key);
+	if (out && !p->inplace)
+		json_release(p->arena, key);
 failure:
 	json_delete(ret);
 	return false;
 }
 
-bool parse_string(const char **sp, char **out)
+bool parse_string(const Parser *p, const char **sp, char **out)
 {
 	const char *s = *sp;
 	SB sb;
 	char throwaway_buffer[4];
 		/* enough space for a UTF-8 character */
 	char *b;
+	char *inplace = NULL;
+		/* start of the string, when unescaping it where it lies */
 	
 	if (*s++ != '"')
 		return false;
 	
-	if (out) {
-		sb_init(&sb);
+	/*
+	 * Unescaping never makes a string longer, so in place, b can trail
+	 * behind s without ever overtaking it.
+	 */
+	if (out && p->inplace) {
+		inplace = b = (char*) s;
+	} else if (out) {
+		sb_init(&sb, p->arena);
 		sb_need(&sb, 4);
 		b = sb.cur;
 	} else {
 		b = throwaway_buffer;
 	}
 	
-	while (*s != '"') {
-		unsigned char c = *s++;
+	for (;;) {
+		size_t run = span_plain(s);
+		unsigned char c;
+		
+		/* Copy a run of characters which need no decoding or checks. */
+		if (run > 0) {
+			if (inplace) {
+				if (b != s)
+					memmove(b, s, run);
+				b += run;
+			} else if (out) {
+				sb.cur = b;
+				sb_need(&sb, (int) run + 4);
+				if (sb.failed)
+					goto failed;
+				b = sb.cur;
+				memcpy(b, s, run);
+				sb.cur = b += run;
+			}
+			s += run;
+		}
+		
+		if (*s == '"')
+			break;
+		c = *s++;
 		
 		/* Parse next character, and write it to b. */
 		if (c == '\\') {
@@ -934,7 +2584,9 @@ bool parse_string(const char **sp, char **out)
 		 * Update sb to know about the new bytes,
 		 * and set up b to write another character.
 		 */
-		if (out) {
+		if (inplace) {
+			/* Writing in place needs no room made */
+		} else if (out) {
 			sb.cur = b;
 			sb_need(&sb, 4);
 			b = sb.cur;
@@ -944,13 +2596,19 @@ bool parse_string(const char **sp, char **out)
 	}
 	s++;
 	
-	if (out)
-		*out = sb_finish(&sb);
+	if (inplace) {
+		*b = 0;
+		*out = inplace;
+	} else if (out) {
+		*out = sb_finish_into(&sb);
+		if (*out == NULL)
+			return false;
+	}
 	*sp = s;
 	return true;
 
 failed:
-	if (out)
+	if (out && !inplace)
 		sb_free(&sb);
 	return false;
 }
@@ -967,11 +2625,39 @@ failed:
  */
 bool parse_number(const char **sp, double *out)
 {
+	/* Powers of ten which are exact in a double */
+	static const double exact_pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
 	const char *s = *sp;
+	bool negative = false;
+	uint64_t mantissa = 0;
+	int digits = 0;         /* significant digits in mantissa */
+	int exp10 = 0;          /* value = mantissa * 10^exp10, if not truncated */
+	bool truncated = false;
+	
+	/*
+	 * Validate and convert in one pass: gather up to 19 significant digits
+	 * as an integer, and note where the decimal point goes.
+	 */
+#define ADD_DIGIT(c, scale) do { \
+			if (digits < 19) { \
+				mantissa = mantissa * 10 + (uint64_t) ((c) - '0'); \
+				if (mantissa != 0) \
+					digits++; \
+				exp10 -= (scale); \
+			} else { \
+				truncated = true; \
+				exp10 += 1 - (scale); \
+			} \
+		} while (0)
 
 	/* '-'? */
-	if (*s == '-')
+	if (*s == '-') {
+		negative = true;
 		s++;
+	}
 
 	/* (0 | [1-9][0-9]*) */
 	if (*s == '0') {
@@ -980,6 +2666,7 @@ bool parse_number(const char **sp, double *out)
 		if (!is_digit(*s))
 			return false;
 		do {
+			ADD_DIGIT(*s, 0);
 			s++;
 		} while (is_digit(*s));
 	}
@@ -990,313 +2677,1980 @@ bool parse_number(const char **sp, double *out)
 		if (!is_digit(*s))
 			return false;
 		do {
+			ADD_DIGIT(*s, 1);
 			s++;
 		} while (is_digit(*s));
 	}
 
+#undef ADD_DIGIT
+
 	/* ([Ee] [+-]? [0-9]+)? */
 	if (*s == 'E' || *s == 'e') {
+		bool exp_negative = false;
+		int exp = 0;
+		
 		s++;
 		if (*s == '+' || *s == '-')
-			s++;
+			exp_negative = (*s++ == '-');
 		if (!is_digit(*s))
 			return false;
 		do {
+			if (exp < 100000)
+				exp = exp * 10 + (*s - '0');
 			s++;
 		} while (is_digit(*s));
+		
+		exp10 += exp_negative ? -exp : exp;
 	}
 
-	if (out)
-		*out = strtod(*sp, NULL);
+	if (out) {
+		/*
+		 * When the digits and the power of ten are both exact in a double,
+		 * one multiply or divide rounds correctly (Clinger's fast path).
+		 * Anything harder goes to strtod.
+		 */
+		if (!truncated && mantissa <= (UINT64_C(1) << 53) && exp10 >= -22 && exp10 <= 22) {
+			double d = (double) mantissa;
+			d = exp10 < 0 ? d / exact_pow10[-exp10] : d * exact_pow10[exp10];
+			*out = negative ? -d : d;
+		} else {
+			*out = strtod(*sp, NULL);
+		}
+	}
+
+	*sp = s;
+	return true;
+}
+
+static void skip_space(const char **sp)
+{
+	const char *s = *sp;
+	
+	/* Compact JSON has no space, or a single one, between tokens */
+	if (is_space(*s))
+		s += is_space(s[1]) ? span_space(s) : 1;
+	*sp = s;
+}
+
+/*
+ * Streaming parser
+ *
+ * Structure is tracked with a small state machine and a stack of open
+ * containers.  Scalars are collected into a token buffer until they are
+ * complete, and then handed to the same parse_string/parse_number used by
+ * json_decode, so both accept exactly the same documents (apart from the
+ * token length and nesting limits).
+ */
+
+#define STREAM_DEFAULT_TOKEN 4096
+#define STREAM_DEFAULT_DEPTH 64
+#define STREAM_CHUNK 4096
+
+typedef enum {
+	STREAM_VALUE,           /* value expected */
+	STREAM_VALUE_OR_CLOSE,  /* just after '[' */
+	STREAM_KEY,             /* just after ',' in an object */
+	STREAM_KEY_OR_CLOSE,    /* just after '{' */
+	STREAM_COLON,
+	STREAM_COMMA_OR_CLOSE,
+	STREAM_DONE,            /* top-level value complete */
+	STREAM_FAILED,
+} StreamState;
+
+typedef enum {
+	TOKEN_NONE,
+	TOKEN_STRING,
+	TOKEN_KEY,
+	TOKEN_NUMBER,
+	TOKEN_LITERAL,
+} StreamToken;
+
+struct JsonStream
+{
+	JsonEventHandler handler;
+	void *ctx;
+	
+	StreamState state;
+	StreamToken token;
+	bool escaped;           /* previous string byte was an escaping backslash */
+	
+	char *buf;              /* raw bytes of the current token */
+	size_t len;
+	size_t max_token;
+	
+	char *key;              /* decoded key of the member being parsed */
+	
+	char *stack;            /* '[' or '{' for each open container */
+	int depth;
+	int max_depth;
+	
+	size_t offset;          /* bytes consumed so far */
+	const char *error;
+};
+
+#define is_number_char(c) (is_digit(c) || (c) == '-' || (c) == '+' || (c) == '.' || (c) == 'e' || (c) == 'E')
+#define is_literal_char(c) ((c) >= 'a' && (c) <= 'z')
+
+JsonStream *json_stream_create(JsonEventHandler handler, void *ctx, size_t max_token, int max_depth)
+{
+    if (handler == NULL) {
+        return NULL;
+    }
+
+	JsonStream *stream = (JsonStream*) malloc(sizeof(JsonStream));
+	if (stream == NULL)
+		return NULL;
+	
+	stream->handler = handler;
+	stream->ctx = ctx;
+	stream->max_token = max_token > 0 ? max_token : STREAM_DEFAULT_TOKEN;
+	stream->max_depth = max_depth > 0 ? max_depth : STREAM_DEFAULT_DEPTH;
+	
+	stream->buf = (char*) malloc(stream->max_token + 1);
+	stream->key = (char*) malloc(stream->max_token + 1);
+	stream->stack = (char*) malloc(stream->max_depth);
+	if (stream->buf == NULL || stream->key == NULL || stream->stack == NULL) {
+		json_stream_destroy(stream);
+		return NULL;
+	}
+	
+	json_stream_reset(stream);
+	return stream;
+}
+
+void json_stream_reset(JsonStream *stream)
+{
+    if (stream == NULL) {
+        return;
+    }
+
+	stream->state = STREAM_VALUE;
+	stream->token = TOKEN_NONE;
+	stream->escaped = false;
+	stream->len = 0;
+	stream->key[0] = 0;
+	stream->depth = 0;
+	stream->offset = 0;
+	stream->error = NULL;
+}
+
+void json_stream_destroy(JsonStream *stream)
+{
+    if (stream == NULL) {
+        return;
+    }
+
+	free(stream->buf);
+	free(stream->key);
+	free(stream->stack);
+	free(stream);
+}
+
+const char *json_stream_error(const JsonStream *stream, size_t *offset)
+{
+    if (stream == NULL) {
+        return NULL;
+    }
+
+	if (offset != NULL)
+		*offset = stream->offset;
+	return stream->error;
+}
+
+static bool stream_fail(JsonStream *stream, const char *error)
+{
+	stream->state = STREAM_FAILED;
+	stream->error = error;
+	return false;
+}
+
+static bool stream_emit(JsonStream *stream, JsonEvent *event)
+{
+	bool in_object = stream->depth > 0 && stream->stack[stream->depth - 1] == '{';
+	
+	event->key = in_object ? stream->key : NULL;
+	event->depth = stream->depth;
+	
+	if (!stream->handler(stream->ctx, event))
+		return stream_fail(stream, "Stopped by handler");
+	return true;
+}
+
+/* A value (scalar, or a whole container) has just been finished */
+static void stream_value_done(JsonStream *stream)
+{
+	stream->state = stream->depth > 0 ? STREAM_COMMA_OR_CLOSE : STREAM_DONE;
+}
+
+static bool stream_open(JsonStream *stream, char c)
+{
+	JsonEvent event;
+	
+	if (stream->depth == stream->max_depth)
+		return stream_fail(stream, "Nesting too deep");
+	
+	event.type = c == '[' ? JSON_EVENT_ARRAY_BEGIN : JSON_EVENT_OBJECT_BEGIN;
+	if (!stream_emit(stream, &event))
+		return false;
+	
+	stream->stack[stream->depth++] = c;
+	stream->state = c == '[' ? STREAM_VALUE_OR_CLOSE : STREAM_KEY_OR_CLOSE;
+	return true;
+}
+
+static bool stream_close(JsonStream *stream, char c)
+{
+	JsonEvent event;
+	char open = c == ']' ? '[' : '{';
+	
+	if (stream->depth == 0 || stream->stack[stream->depth - 1] != open)
+		return stream_fail(stream, "Mismatched bracket");
+	
+	stream->depth--;
+	
+	event.type = c == ']' ? JSON_EVENT_ARRAY_END : JSON_EVENT_OBJECT_END;
+	if (!stream_emit(stream, &event))
+		return false;
+	
+	stream_value_done(stream);
+	return true;
+}
+
+static bool stream_put(JsonStream *stream, const char *bytes, size_t count)
+{
+	if (count > stream->max_token - stream->len)
+		return stream_fail(stream, "Token too long");
+	
+	memcpy(stream->buf + stream->len, bytes, count);
+	stream->len += count;
+	return true;
+}
+
+/* The current token is complete, so decode it and emit its value */
+static bool stream_finish_token(JsonStream *stream)
+{
+	const char *s = stream->buf;
+	StreamToken token = stream->token;
+	JsonEvent event;
+	bool ok;
+	
+	stream->buf[stream->len] = 0;
+	stream->token = TOKEN_NONE;
+	stream->len = 0;
+	
+	switch (token) {
+		case TOKEN_STRING:
+		case TOKEN_KEY:
+		{
+			/* The token is our own copy, so it can be decoded where it lies */
+			Parser p = { NULL, true };
+			char *str;
+			
+			if (!parse_string(&p, &s, &str) || *s != 0)
+				return stream_fail(stream, "Invalid string");
+			
+			if (token == TOKEN_KEY) {
+				/* Decoding never makes a string longer, so this always fits */
+				strcpy(stream->key, str);
+				stream->state = STREAM_COLON;
+				return true;
+			}
+			
+			event.type = JSON_EVENT_STRING;
+			event.string_ = str;
+			ok = stream_emit(stream, &event);
+			break;
+		}
+		
+		case TOKEN_NUMBER:
+			event.type = JSON_EVENT_NUMBER;
+			if (!parse_number(&s, &event.number_) || *s != 0)
+				return stream_fail(stream, "Invalid number");
+			ok = stream_emit(stream, &event);
+			break;
+		
+		case TOKEN_LITERAL:
+			if (strcmp(s, "null") == 0) {
+				event.type = JSON_EVENT_NULL;
+			} else if (strcmp(s, "true") == 0 || strcmp(s, "false") == 0) {
+				event.type = JSON_EVENT_BOOL;
+				event.bool_ = s[0] == 't';
+			} else {
+				return stream_fail(stream, "Invalid literal");
+			}
+			ok = stream_emit(stream, &event);
+			break;
+		
+		default:
+			return stream_fail(stream, "Internal error");
+	}
+	
+	if (ok)
+		stream_value_done(stream);
+	return ok;
+}
+
+/* Start a new token with its first byte */
+static bool stream_start_token(JsonStream *stream, StreamToken token, char c)
+{
+	stream->token = token;
+	stream->escaped = false;
+	stream->len = 0;
+	return stream_put(stream, &c, 1);
+}
+
+static bool stream_value_start(JsonStream *stream, char c)
+{
+	if (c == '"')
+		return stream_start_token(stream, TOKEN_STRING, c);
+	if (c == '-' || is_digit(c))
+		return stream_start_token(stream, TOKEN_NUMBER, c);
+	if (is_literal_char(c))
+		return stream_start_token(stream, TOKEN_LITERAL, c);
+	if (c == '[' || c == '{')
+		return stream_open(stream, c);
+	return stream_fail(stream, "Value expected");
+}
+
+/* Handle a byte which is not part of a token */
+static bool stream_structure(JsonStream *stream, char c)
+{
+	if (is_space(c))
+		return true;
+	
+	switch (stream->state) {
+		case STREAM_VALUE_OR_CLOSE:
+			if (c == ']')
+				return stream_close(stream, c);
+			/* fallthrough */
+		case STREAM_VALUE:
+			return stream_value_start(stream, c);
+		
+		case STREAM_KEY_OR_CLOSE:
+			if (c == '}')
+				return stream_close(stream, c);
+			/* fallthrough */
+		case STREAM_KEY:
+			if (c == '"')
+				return stream_start_token(stream, TOKEN_KEY, c);
+			return stream_fail(stream, "Member name expected");
+		
+		case STREAM_COLON:
+			if (c != ':')
+				return stream_fail(stream, "':' expected");
+			stream->state = STREAM_VALUE;
+			return true;
+		
+		case STREAM_COMMA_OR_CLOSE:
+			if (c == ',') {
+				stream->state = stream->stack[stream->depth - 1] == '[' ? STREAM_VALUE : STREAM_KEY;
+				return true;
+			}
+			if (c == ']' || c == '}')
+				return stream_close(stream, c);
+			return stream_fail(stream, "',' or closing bracket expected");
+		
+		case STREAM_DONE:
+			return stream_fail(stream, "Trailing data after value");
+		
+		default:
+			return false;
+	}
+}
+
+bool json_stream_feed(JsonStream *stream, const char *data, size_t len)
+{
+    if (stream == NULL || (data == NULL && len > 0)) {
+        return false;
+    }
+
+	const char *s = data;
+	const char *end = data + len;
+	size_t base = stream->offset;
+	
+	if (stream->state == STREAM_FAILED)
+		return false;
+	
+	while (s < end) {
+		const char *start = s;
+		char c;
+		
+		switch (stream->token) {
+			case TOKEN_STRING:
+			case TOKEN_KEY:
+				/* Copy runs of ordinary characters in one go */
+				if (!stream->escaped) {
+					while (s < end && *s != '"' && *s != '\\')
+						s++;
+					if (!stream_put(stream, start, s - start))
+						goto failed;
+					if (s == end)
+						break;
+				}
+				
+				c = *s++;
+				if (!stream_put(stream, &c, 1))
+					goto failed;
+				
+				if (stream->escaped)
+					stream->escaped = false;
+				else if (c == '\\')
+					stream->escaped = true;
+				else if (!stream_finish_token(stream))
+					goto failed;
+				break;
+			
+			case TOKEN_NUMBER:
+			case TOKEN_LITERAL:
+				if (stream->token == TOKEN_NUMBER) {
+					while (s < end && is_number_char(*s))
+						s++;
+				} else {
+					while (s < end && is_literal_char(*s))
+						s++;
+				}
+				if (!stream_put(stream, start, s - start))
+					goto failed;
+				
+				/* The token ends at the first byte which can't belong to it */
+				if (s < end && !stream_finish_token(stream))
+					goto failed;
+				break;
+			
+			default:
+				if (!stream_structure(stream, *s))
+					goto failed;
+				s++;
+		}
+	}
+	
+	stream->offset = base + len;
+	return true;
+
+failed:
+	stream->offset = base + (s - data);
+	return false;
+}
+
+bool json_stream_finish(JsonStream *stream)
+{
+    if (stream == NULL) {
+        return false;
+    }
+
+	if (stream->state == STREAM_FAILED)
+		return false;
+	
+	/* Numbers and literals are only terminated by what follows them */
+	if ((stream->token == TOKEN_NUMBER || stream->token == TOKEN_LITERAL)
+	    && !stream_finish_token(stream))
+		return false;
+	
+	if (stream->state != STREAM_DONE || stream->token != TOKEN_NONE)
+		return stream_fail(stream, "Unexpected end of input");
+	
+	return true;
+}
+
+bool json_stream_parse_fd(JsonStream *stream, int fd)
+{
+    if (stream == NULL) {
+        return false;
+    }
+
+	char chunk[STREAM_CHUNK];
+	ssize_t count;
+	
+	for (;;) {
+		count = read(fd, chunk, sizeof(chunk));
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			return stream_fail(stream, "Read error");
+		}
+		if (count == 0)
+			break;
+		if (!json_stream_feed(stream, chunk, count))
+			return false;
+	}
+	
+	return json_stream_finish(stream);
+}
+
+static void emit_value(SB *out, const JsonNode *node)
+{
+	assert(tag_is_valid(node->tag));
+	switch (node->tag) {
+		case JSON_NULL:
+			sb_puts(out, "null");
+			break;
+		case JSON_BOOL:
+			sb_puts(out, node->bool_ ? "true" : "false");
+			break;
+		case JSON_STRING:
+			emit_string(out, node->string_);
+			break;
+		case JSON_NUMBER:
+			emit_number(out, node->number_);
+			break;
+		case JSON_ARRAY:
+			emit_array(out, node);
+			break;
+		case JSON_OBJECT:
+			emit_object(out, node);
+			break;
+		default:
+			assert(false);
+	}
+}
+
+void emit_value_indented(SB *out, const JsonNode *node, const char *space, int indent_level)
+{
+	assert(tag_is_valid(node->tag));
+	switch (node->tag) {
+		case JSON_NULL:
+			sb_puts(out, "null");
+			break;
+		case JSON_BOOL:
+			sb_puts(out, node->bool_ ? "true" : "false");
+			break;
+		case JSON_STRING:
+			emit_string(out, node->string_);
+			break;
+		case JSON_NUMBER:
+			emit_number(out, node->number_);
+			break;
+		case JSON_ARRAY:
+			emit_array_indented(out, node, space, indent_level);
+			break;
+		case JSON_OBJECT:
+			emit_object_indented(out, node, space, indent_level);
+			break;
+		default:
+			assert(false);
+	}
+}
+
+static void emit_array(SB *out, const JsonNode *array)
+{
+	const JsonNode *element;
+	
+	sb_putc(out, '[');
+	json_foreach(element, array) {
+		emit_value(out, element);
+		if (element->next != NULL)
+			sb_putc(out, ',');
+	}
+	sb_putc(out, ']');
+}
+
+static void emit_array_indented(SB *out, const JsonNode *array, const char *space, int indent_level)
+{
+	const JsonNode *element = array->children.head;
+	int i;
+	
+	if (element == NULL) {
+		sb_puts(out, "[]");
+		return;
+	}
+	
+	sb_puts(out, "[\n");
+	while (element != NULL) {
+		for (i = 0; i < indent_level + 1; i++)
+			sb_puts(out, space);
+		emit_value_indented(out, element, space, indent_level + 1);
+		
+		element = element->next;
+		sb_puts(out, element != NULL ? ",\n" : "\n");
+	}
+	for (i = 0; i < indent_level; i++)
+		sb_puts(out, space);
+	sb_putc(out, ']');
+}
+
+static void emit_object(SB *out, const JsonNode *object)
+{
+	const JsonNode *member;
+	
+	sb_putc(out, '{');
+	json_foreach(member, object) {
+		emit_string(out, member->key);
+		sb_putc(out, ':');
+		emit_value(out, member);
+		if (member->next != NULL)
+			sb_putc(out, ',');
+	}
+	sb_putc(out, '}');
+}
+
+static void emit_object_indented(SB *out, const JsonNode *object, const char *space, int indent_level)
+{
+	const JsonNode *member = object->children.head;
+	int i;
+	
+	if (member == NULL) {
+		sb_puts(out, "{}");
+		return;
+	}
+	
+	sb_puts(out, "{\n");
+	while (member != NULL) {
+		for (i = 0; i < indent_level + 1; i++)
+			sb_puts(out, space);
+		emit_string(out, member->key);
+		sb_puts(out, ": ");
+		emit_value_indented(out, member, space, indent_level + 1);
+		
+		member = member->next;
+		sb_puts(out, member != NULL ? ",\n" : "\n");
+	}
+	for (i = 0; i < indent_level; i++)
+		sb_puts(out, space);
+	sb_putc(out, '}');
+}
+
+/*
+ * Encode the character at *sp, advancing *sp past it.
+ * Writes at most 12 bytes (two \uXXXX escapes) to b, and returns how many.
+ */
+static int encode_char(const char **sp, char *b, bool escape_unicode)
+{
+	const char *s = *sp;
+	char *start = b;
+	unsigned char c = *s++;
+	
+	/* Encode the next character, and write it to b. */
+	switch (c) {
+		case '"':
+			*b++ = '\\';
+			*b++ = '"';
+			break;
+		case '\\':
+			*b++ = '\\';
+			*b++ = '\\';
+			break;
+		case '\b':
+			*b++ = '\\';
+			*b++ = 'b';
+			break;
+		case '\f':
+			*b++ = '\\';
+			*b++ = 'f';
+			break;
+		case '\n':
+			*b++ = '\\';
+			*b++ = 'n';
+			break;
+		case '\r':
+			*b++ = '\\';
+			*b++ = 'r';
+			break;
+		case '\t':
+			*b++ = '\\';
+			*b++ = 't';
+			break;
+		default: {
+			int len;
+			
+			s--;
+			len = utf8_validate_cz(s);
+			
+			if (len == 0) {
+				/*
+				 * Handle invalid UTF-8 character gracefully in production
+				 * by writing a replacement character (U+FFFD)
+				 * and skipping a single byte.
+				 *
+				 * This should never happen when assertions are enabled
+				 * due to the assertion at the beginning of this function.
+				 */
+				assert(false);
+				if (escape_unicode) {
+					strcpy(b, "\\uFFFD");
+					b += 6;
+				} else {
+					*b++ = 0xEF;
+					*b++ = 0xBF;
+					*b++ = 0xBD;
+				}
+				s++;
+			} else if (c <= 0x1F || (c >= 0x80 && escape_unicode)) {
+				/* Encode using \u.... */
+				uint32_t unicode;
+				
+				s += utf8_read_char(s, &unicode);
+				
+				if (unicode <= 0xFFFF) {
+					*b++ = '\\';
+					*b++ = 'u';
+					b += write_hex16(b, unicode);
+				} else {
+					/* Produce a surrogate pair. */
+					uint16_t uc, lc;
+					assert(unicode <= 0x10FFFF);
+					to_surrogate_pair(unicode, &uc, &lc);
+					*b++ = '\\';
+					*b++ = 'u';
+					b += write_hex16(b, uc);
+					*b++ = '\\';
+					*b++ = 'u';
+					b += write_hex16(b, lc);
+				}
+			} else {
+				/* Write the character directly. */
+				while (len--)
+					*b++ = *s++;
+			}
+			
+			break;
+		}
+	}
+
+	*sp = s;
+	return b - start;
+}
+
+void emit_string(SB *out, const char *str)
+{
+	bool escape_unicode = false;
+	const char *s = str;
+	char *b;
+	
+	assert(utf8_validate(str));
+	
+	/*
+	 * 14 bytes is enough space to write up to two
+	 * \uXXXX escapes and two quotation marks.
+	 */
+	sb_need(out, 14);
+	b = out->cur;
+	
+	*b++ = '"';
+	while (*s != 0) {
+		size_t run = span_plain(s);
+		
+		/* Plain ASCII needs no escaping, and is copied in runs */
+		if (run > 0) {
+			out->cur = b;
+			sb_need(out, (int) run + 14);
+			if (out->failed)
+				return;
+			b = out->cur;
+			memcpy(b, s, run);
+			b += run;
+			s += run;
+			if (*s == 0)
+				break;
+		}
+		
+		b += encode_char(&s, b, escape_unicode);
+		
+		/*
+		 * Update *out to know about the new bytes,
+		 * and set up b to write another encoded character.
+		 */
+		out->cur = b;
+		sb_need(out, 14);
+		b = out->cur;
+	}
+	*b++ = '"';
+	
+	out->cur = b;
+}
+
+/*
+ * Number formatting
+ *
+ * Doubles are printed with the fewest digits which read back as exactly the
+ * same value, using Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly
+ * and Accurately with Integers", 2010).  Grisu2 always round-trips, and gives
+ * the shortest digits for all but a tiny fraction of inputs.  Integers get a
+ * faster path of their own.
+ *
+ * The layout follows printf's %g, which is what was used before: exponent
+ * notation for exponents below -4 or from 16 up, and no trailing ".0".
+ */
+
+/* Large enough for "-1.2345678901234567e-308" */
+#define JSON_NUMBER_MAX 32
+
+typedef struct
+{
+	uint64_t f;
+	int e;
+} DiyFp;
+
+#define DP_SIGNIFICAND_SIZE 52
+#define DP_EXPONENT_BIAS (0x3FF + DP_SIGNIFICAND_SIZE)
+#define DP_HIDDEN_BIT UINT64_C(0x0010000000000000)
+#define DP_SIGNIFICAND_MASK UINT64_C(0x000FFFFFFFFFFFFF)
+
+/* 10^k for k = -348, -340, ..., 340, normalized to 64-bit significands */
+static const uint64_t cached_powers_f[] = {
+	UINT64_C(0xfa8fd5a0081c0288), UINT64_C(0xbaaee17fa23ebf76), UINT64_C(0x8b16fb203055ac76),
+	UINT64_C(0xcf42894a5dce35ea), UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0xe61acf033d1a45df),
+	UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0xff77b1fcbebcdc4f), UINT64_C(0xbe5691ef416bd60c),
+	UINT64_C(0x8dd01fad907ffc3c), UINT64_C(0xd3515c2831559a83), UINT64_C(0x9d71ac8fada6c9b5),
+	UINT64_C(0xea9c227723ee8bcb), UINT64_C(0xaecc49914078536d), UINT64_C(0x823c12795db6ce57),
+	UINT64_C(0xc21094364dfb5637), UINT64_C(0x9096ea6f3848984f), UINT64_C(0xd77485cb25823ac7),
+	UINT64_C(0xa086cfcd97bf97f4), UINT64_C(0xef340a98172aace5), UINT64_C(0xb23867fb2a35b28e),
+	UINT64_C(0x84c8d4dfd2c63f3b), UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x936b9fcebb25c996),
+	UINT64_C(0xdbac6c247d62a584), UINT64_C(0xa3ab66580d5fdaf6), UINT64_C(0xf3e2f893dec3f126),
+	UINT64_C(0xb5b5ada8aaff80b8), UINT64_C(0x87625f056c7c4a8b), UINT64_C(0xc9bcff6034c13053),
+	UINT64_C(0x964e858c91ba2655), UINT64_C(0xdff9772470297ebd), UINT64_C(0xa6dfbd9fb8e5b88f),
+	UINT64_C(0xf8a95fcf88747d94), UINT64_C(0xb94470938fa89bcf), UINT64_C(0x8a08f0f8bf0f156b),
+	UINT64_C(0xcdb02555653131b6), UINT64_C(0x993fe2c6d07b7fac), UINT64_C(0xe45c10c42a2b3b06),
+	UINT64_C(0xaa242499697392d3), UINT64_C(0xfd87b5f28300ca0e), UINT64_C(0xbce5086492111aeb),
+	UINT64_C(0x8cbccc096f5088cc), UINT64_C(0xd1b71758e219652c), UINT64_C(0x9c40000000000000),
+	UINT64_C(0xe8d4a51000000000), UINT64_C(0xad78ebc5ac620000), UINT64_C(0x813f3978f8940984),
+	UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x8f7e32ce7bea5c70), UINT64_C(0xd5d238a4abe98068),
+	UINT64_C(0x9f4f2726179a2245), UINT64_C(0xed63a231d4c4fb27), UINT64_C(0xb0de65388cc8ada8),
+	UINT64_C(0x83c7088e1aab65db), UINT64_C(0xc45d1df942711d9a), UINT64_C(0x924d692ca61be758),
+	UINT64_C(0xda01ee641a708dea), UINT64_C(0xa26da3999aef774a), UINT64_C(0xf209787bb47d6b85),
+	UINT64_C(0xb454e4a179dd1877), UINT64_C(0x865b86925b9bc5c2), UINT64_C(0xc83553c5c8965d3d),
+	UINT64_C(0x952ab45cfa97a0b3), UINT64_C(0xde469fbd99a05fe3), UINT64_C(0xa59bc234db398c25),
+	UINT64_C(0xf6c69a72a3989f5c), UINT64_C(0xb7dcbf5354e9bece), UINT64_C(0x88fcf317f22241e2),
+	UINT64_C(0xcc20ce9bd35c78a5), UINT64_C(0x98165af37b2153df), UINT64_C(0xe2a0b5dc971f303a),
+	UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0xfb9b7cd9a4a7443c), UINT64_C(0xbb764c4ca7a44410),
+	UINT64_C(0x8bab8eefb6409c1a), UINT64_C(0xd01fef10a657842c), UINT64_C(0x9b10a4e5e9913129),
+	UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0xac2820d9623bf429), UINT64_C(0x80444b5e7aa7cf85),
+	UINT64_C(0xbf21e44003acdd2d), UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0xd433179d9c8cb841),
+	UINT64_C(0x9e19db92b4e31ba9), UINT64_C(0xeb96bf6ebadf77d9), UINT64_C(0xaf87023b9bf0ee6b)
+};
+
+static const int16_t cached_powers_e[] = {
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+	-954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+	-688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+	-422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+	-157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+	109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+	641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+	907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static const uint64_t pow10_u64[] = {
+	UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+	UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+	UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+	UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+	UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+	UINT64_C(100000000000000000), UINT64_C(1000000000000000000),
+	UINT64_C(10000000000000000000)
+};
+
+static uint64_t double_bits(double d)
+{
+	uint64_t u;
+	memcpy(&u, &d, sizeof(u));
+	return u;
+}
+
+static DiyFp diyfp_from_double(double d)
+{
+	uint64_t u = double_bits(d);
+	int biased_e = (int) ((u >> DP_SIGNIFICAND_SIZE) & 0x7FF);
+	DiyFp ret;
+	
+	ret.f = u & DP_SIGNIFICAND_MASK;
+	if (biased_e != 0) {
+		ret.f += DP_HIDDEN_BIT;
+		ret.e = biased_e - DP_EXPONENT_BIAS;
+	} else {
+		ret.e = 1 - DP_EXPONENT_BIAS;
+	}
+	return ret;
+}
+
+/* 64x64 multiply keeping the rounded high half, without needing 128-bit types */
+static DiyFp diyfp_mul(DiyFp x, DiyFp y)
+{
+	const uint64_t M32 = 0xFFFFFFFFu;
+	uint64_t a = x.f >> 32, b = x.f & M32;
+	uint64_t c = y.f >> 32, d = y.f & M32;
+	uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+	DiyFp ret;
+	
+	tmp += UINT64_C(1) << 31;
+	ret.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+	ret.e = x.e + y.e + 64;
+	return ret;
+}
+
+static DiyFp diyfp_normalize(DiyFp x)
+{
+	while (!(x.f & (UINT64_C(1) << 63))) {
+		x.f <<= 1;
+		x.e--;
+	}
+	return x;
+}
+
+/* Boundaries of the interval which rounds to the same double */
+static void diyfp_boundaries(DiyFp v, DiyFp *minus, DiyFp *plus)
+{
+	DiyFp pl, mi;
+	
+	pl.f = (v.f << 1) + 1;
+	pl.e = v.e - 1;
+	pl = diyfp_normalize(pl);
+	
+	if (v.f == DP_HIDDEN_BIT) {
+		mi.f = (v.f << 2) - 1;
+		mi.e = v.e - 2;
+	} else {
+		mi.f = (v.f << 1) - 1;
+		mi.e = v.e - 1;
+	}
+	mi.f <<= mi.e - pl.e;
+	mi.e = pl.e;
+	
+	*minus = mi;
+	*plus = pl;
+}
+
+static DiyFp cached_power(int e, int *K)
+{
+	double dk = (-61 - e) * 0.30102999566398114 + 347;
+	int k = (int) dk;
+	unsigned int index;
+	DiyFp ret;
+	
+	if (k != dk)
+		k++;
+	
+	index = (unsigned int) ((k >> 3) + 1);
+	*K = -(-348 + (int) (index << 3));
+	
+	ret.f = cached_powers_f[index];
+	ret.e = cached_powers_e[index];
+	return ret;
+}
+
+static void grisu_round(char *buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+	while (rest < wp_w && delta - rest >= ten_kappa &&
+	       (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+		buffer[len - 1]--;
+		rest += ten_kappa;
+	}
+}
+
+static int count_digits32(uint32_t n)
+{
+	int digits = 1;
+	
+	while (n >= 10) {
+		n /= 10;
+		digits++;
+	}
+	return digits;
+}
+
+static void digit_gen(DiyFp W, DiyFp Mp, uint64_t delta, char *buffer, int *len, int *K)
+{
+	DiyFp one;
+	uint64_t wp_w = Mp.f - W.f;
+	uint32_t p1;
+	uint64_t p2;
+	int kappa;
+	
+	one.f = UINT64_C(1) << -Mp.e;
+	one.e = Mp.e;
+	p1 = (uint32_t) (Mp.f >> -one.e);
+	p2 = Mp.f & (one.f - 1);
+	kappa = count_digits32(p1);
+	*len = 0;
+	
+	while (kappa > 0) {
+		uint32_t div = (uint32_t) pow10_u64[kappa - 1];
+		uint32_t d = p1 / div;
+		uint64_t tmp;
+		
+		p1 %= div;
+		if (d != 0 || *len != 0)
+			buffer[(*len)++] = (char) ('0' + d);
+		kappa--;
+		
+		tmp = ((uint64_t) p1 << -one.e) + p2;
+		if (tmp <= delta) {
+			*K += kappa;
+			grisu_round(buffer, *len, delta, tmp, pow10_u64[kappa] << -one.e, wp_w);
+			return;
+		}
+	}
+	
+	for (;;) {
+		char d;
+		
+		p2 *= 10;
+		delta *= 10;
+		d = (char) (p2 >> -one.e);
+		if (d != 0 || *len != 0)
+			buffer[(*len)++] = (char) ('0' + d);
+		p2 &= one.f - 1;
+		kappa--;
+		
+		if (p2 < delta) {
+			*K += kappa;
+			grisu_round(buffer, *len, delta, p2, one.f,
+			            -kappa < 20 ? wp_w * pow10_u64[-kappa] : 0);
+			return;
+		}
+	}
+}
+
+/* Shortest digits of a finite, positive double: value = digits * 10^K */
+static int grisu2(double value, char *digits, int *K)
+{
+	DiyFp v = diyfp_from_double(value);
+	DiyFp w_m, w_p, c_mk, W, Wp, Wm;
+	int len;
+	
+	diyfp_boundaries(v, &w_m, &w_p);
+	c_mk = cached_power(w_p.e, K);
+	W = diyfp_mul(diyfp_normalize(v), c_mk);
+	Wp = diyfp_mul(w_p, c_mk);
+	Wm = diyfp_mul(w_m, c_mk);
+	Wm.f++;
+	Wp.f--;
+	
+	digit_gen(W, Wp, Wp.f - Wm.f, digits, &len, K);
+	return len;
+}
+
+static int format_uint(char *buf, uint64_t n)
+{
+	char tmp[20];
+	int len = 0, i;
+	
+	do {
+		tmp[len++] = (char) ('0' + n % 10);
+		n /= 10;
+	} while (n != 0);
+	
+	for (i = 0; i < len; i++)
+		buf[i] = tmp[len - 1 - i];
+	return len;
+}
+
+/* buf must have room for at least JSON_NUMBER_MAX bytes */
+static int format_number(char *buf, double num)
+{
+	char digits[20];
+	char *b = buf;
+	int len, K, exp10, i;
+	
+	/* NaN and infinity have no JSON representation */
+	if (num != num || num - num != 0) {
+		strcpy(buf, "null");
+		return 4;
+	}
+	
+	if (double_bits(num) >> 63) {
+		*b++ = '-';
+		num = -num;
+	}
+	
+	/* Integers which are exact in a double print as themselves */
+	if (num < 9007199254740992.0 && num == (double) (uint64_t) num) {
+		b += format_uint(b, (uint64_t) num);
+		*b = 0;
+		return b - buf;
+	}
+	
+	len = grisu2(num, digits, &K);
+	exp10 = len + K - 1;            /* exponent in d.ddd x 10^exp10 */
+	
+	if (exp10 < -4 || exp10 >= 16) {
+		*b++ = digits[0];
+		if (len > 1) {
+			*b++ = '.';
+			memcpy(b, digits + 1, len - 1);
+			b += len - 1;
+		}
+		*b++ = 'e';
+		*b++ = exp10 < 0 ? '-' : '+';
+		if (exp10 < 0)
+			exp10 = -exp10;
+		if (exp10 < 10)
+			*b++ = '0';
+		b += format_uint(b, (uint64_t) exp10);
+	} else if (exp10 >= 0) {
+		/* Point inside the digits, or zeros to pad out an integer */
+		for (i = 0; i < len || i <= exp10; i++) {
+			if (i == exp10 + 1)
+				*b++ = '.';
+			*b++ = i < len ? digits[i] : '0';
+		}
+	} else {
+		*b++ = '0';
+		*b++ = '.';
+		for (i = -1; i > exp10; i--)
+			*b++ = '0';
+		memcpy(b, digits, len);
+		b += len;
+	}
+	
+	*b = 0;
+	return b - buf;
+}
+
+static void emit_number(SB *out, double num)
+{
+	char buf[JSON_NUMBER_MAX];
+	
+	sb_put(out, buf, format_number(buf, num));
+}
+
+/*
+ * Streaming writer
+ *
+ * The writer keeps one bit per nesting level saying whether that level
+ * already has a value (and so needs a comma before the next one), and one
+ * saying whether it is an object.
+ */
+
+#define level_bit(depth) (1UL << (depth))
+
+static void writer_fail(JsonWriter *w)
+{
+	w->failed = true;
+}
+
+static void writer_flush(JsonWriter *w)
+{
+	const char *s = w->buf;
+	
+	while (w->len > 0) {
+		ssize_t count = write(w->fd, s, w->len);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			writer_fail(w);
+			return;
+		}
+		s += count;
+		w->len -= count;
+		w->flushed += count;
+	}
+}
+
+static void writer_put(JsonWriter *w, const char *bytes, size_t count)
+{
+	if (w->failed)
+		return;
+	
+	if (w->fd < 0) {
+		/* Always leave room for the terminator */
+		if (count >= w->size - w->len) {
+			writer_fail(w);
+			return;
+		}
+		memcpy(w->buf + w->len, bytes, count);
+		w->len += count;
+		return;
+	}
+	
+	while (count > 0 && !w->failed) {
+		size_t space = w->size - w->len;
+		
+		if (space == 0) {
+			writer_flush(w);
+			continue;
+		}
+		if (space > count)
+			space = count;
+		
+		memcpy(w->buf + w->len, bytes, space);
+		w->len += space;
+		bytes += space;
+		count -= space;
+	}
+}
+
+static void writer_putc(JsonWriter *w, char c)
+{
+	writer_put(w, &c, 1);
+}
+
+static void writer_string(JsonWriter *w, const char *str)
+{
+	const char *s = str;
+	
+	writer_putc(w, '"');
+	
+	while (*s != 0 && !w->failed) {
+		size_t run = span_plain(s);
+		unsigned char c;
+		
+		/* Plain ASCII needs no escaping, and is copied in runs */
+		writer_put(w, s, run);
+		s += run;
+		c = *s;
+		
+		if (c == 0) {
+			break;
+		} else if (c >= 0x80) {
+			int len = utf8_validate_cz(s);
+			
+			if (len == 0) {
+				writer_fail(w);
+				return;
+			}
+			writer_put(w, s, len);
+			s += len;
+		} else {
+			char buf[12];
+			writer_put(w, buf, encode_char(&s, buf, false));
+		}
+	}
+	
+	writer_putc(w, '"');
+}
+
+/* Comma and bookkeeping before a value */
+static bool writer_value(JsonWriter *w)
+{
+	if (w->failed)
+		return false;
+	
+	if (w->depth > 0 && (w->objects & level_bit(w->depth))) {
+		/* The comma went out with the key */
+		if (!w->have_key) {
+			writer_fail(w);
+			return false;
+		}
+		w->have_key = false;
+		return true;
+	}
+	
+	if (w->need_comma & level_bit(w->depth)) {
+		/* Only one value is allowed at the top level */
+		if (w->depth == 0) {
+			writer_fail(w);
+			return false;
+		}
+		writer_putc(w, ',');
+	}
+	w->need_comma |= level_bit(w->depth);
+	return true;
+}
+
+static void writer_begin(JsonWriter *w, char c)
+{
+	if (!writer_value(w))
+		return;
+	
+	if (w->depth == JSON_WRITER_MAX_DEPTH) {
+		writer_fail(w);
+		return;
+	}
+	
+	writer_putc(w, c);
+	w->depth++;
+	w->need_comma &= ~level_bit(w->depth);
+	if (c == '{')
+		w->objects |= level_bit(w->depth);
+	else
+		w->objects &= ~level_bit(w->depth);
+}
+
+static void writer_end(JsonWriter *w, char c)
+{
+	bool object = c == '}';
+	
+	if (w->failed)
+		return;
+	
+	if (w->depth == 0 || w->have_key
+	    || ((w->objects & level_bit(w->depth)) != 0) != object) {
+		writer_fail(w);
+		return;
+	}
+	
+	writer_putc(w, c);
+	w->depth--;
+}
+
+void json_writer_init(JsonWriter *w, char *buf, size_t size)
+{
+    if (w == NULL) {
+        return;
+    }
+
+	memset(w, 0, sizeof(*w));
+	w->buf = buf;
+	w->size = size;
+	w->fd = -1;
+	
+	if (buf == NULL || size == 0)
+		writer_fail(w);
+	else
+		buf[0] = 0;
+}
+
+void json_writer_init_fd(JsonWriter *w, int fd, char *buf, size_t size)
+{
+    if (w == NULL) {
+        return;
+    }
+
+	memset(w, 0, sizeof(*w));
+	w->buf = buf;
+	w->size = size;
+	w->fd = fd;
+	
+	if (buf == NULL || size == 0 || fd < 0)
+		writer_fail(w);
+}
+
+void json_writer_begin_object(JsonWriter *w)
+{
+	if (w != NULL)
+		writer_begin(w, '{');
+}
+
+void json_writer_end_object(JsonWriter *w)
+{
+	if (w != NULL)
+		writer_end(w, '}');
+}
+
+void json_writer_begin_array(JsonWriter *w)
+{
+	if (w != NULL)
+		writer_begin(w, '[');
+}
+
+void json_writer_end_array(JsonWriter *w)
+{
+	if (w != NULL)
+		writer_end(w, ']');
+}
+
+void json_writer_key(JsonWriter *w, const char *key)
+{
+    if (w == NULL || key == NULL) {
+        return;
+    }
+
+	if (w->failed)
+		return;
+	
+	if (w->depth == 0 || !(w->objects & level_bit(w->depth)) || w->have_key) {
+		writer_fail(w);
+		return;
+	}
+	
+	if (w->need_comma & level_bit(w->depth))
+		writer_putc(w, ',');
+	w->need_comma |= level_bit(w->depth);
+	
+	writer_string(w, key);
+	writer_putc(w, ':');
+	w->have_key = true;
+}
+
+void json_writer_null(JsonWriter *w)
+{
+	if (w != NULL && writer_value(w))
+		writer_put(w, "null", 4);
+}
+
+void json_writer_bool(JsonWriter *w, bool b)
+{
+	if (w == NULL || !writer_value(w))
+		return;
+	
+	if (b)
+		writer_put(w, "true", 4);
+	else
+		writer_put(w, "false", 5);
+}
+
+void json_writer_string(JsonWriter *w, const char *str)
+{
+    if (w == NULL) {
+        return;
+    }
+
+	if (str == NULL) {
+		writer_fail(w);
+		return;
+	}
+	
+	if (writer_value(w))
+		writer_string(w, str);
+}
+
+void json_writer_number(JsonWriter *w, double n)
+{
+	char buf[JSON_NUMBER_MAX];
+	
+	if (w != NULL && writer_value(w))
+		writer_put(w, buf, format_number(buf, n));
+}
+
+bool json_writer_finish(JsonWriter *w)
+{
+    if (w == NULL) {
+        return false;
+    }
+
+	/* Exactly one complete value must have been written */
+	if (w->depth != 0 || !(w->need_comma & level_bit(0)))
+		writer_fail(w);
+	
+	if (w->failed)
+		return false;
+	
+	if (w->fd < 0)
+		w->buf[w->len] = 0;
+	else
+		writer_flush(w);
+	
+	return !w->failed;
+}
+
+size_t json_writer_length(const JsonWriter *w)
+{
+    if (w == NULL) {
+        return 0;
+    }
+
+	return w->flushed + w->len;
+}
+
+/*
+ * Binary encoding
+ *
+ * Every item starts with a byte whose top three bits are its type, and whose
+ * low five bits are a count or value n:
+ *
+ *   0  simple   n is 0 null, 1 false, 2 true, 3 float32, 4 float64; floats
+ *               follow as little-endian IEEE 754
+ *   1  uint     the integer n
+ *   2  nint     the integer -1 - n
+ *   3  string   n bytes of UTF-8 follow
+ *   4  array    n items follow
+ *   5  object   n members follow, each a key (a string or keyref) and an item
+ *   6  keyref   in place of a key: the n'th distinct key in the document
+ *
+ * n is stored in the low five bits when it is below 31.  Otherwise they hold
+ * 31, and n - 31 follows as an unsigned LEB128 varint.  Keys are numbered
+ * from 0 in the order they are first written out as strings.
+ */
+
+enum {
+	BIN_SIMPLE,
+	BIN_UINT,
+	BIN_NINT,
+	BIN_STRING,
+	BIN_ARRAY,
+	BIN_OBJECT,
+	BIN_KEYREF,
+};
+
+enum {
+	BIN_NULL,
+	BIN_FALSE,
+	BIN_TRUE,
+	BIN_FLOAT32,
+	BIN_FLOAT64,
+};
+
+#define BIN_EXTENDED 31
+
+/* Maps keys already written to their numbers */
+typedef struct
+{
+	uint32_t hash;
+	uint32_t id;            /* 0 marks an empty slot, otherwise key number + 1 */
+} BinKeySlot;
+
+typedef struct
+{
+	BinKeySlot *slots;      /* open addressing, at most half full */
+	size_t mask;
+	const char **keys;      /* by number */
+	uint32_t count;
+	bool failed;            /* ran out of memory */
+} BinKeys;
+
+#define BIN_KEYS_INITIAL 256
+
+/* Every key gets hashed, so this takes a word at a time rather than a byte */
+static uint32_t bin_hash(const char *key, size_t len)
+{
+	uint64_t h = len * UINT64_C(0x9E3779B97F4A7C15);
+	uint64_t word = 0;
+	size_t i;
+	
+	if (len < 8) {
+		for (i = 0; i < len; i++)
+			word |= (uint64_t) (unsigned char) key[i] << (8 * i);
+		h = (h ^ word) * UINT64_C(0xFF51AFD7ED558CCD);
+		return (uint32_t) (h ^ (h >> 32));
+	}
+	
+	/* Whole words, then the last eight bytes (overlapping) for any remainder */
+	for (i = 0; i + 8 <= len; i += 8) {
+		memcpy(&word, key + i, 8);
+		h = (h ^ word) * UINT64_C(0xFF51AFD7ED558CCD);
+		h ^= h >> 32;
+	}
+	if (i < len) {
+		memcpy(&word, key + len - 8, 8);
+		h = (h ^ word) * UINT64_C(0xFF51AFD7ED558CCD);
+		h ^= h >> 32;
+	}
+	return (uint32_t) h;
+}
+
+static bool bin_keys_grow(BinKeys *t)
+{
+	size_t size = t->slots ? (t->mask + 1) * 2 : BIN_KEYS_INITIAL;
+	BinKeySlot *slots = (BinKeySlot*) calloc(size, sizeof(*slots));
+	const char **keys = (const char**) realloc(t->keys, size / 2 * sizeof(*keys));
+	size_t i, j;
+	
+	if (keys != NULL)
+		t->keys = keys;
+	if (slots == NULL || keys == NULL) {
+		free(slots);
+		return false;
+	}
+	
+	for (i = 0; t->slots && i <= t->mask; i++) {
+		if (t->slots[i].id != 0) {
+			for (j = t->slots[i].hash & (size - 1); slots[j].id != 0; j = (j + 1) & (size - 1))
+				;
+			slots[j] = t->slots[i];
+		}
+	}
+	
+	free(t->slots);
+	t->slots = slots;
+	t->mask = size - 1;
+	return true;
+}
+
+static void bin_keys_free(BinKeys *t)
+{
+	free(t->slots);
+	free(t->keys);
+}
+
+/*
+ * Returns true with the key's number if it was seen before, and numbers it if
+ * not.  Running out of memory for the table sets failed.
+ */
+static bool bin_keys_lookup(BinKeys *t, const char *key, size_t len, uint32_t *id)
+{
+	uint32_t hash = bin_hash(key, len);
+	size_t i;
+	
+	if ((t->slots == NULL || (t->count + 1) * 2 > t->mask + 1) && !bin_keys_grow(t)) {
+		t->failed = true;
+		return false;
+	}
+	
+	for (i = hash & t->mask; t->slots[i].id != 0; i = (i + 1) & t->mask) {
+		BinKeySlot *slot = &t->slots[i];
+		
+		if (slot->hash == hash && strcmp(t->keys[slot->id - 1], key) == 0) {
+			*id = slot->id - 1;
+			return true;
+		}
+	}
+	
+	t->keys[t->count] = key;
+	t->slots[i].hash = hash;
+	t->slots[i].id = ++t->count;
+	return false;
+}
+
+static void bin_put_head(SB *out, int type, uint64_t n)
+{
+	if (n < BIN_EXTENDED) {
+		sb_putc(out, (char) (type << 5 | (int) n));
+		return;
+	}
+	
+	sb_putc(out, (char) (type << 5 | BIN_EXTENDED));
+	for (n -= BIN_EXTENDED; n >= 0x80; n >>= 7)
+		sb_putc(out, (char) (n | 0x80));
+	sb_putc(out, (char) n);
+}
+
+static void bin_put_le(SB *out, uint64_t bits, int bytes)
+{
+	int i;
+	
+	for (i = 0; i < bytes; i++, bits >>= 8)
+		sb_putc(out, (char) (bits & 0xFF));
+}
 
-	*sp = s;
-	return true;
+static void bin_emit_number(SB *out, double num)
+{
+	double mag = num < 0 ? -num : num;
+	float f;
+	uint32_t f_bits;
+	
+	/* Integers, other than -0, which fit in 64 bits */
+	if (mag < 18446744073709551616.0 && (double) (uint64_t) mag == mag && !(double_bits(num) >> 63)) {
+		bin_put_head(out, BIN_UINT, (uint64_t) mag);
+		return;
+	}
+	if (mag < 18446744073709551616.0 && (double) (uint64_t) mag == mag && mag >= 1) {
+		bin_put_head(out, BIN_NINT, (uint64_t) mag - 1);
+		return;
+	}
+	
+	/* Converting to float is only defined inside its range (or for inf/NaN) */
+	if (mag <= 3.4028234663852886e+38 || mag - mag != 0) {
+		f = (float) num;
+		if ((double) f == num) {
+			memcpy(&f_bits, &f, sizeof(f_bits));
+			bin_put_head(out, BIN_SIMPLE, BIN_FLOAT32);
+			bin_put_le(out, f_bits, 4);
+			return;
+		}
+	}
+	
+	bin_put_head(out, BIN_SIMPLE, BIN_FLOAT64);
+	bin_put_le(out, double_bits(num), 8);
 }
 
-static void skip_space(const char **sp)
+static void bin_emit_string(SB *out, const char *str, size_t len)
 {
-	const char *s = *sp;
-	while (is_space(*s))
-		s++;
-	*sp = s;
+	bin_put_head(out, BIN_STRING, len);
+	sb_put(out, str, (int) len);
 }
 
-static void emit_value(SB *out, const JsonNode *node)
+static bool bin_emit(SB *out, BinKeys *keys, const JsonNode *node)
 {
-	assert(tag_is_valid(node->tag));
+	const JsonNode *child;
+	size_t count = 0;
+	uint32_t id;
+	
 	switch (node->tag) {
 		case JSON_NULL:
-			sb_puts(out, "null");
-			break;
+			bin_put_head(out, BIN_SIMPLE, BIN_NULL);
+			return true;
 		case JSON_BOOL:
-			sb_puts(out, node->bool_ ? "true" : "false");
-			break;
+			bin_put_head(out, BIN_SIMPLE, node->bool_ ? BIN_TRUE : BIN_FALSE);
+			return true;
 		case JSON_STRING:
-			emit_string(out, node->string_);
-			break;
+			bin_emit_string(out, node->string_, strlen(node->string_));
+			return true;
 		case JSON_NUMBER:
-			emit_number(out, node->number_);
-			break;
+			bin_emit_number(out, node->number_);
+			return true;
 		case JSON_ARRAY:
-			emit_array(out, node);
-			break;
 		case JSON_OBJECT:
-			emit_object(out, node);
-			break;
+			json_foreach(child, node)
+				count++;
+			bin_put_head(out, node->tag == JSON_ARRAY ? BIN_ARRAY : BIN_OBJECT, count);
+			
+			json_foreach(child, node) {
+				if (node->tag == JSON_OBJECT) {
+					size_t len;
+					
+					if (child->key == NULL)
+						return false;
+					len = strlen(child->key);
+					if (bin_keys_lookup(keys, child->key, len, &id))
+						bin_put_head(out, BIN_KEYREF, id);
+					else if (!keys->failed)
+						bin_emit_string(out, child->key, len);
+					else
+						return false;
+				}
+				if (!bin_emit(out, keys, child))
+					return false;
+			}
+			return true;
 		default:
-			assert(false);
+			return false;
 	}
 }
 
-void emit_value_indented(SB *out, const JsonNode *node, const char *space, int indent_level)
+unsigned char *json_encode_binary(const JsonNode *node, size_t *len)
 {
-	assert(tag_is_valid(node->tag));
-	switch (node->tag) {
-		case JSON_NULL:
-			sb_puts(out, "null");
-			break;
-		case JSON_BOOL:
-			sb_puts(out, node->bool_ ? "true" : "false");
-			break;
-		case JSON_STRING:
-			emit_string(out, node->string_);
-			break;
-		case JSON_NUMBER:
-			emit_number(out, node->number_);
-			break;
-		case JSON_ARRAY:
-			emit_array_indented(out, node, space, indent_level);
-			break;
-		case JSON_OBJECT:
-			emit_object_indented(out, node, space, indent_level);
-			break;
-		default:
-			assert(false);
+	BinKeys keys = { 0 };
+	SB sb;
+	bool ok;
+	
+	if (node == NULL || len == NULL) {
+		return NULL;
+	}
+	
+	sb_init(&sb, NULL);
+	ok = bin_emit(&sb, &keys, node) && !sb.failed;
+	bin_keys_free(&keys);
+	
+	if (!ok) {
+		sb_free(&sb);
+		return NULL;
 	}
+	
+	*len = sb.cur - sb.start;
+	return (unsigned char*) sb.start;
 }
 
-static void emit_array(SB *out, const JsonNode *array)
+/* A key in the input, checked the first time it was read */
+typedef struct
 {
-	const JsonNode *element;
+	const unsigned char *str;
+	size_t len;
+} BinKey;
+
+typedef struct
+{
+	const unsigned char *s;
+	const unsigned char *end;
+	JsonArena *arena;
 	
-	sb_putc(out, '[');
-	json_foreach(element, array) {
-		emit_value(out, element);
-		if (element->next != NULL)
-			sb_putc(out, ',');
+	/* Keys seen so far, by number */
+	BinKey *keys;
+	size_t count;
+	size_t alloc;
+} BinReader;
+
+static bool bin_read_head(BinReader *r, int *type, uint64_t *n)
+{
+	uint64_t extra = 0;
+	int shift;
+	unsigned char c;
+	
+	if (r->s >= r->end)
+		return false;
+	c = *r->s++;
+	*type = c >> 5;
+	*n = c & 0x1F;
+	if (*n < BIN_EXTENDED)
+		return true;
+	
+	for (shift = 0; ; shift += 7) {
+		if (r->s >= r->end || shift > 63)
+			return false;
+		c = *r->s++;
+		extra |= (uint64_t) (c & 0x7F) << shift;
+		if (!(c & 0x80))
+			break;
 	}
-	sb_putc(out, ']');
+	
+	if (extra > UINT64_MAX - BIN_EXTENDED)
+		return false;
+	*n = extra + BIN_EXTENDED;
+	return true;
 }
 
-static void emit_array_indented(SB *out, const JsonNode *array, const char *space, int indent_level)
+static uint64_t bin_read_le(BinReader *r, int bytes)
 {
-	const JsonNode *element = array->children.head;
+	uint64_t bits = 0;
 	int i;
 	
-	if (element == NULL) {
-		sb_puts(out, "[]");
-		return;
-	}
+	for (i = 0; i < bytes; i++)
+		bits |= (uint64_t) *r->s++ << (8 * i);
+	return bits;
+}
+
+static char *bin_copy(JsonArena *arena, const unsigned char *str, size_t len)
+{
+	char *ret = (char*) json_alloc(arena, len + 1);
 	
-	sb_puts(out, "[\n");
-	while (element != NULL) {
-		for (i = 0; i < indent_level + 1; i++)
-			sb_puts(out, space);
-		emit_value_indented(out, element, space, indent_level + 1);
-		
-		element = element->next;
-		sb_puts(out, element != NULL ? ",\n" : "\n");
-	}
-	for (i = 0; i < indent_level; i++)
-		sb_puts(out, space);
-	sb_putc(out, ']');
+	if (ret == NULL)
+		return NULL;
+	memcpy(ret, str, len);
+	ret[len] = 0;
+	return ret;
 }
 
-static void emit_object(SB *out, const JsonNode *object)
+/* A copy of the next len bytes, if they are valid UTF-8 without a NUL */
+static char *bin_read_string(BinReader *r, uint64_t len)
 {
-	const JsonNode *member;
+	char *str;
 	
-	sb_putc(out, '{');
-	json_foreach(member, object) {
-		emit_string(out, member->key);
-		sb_putc(out, ':');
-		emit_value(out, member);
-		if (member->next != NULL)
-			sb_putc(out, ',');
+	if (len > (uint64_t) (r->end - r->s) || memchr(r->s, 0, len) != NULL)
+		return NULL;
+	
+	str = bin_copy(r->arena, r->s, len);
+	if (str == NULL)
+		return NULL;
+	if (!utf8_validate(str)) {
+		json_release(r->arena, str);
+		return NULL;
 	}
-	sb_putc(out, '}');
+	
+	r->s += len;
+	return str;
 }
 
-static void emit_object_indented(SB *out, const JsonNode *object, const char *space, int indent_level)
+static char *bin_read_key(BinReader *r)
 {
-	const JsonNode *member = object->children.head;
-	int i;
+	const unsigned char *start;
+	uint64_t n;
+	int type;
+	char *key;
 	
-	if (member == NULL) {
-		sb_puts(out, "{}");
-		return;
-	}
+	if (!bin_read_head(r, &type, &n))
+		return NULL;
 	
-	sb_puts(out, "{\n");
-	while (member != NULL) {
-		for (i = 0; i < indent_level + 1; i++)
-			sb_puts(out, space);
-		emit_string(out, member->key);
-		sb_puts(out, ": ");
-		emit_value_indented(out, member, space, indent_level + 1);
-		
-		member = member->next;
-		sb_puts(out, member != NULL ? ",\n" : "\n");
+	if (type == BIN_KEYREF)
+		return n < r->count ? bin_copy(r->arena, r->keys[n].str, r->keys[n].len) : NULL;
+	if (type != BIN_STRING)
+		return NULL;
+	
+	start = r->s;
+	key = bin_read_string(r, n);
+	if (key == NULL)
+		return NULL;
+	
+	if (r->count == r->alloc) {
+		size_t alloc = r->alloc ? r->alloc * 2 : 32;
+		BinKey *keys = (BinKey*) mem_realloc(r->arena, r->keys, r->alloc * sizeof(*r->keys),
+		                                     alloc * sizeof(*r->keys));
+		if (keys == NULL) {
+			json_release(r->arena, key);
+			return NULL;
+		}
+		r->keys = keys;
+		r->alloc = alloc;
 	}
-	for (i = 0; i < indent_level; i++)
-		sb_puts(out, space);
-	sb_putc(out, '}');
+	r->keys[r->count].str = start;
+	r->keys[r->count].len = n;
+	r->count++;
+	
+	return key;
 }
 
-void emit_string(SB *out, const char *str)
+static bool bin_read_value(BinReader *r, JsonNode **out)
 {
-	bool escape_unicode = false;
-	const char *s = str;
-	char *b;
-	
-	assert(utf8_validate(str));
+	JsonNode *ret = NULL;
+	JsonNode *child;
+	uint64_t n;
+	int type;
 	
-	/*
-	 * 14 bytes is enough space to write up to two
-	 * \uXXXX escapes and two quotation marks.
-	 */
-	sb_need(out, 14);
-	b = out->cur;
+	if (!bin_read_head(r, &type, &n))
+		return false;
 	
-	*b++ = '"';
-	while (*s != 0) {
-		unsigned char c = *s++;
+	switch (type) {
+		case BIN_SIMPLE:
+			if (n == BIN_NULL) {
+				ret = mknode(r->arena, JSON_NULL);
+			} else if (n == BIN_FALSE || n == BIN_TRUE) {
+				ret = json_mkbool_a(r->arena, n == BIN_TRUE);
+			} else if (n == BIN_FLOAT32 && r->end - r->s >= 4) {
+				uint32_t bits = (uint32_t) bin_read_le(r, 4);
+				float f;
+				memcpy(&f, &bits, sizeof(f));
+				ret = json_mknumber_a(r->arena, f);
+			} else if (n == BIN_FLOAT64 && r->end - r->s >= 8) {
+				uint64_t bits = bin_read_le(r, 8);
+				double d;
+				memcpy(&d, &bits, sizeof(d));
+				ret = json_mknumber_a(r->arena, d);
+			} else {
+				return false;
+			}
+			break;
 		
-		/* Encode the next character, and write it to b. */
-		switch (c) {
-			case '"':
-				*b++ = '\\';
-				*b++ = '"';
-				break;
-			case '\\':
-				*b++ = '\\';
-				*b++ = '\\';
-				break;
-			case '\b':
-				*b++ = '\\';
-				*b++ = 'b';
-				break;
-			case '\f':
-				*b++ = '\\';
-				*b++ = 'f';
-				break;
-			case '\n':
-				*b++ = '\\';
-				*b++ = 'n';
-				break;
-			case '\r':
-				*b++ = '\\';
-				*b++ = 'r';
-				break;
-			case '\t':
-				*b++ = '\\';
-				*b++ = 't';
-				break;
-			default: {
-				int len;
+		case BIN_UINT:
+			ret = json_mknumber_a(r->arena, (double) n);
+			break;
+		
+		case BIN_NINT:
+			/* n + 1 is what was encoded, so it converts exactly; -1.0 - n would round twice */
+			if (n == UINT64_MAX)
+				return false;
+			ret = json_mknumber_a(r->arena, -(double) (n + 1));
+			break;
+		
+		case BIN_STRING:
+		{
+			char *str = bin_read_string(r, n);
+			if (str == NULL)
+				return false;
+			ret = mkstring(r->arena, str);
+			break;
+		}
+		
+		case BIN_ARRAY:
+		case BIN_OBJECT:
+			ret = mknode(r->arena, type == BIN_ARRAY ? JSON_ARRAY : JSON_OBJECT);
+			if (ret == NULL)
+				return false;
+			
+			/* Every child takes at least a byte, so a bogus count can't spin for long */
+			for (; n > 0; n--) {
+				char *key = NULL;
 				
-				s--;
-				len = utf8_validate_cz(s);
+				if (type == BIN_OBJECT && (key = bin_read_key(r)) == NULL)
+					goto failure;
 				
-				if (len == 0) {
-					/*
-					 * Handle invalid UTF-8 character gracefully in production
-					 * by writing a replacement character (U+FFFD)
-					 * and skipping a single byte.
-					 *
-					 * This should never happen when assertions are enabled
-					 * due to the assertion at the beginning of this function.
-					 */
-					assert(false);
-					if (escape_unicode) {
-						strcpy(b, "\\uFFFD");
-						b += 6;
-					} else {
-						*b++ = 0xEF;
-						*b++ = 0xBF;
-						*b++ = 0xBD;
-					}
-					s++;
-				} else if (c < 0x1F || (c >= 0x80 && escape_unicode)) {
-					/* Encode using \u.... */
-					uint32_t unicode;
-					
-					s += utf8_read_char(s, &unicode);
-					
-					if (unicode <= 0xFFFF) {
-						*b++ = '\\';
-						*b++ = 'u';
-						b += write_hex16(b, unicode);
-					} else {
-						/* Produce a surrogate pair. */
-						uint16_t uc, lc;
-						assert(unicode <= 0x10FFFF);
-						to_surrogate_pair(unicode, &uc, &lc);
-						*b++ = '\\';
-						*b++ = 'u';
-						b += write_hex16(b, uc);
-						*b++ = '\\';
-						*b++ = 'u';
-						b += write_hex16(b, lc);
-					}
-				} else {
-					/* Write the character directly. */
-					while (len--)
-						*b++ = *s++;
+				if (!bin_read_value(r, &child)) {
+					json_release(r->arena, key);
+					goto failure;
 				}
 				
-				break;
+				if (type == BIN_OBJECT)
+					append_member(ret, key, child);
+				else
+					append_node(ret, child);
 			}
-		}
-	
-		/*
-		 * Update *out to know about the new bytes,
-		 * and set up b to write another encoded character.
-		 */
-		out->cur = b;
-		sb_need(out, 14);
-		b = out->cur;
+			break;
+		
+		default:
+			return false;
 	}
-	*b++ = '"';
 	
-	out->cur = b;
+	/* Out of memory */
+	if (ret == NULL)
+		return false;
+	
+	*out = ret;
+	return true;
+
+failure:
+	json_delete(ret);
+	return false;
 }
 
-static void emit_number(SB *out, double num)
+JsonNode *json_decode_binary(const void *data, size_t len)
 {
-	/*
-	 * This isn't exactly how JavaScript renders numbers,
-	 * but it should produce valid JSON for reasonable numbers
-	 * preserve precision well enough, and avoid some oddities
-	 * like 0.3 -> 0.299999999999999988898 .
-	 */
-	char buf[64];
-	sprintf(buf, "%.16g", num);
-	
-	if (number_is_valid(buf))
-		sb_puts(out, buf);
-	else
-		sb_puts(out, "null");
+	return json_decode_binary_a(NULL, data, len);
 }
 
-static bool tag_is_valid(unsigned int tag)
+JsonNode *json_decode_binary_a(JsonArena *arena, const void *data, size_t len)
 {
-	return (/* tag >= JSON_NULL && */ tag <= JSON_OBJECT);
+	BinReader r = { 0 };
+	JsonNode *ret = NULL;
+	
+	if (data == NULL) {
+		return NULL;
+	}
+	
+	r.s = (const unsigned char*) data;
+	r.end = r.s + len;
+	r.arena = arena;
+	
+	if (!bin_read_value(&r, &ret) || r.s != r.end) {
+		json_delete(ret);
+		ret = NULL;
+	}
+	
+	mem_free(arena, r.keys, r.alloc * sizeof(*r.keys));
+	return ret;
 }
 
-static bool number_is_valid(const char *num)
+static bool tag_is_valid(unsigned int tag)
 {
-	return (parse_number(&num, NULL) && *num == '\0');
+	return (/* tag >= JSON_NULL && */ tag <= JSON_OBJECT);
 }
 
 static bool expect_literal(const char **sp, const char *str)
@@ -1426,6 +4780,30 @@ bool json_check(const JsonNode *node, char errmsg[256])
 			if (last != tail)
 				problem("tail does not match pointer found by starting at head and following next links");
 		}
+		
+		if (node_index(node) != NULL) {
+			JsonIndex *index = node_index(node);
+			JsonNode *child;
+			size_t i = 0;
+			
+			json_foreach(child, node) {
+				if (node->tag == JSON_ARRAY) {
+					if (i >= index->count || index->slots[i] != child)
+						problem("Array index does not match element %zu", i);
+				} else {
+					JsonNode *entry = *bucket_of(index, hash_key(child->key));
+					
+					while (entry != NULL && entry != child)
+						entry = node_box(entry)->meta.hash_next;
+					if (entry == NULL)
+						problem("Object member \"%s\" is missing from the index", child->key);
+				}
+				i++;
+			}
+			
+			if (i != index->count)
+				problem("Index holds %zu entries, but there are %zu children", index->count, i);
+		}
 	}
 	
 	return true;
@@ -0,0 +1,234 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @defgroup ARBITER HAL Bus Arbitration
+ * @addtogroup ARBITER
+ * @{
+ */
+
+#ifndef K_ARBITER_H
+#define K_ARBITER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Bus wait statistics for a single client of an arbiter
+ */
+typedef struct {
+    uint32_t acquired;          /**< Number of times the bus was acquired */
+    uint32_t contended;         /**< Number of those which had to wait for another client */
+    uint32_t timeouts;          /**< Number of times the client gave up waiting */
+    uint64_t wait_total_ns;     /**< Total time spent waiting for the bus */
+    uint64_t wait_max_ns;       /**< Longest single wait for the bus */
+    uint32_t deadline_misses;   /**< Number of requests which got the bus after their deadline */
+    uint32_t preemptions;       /**< Number of times the client yielded the bus to a higher-priority request */
+} KArbiterStats;
+
+/**
+ * Conventional priority classes for arbiter requests
+ */
+typedef enum {
+    ARBITER_BULK    = -1,       /**< Background traffic, such as telemetry sweeps */
+    ARBITER_NORMAL  = 0,        /**< Ordinary commands. The default */
+    ARBITER_CONTROL = 1,        /**< Latency-critical commands, such as control loop actuation */
+} KArbiterClass;
+
+/**
+ * A single use of the bus
+ *
+ * Requests carry their own priority, so that one client can mix
+ * latency-critical commands with bulk traffic.
+ */
+typedef struct {
+    int                     priority; /**< Waiting requests with a higher priority are served first. Usually a ::KArbiterClass */
+    const struct timespec * deadline; /**< `CLOCK_MONOTONIC` time by which the request should have the bus. `NULL` if it has none */
+} KArbiterRequest;
+
+/**
+ * A user of an arbiter
+ *
+ * Clients are owned by the caller, and must stay valid while they are waiting
+ * for or holding the arbiter.
+ */
+typedef struct {
+    int           priority;     /**< Waiting clients with a higher priority are served first */
+    KArbiterStats stats;        /**< Wait statistics. Read with ::k_arbiter_get_stats */
+} KArbiterClient;
+
+/** \cond INTERNAL */
+typedef struct karbiter_waiter karbiter_waiter;
+/** \endcond */
+
+/**
+ * Exclusive access to a shared bus
+ *
+ * An arbiter works like a mutex, except that the order in which waiting
+ * clients get the bus is controlled: the waiter with the highest priority goes
+ * next, then the one with the earliest deadline, and otherwise waiters are
+ * served in the order they arrived. When every client uses the same priority
+ * the arbiter is therefore a fair (FIFO) lock, and no client can be starved by
+ * others repeatedly re-taking the bus.
+ *
+ * The bus is only ever handed over when it is released or yielded, so a
+ * transaction in progress is never interrupted. Long sequences of transactions
+ * can let more urgent requests in between them with ::k_arbiter_yield.
+ *
+ * The bus is handed directly from the releasing client to the next waiter, so
+ * a client which has just released it can't take it back ahead of the queue.
+ *
+ * All times are measured against `CLOCK_MONOTONIC`.
+ */
+typedef struct {
+    pthread_mutex_t   mutex;    /**< Protects the rest of the arbiter */
+    pthread_cond_t    cond;     /**< Signalled when the bus is handed over */
+    bool              held;     /**< Whether a client currently has the bus */
+    int               holder;   /**< Priority of the request holding the bus */
+    karbiter_waiter * waiters;  /**< Clients waiting for the bus, in order of arrival */
+} KArbiter;
+
+/**
+ * @brief Initializes an arbiter
+ *
+ * @param arbiter arbiter to initialize
+ * @return bool true if successful, false if the arbiter's resources could not be created
+ */
+bool k_arbiter_init(KArbiter * arbiter);
+
+/**
+ * @brief Releases an arbiter's resources
+ *
+ * The arbiter must not be held or waited on
+ *
+ * @param arbiter arbiter to destroy
+ */
+void k_arbiter_destroy(KArbiter * arbiter);
+
+/**
+ * @brief Waits for exclusive access to the bus
+ *
+ * Example usage:
+ * @code
+KArbiterClient client = { .priority = 0 };
+const struct timespec timeout = { .tv_sec = 1, .tv_nsec = 0 };
+if (k_arbiter_acquire(&arbiter, &client, &timeout))
+{
+    write(fd, &cmd, 1);
+    k_arbiter_release(&arbiter);
+}
+ * @endcode
+ *
+ * @param arbiter arbiter to acquire
+ * @param client client acquiring the arbiter. Its priority decides its place in
+ * the queue, and its statistics are updated
+ * @param timeout longest time to wait. `NULL` waits indefinitely
+ * @return bool true if the bus was acquired, false if the wait timed out
+ */
+bool k_arbiter_acquire(KArbiter * arbiter, KArbiterClient * client,
+                       const struct timespec * timeout);
+
+/**
+ * @brief Waits for exclusive access to the bus on behalf of a single request
+ *
+ * This is the same as ::k_arbiter_acquire, except that the request's priority
+ * is used in place of the client's. If the bus is acquired after the request's
+ * deadline, the client's `deadline_misses` count is incremented. The request
+ * still goes ahead, since it's up to the caller to decide whether a late
+ * transaction is worthless.
+ *
+ * Example usage:
+ * @code
+KArbiterClient client = { .priority = 0 };
+// CLOCK_MONOTONIC time by which the command should be sent
+struct timespec deadline = next_control_tick();
+KArbiterRequest request = { .priority = ARBITER_CONTROL, .deadline = &deadline };
+if (k_arbiter_acquire_request(&arbiter, &client, &request, NULL))
+{
+    write(fd, cmd, sizeof(cmd));
+    k_arbiter_release(&arbiter);
+}
+ * @endcode
+ *
+ * @param arbiter arbiter to acquire
+ * @param client client acquiring the arbiter. Its statistics are updated
+ * @param request priority and deadline of this use of the bus. `NULL` uses the
+ * client's priority, with no deadline
+ * @param timeout longest time to wait. `NULL` waits indefinitely
+ * @return bool true if the bus was acquired, false if the wait timed out
+ */
+bool k_arbiter_acquire_request(KArbiter * arbiter, KArbiterClient * client,
+                               const KArbiterRequest * request,
+                               const struct timespec * timeout);
+
+/**
+ * @brief Lets more urgent requests use the bus at a transaction boundary
+ *
+ * If a waiting request has a higher priority than the one holding the bus, the
+ * bus is handed over and the caller waits for it again, with the same priority
+ * (but no deadline). Otherwise the caller simply keeps the bus.
+ *
+ * This should be called in-between the transactions of a long sequence, such
+ * as a telemetry sweep, so that control commands don't have to wait for the
+ * whole sequence to finish.
+ *
+ * @param arbiter arbiter currently held by the caller
+ * @param client client holding the arbiter
+ * @param request request the bus was acquired for (`NULL` if it was acquired
+ * with ::k_arbiter_acquire)
+ * @param timeout longest time to wait for the bus to come back. `NULL` waits
+ * indefinitely
+ * @return bool true if the caller holds the bus, false if the wait timed out
+ * (in which case the bus must not be released)
+ */
+bool k_arbiter_yield(KArbiter * arbiter, KArbiterClient * client,
+                     const KArbiterRequest * request,
+                     const struct timespec * timeout);
+
+/**
+ * @brief Gives up the bus, handing it to the next waiting client
+ *
+ * @param arbiter arbiter to release
+ */
+void k_arbiter_release(KArbiter * arbiter);
+
+/**
+ * @brief Changes a client's priority
+ *
+ * If the client is currently waiting, its new priority applies the next time
+ * the bus is handed over
+ *
+ * @param arbiter arbiter the client uses
+ * @param client client to update
+ * @param priority new priority. Higher values are served first
+ */
+void k_arbiter_set_priority(KArbiter * arbiter, KArbiterClient * client,
+                            int priority);
+
+/**
+ * @brief Copies a client's wait statistics
+ *
+ * @param arbiter arbiter the client uses
+ * @param client client to read
+ * @param[out] stats storage for the statistics
+ */
+void k_arbiter_get_stats(KArbiter * arbiter, const KArbiterClient * client,
+                         KArbiterStats * stats);
+
+#endif
+/* @} */
@@ -0,0 +1,103 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @defgroup CRC HAL CRC Functions
+ * @addtogroup CRC
+ * @{
+ */
+
+#ifndef K_CRC_H
+#define K_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Supported CRC algorithms
+ */
+typedef enum {
+    /** CRC-8 (poly 0x07, not reflected, no final XOR). Used by the iOBC supervisor */
+    K_CRC8,
+    /** CRC-16/CCITT-FALSE (poly 0x1021, not reflected, no final XOR) */
+    K_CRC16_CCITT,
+    /** CRC-32 (poly 0x04C11DB7, reflected, final XOR 0xFFFFFFFF). Compatible with zlib */
+    K_CRC32
+} KCRCType;
+
+/**
+ *  @name Initial Values
+ *  Value to pass as `crc` when starting a new calculation
+ */
+/**@{*/
+#define K_CRC8_INIT         0x00
+#define K_CRC16_CCITT_INIT  0xFFFF
+#define K_CRC32_INIT        0x00000000
+/**@}*/
+
+/**
+ * @brief Calculates a CRC-8 checksum
+ *
+ * Data can be processed in pieces by passing the result of one call as the
+ * `crc` of the next.
+ *
+ * Example usage:
+ * @code
+uint8_t crc = k_crc8(K_CRC8_INIT, header, sizeof(header));
+crc = k_crc8(crc, payload, sizeof(payload));
+ * @endcode
+ *
+ * @param crc ::K_CRC8_INIT, or the result of a previous call
+ * @param data data to checksum
+ * @param len length of data, in bytes
+ * @return uint8_t updated checksum
+ */
+uint8_t k_crc8(uint8_t crc, const uint8_t * data, size_t len);
+
+/**
+ * @brief Calculates a CRC-16/CCITT-FALSE checksum
+ *
+ * @param crc ::K_CRC16_CCITT_INIT, or the result of a previous call
+ * @param data data to checksum
+ * @param len length of data, in bytes
+ * @return uint16_t updated checksum
+ */
+uint16_t k_crc16(uint16_t crc, const uint8_t * data, size_t len);
+
+/**
+ * @brief Calculates a CRC-32 checksum
+ *
+ * @param crc ::K_CRC32_INIT, or the result of a previous call
+ * @param data data to checksum
+ * @param len length of data, in bytes
+ * @return uint32_t updated checksum
+ */
+uint32_t k_crc32(uint32_t crc, const uint8_t * data, size_t len);
+
+/**
+ * @brief Calculates a checksum with the requested algorithm
+ *
+ * @param type algorithm to use
+ * @param crc initial value for the algorithm, or the result of a previous call
+ * @param data data to checksum
+ * @param len length of data, in bytes
+ * @return uint32_t updated checksum. Unknown algorithms return `crc` unchanged
+ */
+uint32_t k_crc_calculate(KCRCType type, uint32_t crc, const uint8_t * data,
+                         size_t len);
+
+#endif
+/* @} */
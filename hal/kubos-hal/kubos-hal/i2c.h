@@ -25,8 +25,11 @@
 
 #include <pthread.h>
 #include <stdint.h>
+#include "arbiter.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/uio.h>
+#include <time.h>
 
 /**
  * IOCTL master role value
@@ -37,6 +40,11 @@
  */
 #define I2C_SLAVE   1
 
+/**
+ * Maximum total length of a scatter/gather write (see ::k_i2c_writev)
+ */
+#define I2C_MAX_GATHER 512
+
 /**
  * I2C function status
  */
@@ -53,6 +61,37 @@ typedef enum {
     I2C_ERROR_CONFIG
 } KI2CStatus;
 
+/**
+ * A single message of an I2C batch (see ::k_i2c_batch)
+ *
+ * Each message writes `tx_len` bytes from `tx` to the slave, waits `delay`,
+ * and then reads `rx_len` bytes into `rx`. Either phase may be skipped by
+ * giving it a length of zero. A message with neither phase simply waits,
+ * which can be used to give a device time to complete an operation which
+ * was started by a previous message.
+ */
+typedef struct {
+    uint16_t addr;                  /**< Address of target I2C device */
+    uint8_t * tx;                   /**< Data to write */
+    int tx_len;                     /**< Length of data to write (0 = no write) */
+    uint8_t * rx;                   /**< Storage for the response */
+    int rx_len;                     /**< Length of response to read (0 = no read) */
+    /**
+     * Time to wait between the write and the read phases. `NULL` indicates
+     * that no wait is needed, in which case a message with both phases is sent
+     * as a single repeated-start transfer
+     */
+    const struct timespec * delay;
+    /**
+     * Let more urgent requests use the bus before this message is sent (see
+     * ::k_arbiter_yield). Only set this where the device doesn't mind other
+     * traffic in-between
+     */
+    bool yield;
+    KI2CStatus status;              /**< Result of this message, filled in by ::k_i2c_batch */
+    struct timespec done;           /**< `CLOCK_MONOTONIC` time this message finished, filled in by ::k_i2c_batch */
+} KI2CBatchMsg;
+
 /**
  * @brief Configures and enables an I2C bus
  * 
@@ -81,6 +120,7 @@ KI2CStatus k_i2c_init(char * device, int * fp);
  * This fuction is used to terminate an active I2C bus connection.
  * It takes a pointer to the file descriptor to be closed.
  * After calling this function the device will *not* be available for usage in the reading/writing functions.
+ * Calls which are already waiting for or using the bus through this connection are allowed to finish first.
  *
  * Example usage:
  * @code
@@ -113,9 +153,14 @@ KI2CStatus write_status;
 write_status = k_i2c_write(bus, slave_addr, &cmd, 1);
  * @endcode
  *
- * In order to ensure safe I2C sharing, this function is semaphore locked.
- * There is one semaphore per bus. This function will block indefinitely
- * while waiting for the semaphore.
+ * In order to ensure safe I2C sharing, access to the bus is arbitrated.
+ * All connections opened on the same device share one arbiter, which serves
+ * waiting connections in priority order and then in order of arrival.
+ * By default, this function will block indefinitely while waiting for the bus
+ * (see ::k_i2c_set_arbitration).
+ *
+ * The slave address is only reprogrammed when it differs from the one used by
+ * the previous transaction on this bus connection.
  *
  * @param i2c I2C bus to transmit over
  * @param addr address of target I2C device
@@ -143,9 +188,14 @@ KI2CStatus read_status;
 read_status = k_i2c_read(bus, slave_addr, buffer, read_len);
  * @endcode
  *
- * In order to ensure safe I2C sharing, this function is semaphore locked.
- * There is one semaphore per bus. This function will block indefinitely
- * while waiting for the semaphore.
+ * In order to ensure safe I2C sharing, access to the bus is arbitrated.
+ * All connections opened on the same device share one arbiter, which serves
+ * waiting connections in priority order and then in order of arrival.
+ * By default, this function will block indefinitely while waiting for the bus
+ * (see ::k_i2c_set_arbitration).
+ *
+ * The slave address is only reprogrammed when it differs from the one used by
+ * the previous transaction on this bus connection.
  *
  * @param i2c I2C bus to read from
  * @param addr address of target I2C device
@@ -155,5 +205,198 @@ read_status = k_i2c_read(bus, slave_addr, buffer, read_len);
  */
 KI2CStatus k_i2c_read(int i2c, uint16_t addr, uint8_t *ptr, int len);
 
+/**
+ * @brief Write data to a device and read back its response in a single bus transaction
+ *
+ * This function sends the contents of the transmit buffer to the specified slave address
+ * and then immediately reads the response, using a repeated-start condition in-between the
+ * two phases. The bus is not released between the write and the read, and the whole
+ * exchange is completed with a single system call.
+ * This function is intended to be used on an I2C bus which has already been initialized.
+ *
+ * Example usage:
+ * @code
+int bus = 0;
+k_i2c_init("/dev/i2c-1", &bus);
+uint8_t cmd = 0x40;
+uint8_t buffer[10];
+uint16_t slave_addr = 0x80;
+KI2CStatus status;
+status = k_i2c_transfer(bus, slave_addr, &cmd, 1, buffer, sizeof(buffer));
+ * @endcode
+ *
+ * @note Some devices need time to process a command before they are able to return
+ * a response. Those devices should continue to use separate ::k_i2c_write and
+ * ::k_i2c_read calls.
+ *
+ * @param i2c I2C bus to transmit over
+ * @param addr address of target I2C device
+ * @param tx pointer to data to write
+ * @param tx_len length of data to write
+ * @param rx pointer to storage for the response
+ * @param rx_len length of response to read
+ * @return KI2CStatus I2C_OK on success, I2C_ERROR on error
+ */
+KI2CStatus k_i2c_transfer(int i2c, uint16_t addr, uint8_t * tx, int tx_len,
+                          uint8_t * rx, int rx_len);
+
+/**
+ * @brief Run a sequence of I2C messages while holding the bus
+ *
+ * This function executes each of the given messages in order, without letting
+ * any other user of the bus in-between (unless a message is flagged with
+ * `yield`, and a connection with a higher priority is waiting). It is intended for
+ * telemetry sweeps which would otherwise need a separate lock acquisition
+ * (and often a separate fixed delay) for every request.
+ *
+ * All of the messages are attempted, even if an earlier one fails, and the
+ * result of each is stored in its `status` field.
+ *
+ * Example usage:
+ * @code
+int bus = 0;
+k_i2c_init("/dev/i2c-1", &bus);
+uint8_t cmd[2] = { 0x40, 0x41 };
+uint8_t resp[2][4];
+const struct timespec wait = { 0, 1000000 };
+KI2CBatchMsg msgs[2] = {
+    { .addr = 0x80, .tx = &cmd[0], .tx_len = 1, .rx = resp[0], .rx_len = 4 },
+    { .addr = 0x80, .tx = &cmd[1], .tx_len = 1, .rx = resp[1], .rx_len = 4, .delay = &wait }
+};
+KI2CStatus status;
+status = k_i2c_batch(bus, msgs, 2);
+ * @endcode
+ *
+ * @param i2c I2C bus to transmit over
+ * @param msgs array of messages to execute
+ * @param count number of messages in the array
+ * @return KI2CStatus I2C_OK if every message succeeded, I2C_ERROR otherwise
+ */
+KI2CStatus k_i2c_batch(int i2c, KI2CBatchMsg * msgs, int count);
+
+/**
+ * @brief Run a sequence of I2C messages with a given priority and deadline
+ *
+ * This is the same as ::k_i2c_batch, except that the bus is requested with
+ * the given priority in place of the connection's, and a late start is
+ * counted in the connection's `deadline_misses` statistic. When messages are
+ * flagged with `yield`, waiting requests with a higher priority than this one
+ * get the bus before those messages are sent.
+ *
+ * This lets a single connection send latency-critical commands ahead of its
+ * own bulk traffic, and lets a long telemetry sweep get out of their way.
+ *
+ * Example usage:
+ * @code
+int bus = 0;
+k_i2c_init("/dev/i2c-1", &bus);
+uint8_t cmd[2] = { 0x40, 0x41 };
+uint8_t resp[2][4];
+KI2CBatchMsg msgs[2] = {
+    { .addr = 0x80, .tx = &cmd[0], .tx_len = 1, .rx = resp[0], .rx_len = 4 },
+    { .addr = 0x80, .tx = &cmd[1], .tx_len = 1, .rx = resp[1], .rx_len = 4, .yield = true }
+};
+const KArbiterRequest sweep = { .priority = ARBITER_BULK, .deadline = NULL };
+KI2CStatus status;
+status = k_i2c_batch_request(bus, &sweep, msgs, 2);
+ * @endcode
+ *
+ * @param i2c I2C bus to transmit over
+ * @param request priority and deadline of the batch. `NULL` is the same as ::k_i2c_batch
+ * @param msgs array of messages to execute
+ * @param count number of messages in the array
+ * @return KI2CStatus I2C_OK if every message succeeded, I2C_ERROR otherwise
+ */
+KI2CStatus k_i2c_batch_request(int i2c, const KArbiterRequest * request,
+                               KI2CBatchMsg * msgs, int count);
+
+/**
+ * @brief Write data assembled from several buffers as a single I2C message
+ *
+ * This allows callers to send a command header followed by a payload without
+ * first copying both into a heap-allocated packet. The pieces are gathered
+ * into a fixed-size buffer on the stack and sent with one write, so the
+ * device sees exactly the same message as it would from ::k_i2c_write.
+ * If only one piece is given, it is sent directly without being copied.
+ *
+ * Example usage:
+ * @code
+int bus = 0;
+k_i2c_init("/dev/i2c-1", &bus);
+uint8_t cmd = 0x10;
+uint8_t payload[20];
+struct iovec iov[2] = {
+    { .iov_base = &cmd, .iov_len = 1 },
+    { .iov_base = payload, .iov_len = sizeof(payload) }
+};
+KI2CStatus status;
+status = k_i2c_writev(bus, 0x80, iov, 2);
+ * @endcode
+ *
+ * @param i2c I2C bus to transmit over
+ * @param addr address of target I2C device
+ * @param iov array of buffers to send, in order
+ * @param iovcnt number of buffers in the array
+ * @return KI2CStatus I2C_OK on success, I2C_ERROR_CONFIG if the total length
+ * exceeds ::I2C_MAX_GATHER, I2C_ERROR on any other error
+ */
+KI2CStatus k_i2c_writev(int i2c, uint16_t addr, const struct iovec * iov,
+                        int iovcnt);
+
+/**
+ * @brief Write data assembled from several buffers and read back the response in a
+ * single bus transaction
+ *
+ * This is the scatter/gather equivalent of ::k_i2c_transfer. The write phase is
+ * assembled in the same way as ::k_i2c_writev.
+ *
+ * @param i2c I2C bus to transmit over
+ * @param addr address of target I2C device
+ * @param iov array of buffers to send, in order
+ * @param iovcnt number of buffers in the array
+ * @param rx pointer to storage for the response
+ * @param rx_len length of response to read
+ * @return KI2CStatus I2C_OK on success, I2C_ERROR_CONFIG if the total length
+ * exceeds ::I2C_MAX_GATHER, I2C_ERROR on any other error
+ */
+KI2CStatus k_i2c_transferv(int i2c, uint16_t addr, const struct iovec * iov,
+                           int iovcnt, uint8_t * rx, int rx_len);
+
+/**
+ * @brief Sets how a connection waits for its turn on the bus
+ *
+ * Every connection opened on the same I2C device shares one arbiter (see
+ * ::KArbiter), so transactions from different drivers never interleave. When
+ * several connections are waiting, the one with the highest priority goes
+ * next; connections with the same priority take turns in order of arrival.
+ *
+ * If a timeout is set and the bus can't be acquired in time, the transaction
+ * isn't attempted and `I2C_ERROR_TIMEOUT` is returned.
+ *
+ * Example usage:
+ * @code
+int bus = 0;
+k_i2c_init("/dev/i2c-0", &bus);
+const struct timespec timeout = { .tv_sec = 1, .tv_nsec = 0 };
+k_i2c_set_arbitration(bus, 0, &timeout);
+ * @endcode
+ *
+ * @param i2c I2C bus connection to configure
+ * @param priority priority of this connection's transactions. The default is 0
+ * @param timeout longest time to wait for the bus. `NULL` (the default) waits indefinitely
+ * @return KI2CStatus I2C_OK on success, I2C_ERROR if the connection isn't known
+ */
+KI2CStatus k_i2c_set_arbitration(int i2c, int priority,
+                                 const struct timespec * timeout);
+
+/**
+ * @brief Gets the bus wait statistics of a connection
+ *
+ * @param i2c I2C bus connection to query
+ * @param[out] stats storage for the statistics
+ * @return KI2CStatus I2C_OK on success, I2C_ERROR if the connection isn't known
+ */
+KI2CStatus k_i2c_get_arbitration_stats(int i2c, KArbiterStats * stats);
+
 #endif
 /* @} */
@@ -0,0 +1,112 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @defgroup KICK HAL Watchdog Kick Scheduling
+ * @addtogroup KICK
+ * @{
+ */
+
+#ifndef K_KICK_H
+#define K_KICK_H
+
+#include <stdbool.h>
+#include <time.h>
+
+/**
+ * Function which kicks a device's watchdog
+ *
+ * @param arg the kick's `arg`
+ */
+typedef void (*KKickFunc)(void * arg);
+
+/** \cond INTERNAL */
+typedef struct kkick KKick;
+/** \endcond */
+
+/**
+ * A periodic watchdog kick
+ *
+ * Every registered kick is run from a single shared scheduler thread, rather
+ * than each driver keeping a thread of its own. Kicks are only ever started
+ * and stopped in-between calls to `func`, so a kick can't be interrupted in
+ * the middle of a bus transaction.
+ *
+ * To save wake-ups, a kick may be run up to an eighth of its period early if
+ * another kick is being run at the time. It is never run late on purpose.
+ *
+ * Kicks are owned by the caller, and must stay valid while they are
+ * registered. All times are measured against `CLOCK_MONOTONIC`.
+ */
+struct kkick {
+    KKickFunc       func;       /**< Function which kicks the watchdog */
+    void *          arg;        /**< Passed to `func` */
+    struct timespec period;     /**< Longest time between kicks */
+    /** \cond INTERNAL */
+    struct timespec due;        /* When the kick should next be run */
+    bool            registered; /* Whether the scheduler is running the kick */
+    bool            first;      /* Set until the kick has been run once */
+    KKick *         next;       /* Next registered kick */
+    /** \endcond */
+};
+
+/**
+ * @brief Starts running a kick periodically
+ *
+ * The kick is run straight away, and then once every period. This returns
+ * once the first kick has finished, so a device is always kicked at least once
+ * between registering and unregistering. The scheduler thread is started with
+ * the first registration.
+ *
+ * Example usage:
+ * @code
+static void kick_watchdog(void * arg)
+{
+    k_i2c_write(bus, addr, &reset_cmd, 1);
+}
+
+static KKick kick = { .func = kick_watchdog, .period = { .tv_sec = 20 } };
+k_kick_register(&kick);
+ * @endcode
+ *
+ * @param kick kick to register. Its `func` and `period` must be set
+ * @return bool true if the kick is registered, false if the arguments are
+ * invalid or the scheduler thread couldn't be started
+ */
+bool k_kick_register(KKick * kick);
+
+/**
+ * @brief Stops running a kick
+ *
+ * If the kick is being run, this waits for it to finish first (unless it is
+ * called by the kick itself). The scheduler thread exits once no kicks are
+ * left.
+ *
+ * @param kick kick to unregister
+ * @return bool true if the kick was unregistered, false if it wasn't registered
+ */
+bool k_kick_unregister(KKick * kick);
+
+/**
+ * @brief Checks whether a kick is registered
+ *
+ * @param kick kick to check
+ * @return bool true if the kick is registered
+ */
+bool k_kick_is_registered(const KKick * kick);
+
+#endif
+/* @} */
@@ -0,0 +1,118 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @defgroup PACING HAL Transaction Pacing
+ * @addtogroup PACING
+ * @{
+ */
+
+#ifndef K_PACING_H
+#define K_PACING_H
+
+#include <stdbool.h>
+#include <time.h>
+
+/**
+ * Transaction pacing state for a single device
+ *
+ * Many devices require a minimum amount of time between consecutive
+ * transactions. Rather than sleeping for the full amount after every
+ * transaction, a pacer records when the last transaction finished and only
+ * sleeps for whatever portion of the gap has not already elapsed.
+ *
+ * All times are measured against `CLOCK_MONOTONIC`.
+ *
+ * A pacer does not do any locking of its own. Callers which share a pacer
+ * between threads should already be serializing their transactions.
+ */
+typedef struct {
+    struct timespec min_gap;    /**< Minimum time between the end of one transaction and the start of the next */
+    struct timespec last;       /**< Time the last transaction finished */
+    bool            active;     /**< Whether `last` has been recorded yet */
+} KPacer;
+
+/**
+ * @brief Initializes a pacer
+ *
+ * Example usage:
+ * @code
+KPacer pacer;
+const struct timespec gap = { .tv_sec = 0, .tv_nsec = 1000000 };
+k_pacer_init(&pacer, &gap);
+ * @endcode
+ *
+ * @param pacer pacer to initialize
+ * @param min_gap minimum time between transactions. `NULL` means no gap is required
+ */
+void k_pacer_init(KPacer * pacer, const struct timespec * min_gap);
+
+/**
+ * @brief Gets the configured minimum gap between transactions
+ *
+ * @param pacer pacer to query
+ * @param[out] min_gap storage for the minimum gap
+ */
+void k_pacer_get_gap(const KPacer * pacer, struct timespec * min_gap);
+
+/**
+ * @brief Changes the minimum gap between transactions
+ *
+ * The new gap applies starting with the next call to ::k_pacer_wait
+ *
+ * @param pacer pacer to update
+ * @param min_gap new minimum gap. `NULL` means no gap is required
+ */
+void k_pacer_set_gap(KPacer * pacer, const struct timespec * min_gap);
+
+/**
+ * @brief Waits until the minimum gap since the last transaction has elapsed
+ *
+ * Returns immediately if no transaction has been recorded yet, or if the gap
+ * has already passed.
+ *
+ * Example usage:
+ * @code
+k_pacer_wait(&pacer);
+k_i2c_write(bus, addr, &cmd, 1);
+k_pacer_mark(&pacer);
+ * @endcode
+ *
+ * @param pacer pacer to wait on
+ */
+void k_pacer_wait(KPacer * pacer);
+
+/**
+ * @brief Waits until a specific gap since the last transaction has elapsed
+ *
+ * This is used when a particular transaction needs a different amount of time
+ * than the configured minimum (for example, a reset command which takes longer
+ * to complete).
+ *
+ * @param pacer pacer to wait on
+ * @param gap time which must have passed since the last transaction
+ */
+void k_pacer_wait_gap(KPacer * pacer, const struct timespec * gap);
+
+/**
+ * @brief Records that a transaction has just finished
+ *
+ * @param pacer pacer to update
+ */
+void k_pacer_mark(KPacer * pacer);
+
+#endif
+/* @} */
@@ -0,0 +1,389 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "arbiter.h"
+#include <errno.h>
+#include <stddef.h>
+
+#define NSEC_PER_SEC 1000000000L
+
+/* A client waiting for the bus. Lives on the waiting thread's stack */
+struct karbiter_waiter {
+    KArbiterClient *        client;
+    const KArbiterRequest * request;  /* NULL to use the client's priority */
+    bool                    granted;  /* Set when the bus has been handed to this waiter */
+    karbiter_waiter *       next;
+};
+
+static uint64_t kprv_arbiter_elapsed_ns(const struct timespec * start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)(now.tv_sec - start->tv_sec) * NSEC_PER_SEC
+           + (now.tv_nsec - start->tv_nsec);
+}
+
+static int kprv_arbiter_priority(const karbiter_waiter * waiter)
+{
+    return (waiter->request != NULL) ? waiter->request->priority
+                                     : waiter->client->priority;
+}
+
+static const struct timespec * kprv_arbiter_deadline(
+    const karbiter_waiter * waiter)
+{
+    return (waiter->request != NULL) ? waiter->request->deadline : NULL;
+}
+
+/* Whether `a` should get the bus before `b`, which arrived earlier */
+static bool kprv_arbiter_before(const karbiter_waiter * a,
+                                const karbiter_waiter * b)
+{
+    const struct timespec * a_deadline = kprv_arbiter_deadline(a);
+    const struct timespec * b_deadline = kprv_arbiter_deadline(b);
+
+    if (kprv_arbiter_priority(a) != kprv_arbiter_priority(b))
+    {
+        return kprv_arbiter_priority(a) > kprv_arbiter_priority(b);
+    }
+
+    /* Within a priority, the earliest deadline goes first */
+    if (a_deadline == NULL)
+    {
+        return false;
+    }
+    if (b_deadline == NULL)
+    {
+        return true;
+    }
+
+    return a_deadline->tv_sec < b_deadline->tv_sec
+           || (a_deadline->tv_sec == b_deadline->tv_sec
+               && a_deadline->tv_nsec < b_deadline->tv_nsec);
+}
+
+/*
+ * Give the bus to a waiter, which may not have been queued yet.
+ * The caller must hold the arbiter's mutex
+ */
+static void kprv_arbiter_grant(KArbiter * arbiter, karbiter_waiter * waiter)
+{
+    const struct timespec * deadline = kprv_arbiter_deadline(waiter);
+    struct timespec         now;
+
+    arbiter->held   = true;
+    arbiter->holder = kprv_arbiter_priority(waiter);
+    waiter->granted = true;
+    waiter->client->stats.acquired++;
+
+    if (deadline != NULL)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > deadline->tv_sec
+            || (now.tv_sec == deadline->tv_sec
+                && now.tv_nsec > deadline->tv_nsec))
+        {
+            waiter->client->stats.deadline_misses++;
+        }
+    }
+}
+
+/*
+ * Find the waiter which should go next. Returns the link pointing at it, or
+ * NULL if nobody is waiting. The caller must hold the arbiter's mutex
+ */
+static karbiter_waiter ** kprv_arbiter_next(KArbiter * arbiter)
+{
+    karbiter_waiter ** link;
+    karbiter_waiter ** next = NULL;
+
+    for (link = &arbiter->waiters; *link != NULL; link = &(*link)->next)
+    {
+        if (next == NULL || kprv_arbiter_before(*link, *next))
+        {
+            next = link;
+        }
+    }
+
+    return next;
+}
+
+/*
+ * Hand the bus straight over to the next waiter, so it stays held. Returns
+ * false if nobody is waiting. The caller must hold the arbiter's mutex
+ */
+static bool kprv_arbiter_hand_over(KArbiter * arbiter)
+{
+    karbiter_waiter ** next = kprv_arbiter_next(arbiter);
+    karbiter_waiter *  waiter;
+
+    if (next == NULL)
+    {
+        return false;
+    }
+
+    waiter = *next;
+    *next  = waiter->next;
+    kprv_arbiter_grant(arbiter, waiter);
+    pthread_cond_broadcast(&arbiter->cond);
+
+    return true;
+}
+
+/*
+ * Queue up and wait until the bus is handed over. A waiter which is giving the
+ * bus up for a moment goes to the front, so it keeps its place among waiters
+ * with the same priority. The caller must hold the arbiter's mutex
+ */
+static bool kprv_arbiter_wait(KArbiter * arbiter, karbiter_waiter * self,
+                              bool front, const struct timespec * timeout)
+{
+    karbiter_waiter ** link;
+    struct timespec    start;
+    struct timespec    deadline;
+    uint64_t           waited;
+    int                ret = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (timeout != NULL)
+    {
+        deadline.tv_sec  = start.tv_sec + timeout->tv_sec;
+        deadline.tv_nsec = start.tv_nsec + timeout->tv_nsec;
+        if (deadline.tv_nsec >= NSEC_PER_SEC)
+        {
+            deadline.tv_sec += deadline.tv_nsec / NSEC_PER_SEC;
+            deadline.tv_nsec %= NSEC_PER_SEC;
+        }
+    }
+
+    if (front)
+    {
+        self->next       = arbiter->waiters;
+        arbiter->waiters = self;
+    }
+    else
+    {
+        /* Join the back of the queue */
+        for (link = &arbiter->waiters; *link != NULL; link = &(*link)->next)
+        {
+            continue;
+        }
+        *link = self;
+    }
+
+    while (!self->granted && ret != ETIMEDOUT)
+    {
+        if (timeout == NULL)
+        {
+            pthread_cond_wait(&arbiter->cond, &arbiter->mutex);
+        }
+        else
+        {
+            ret = pthread_cond_timedwait(&arbiter->cond, &arbiter->mutex,
+                                         &deadline);
+        }
+    }
+
+    waited = kprv_arbiter_elapsed_ns(&start);
+    self->client->stats.wait_total_ns += waited;
+    if (waited > self->client->stats.wait_max_ns)
+    {
+        self->client->stats.wait_max_ns = waited;
+    }
+
+    if (!self->granted)
+    {
+        /* Timed out, so leave the queue */
+        for (link = &arbiter->waiters; *link != self; link = &(*link)->next)
+        {
+            continue;
+        }
+        *link = self->next;
+
+        self->client->stats.timeouts++;
+        return false;
+    }
+
+    self->client->stats.contended++;
+
+    return true;
+}
+
+bool k_arbiter_init(KArbiter * arbiter)
+{
+    pthread_condattr_t attr;
+
+    if (arbiter == NULL)
+    {
+        return false;
+    }
+
+    arbiter->held    = false;
+    arbiter->holder  = 0;
+    arbiter->waiters = NULL;
+
+    /* Timeouts are measured against the monotonic clock, like everything else */
+    if (pthread_condattr_init(&attr) != 0)
+    {
+        return false;
+    }
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    if (pthread_cond_init(&arbiter->cond, &attr) != 0)
+    {
+        pthread_condattr_destroy(&attr);
+        return false;
+    }
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_mutex_init(&arbiter->mutex, NULL) != 0)
+    {
+        pthread_cond_destroy(&arbiter->cond);
+        return false;
+    }
+
+    return true;
+}
+
+void k_arbiter_destroy(KArbiter * arbiter)
+{
+    if (arbiter == NULL)
+    {
+        return;
+    }
+
+    pthread_cond_destroy(&arbiter->cond);
+    pthread_mutex_destroy(&arbiter->mutex);
+}
+
+bool k_arbiter_acquire(KArbiter * arbiter, KArbiterClient * client,
+                       const struct timespec * timeout)
+{
+    return k_arbiter_acquire_request(arbiter, client, NULL, timeout);
+}
+
+bool k_arbiter_acquire_request(KArbiter * arbiter, KArbiterClient * client,
+                               const KArbiterRequest * request,
+                               const struct timespec * timeout)
+{
+    karbiter_waiter self
+        = {.client = client, .request = request, .granted = false, .next = NULL };
+    bool acquired = true;
+
+    if (arbiter == NULL || client == NULL)
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&arbiter->mutex);
+
+    /* The bus is always handed over while there are waiters, so nobody is queued */
+    if (!arbiter->held)
+    {
+        kprv_arbiter_grant(arbiter, &self);
+    }
+    else
+    {
+        acquired = kprv_arbiter_wait(arbiter, &self, false, timeout);
+    }
+
+    pthread_mutex_unlock(&arbiter->mutex);
+
+    return acquired;
+}
+
+bool k_arbiter_yield(KArbiter * arbiter, KArbiterClient * client,
+                     const KArbiterRequest * request,
+                     const struct timespec * timeout)
+{
+    /* The deadline was for getting the bus in the first place */
+    KArbiterRequest again;
+    karbiter_waiter self
+        = {.client = client, .request = NULL, .granted = false, .next = NULL };
+    karbiter_waiter ** next;
+    bool               acquired = true;
+
+    if (arbiter == NULL || client == NULL)
+    {
+        return false;
+    }
+
+    if (request != NULL)
+    {
+        again.priority = request->priority;
+        again.deadline = NULL;
+        self.request   = &again;
+    }
+
+    pthread_mutex_lock(&arbiter->mutex);
+
+    next = kprv_arbiter_next(arbiter);
+    if (next != NULL && kprv_arbiter_priority(*next) > arbiter->holder)
+    {
+        client->stats.preemptions++;
+        kprv_arbiter_hand_over(arbiter);
+        acquired = kprv_arbiter_wait(arbiter, &self, true, timeout);
+    }
+
+    pthread_mutex_unlock(&arbiter->mutex);
+
+    return acquired;
+}
+
+void k_arbiter_release(KArbiter * arbiter)
+{
+    if (arbiter == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&arbiter->mutex);
+
+    if (!kprv_arbiter_hand_over(arbiter))
+    {
+        arbiter->held = false;
+    }
+
+    pthread_mutex_unlock(&arbiter->mutex);
+}
+
+void k_arbiter_set_priority(KArbiter * arbiter, KArbiterClient * client,
+                            int priority)
+{
+    if (arbiter == NULL || client == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&arbiter->mutex);
+    client->priority = priority;
+    pthread_mutex_unlock(&arbiter->mutex);
+}
+
+void k_arbiter_get_stats(KArbiter * arbiter, const KArbiterClient * client,
+                         KArbiterStats * stats)
+{
+    if (arbiter == NULL || client == NULL || stats == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&arbiter->mutex);
+    *stats = client->stats;
+    pthread_mutex_unlock(&arbiter->mutex);
+}
@@ -19,14 +19,299 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
+/* Maximum number of simultaneously open I2C bus connections with tracked state */
+#define I2C_MAX_BUSES 8
+
+/* Sentinel for "no slave address currently programmed" */
+#define I2C_ADDR_UNKNOWN -1
+
+/* Longest I2C device name which is tracked ("/dev/i2c-n" plus some room) */
+#define I2C_MAX_DEVICE 16
+
+/**
+ * Arbitration for one physical bus
+ *
+ * Every driver opens its own connection, so connections to the same device
+ * share one of these. Otherwise transactions from different drivers could
+ * interleave on the wire.
+ */
+typedef struct {
+    char     device[I2C_MAX_DEVICE]; /* Device name ("" if the slot is free) */
+    int      users;                  /* Connections using this bus */
+    KArbiter arbiter;                /* Decides which connection uses the bus next */
+} i2c_device_state;
+
+/**
+ * Per-connection bus state
+ *
+ * The slave address set with the I2C_SLAVE ioctl belongs to the file
+ * descriptor, so we remember the last one programmed and only issue the ioctl
+ * again when a caller targets a different device. The device's arbiter keeps
+ * the address selection and the following read/write together, and keeps
+ * other connections to the same bus out in the meantime.
+ *
+ * Calls which are waiting for or holding the bus keep a reference to the
+ * connection, so that closing it can wait for them to finish before the
+ * device's arbiter is destroyed.
+ */
+typedef struct {
+    int                fd;          /* File descriptor (0 if the slot is free) */
+    int                refs;        /* Calls currently using the connection's arbiter */
+    bool               closing;     /* Set while the connection waits to be closed */
+    int                addr;        /* Last programmed slave address */
+    i2c_device_state * device;      /* Bus this connection was opened on */
+    KArbiterClient     client;      /* This connection's place in the arbiter */
+    bool               has_timeout; /* Whether waits for the bus are limited */
+    struct timespec    timeout;     /* Longest wait for the bus */
+} i2c_bus_state;
+
+static i2c_bus_state    i2c_buses[I2C_MAX_BUSES];
+static i2c_device_state i2c_devices[I2C_MAX_BUSES];
+static pthread_mutex_t  i2c_buses_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   i2c_buses_cond  = PTHREAD_COND_INITIALIZER; /* Signalled when a reference is dropped */
+
+/* Find or start tracking a bus device. The caller must hold i2c_buses_mutex */
+static i2c_device_state * kprv_i2c_get_device(const char * name)
+{
+    i2c_device_state * free_slot = NULL;
+
+    for (int i = 0; i < I2C_MAX_BUSES; i++)
+    {
+        if (i2c_devices[i].users > 0
+            && strncmp(i2c_devices[i].device, name, I2C_MAX_DEVICE) == 0)
+        {
+            i2c_devices[i].users++;
+            return &i2c_devices[i];
+        }
+        if (i2c_devices[i].users == 0 && free_slot == NULL)
+        {
+            free_slot = &i2c_devices[i];
+        }
+    }
+
+    if (free_slot == NULL || !k_arbiter_init(&free_slot->arbiter))
+    {
+        return NULL;
+    }
+
+    snprintf(free_slot->device, sizeof(free_slot->device), "%s", name);
+    free_slot->users = 1;
+
+    return free_slot;
+}
+
+/* Start tracking a newly opened connection */
+static void kprv_i2c_register(int fd, const char * name)
+{
+    pthread_mutex_lock(&i2c_buses_mutex);
+
+    for (int i = 0; i < I2C_MAX_BUSES; i++)
+    {
+        if (i2c_buses[i].fd == 0)
+        {
+            i2c_buses[i].device = kprv_i2c_get_device(name);
+            if (i2c_buses[i].device == NULL)
+            {
+                break;
+            }
+            i2c_buses[i].client      = (KArbiterClient) { 0 };
+            i2c_buses[i].refs        = 0;
+            i2c_buses[i].closing     = false;
+            i2c_buses[i].has_timeout = false;
+            i2c_buses[i].addr        = I2C_ADDR_UNKNOWN;
+            i2c_buses[i].fd          = fd;
+            break;
+        }
+    }
+
+    /*
+     * If the table is full, the connection is simply not tracked. Every
+     * transaction will program the slave address, and there is no arbitration
+     */
+    pthread_mutex_unlock(&i2c_buses_mutex);
+}
+
+/*
+ * Stop tracking a connection which is about to be closed. Calls already using
+ * the connection are allowed to finish first, so that the arbiter isn't
+ * destroyed while it's held or waited on
+ */
+static void kprv_i2c_unregister(int fd)
+{
+    pthread_mutex_lock(&i2c_buses_mutex);
+
+    for (int i = 0; i < I2C_MAX_BUSES; i++)
+    {
+        if (i2c_buses[i].fd == fd && !i2c_buses[i].closing)
+        {
+            i2c_device_state * device = i2c_buses[i].device;
+
+            /* Keep new calls out while the old ones drain */
+            i2c_buses[i].closing = true;
+            while (i2c_buses[i].refs > 0)
+            {
+                pthread_cond_wait(&i2c_buses_cond, &i2c_buses_mutex);
+            }
+
+            i2c_buses[i].closing = false;
+            i2c_buses[i].fd      = 0;
+            if (--device->users == 0)
+            {
+                k_arbiter_destroy(&device->arbiter);
+            }
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&i2c_buses_mutex);
+}
+
+/* Find the state for a connection. The caller must hold i2c_buses_mutex */
+static i2c_bus_state * kprv_i2c_find_bus(int fd)
+{
+    if (fd == 0)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < I2C_MAX_BUSES; i++)
+    {
+        if (i2c_buses[i].fd == fd && !i2c_buses[i].closing)
+        {
+            return &i2c_buses[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Drop a reference taken by kprv_i2c_lock_bus */
+static void kprv_i2c_put_bus(i2c_bus_state * bus)
+{
+    pthread_mutex_lock(&i2c_buses_mutex);
+
+    if (--bus->refs == 0)
+    {
+        pthread_cond_broadcast(&i2c_buses_cond);
+    }
+
+    pthread_mutex_unlock(&i2c_buses_mutex);
+}
+
+/*
+ * Wait for a connection's turn on the bus. `*bus` is left NULL if the
+ * connection isn't tracked, in which case there is nothing to wait for.
+ * Otherwise the connection is referenced until kprv_i2c_unlock_bus
+ */
+static KI2CStatus kprv_i2c_lock_bus(int fd, const KArbiterRequest * request,
+                                    i2c_bus_state ** bus)
+{
+    struct timespec timeout;
+    bool            has_timeout = false;
+
+    pthread_mutex_lock(&i2c_buses_mutex);
+
+    *bus = kprv_i2c_find_bus(fd);
+    if (*bus != NULL)
+    {
+        (*bus)->refs++;
+        has_timeout = (*bus)->has_timeout;
+        timeout     = (*bus)->timeout;
+    }
+
+    pthread_mutex_unlock(&i2c_buses_mutex);
+
+    if (*bus != NULL
+        && !k_arbiter_acquire_request(&(*bus)->device->arbiter,
+                                      &(*bus)->client, request,
+                                      has_timeout ? &timeout : NULL))
+    {
+        kprv_i2c_put_bus(*bus);
+        *bus = NULL;
+        return I2C_ERROR_TIMEOUT;
+    }
+
+    return I2C_OK;
+}
+
+/*
+ * Let a more urgent request have the bus in-between messages. `*bus` is left
+ * NULL (and its reference dropped) if the bus couldn't be taken back
+ */
+static KI2CStatus kprv_i2c_yield_bus(const KArbiterRequest * request,
+                                     i2c_bus_state ** bus)
+{
+    struct timespec timeout;
+    bool            has_timeout;
+
+    if (*bus == NULL)
+    {
+        return I2C_OK;
+    }
+
+    pthread_mutex_lock(&i2c_buses_mutex);
+    has_timeout = (*bus)->has_timeout;
+    timeout     = (*bus)->timeout;
+    pthread_mutex_unlock(&i2c_buses_mutex);
+
+    if (!k_arbiter_yield(&(*bus)->device->arbiter, &(*bus)->client, request,
+                         has_timeout ? &timeout : NULL))
+    {
+        kprv_i2c_put_bus(*bus);
+        *bus = NULL;
+        return I2C_ERROR_TIMEOUT;
+    }
+
+    return I2C_OK;
+}
+
+static void kprv_i2c_unlock_bus(i2c_bus_state * bus)
+{
+    if (bus != NULL)
+    {
+        k_arbiter_release(&bus->device->arbiter);
+        kprv_i2c_put_bus(bus);
+    }
+}
+
+/* Point the connection at the requested slave, if it isn't already */
+static KI2CStatus kprv_i2c_select(i2c_bus_state * bus, int fd, uint16_t addr)
+{
+    if (bus != NULL && bus->addr == addr)
+    {
+        return I2C_OK;
+    }
+
+    if (ioctl(fd, I2C_SLAVE, addr) < 0)
+    {
+        perror("Couldn't reach requested address");
+        if (bus != NULL)
+        {
+            bus->addr = I2C_ADDR_UNKNOWN;
+        }
+        return I2C_ERROR_ADDR_TIMEOUT;
+    }
+
+    if (bus != NULL)
+    {
+        bus->addr = addr;
+    }
+
+    return I2C_OK;
+}
+
 KI2CStatus k_i2c_init(char * device, int * fp)
 {
     if (device == NULL || fp == NULL)
@@ -46,6 +331,8 @@ KI2CStatus k_i2c_init(char * device, int * fp)
         return I2C_ERROR_CONFIG;
     }
 
+    kprv_i2c_register(*fp, bus);
+
     return I2C_OK;
 }
 
@@ -56,36 +343,190 @@ void k_i2c_terminate(int * fp)
         return;
     }
 
+    kprv_i2c_unregister(*fp);
     close(*fp);
     *fp = 0;
 
     return;
 }
 
-KI2CStatus k_i2c_write(int i2c, uint16_t addr, uint8_t* ptr, int len)
+/* Select the slave and transmit. The caller must hold the bus lock */
+static KI2CStatus kprv_i2c_write(i2c_bus_state * bus, int i2c, uint16_t addr,
+                                 uint8_t * ptr, int len)
 {
-    if (i2c == 0 || ptr == NULL)
+    /* Set the desired slave's address */
+    KI2CStatus status = kprv_i2c_select(bus, i2c, addr);
+
+    /* Transmit buffer */
+    if (status == I2C_OK && write(i2c, ptr, len) != len)
     {
-        return I2C_ERROR;
+        perror("I2C write failed");
+        status = I2C_ERROR;
     }
 
+    return status;
+}
+
+/* Select the slave and read. The caller must hold the bus lock */
+static KI2CStatus kprv_i2c_read(i2c_bus_state * bus, int i2c, uint16_t addr,
+                                uint8_t * ptr, int len)
+{
     /* Set the desired slave's address */
-    if (ioctl(i2c, I2C_SLAVE, addr) < 0)
+    KI2CStatus status = kprv_i2c_select(bus, i2c, addr);
+
+    /* Read in data */
+    if (status == I2C_OK && read(i2c, ptr, len) != len)
     {
-        perror("Couldn't reach requested address");
-        return I2C_ERROR_ADDR_TIMEOUT;
+        perror("I2C read failed");
+        status = I2C_ERROR;
     }
 
-    /* Transmit buffer */
-    if (write(i2c, ptr, len) != len)
+    return status;
+}
+
+/* Write followed by a repeated-start read. Doesn't touch the slave address */
+static KI2CStatus kprv_i2c_transfer(int i2c, uint16_t addr, uint8_t * tx,
+                                    int tx_len, uint8_t * rx, int rx_len)
+{
+    struct i2c_msg msgs[2] = {
+        {.addr = addr, .flags = 0, .len = tx_len, .buf = tx },
+        {.addr = addr, .flags = I2C_M_RD, .len = rx_len, .buf = rx }
+    };
+    struct i2c_rdwr_ioctl_data packets = {.msgs = msgs, .nmsgs = 2 };
+
+    /* On success, the number of messages transferred is returned */
+    if (ioctl(i2c, I2C_RDWR, &packets) != 2)
     {
-        perror("I2C write failed");
+        perror("I2C transfer failed");
         return I2C_ERROR;
     }
 
     return I2C_OK;
 }
 
+/*
+ * Flatten a scatter/gather list into a single message. A single buffer is used
+ * in place; anything else is copied into `scratch`, which must be
+ * I2C_MAX_GATHER bytes long
+ */
+static KI2CStatus kprv_i2c_gather(const struct iovec * iov, int iovcnt,
+                                  uint8_t * scratch, uint8_t ** msg, int * len)
+{
+    size_t total = 0;
+
+    if (iov == NULL || iovcnt < 1)
+    {
+        return I2C_ERROR;
+    }
+
+    for (int i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].iov_base == NULL && iov[i].iov_len != 0)
+        {
+            return I2C_ERROR;
+        }
+        total += iov[i].iov_len;
+    }
+
+    if (total == 0)
+    {
+        return I2C_ERROR;
+    }
+
+    if (iovcnt == 1)
+    {
+        *msg = (uint8_t *) iov[0].iov_base;
+        *len = (int) total;
+        return I2C_OK;
+    }
+
+    if (total > I2C_MAX_GATHER)
+    {
+        return I2C_ERROR_CONFIG;
+    }
+
+    /*
+     * The pieces can't be handed to the adapter as separate messages without
+     * I2C_M_NOSTART, which most adapters don't support, so join them here
+     */
+    uint8_t * pos = scratch;
+    for (int i = 0; i < iovcnt; i++)
+    {
+        memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+        pos += iov[i].iov_len;
+    }
+
+    *msg = scratch;
+    *len = (int) total;
+
+    return I2C_OK;
+}
+
+/* Run a single batch message. The caller must hold the bus lock */
+static KI2CStatus kprv_i2c_batch_msg(i2c_bus_state * bus, int i2c,
+                                     KI2CBatchMsg * msg)
+{
+    bool has_tx    = msg->tx_len > 0;
+    bool has_rx    = msg->rx_len > 0;
+    bool has_delay = msg->delay != NULL
+                     && (msg->delay->tv_sec != 0 || msg->delay->tv_nsec != 0);
+    KI2CStatus status = I2C_OK;
+
+    if ((has_tx && msg->tx == NULL) || (has_rx && msg->rx == NULL)
+        || msg->tx_len < 0 || msg->rx_len < 0)
+    {
+        return I2C_ERROR;
+    }
+
+    if (has_tx && has_rx && !has_delay)
+    {
+        /* Nothing needs to happen in-between, so use a repeated start */
+        return kprv_i2c_transfer(i2c, msg->addr, msg->tx, msg->tx_len, msg->rx,
+                                 msg->rx_len);
+    }
+
+    if (has_tx)
+    {
+        status = kprv_i2c_write(bus, i2c, msg->addr, msg->tx, msg->tx_len);
+        if (status != I2C_OK)
+        {
+            return status;
+        }
+    }
+
+    if (has_delay)
+    {
+        nanosleep(msg->delay, NULL);
+    }
+
+    if (has_rx)
+    {
+        status = kprv_i2c_read(bus, i2c, msg->addr, msg->rx, msg->rx_len);
+    }
+
+    return status;
+}
+
+KI2CStatus k_i2c_write(int i2c, uint16_t addr, uint8_t* ptr, int len)
+{
+    if (i2c == 0 || ptr == NULL)
+    {
+        return I2C_ERROR;
+    }
+
+    i2c_bus_state * bus;
+    KI2CStatus      status = kprv_i2c_lock_bus(i2c, NULL, &bus);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    status = kprv_i2c_write(bus, i2c, addr, ptr, len);
+    kprv_i2c_unlock_bus(bus);
+
+    return status;
+}
+
 KI2CStatus k_i2c_read(int i2c, uint16_t addr, uint8_t* ptr, int len)
 {
     if (i2c == 0 || ptr == NULL)
@@ -93,19 +534,212 @@ KI2CStatus k_i2c_read(int i2c, uint16_t addr, uint8_t* ptr, int len)
         return I2C_ERROR;
     }
 
-    /* Set the desired slave's address */
-    if (ioctl(i2c, I2C_SLAVE, addr) < 0)
+    i2c_bus_state * bus;
+    KI2CStatus      status = kprv_i2c_lock_bus(i2c, NULL, &bus);
+    if (status != I2C_OK)
     {
-        perror("Couldn't reach requested address");
-        return I2C_ERROR_ADDR_TIMEOUT;
+        return status;
     }
 
-    /* Read in data */
-    if (read(i2c, ptr, len) != len)
+    status = kprv_i2c_read(bus, i2c, addr, ptr, len);
+    kprv_i2c_unlock_bus(bus);
+
+    return status;
+}
+
+KI2CStatus k_i2c_transfer(int i2c, uint16_t addr, uint8_t * tx, int tx_len,
+                          uint8_t * rx, int rx_len)
+{
+    i2c_bus_state * bus;
+    KI2CStatus      status;
+
+    if (i2c == 0 || tx == NULL || tx_len < 1 || rx == NULL || rx_len < 1)
     {
-        perror("I2C read failed");
         return I2C_ERROR;
     }
 
-    return I2C_OK;
+    /*
+     * The transfer itself is a single ioctl, but it still has to wait for any
+     * other connection's multi-part transaction to finish
+     */
+    status = kprv_i2c_lock_bus(i2c, NULL, &bus);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    status = kprv_i2c_transfer(i2c, addr, tx, tx_len, rx, rx_len);
+    kprv_i2c_unlock_bus(bus);
+
+    return status;
+}
+
+KI2CStatus k_i2c_writev(int i2c, uint16_t addr, const struct iovec * iov,
+                        int iovcnt)
+{
+    uint8_t    scratch[I2C_MAX_GATHER];
+    uint8_t *  msg;
+    int        len;
+    KI2CStatus status;
+
+    if (i2c == 0)
+    {
+        return I2C_ERROR;
+    }
+
+    status = kprv_i2c_gather(iov, iovcnt, scratch, &msg, &len);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    i2c_bus_state * bus;
+    status = kprv_i2c_lock_bus(i2c, NULL, &bus);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    status = kprv_i2c_write(bus, i2c, addr, msg, len);
+    kprv_i2c_unlock_bus(bus);
+
+    return status;
+}
+
+KI2CStatus k_i2c_transferv(int i2c, uint16_t addr, const struct iovec * iov,
+                           int iovcnt, uint8_t * rx, int rx_len)
+{
+    uint8_t    scratch[I2C_MAX_GATHER];
+    uint8_t *  msg;
+    int        len;
+    KI2CStatus status;
+
+    if (i2c == 0 || rx == NULL || rx_len < 1)
+    {
+        return I2C_ERROR;
+    }
+
+    status = kprv_i2c_gather(iov, iovcnt, scratch, &msg, &len);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    i2c_bus_state * bus;
+    status = kprv_i2c_lock_bus(i2c, NULL, &bus);
+    if (status != I2C_OK)
+    {
+        return status;
+    }
+
+    status = kprv_i2c_transfer(i2c, addr, msg, len, rx, rx_len);
+    kprv_i2c_unlock_bus(bus);
+
+    return status;
+}
+
+KI2CStatus k_i2c_batch(int i2c, KI2CBatchMsg * msgs, int count)
+{
+    return k_i2c_batch_request(i2c, NULL, msgs, count);
+}
+
+KI2CStatus k_i2c_batch_request(int i2c, const KArbiterRequest * request,
+                               KI2CBatchMsg * msgs, int count)
+{
+    i2c_bus_state * bus;
+    KI2CStatus      result;
+    KI2CStatus      lock;
+
+    if (i2c == 0 || msgs == NULL || count < 1)
+    {
+        return I2C_ERROR;
+    }
+
+    /* Hold the bus for the whole sweep */
+    result = kprv_i2c_lock_bus(i2c, request, &bus);
+    if (result != I2C_OK)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            msgs[i].status = result;
+        }
+        return result;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0 && msgs[i].yield)
+        {
+            lock = kprv_i2c_yield_bus(request, &bus);
+            if (lock != I2C_OK)
+            {
+                /* We no longer have the bus, so the rest can't be sent */
+                for (; i < count; i++)
+                {
+                    msgs[i].status = lock;
+                }
+                return I2C_ERROR;
+            }
+        }
+
+        /*
+         * Keep going after a failure so that the caller gets whatever data
+         * was available
+         */
+        msgs[i].status = kprv_i2c_batch_msg(bus, i2c, &msgs[i]);
+        clock_gettime(CLOCK_MONOTONIC, &msgs[i].done);
+        if (msgs[i].status != I2C_OK)
+        {
+            result = I2C_ERROR;
+        }
+    }
+
+    kprv_i2c_unlock_bus(bus);
+
+    return result;
+}
+
+KI2CStatus k_i2c_set_arbitration(int i2c, int priority,
+                                 const struct timespec * timeout)
+{
+    i2c_bus_state * bus;
+
+    pthread_mutex_lock(&i2c_buses_mutex);
+
+    bus = kprv_i2c_find_bus(i2c);
+    if (bus != NULL)
+    {
+        bus->has_timeout = (timeout != NULL);
+        if (timeout != NULL)
+        {
+            bus->timeout = *timeout;
+        }
+        k_arbiter_set_priority(&bus->device->arbiter, &bus->client, priority);
+    }
+
+    pthread_mutex_unlock(&i2c_buses_mutex);
+
+    return (bus != NULL) ? I2C_OK : I2C_ERROR;
+}
+
+KI2CStatus k_i2c_get_arbitration_stats(int i2c, KArbiterStats * stats)
+{
+    i2c_bus_state * bus;
+
+    if (stats == NULL)
+    {
+        return I2C_ERROR;
+    }
+
+    pthread_mutex_lock(&i2c_buses_mutex);
+
+    bus = kprv_i2c_find_bus(i2c);
+    if (bus != NULL)
+    {
+        k_arbiter_get_stats(&bus->device->arbiter, &bus->client, stats);
+    }
+
+    pthread_mutex_unlock(&i2c_buses_mutex);
+
+    return (bus != NULL) ? I2C_OK : I2C_ERROR;
 }
@@ -0,0 +1,280 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "kick.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NSEC_PER_SEC 1000000000L
+
+/* A kick may be run this fraction of its period early, to share a wake-up */
+#define KICK_EARLY_DIVISOR 8
+
+static pthread_mutex_t kick_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  kick_cond;       /* Signalled whenever the schedule changes */
+static pthread_once_t  kick_once = PTHREAD_ONCE_INIT;
+static pthread_t       kick_thread;
+static bool            kick_running  = false; /* Whether kick_thread exists */
+static bool            kick_stopping = false; /* Set to ask kick_thread to exit */
+static KKick *         kick_list     = NULL;  /* Registered kicks */
+static KKick *         kick_current  = NULL;  /* Kick being run, if any */
+
+/* Timed waits are measured against the monotonic clock, like everything else */
+static void kprv_kick_setup(void)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&kick_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static uint64_t kprv_kick_ns(const struct timespec * ts)
+{
+    return (uint64_t) ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static struct timespec kprv_kick_from_ns(uint64_t ns)
+{
+    struct timespec ts = {.tv_sec  = ns / NSEC_PER_SEC,
+                          .tv_nsec = ns % NSEC_PER_SEC };
+    return ts;
+}
+
+/* Earliest time the kick may be run along with another one */
+static uint64_t kprv_kick_window(const KKick * kick)
+{
+    uint64_t due   = kprv_kick_ns(&kick->due);
+    uint64_t early = kprv_kick_ns(&kick->period) / KICK_EARLY_DIVISOR;
+
+    return (due > early) ? due - early : 0;
+}
+
+/*
+ * Find a kick which should be run now: one which is due, or, if `coalesce` is
+ * set, one whose early window has opened. The caller must hold kick_mutex
+ */
+static KKick * kprv_kick_next(uint64_t now, bool coalesce)
+{
+    KKick * kick;
+
+    for (kick = kick_list; kick != NULL; kick = kick->next)
+    {
+        if (kprv_kick_ns(&kick->due) <= now)
+        {
+            return kick;
+        }
+    }
+
+    for (kick = kick_list; coalesce && kick != NULL; kick = kick->next)
+    {
+        if (kprv_kick_window(kick) <= now)
+        {
+            return kick;
+        }
+    }
+
+    return NULL;
+}
+
+static void * kprv_kick_thread(void * arg)
+{
+    struct timespec now;
+    struct timespec wake;
+    KKick *         kick;
+    bool            coalesce = false;
+
+    pthread_mutex_lock(&kick_mutex);
+
+    while (!kick_stopping)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        kick = kprv_kick_next(kprv_kick_ns(&now), coalesce);
+        if (kick != NULL)
+        {
+            /* The period runs from when the kick actually happens */
+            kick->due = kprv_kick_from_ns(kprv_kick_ns(&now)
+                                          + kprv_kick_ns(&kick->period));
+            kick_current = kick;
+
+            pthread_mutex_unlock(&kick_mutex);
+            kick->func(kick->arg);
+            pthread_mutex_lock(&kick_mutex);
+
+            kick_current = NULL;
+            kick->first  = false;
+            pthread_cond_broadcast(&kick_cond);
+
+            /* We're awake anyway, so run anything which is nearly due */
+            coalesce = true;
+            continue;
+        }
+
+        coalesce = false;
+
+        if (kick_list == NULL)
+        {
+            pthread_cond_wait(&kick_cond, &kick_mutex);
+            continue;
+        }
+
+        /* Sleep until the next kick is due */
+        wake = kick_list->due;
+        for (kick = kick_list->next; kick != NULL; kick = kick->next)
+        {
+            if (kprv_kick_ns(&kick->due) < kprv_kick_ns(&wake))
+            {
+                wake = kick->due;
+            }
+        }
+        pthread_cond_timedwait(&kick_cond, &kick_mutex, &wake);
+    }
+
+    pthread_mutex_unlock(&kick_mutex);
+
+    return NULL;
+}
+
+bool k_kick_register(KKick * kick)
+{
+    bool self;
+
+    if (kick == NULL || kick->func == NULL
+        || (kick->period.tv_sec == 0 && kick->period.tv_nsec == 0))
+    {
+        return false;
+    }
+
+    pthread_once(&kick_once, kprv_kick_setup);
+    pthread_mutex_lock(&kick_mutex);
+
+    /* Let a previous scheduler thread finish exiting */
+    while (kick_stopping)
+    {
+        pthread_cond_wait(&kick_cond, &kick_mutex);
+    }
+
+    if (kick->registered)
+    {
+        pthread_mutex_unlock(&kick_mutex);
+        return true;
+    }
+
+    if (!kick_running)
+    {
+        if (pthread_create(&kick_thread, NULL, kprv_kick_thread, NULL) != 0)
+        {
+            pthread_mutex_unlock(&kick_mutex);
+            return false;
+        }
+        kick_running = true;
+    }
+
+    /* Kick right away */
+    clock_gettime(CLOCK_MONOTONIC, &kick->due);
+    kick->registered = true;
+    kick->first      = true;
+    kick->next       = kick_list;
+    kick_list        = kick;
+    pthread_cond_broadcast(&kick_cond);
+
+    /* A kick registering another one can't wait for the scheduler */
+    self = pthread_equal(pthread_self(), kick_thread);
+
+    while (!self && kick->registered && kick->first)
+    {
+        pthread_cond_wait(&kick_cond, &kick_mutex);
+    }
+
+    pthread_mutex_unlock(&kick_mutex);
+
+    return true;
+}
+
+bool k_kick_unregister(KKick * kick)
+{
+    KKick ** link;
+    bool     self;
+
+    if (kick == NULL)
+    {
+        return false;
+    }
+
+    pthread_once(&kick_once, kprv_kick_setup);
+    pthread_mutex_lock(&kick_mutex);
+
+    if (!kick->registered)
+    {
+        pthread_mutex_unlock(&kick_mutex);
+        return false;
+    }
+
+    for (link = &kick_list; *link != kick; link = &(*link)->next)
+    {
+        continue;
+    }
+    *link            = kick->next;
+    kick->registered = false;
+    kick->next       = NULL;
+
+    /* A kick unregistering itself can't wait for itself to finish */
+    self = kick_running && pthread_equal(pthread_self(), kick_thread);
+
+    while (!self && kick_current == kick)
+    {
+        pthread_cond_wait(&kick_cond, &kick_mutex);
+    }
+
+    /* Nothing left to kick, so the thread's stack can be given back */
+    if (!self && kick_list == NULL && kick_running && !kick_stopping)
+    {
+        kick_stopping = true;
+        pthread_cond_broadcast(&kick_cond);
+
+        pthread_mutex_unlock(&kick_mutex);
+        pthread_join(kick_thread, NULL);
+        pthread_mutex_lock(&kick_mutex);
+
+        kick_running  = false;
+        kick_stopping = false;
+        pthread_cond_broadcast(&kick_cond);
+    }
+
+    pthread_mutex_unlock(&kick_mutex);
+
+    return true;
+}
+
+bool k_kick_is_registered(const KKick * kick)
+{
+    bool registered;
+
+    if (kick == NULL)
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&kick_mutex);
+    registered = kick->registered;
+    pthread_mutex_unlock(&kick_mutex);
+
+    return registered;
+}
@@ -0,0 +1,114 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pacing.h"
+#include <errno.h>
+#include <stddef.h>
+
+#define NSEC_PER_SEC 1000000000L
+
+void k_pacer_init(KPacer * pacer, const struct timespec * min_gap)
+{
+    if (pacer == NULL)
+    {
+        return;
+    }
+
+    pacer->active = false;
+    pacer->last.tv_sec = 0;
+    pacer->last.tv_nsec = 0;
+    k_pacer_set_gap(pacer, min_gap);
+}
+
+void k_pacer_get_gap(const KPacer * pacer, struct timespec * min_gap)
+{
+    if (pacer == NULL || min_gap == NULL)
+    {
+        return;
+    }
+
+    *min_gap = pacer->min_gap;
+}
+
+void k_pacer_set_gap(KPacer * pacer, const struct timespec * min_gap)
+{
+    if (pacer == NULL)
+    {
+        return;
+    }
+
+    if (min_gap == NULL)
+    {
+        pacer->min_gap.tv_sec = 0;
+        pacer->min_gap.tv_nsec = 0;
+    }
+    else
+    {
+        pacer->min_gap = *min_gap;
+    }
+}
+
+void k_pacer_wait(KPacer * pacer)
+{
+    if (pacer == NULL)
+    {
+        return;
+    }
+
+    k_pacer_wait_gap(pacer, &pacer->min_gap);
+}
+
+void k_pacer_wait_gap(KPacer * pacer, const struct timespec * gap)
+{
+    if (pacer == NULL || gap == NULL || !pacer->active)
+    {
+        return;
+    }
+
+    /* Work out when the gap ends and sleep until then */
+    struct timespec deadline = {
+        .tv_sec = pacer->last.tv_sec + gap->tv_sec,
+        .tv_nsec = pacer->last.tv_nsec + gap->tv_nsec
+    };
+
+    if (deadline.tv_nsec >= NSEC_PER_SEC)
+    {
+        deadline.tv_sec += deadline.tv_nsec / NSEC_PER_SEC;
+        deadline.tv_nsec %= NSEC_PER_SEC;
+    }
+
+    /*
+     * An absolute sleep returns immediately if the deadline has already
+     * passed, and doesn't drift if we get interrupted by a signal
+     */
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)
+           == EINTR)
+    {
+        continue;
+    }
+}
+
+void k_pacer_mark(KPacer * pacer)
+{
+    if (pacer == NULL)
+    {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &pacer->last);
+    pacer->active = true;
+}
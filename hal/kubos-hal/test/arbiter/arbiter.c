@@ -0,0 +1,314 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmocka.h>
+#include <stdint.h>
+#include "arbiter.h"
+
+#define NUM_WAITERS 3
+
+/* Time for a new thread to start waiting on the arbiter */
+static const struct timespec settle = {.tv_sec = 0, .tv_nsec = 20000000 };
+static const struct timespec short_timeout = {.tv_sec = 0, .tv_nsec = 10000000 };
+
+static KArbiter arbiter;
+
+/* Order in which waiting threads got the bus */
+static int order[NUM_WAITERS];
+static int served;
+
+typedef struct {
+    int               id;
+    KArbiterClient    client;
+    KArbiterRequest * request;
+} waiter;
+
+static void * wait_for_bus(void * arg)
+{
+    waiter * self = arg;
+
+    if (k_arbiter_acquire_request(&arbiter, &self->client, self->request, NULL))
+    {
+        order[served++] = self->id;
+        k_arbiter_release(&arbiter);
+    }
+
+    return NULL;
+}
+
+/* Hold the bus while each waiter queues up, then let them all through */
+static void run_waiters(waiter * waiters, int count)
+{
+    pthread_t      threads[NUM_WAITERS];
+    KArbiterClient holder = { 0 };
+
+    served = 0;
+    assert_true(k_arbiter_acquire(&arbiter, &holder, NULL));
+
+    for (int i = 0; i < count; i++)
+    {
+        pthread_create(&threads[i], NULL, wait_for_bus, &waiters[i]);
+        nanosleep(&settle, NULL);
+    }
+
+    k_arbiter_release(&arbiter);
+
+    for (int i = 0; i < count; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    assert_int_equal(served, count);
+}
+
+static int setup(void ** state)
+{
+    return k_arbiter_init(&arbiter) ? 0 : -1;
+}
+
+static int teardown(void ** state)
+{
+    k_arbiter_destroy(&arbiter);
+    return 0;
+}
+
+static void test_uncontended(void ** arg)
+{
+    KArbiterClient client = { 0 };
+    KArbiterStats  stats;
+
+    for (int i = 0; i < 3; i++)
+    {
+        assert_true(k_arbiter_acquire(&arbiter, &client, NULL));
+        k_arbiter_release(&arbiter);
+    }
+
+    k_arbiter_get_stats(&arbiter, &client, &stats);
+    assert_int_equal(stats.acquired, 3);
+    assert_int_equal(stats.contended, 0);
+    assert_int_equal(stats.timeouts, 0);
+}
+
+static void test_timeout(void ** arg)
+{
+    KArbiterClient        holder = { 0 };
+    KArbiterClient        client = { 0 };
+    KArbiterStats         stats;
+    const struct timespec none   = { 0 };
+
+    assert_true(k_arbiter_acquire(&arbiter, &holder, NULL));
+
+    assert_false(k_arbiter_acquire(&arbiter, &client, &short_timeout));
+    assert_false(k_arbiter_acquire(&arbiter, &client, &none));
+
+    k_arbiter_release(&arbiter);
+
+    /* Nobody is left queued, so the bus is free again */
+    assert_true(k_arbiter_acquire(&arbiter, &client, &none));
+    k_arbiter_release(&arbiter);
+
+    k_arbiter_get_stats(&arbiter, &client, &stats);
+    assert_int_equal(stats.timeouts, 2);
+    assert_int_equal(stats.acquired, 1);
+    assert_true(stats.wait_max_ns >= (uint64_t) short_timeout.tv_nsec);
+    assert_true(stats.wait_total_ns >= stats.wait_max_ns);
+}
+
+static void test_fifo(void ** arg)
+{
+    waiter        waiters[NUM_WAITERS];
+    KArbiterStats stats;
+
+    for (int i = 0; i < NUM_WAITERS; i++)
+    {
+        waiters[i] = (waiter) {.id = i };
+    }
+
+    run_waiters(waiters, NUM_WAITERS);
+
+    /* Served in order of arrival */
+    for (int i = 0; i < NUM_WAITERS; i++)
+    {
+        assert_int_equal(order[i], i);
+    }
+
+    k_arbiter_get_stats(&arbiter, &waiters[0].client, &stats);
+    assert_int_equal(stats.acquired, 1);
+    assert_int_equal(stats.contended, 1);
+    assert_true(stats.wait_total_ns > 0);
+}
+
+static void test_priority(void ** arg)
+{
+    waiter waiters[NUM_WAITERS] = {
+        {.id = 0, .client = {.priority = 0 } },
+        {.id = 1, .client = {.priority = 5 } },
+        {.id = 2, .client = {.priority = 5 } }
+    };
+
+    run_waiters(waiters, NUM_WAITERS);
+
+    /* Higher priority first, then in order of arrival */
+    assert_int_equal(order[0], 1);
+    assert_int_equal(order[1], 2);
+    assert_int_equal(order[2], 0);
+}
+
+static void test_set_priority(void ** arg)
+{
+    waiter waiters[2] = {
+        {.id = 0 },
+        {.id = 1 }
+    };
+
+    k_arbiter_set_priority(&arbiter, &waiters[1].client, 1);
+    run_waiters(waiters, 2);
+
+    assert_int_equal(order[0], 1);
+    assert_int_equal(order[1], 0);
+}
+
+static void test_deadline_order(void ** arg)
+{
+    struct timespec now;
+    struct timespec early;
+    struct timespec late;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    early = (struct timespec) {.tv_sec = now.tv_sec + 10, .tv_nsec = 0 };
+    late  = (struct timespec) {.tv_sec = now.tv_sec + 20, .tv_nsec = 0 };
+
+    KArbiterRequest none_req  = {.priority = ARBITER_NORMAL, .deadline = NULL };
+    KArbiterRequest late_req  = {.priority = ARBITER_NORMAL, .deadline = &late };
+    KArbiterRequest early_req = {.priority = ARBITER_NORMAL, .deadline = &early };
+
+    waiter waiters[NUM_WAITERS] = {
+        {.id = 0, .request = &none_req },
+        {.id = 1, .request = &late_req },
+        {.id = 2, .request = &early_req }
+    };
+
+    run_waiters(waiters, NUM_WAITERS);
+
+    /* Earliest deadline first, and anything with a deadline before the rest */
+    assert_int_equal(order[0], 2);
+    assert_int_equal(order[1], 1);
+    assert_int_equal(order[2], 0);
+}
+
+static void test_request_priority(void ** arg)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    KArbiterRequest bulk    = {.priority = ARBITER_BULK, .deadline = &now };
+    KArbiterRequest control = {.priority = ARBITER_CONTROL, .deadline = NULL };
+
+    /* The request's priority counts, not the client's */
+    waiter waiters[2] = {
+        {.id = 0, .client = {.priority = 5 }, .request = &bulk },
+        {.id = 1, .request = &control }
+    };
+
+    run_waiters(waiters, 2);
+
+    assert_int_equal(order[0], 1);
+    assert_int_equal(order[1], 0);
+}
+
+static void test_deadline_miss(void ** arg)
+{
+    KArbiterClient  client = { 0 };
+    KArbiterStats   stats;
+    struct timespec past;
+    struct timespec future;
+
+    clock_gettime(CLOCK_MONOTONIC, &past);
+    future = (struct timespec) {.tv_sec = past.tv_sec + 10, .tv_nsec = 0 };
+
+    KArbiterRequest late    = {.priority = ARBITER_CONTROL, .deadline = &past };
+    KArbiterRequest on_time = {.priority = ARBITER_CONTROL, .deadline = &future };
+
+    assert_true(k_arbiter_acquire_request(&arbiter, &client, &late, NULL));
+    k_arbiter_release(&arbiter);
+    assert_true(k_arbiter_acquire_request(&arbiter, &client, &on_time, NULL));
+    k_arbiter_release(&arbiter);
+
+    k_arbiter_get_stats(&arbiter, &client, &stats);
+    assert_int_equal(stats.acquired, 2);
+    assert_int_equal(stats.deadline_misses, 1);
+}
+
+static void test_yield(void ** arg)
+{
+    KArbiterClient  holder  = { 0 };
+    KArbiterRequest sweep   = {.priority = ARBITER_BULK, .deadline = NULL };
+    KArbiterRequest control = {.priority = ARBITER_CONTROL, .deadline = NULL };
+    KArbiterStats   stats;
+    pthread_t       thread;
+    pthread_t       urgent_thread;
+    waiter          peer   = {.id = 0, .request = &sweep };
+    waiter          urgent = {.id = 1, .request = &control };
+
+    served = 0;
+    assert_true(k_arbiter_acquire_request(&arbiter, &holder, &sweep, NULL));
+
+    /* Nobody is waiting */
+    assert_true(k_arbiter_yield(&arbiter, &holder, &sweep, NULL));
+    assert_int_equal(served, 0);
+
+    /* A waiter with the same priority has to wait for the release */
+    pthread_create(&thread, NULL, wait_for_bus, &peer);
+    nanosleep(&settle, NULL);
+    assert_true(k_arbiter_yield(&arbiter, &holder, &sweep, NULL));
+    assert_int_equal(served, 0);
+
+    /* A more urgent one goes in-between, and the holder keeps its place */
+    pthread_create(&urgent_thread, NULL, wait_for_bus, &urgent);
+    nanosleep(&settle, NULL);
+    assert_true(k_arbiter_yield(&arbiter, &holder, &sweep, NULL));
+    pthread_join(urgent_thread, NULL);
+    assert_int_equal(served, 1);
+    assert_int_equal(order[0], 1);
+
+    k_arbiter_release(&arbiter);
+    pthread_join(thread, NULL);
+    assert_int_equal(served, 2);
+    assert_int_equal(order[1], 0);
+
+    k_arbiter_get_stats(&arbiter, &holder, &stats);
+    assert_int_equal(stats.preemptions, 1);
+    assert_int_equal(stats.acquired, 2);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_uncontended, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_timeout, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_fifo, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_priority, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_set_priority, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_deadline_order, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_request_priority, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_deadline_miss, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_yield, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
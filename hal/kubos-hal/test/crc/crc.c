@@ -0,0 +1,139 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmocka.h>
+#include "crc.h"
+
+/* Standard check input for CRC catalogues */
+static const uint8_t check_data[] = "123456789";
+#define CHECK_LEN 9
+
+/* Bit-at-a-time references to compare the table-driven versions against */
+static uint8_t ref_crc8(uint8_t crc, const uint8_t * data, size_t len)
+{
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint16_t ref_crc16(uint16_t crc, const uint8_t * data, size_t len)
+{
+    while (len--)
+    {
+        crc ^= (uint16_t)(*data++ << 8);
+        for (int i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint32_t ref_crc32(uint32_t crc, const uint8_t * data, size_t len)
+{
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+static void test_check_values(void ** arg)
+{
+    assert_int_equal(k_crc8(K_CRC8_INIT, check_data, CHECK_LEN), 0xF4);
+    assert_int_equal(k_crc16(K_CRC16_CCITT_INIT, check_data, CHECK_LEN), 0x29B1);
+    assert_int_equal(k_crc32(K_CRC32_INIT, check_data, CHECK_LEN), 0xCBF43926);
+}
+
+static void test_generic(void ** arg)
+{
+    assert_int_equal(k_crc_calculate(K_CRC8, K_CRC8_INIT, check_data, CHECK_LEN),
+                     0xF4);
+    assert_int_equal(k_crc_calculate(K_CRC16_CCITT, K_CRC16_CCITT_INIT,
+                                     check_data, CHECK_LEN),
+                     0x29B1);
+    assert_int_equal(k_crc_calculate(K_CRC32, K_CRC32_INIT, check_data, CHECK_LEN),
+                     0xCBF43926);
+    assert_int_equal(k_crc_calculate((KCRCType) 99, 0x1234, check_data, CHECK_LEN),
+                     0x1234);
+}
+
+static void test_match_reference(void ** arg)
+{
+    uint8_t data[80];
+
+    for (int i = 0; i < (int) sizeof(data); i++)
+    {
+        data[i] = (uint8_t)(i * 37 + 11);
+    }
+
+    /* Cover every combination of slices + leftover bytes, at every alignment */
+    for (size_t offset = 0; offset < 8; offset++)
+    {
+        for (size_t len = 0; len + offset <= sizeof(data); len++)
+        {
+            assert_int_equal(k_crc8(K_CRC8_INIT, data + offset, len),
+                             ref_crc8(K_CRC8_INIT, data + offset, len));
+            assert_int_equal(k_crc16(K_CRC16_CCITT_INIT, data + offset, len),
+                             ref_crc16(K_CRC16_CCITT_INIT, data + offset, len));
+            assert_int_equal(k_crc32(K_CRC32_INIT, data + offset, len),
+                             ref_crc32(K_CRC32_INIT, data + offset, len));
+        }
+    }
+}
+
+static void test_chained(void ** arg)
+{
+    uint8_t  crc8  = k_crc8(K_CRC8_INIT, check_data, 5);
+    uint16_t crc16 = k_crc16(K_CRC16_CCITT_INIT, check_data, 5);
+    uint32_t crc32 = k_crc32(K_CRC32_INIT, check_data, 5);
+
+    assert_int_equal(k_crc8(crc8, check_data + 5, CHECK_LEN - 5), 0xF4);
+    assert_int_equal(k_crc16(crc16, check_data + 5, CHECK_LEN - 5), 0x29B1);
+    assert_int_equal(k_crc32(crc32, check_data + 5, CHECK_LEN - 5), 0xCBF43926);
+}
+
+static void test_null(void ** arg)
+{
+    assert_int_equal(k_crc8(0x12, NULL, 4), 0x12);
+    assert_int_equal(k_crc16(0x1234, NULL, 4), 0x1234);
+    assert_int_equal(k_crc32(0x12345678, NULL, 4), 0x12345678);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_check_values),
+        cmocka_unit_test(test_generic),
+        cmocka_unit_test(test_match_reference),
+        cmocka_unit_test(test_chained),
+        cmocka_unit_test(test_null),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
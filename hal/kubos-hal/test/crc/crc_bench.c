@@ -0,0 +1,178 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * CRC throughput benchmark
+ *
+ * Compares the table-driven CRCs against the previous iOBC supervisor
+ * implementations (bit-at-a-time, and a byte-at-a-time table which was rebuilt
+ * on every call). Usage: kubos-hal-bench-crc [buffer size] [iterations]
+ */
+
+#include "crc.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CRC8_POLYNOMIAL 0x07
+
+/* Copy of the original supervisor bitwise algorithm */
+static uint8_t old_crc8_bitwise(const uint8_t * data, unsigned int length)
+{
+    uint8_t remainder = 0;
+
+    for (unsigned int i = 0; i < length + 1; i++)
+    {
+        uint8_t byte = (i < length) ? data[i] : 0x00;
+
+        for (uint8_t mask = 0x80; mask; mask >>= 1)
+        {
+            bool xor_flag = remainder & 0x80;
+            remainder     = (uint8_t)(remainder << 1) | ((byte & mask) ? 1 : 0);
+            if (xor_flag)
+            {
+                remainder ^= CRC8_POLYNOMIAL;
+            }
+        }
+    }
+
+    return remainder;
+}
+
+static void old_prepare_table(uint8_t * table)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        uint8_t data = i;
+        table[i]     = old_crc8_bitwise(&data, 1);
+    }
+}
+
+/* The original supervisor_calculate_CRC, which rebuilt its table every call */
+static uint8_t old_crc8_table(const uint8_t * data, unsigned int length)
+{
+    static uint8_t table[256];
+    uint8_t        crc = 0;
+
+    old_prepare_table(table);
+
+    for (unsigned int i = 0; i < length; i++)
+    {
+        crc = table[data[i] ^ crc];
+    }
+
+    return crc;
+}
+
+/* Byte-at-a-time with a table built once, to separate the two effects */
+static uint8_t byte_table[256];
+
+static uint8_t prebuilt_crc8_table(const uint8_t * data, unsigned int length)
+{
+    uint8_t crc = 0;
+
+    for (unsigned int i = 0; i < length; i++)
+    {
+        crc = byte_table[data[i] ^ crc];
+    }
+
+    return crc;
+}
+
+static uint8_t new_crc8(const uint8_t * data, unsigned int length)
+{
+    return k_crc8(K_CRC8_INIT, data, length);
+}
+
+static uint8_t new_crc16(const uint8_t * data, unsigned int length)
+{
+    return (uint8_t) k_crc16(K_CRC16_CCITT_INIT, data, length);
+}
+
+static uint8_t new_crc32(const uint8_t * data, unsigned int length)
+{
+    return (uint8_t) k_crc32(K_CRC32_INIT, data, length);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(const char * name,
+                uint8_t (*func)(const uint8_t *, unsigned int),
+                const uint8_t * data, unsigned int len, int iterations)
+{
+    volatile uint8_t sink = 0;
+    double           start = now();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        sink ^= func(data, len);
+    }
+
+    double elapsed = now() - start;
+
+    printf("%-28s %10.2f MB/s  (%.1f ns/call)\n", name,
+           (double) len * iterations / elapsed / 1e6,
+           elapsed / iterations * 1e9);
+    (void) sink;
+}
+
+int main(int argc, char * argv[])
+{
+    unsigned int len        = (argc > 1) ? atoi(argv[1]) : 4096;
+    int          iterations = (argc > 2) ? atoi(argv[2]) : 2000;
+    uint8_t *    data       = malloc(len);
+
+    if (data == NULL || len == 0 || iterations <= 0)
+    {
+        fprintf(stderr, "Usage: %s [buffer size] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    srand(1);
+    for (unsigned int i = 0; i < len; i++)
+    {
+        data[i] = rand();
+    }
+
+    old_prepare_table(byte_table);
+
+    /* Sanity check that everything agrees before timing anything */
+    if (old_crc8_table(data, len) != new_crc8(data, len)
+        || prebuilt_crc8_table(data, len) != new_crc8(data, len))
+    {
+        fprintf(stderr, "CRC-8 implementations disagree\n");
+        return 1;
+    }
+
+    printf("%u byte buffer, %d iterations\n", len, iterations);
+    run("crc8 bitwise (old)", old_crc8_bitwise, data, len, iterations / 10 + 1);
+    run("crc8 table per call (old)", old_crc8_table, data, len, iterations);
+    run("crc8 byte table", prebuilt_crc8_table, data, len, iterations);
+    run("crc8 slice-by-8", new_crc8, data, len, iterations);
+    run("crc16 slice-by-4", new_crc16, data, len, iterations);
+    run("crc32 slice-by-4", new_crc32, data, len, iterations);
+
+    free(data);
+
+    return 0;
+}
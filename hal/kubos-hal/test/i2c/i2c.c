@@ -20,6 +20,7 @@
 
 #define TEST_I2C "/dev/i2c-1"
 #define TEST_ADDR 0x50
+#define TEST_ADDR_2 0x51
 
 static void test_no_init_write(void ** arg)
 {
@@ -127,7 +128,7 @@ static void test_init_write_read(void ** arg)
     will_return(__wrap_write, 1);
     write_ret = k_i2c_write(i2c_fd, TEST_ADDR, &data, 1);
 
-    will_return(__wrap_ioctl, 0);
+    /* Same slave, so the address shouldn't be programmed again */
     will_return(__wrap_read, 1);
     read_ret = k_i2c_read(i2c_fd, TEST_ADDR, &read, 1);
 
@@ -204,7 +205,7 @@ static void test_init_term_init_write_read(void ** arg)
     will_return(__wrap_write, 1);
     write_ret = k_i2c_write(i2c_fd, TEST_ADDR, &data, 1);
 
-    will_return(__wrap_ioctl, 0);
+    /* Same slave, so the address shouldn't be programmed again */
     will_return(__wrap_read, 1);
     read_ret = k_i2c_read(i2c_fd, TEST_ADDR, &read, 1);
 
@@ -216,6 +217,427 @@ static void test_init_term_init_write_read(void ** arg)
     assert_int_equal(data, read);
 }
 
+static void test_init_write_addr_change(void ** arg)
+{
+    char data = 'A';
+    int i2c_fd;
+
+    will_return(__wrap_open, 1);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    will_return(__wrap_ioctl, 0);
+    will_return(__wrap_write, 1);
+    assert_int_equal(k_i2c_write(i2c_fd, TEST_ADDR, &data, 1), I2C_OK);
+
+    /* A different slave needs the address to be reprogrammed */
+    will_return(__wrap_ioctl, 0);
+    will_return(__wrap_write, 1);
+    assert_int_equal(k_i2c_write(i2c_fd, TEST_ADDR_2, &data, 1), I2C_OK);
+
+    will_return(__wrap_ioctl, 0);
+    will_return(__wrap_write, 1);
+    assert_int_equal(k_i2c_write(i2c_fd, TEST_ADDR, &data, 1), I2C_OK);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+}
+
+static void test_init_write_addr_fail(void ** arg)
+{
+    char data = 'A';
+    int i2c_fd;
+
+    will_return(__wrap_open, 1);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    will_return(__wrap_ioctl, -1);
+    assert_int_equal(k_i2c_write(i2c_fd, TEST_ADDR, &data, 1),
+                     I2C_ERROR_ADDR_TIMEOUT);
+
+    /* The failed attempt must not be remembered */
+    will_return(__wrap_ioctl, 0);
+    will_return(__wrap_write, 1);
+    assert_int_equal(k_i2c_write(i2c_fd, TEST_ADDR, &data, 1), I2C_OK);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+}
+
+static void test_no_init_transfer(void ** arg)
+{
+    uint8_t cmd = 'A';
+    uint8_t data;
+    int i2c_fd = 0;
+    assert_int_equal(k_i2c_transfer(i2c_fd, TEST_ADDR, &cmd, 1, &data, 1),
+                     I2C_ERROR);
+}
+
+static void test_init_transfer(void ** arg)
+{
+    uint8_t cmd = 'A';
+    uint8_t data;
+    int i2c_fd;
+    int ret;
+
+    will_return(__wrap_open, 1);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    /* Both messages should be sent with a single ioctl */
+    will_return(__wrap_ioctl, 2);
+    ret = k_i2c_transfer(i2c_fd, TEST_ADDR, &cmd, 1, &data, 1);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+
+    assert_int_equal(ret, I2C_OK);
+}
+
+static void test_init_transfer_fail(void ** arg)
+{
+    uint8_t cmd = 'A';
+    uint8_t data;
+    int i2c_fd;
+    int ret;
+
+    will_return(__wrap_open, 1);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    will_return(__wrap_ioctl, -1);
+    ret = k_i2c_transfer(i2c_fd, TEST_ADDR, &cmd, 1, &data, 1);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+
+    assert_int_equal(ret, I2C_ERROR);
+}
+
+static void test_init_transfer_null(void ** arg)
+{
+    uint8_t cmd = 'A';
+    int i2c_fd;
+    int ret;
+
+    will_return(__wrap_open, 1);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    ret = k_i2c_transfer(i2c_fd, TEST_ADDR, &cmd, 1, NULL, 1);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+
+    assert_int_equal(ret, I2C_ERROR);
+}
+
+static void test_no_init_writev(void ** arg)
+{
+    uint8_t cmd = 'A';
+    struct iovec iov = {.iov_base = &cmd, .iov_len = 1 };
+    int i2c_fd = 0;
+
+    assert_int_equal(k_i2c_writev(i2c_fd, TEST_ADDR, &iov, 1), I2C_ERROR);
+}
+
+static void test_init_writev(void ** arg)
+{
+    uint8_t cmd = 'A';
+    char payload[] = "payload";
+    uint8_t data = 0;
+    struct iovec iov[2] = {
+        {.iov_base = &cmd, .iov_len = 1 },
+        {.iov_base = payload, .iov_len = sizeof(payload) }
+    };
+    int i2c_fd;
+    int ret;
+
+    will_return(__wrap_open, 1);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    /* Both pieces go out as one message */
+    will_return(__wrap_ioctl, 0);
+    will_return(__wrap_write, 1 + sizeof(payload));
+    ret = k_i2c_writev(i2c_fd, TEST_ADDR, iov, 2);
+
+    /* The header should lead the message */
+    will_return(__wrap_read, 1);
+    k_i2c_read(i2c_fd, TEST_ADDR, &data, 1);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+
+    assert_int_equal(ret, I2C_OK);
+    assert_int_equal(data, cmd);
+}
+
+static void test_init_writev_too_long(void ** arg)
+{
+    uint8_t cmd = 'A';
+    static uint8_t payload[I2C_MAX_GATHER];
+    struct iovec iov[2] = {
+        {.iov_base = &cmd, .iov_len = 1 },
+        {.iov_base = payload, .iov_len = sizeof(payload) }
+    };
+    int i2c_fd;
+    int ret;
+
+    will_return(__wrap_open, 1);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    ret = k_i2c_writev(i2c_fd, TEST_ADDR, iov, 2);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+
+    assert_int_equal(ret, I2C_ERROR_CONFIG);
+}
+
+static void test_init_writev_null(void ** arg)
+{
+    uint8_t cmd = 'A';
+    struct iovec iov[2] = {
+        {.iov_base = &cmd, .iov_len = 1 },
+        {.iov_base = NULL, .iov_len = 4 }
+    };
+    int i2c_fd;
+    int ret;
+
+    will_return(__wrap_open, 1);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    ret = k_i2c_writev(i2c_fd, TEST_ADDR, iov, 2);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+
+    assert_int_equal(ret, I2C_ERROR);
+}
+
+static void test_init_transferv(void ** arg)
+{
+    uint8_t cmd = 'A';
+    uint8_t payload[4] = { 0 };
+    uint8_t data;
+    struct iovec iov[2] = {
+        {.iov_base = &cmd, .iov_len = 1 },
+        {.iov_base = payload, .iov_len = sizeof(payload) }
+    };
+    int i2c_fd;
+    int ret;
+
+    will_return(__wrap_open, 1);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    will_return(__wrap_ioctl, 2);
+    ret = k_i2c_transferv(i2c_fd, TEST_ADDR, iov, 2, &data, 1);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+
+    assert_int_equal(ret, I2C_OK);
+}
+
+static void test_no_init_batch(void ** arg)
+{
+    uint8_t cmd = 'A';
+    uint8_t data;
+    int i2c_fd = 0;
+    KI2CBatchMsg msg = {
+        .addr = TEST_ADDR, .tx = &cmd, .tx_len = 1, .rx = &data, .rx_len = 1
+    };
+
+    assert_int_equal(k_i2c_batch(i2c_fd, &msg, 1), I2C_ERROR);
+}
+
+static void test_init_batch(void ** arg)
+{
+    uint8_t cmd[2] = { 'A', 'B' };
+    uint8_t data[2] = { 0 };
+    const struct timespec delay = { 0, 1000 };
+    int i2c_fd;
+    int ret;
+
+    KI2CBatchMsg msgs[3] = {
+        /* Combined transfer */
+        {.addr = TEST_ADDR, .tx = &cmd[0], .tx_len = 1, .rx = &data[0], .rx_len = 1 },
+        /* Write, wait, read */
+        {.addr = TEST_ADDR, .tx = &cmd[1], .tx_len = 1, .rx = &data[1], .rx_len = 1,
+         .delay = &delay },
+        /* Wait only */
+        {.addr = TEST_ADDR, .delay = &delay }
+    };
+
+    will_return(__wrap_open, 1);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    will_return(__wrap_ioctl, 2);
+    will_return(__wrap_ioctl, 0);
+    will_return(__wrap_write, 1);
+    will_return(__wrap_read, 1);
+    ret = k_i2c_batch(i2c_fd, msgs, 3);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+
+    assert_int_equal(ret, I2C_OK);
+    assert_int_equal(msgs[0].status, I2C_OK);
+    assert_int_equal(msgs[1].status, I2C_OK);
+    assert_int_equal(msgs[2].status, I2C_OK);
+    assert_int_equal(data[1], cmd[1]);
+
+    /* Each message is stamped as it finishes */
+    assert_true(msgs[0].done.tv_sec != 0 || msgs[0].done.tv_nsec != 0);
+    assert_true(msgs[2].done.tv_sec > msgs[0].done.tv_sec
+                || (msgs[2].done.tv_sec == msgs[0].done.tv_sec
+                    && msgs[2].done.tv_nsec >= msgs[0].done.tv_nsec));
+}
+
+static void test_init_batch_partial_fail(void ** arg)
+{
+    uint8_t cmd = 'A';
+    uint8_t data[2] = { 0 };
+    int i2c_fd;
+    int ret;
+
+    KI2CBatchMsg msgs[2] = {
+        {.addr = TEST_ADDR, .tx = &cmd, .tx_len = 1, .rx = &data[0], .rx_len = 1 },
+        {.addr = TEST_ADDR, .tx = &cmd, .tx_len = 1, .rx = &data[1], .rx_len = 1 }
+    };
+
+    will_return(__wrap_open, 1);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    /* The first message fails, but the second should still be attempted */
+    will_return(__wrap_ioctl, -1);
+    will_return(__wrap_ioctl, 2);
+    ret = k_i2c_batch(i2c_fd, msgs, 2);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+
+    assert_int_equal(ret, I2C_ERROR);
+    assert_int_equal(msgs[0].status, I2C_ERROR);
+    assert_int_equal(msgs[1].status, I2C_OK);
+}
+
+/* Holds the bus for a while with a wait-only batch message */
+static void * hold_bus(void * arg)
+{
+    static const struct timespec hold = {.tv_sec = 0, .tv_nsec = 100000000 };
+    KI2CBatchMsg msg = {.addr = TEST_ADDR, .delay = &hold };
+
+    k_i2c_batch(*(int *) arg, &msg, 1);
+
+    return NULL;
+}
+
+static void test_init_shared_bus(void ** arg)
+{
+    static const struct timespec settle = {.tv_sec = 0, .tv_nsec = 20000000 };
+    const struct timespec timeout = {.tv_sec = 0, .tv_nsec = 10000000 };
+    char          data = 'A';
+    int           first, second;
+    pthread_t     holder;
+    KArbiterStats stats;
+    int           ret;
+
+    /* Two drivers open the same bus separately */
+    will_return(__wrap_open, 5);
+    k_i2c_init(TEST_I2C, &first);
+    will_return(__wrap_open, 6);
+    k_i2c_init(TEST_I2C, &second);
+
+    assert_int_equal(k_i2c_set_arbitration(second, 0, &timeout), I2C_OK);
+
+    /* While the first connection holds the bus, the second can't use it */
+    pthread_create(&holder, NULL, hold_bus, &first);
+    nanosleep(&settle, NULL);
+    ret = k_i2c_write(second, TEST_ADDR, &data, 1);
+    pthread_join(holder, NULL);
+
+    assert_int_equal(ret, I2C_ERROR_TIMEOUT);
+    assert_int_equal(k_i2c_get_arbitration_stats(second, &stats), I2C_OK);
+    assert_int_equal(stats.timeouts, 1);
+    assert_int_equal(stats.acquired, 0);
+
+    /* Once it's free again, the write goes through */
+    will_return(__wrap_ioctl, 0);
+    will_return(__wrap_write, 1);
+    assert_int_equal(k_i2c_write(second, TEST_ADDR, &data, 1), I2C_OK);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&first);
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&second);
+
+    /* Closed connections are forgotten */
+    assert_int_equal(k_i2c_set_arbitration(6, 0, NULL), I2C_ERROR);
+    assert_int_equal(k_i2c_get_arbitration_stats(5, &stats), I2C_ERROR);
+    assert_int_equal(k_i2c_get_arbitration_stats(0, &stats), I2C_ERROR);
+}
+
+static void test_init_terminate_in_use(void ** arg)
+{
+    static const struct timespec settle = {.tv_sec = 0, .tv_nsec = 20000000 };
+    struct timespec start, end;
+    int             i2c_fd;
+    pthread_t       holder;
+    long            waited_ms;
+
+    will_return(__wrap_open, 8);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    /* Closing the connection waits for the transaction using it to finish */
+    pthread_create(&holder, NULL, hold_bus, &i2c_fd);
+    nanosleep(&settle, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    pthread_join(holder, NULL);
+
+    waited_ms = (end.tv_sec - start.tv_sec) * 1000
+                + (end.tv_nsec - start.tv_nsec) / 1000000;
+    assert_true(waited_ms >= 50);
+    assert_int_equal(k_i2c_set_arbitration(8, 0, NULL), I2C_ERROR);
+}
+
+static void test_init_batch_request(void ** arg)
+{
+    const struct timespec delay = { 0, 1000 };
+    struct timespec       deadline;
+    KArbiterStats         stats;
+    int                   i2c_fd;
+    int                   ret;
+
+    KI2CBatchMsg msgs[2] = {
+        {.addr = TEST_ADDR, .delay = &delay },
+        /* Nobody else is waiting, so this doesn't give up the bus */
+        {.addr = TEST_ADDR, .delay = &delay, .yield = true }
+    };
+
+    /* Already too late */
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    const KArbiterRequest request
+        = {.priority = ARBITER_CONTROL, .deadline = &deadline };
+
+    will_return(__wrap_open, 7);
+    k_i2c_init(TEST_I2C, &i2c_fd);
+
+    ret = k_i2c_batch_request(i2c_fd, &request, msgs, 2);
+    assert_int_equal(k_i2c_get_arbitration_stats(i2c_fd, &stats), I2C_OK);
+
+    will_return(__wrap_close, 0);
+    k_i2c_terminate(&i2c_fd);
+
+    assert_int_equal(ret, I2C_OK);
+    assert_int_equal(msgs[0].status, I2C_OK);
+    assert_int_equal(msgs[1].status, I2C_OK);
+    assert_int_equal(stats.acquired, 1);
+    assert_int_equal(stats.deadline_misses, 1);
+    assert_int_equal(stats.preemptions, 0);
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
@@ -230,6 +652,23 @@ int main(void)
             cmocka_unit_test(test_init_term_read),
             cmocka_unit_test(test_init_term_write_read),
             cmocka_unit_test(test_init_term_init_write_read),
+            cmocka_unit_test(test_init_write_addr_change),
+            cmocka_unit_test(test_init_write_addr_fail),
+            cmocka_unit_test(test_no_init_transfer),
+            cmocka_unit_test(test_init_transfer),
+            cmocka_unit_test(test_init_transfer_fail),
+            cmocka_unit_test(test_init_transfer_null),
+            cmocka_unit_test(test_no_init_writev),
+            cmocka_unit_test(test_init_writev),
+            cmocka_unit_test(test_init_writev_too_long),
+            cmocka_unit_test(test_init_writev_null),
+            cmocka_unit_test(test_init_transferv),
+            cmocka_unit_test(test_no_init_batch),
+            cmocka_unit_test(test_init_batch),
+            cmocka_unit_test(test_init_batch_partial_fail),
+            cmocka_unit_test(test_init_shared_bus),
+            cmocka_unit_test(test_init_batch_request),
+            cmocka_unit_test(test_init_terminate_in_use),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
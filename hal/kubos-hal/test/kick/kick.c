@@ -0,0 +1,191 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmocka.h>
+#include <stdint.h>
+#include "kick.h"
+
+#define MAX_KICKS 16
+
+/* Record of the times a kick was run */
+typedef struct {
+    int             count;
+    struct timespec at[MAX_KICKS];
+} kick_log;
+
+static void record_kick(void * arg)
+{
+    kick_log *      log = arg;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (log->count < MAX_KICKS)
+    {
+        log->at[log->count] = now;
+    }
+    log->count++;
+}
+
+static int64_t ms_between(const struct timespec * start,
+                          const struct timespec * end)
+{
+    return ((int64_t)(end->tv_sec - start->tv_sec) * 1000000000
+            + (end->tv_nsec - start->tv_nsec))
+           / 1000000;
+}
+
+static void wait_ms(long ms)
+{
+    const struct timespec delay
+        = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000 };
+    nanosleep(&delay, NULL);
+}
+
+static void test_bad_args(void ** arg)
+{
+    KKick no_func   = {.period = {.tv_sec = 1 } };
+    KKick no_period = {.func = record_kick };
+
+    assert_false(k_kick_register(NULL));
+    assert_false(k_kick_register(&no_func));
+    assert_false(k_kick_register(&no_period));
+    assert_false(k_kick_unregister(NULL));
+    assert_false(k_kick_unregister(&no_period));
+    assert_false(k_kick_is_registered(NULL));
+}
+
+static void test_periodic(void ** arg)
+{
+    kick_log log  = { 0 };
+    KKick    kick = {.func   = record_kick,
+                     .arg    = &log,
+                     .period = {.tv_sec = 0, .tv_nsec = 10000000 } };
+    int      count;
+
+    assert_true(k_kick_register(&kick));
+    assert_true(k_kick_is_registered(&kick));
+
+    /* Kicked straight away, and then once every period */
+    wait_ms(55);
+    assert_true(k_kick_unregister(&kick));
+    assert_false(k_kick_is_registered(&kick));
+
+    count = log.count;
+    assert_true(count >= 3);
+    assert_true(count <= 7);
+    for (int i = 1; i < count; i++)
+    {
+        assert_true(ms_between(&log.at[i - 1], &log.at[i]) >= 8);
+    }
+
+    /* No more kicks once it's unregistered */
+    wait_ms(25);
+    assert_int_equal(log.count, count);
+    assert_false(k_kick_unregister(&kick));
+}
+
+static void test_coalesce(void ** arg)
+{
+    kick_log first_log  = { 0 };
+    kick_log second_log = { 0 };
+    KKick    first      = {.func   = record_kick,
+                           .arg    = &first_log,
+                           .period = {.tv_sec = 0, .tv_nsec = 40000000 } };
+    KKick    second     = {.func   = record_kick,
+                           .arg    = &second_log,
+                           .period = {.tv_sec = 0, .tv_nsec = 45000000 } };
+
+    assert_true(k_kick_register(&first));
+    assert_true(k_kick_register(&second));
+
+    wait_ms(60);
+
+    assert_true(k_kick_unregister(&first));
+    assert_true(k_kick_unregister(&second));
+
+    assert_true(first_log.count >= 2);
+    assert_true(second_log.count >= 2);
+
+    /* The second kick was run early, along with the first */
+    assert_true(ms_between(&second_log.at[0], &second_log.at[1]) < 45);
+    assert_true(ms_between(&first_log.at[1], &second_log.at[1]) < 2);
+}
+
+static void test_restart(void ** arg)
+{
+    kick_log log  = { 0 };
+    KKick    kick = {.func   = record_kick,
+                     .arg    = &log,
+                     .period = {.tv_sec = 1, .tv_nsec = 0 } };
+
+    /* The scheduler thread stops with the last kick, and starts again */
+    for (int i = 0; i < 3; i++)
+    {
+        assert_true(k_kick_register(&kick));
+        wait_ms(5);
+        assert_true(k_kick_unregister(&kick));
+    }
+
+    assert_int_equal(log.count, 3);
+}
+
+/* A kick which unregisters itself once it has run enough times */
+typedef struct {
+    KKick kick;
+    int   left;
+} counted_kick;
+
+static void kick_and_count(void * arg)
+{
+    counted_kick * self = arg;
+
+    if (--self->left == 0)
+    {
+        assert_true(k_kick_unregister(&self->kick));
+    }
+}
+
+static void test_unregister_self(void ** arg)
+{
+    counted_kick counted = {.kick = {.func   = kick_and_count,
+                                     .period = {.tv_sec = 0, .tv_nsec = 1000000 } },
+                            .left = 2 };
+    counted.kick.arg = &counted;
+
+    assert_true(k_kick_register(&counted.kick));
+    wait_ms(20);
+
+    assert_false(k_kick_is_registered(&counted.kick));
+    assert_int_equal(counted.left, 0);
+
+    /* The scheduler is still usable afterwards */
+    assert_true(k_kick_register(&counted.kick));
+    assert_true(k_kick_unregister(&counted.kick));
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_bad_args),
+        cmocka_unit_test(test_periodic),
+        cmocka_unit_test(test_coalesce),
+        cmocka_unit_test(test_restart),
+        cmocka_unit_test(test_unregister_self),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
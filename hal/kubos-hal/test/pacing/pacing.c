@@ -0,0 +1,126 @@
+/*
+ * KubOS HAL
+ * Copyright (C) 2018 Kubos Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmocka.h>
+#include <stdint.h>
+#include "pacing.h"
+
+#define TEST_GAP_NS 5000000L
+
+static const struct timespec test_gap = {.tv_sec = 0, .tv_nsec = TEST_GAP_NS };
+
+/* Nanoseconds elapsed since a starting time */
+static int64_t elapsed_ns(const struct timespec * start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t)(now.tv_sec - start->tv_sec) * 1000000000L
+           + (now.tv_nsec - start->tv_nsec);
+}
+
+static void test_get_set_gap(void ** arg)
+{
+    KPacer pacer;
+    struct timespec gap;
+    const struct timespec new_gap = {.tv_sec = 1, .tv_nsec = 5 };
+
+    k_pacer_init(&pacer, &test_gap);
+    k_pacer_get_gap(&pacer, &gap);
+    assert_int_equal(gap.tv_sec, test_gap.tv_sec);
+    assert_int_equal(gap.tv_nsec, test_gap.tv_nsec);
+
+    k_pacer_set_gap(&pacer, &new_gap);
+    k_pacer_get_gap(&pacer, &gap);
+    assert_int_equal(gap.tv_sec, new_gap.tv_sec);
+    assert_int_equal(gap.tv_nsec, new_gap.tv_nsec);
+
+    k_pacer_set_gap(&pacer, NULL);
+    k_pacer_get_gap(&pacer, &gap);
+    assert_int_equal(gap.tv_sec, 0);
+    assert_int_equal(gap.tv_nsec, 0);
+}
+
+static void test_wait_first(void ** arg)
+{
+    KPacer pacer;
+    struct timespec start;
+
+    k_pacer_init(&pacer, &test_gap);
+
+    /* Nothing has happened yet, so there should be nothing to wait for */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    k_pacer_wait(&pacer);
+    assert_true(elapsed_ns(&start) < TEST_GAP_NS);
+}
+
+static void test_wait_after_mark(void ** arg)
+{
+    KPacer pacer;
+    struct timespec start;
+
+    k_pacer_init(&pacer, &test_gap);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    k_pacer_mark(&pacer);
+    k_pacer_wait(&pacer);
+    assert_true(elapsed_ns(&start) >= TEST_GAP_NS);
+}
+
+static void test_wait_elapsed(void ** arg)
+{
+    KPacer pacer;
+    struct timespec start;
+    const struct timespec pause = {.tv_sec = 0, .tv_nsec = TEST_GAP_NS };
+
+    k_pacer_init(&pacer, &test_gap);
+    k_pacer_mark(&pacer);
+
+    /* The gap is already used up by other work, so don't sleep again */
+    nanosleep(&pause, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    k_pacer_wait(&pacer);
+    assert_true(elapsed_ns(&start) < TEST_GAP_NS);
+}
+
+static void test_wait_gap(void ** arg)
+{
+    KPacer pacer;
+    struct timespec start;
+    const struct timespec long_gap = {.tv_sec = 0, .tv_nsec = 2 * TEST_GAP_NS };
+
+    k_pacer_init(&pacer, &test_gap);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    k_pacer_mark(&pacer);
+    k_pacer_wait_gap(&pacer, &long_gap);
+    assert_true(elapsed_ns(&start) >= 2 * TEST_GAP_NS);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_get_set_gap),
+        cmocka_unit_test(test_wait_first),
+        cmocka_unit_test(test_wait_after_mark),
+        cmocka_unit_test(test_wait_elapsed),
+        cmocka_unit_test(test_wait_gap),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}